@@ -1,8 +1,21 @@
 #include "CodeGenerator.h"
-#include "../model/FSM.h"
-#include "../model/State.h"
-#include "../model/Transition.h"
 #include <QTextStream>
+#include <QtConcurrent>
+#include <atomic>
+
+namespace {
+
+// Fewer dirty states than this are generated on the calling thread
+constexpr int ParallelThreshold = 64;
+// Dirty states per task; a state class is a few hundred bytes of text
+constexpr int ChunkSize = 32;
+
+struct Range {
+    int begin;
+    int end;
+};
+
+} // namespace
 
 CodeGenerator::CodeGenerator(QObject *parent)
     : QObject(parent)
@@ -15,35 +28,146 @@ CodeGenerator::~CodeGenerator()
 
 QString CodeGenerator::generate(const FSM *fsm)
 {
-    if (!fsm || fsm->states().isEmpty()) {
+    return generate(CodeSnapshot::capture(fsm));
+}
+
+QString CodeGenerator::generate(const CodeSnapshot &snapshot,
+                                const std::function<bool()> &isCanceled)
+{
+    if (snapshot.isEmpty()) {
         return "// Error: No FSM or states to generate";
     }
-    
+
+    QString fsmName = snapshot.name().isEmpty() ? "MyFSM" : snapshot.name();
+    const QVector<CodeSnapshot::StateData> &states = snapshot.states();
+
+    // Look up every state in the cache; a state's fragment only depends on
+    // the FSM name, the state and its outgoing transitions
+    const size_t seed = qHash(fsmName);
+    QVector<size_t> keys(states.size());
+    QVector<QString> fragments(states.size());
+    QVector<int> dirty;
+    for (int i = 0; i < states.size(); ++i) {
+        if (isCanceled && isCanceled()) {
+            return QString();
+        }
+        keys[i] = qHash(states[i], seed);
+        auto cached = m_stateFragments.constFind(keys[i]);
+        if (cached != m_stateFragments.constEnd() &&
+            cached->fsmName == fsmName && cached->state == states[i]) {
+            fragments[i] = cached->code;
+        } else {
+            dirty.append(i);
+        }
+    }
+
+    // Each dirty state writes its own slot of the pre-sized buffer, so the
+    // join below sees the same order however the work was split
+    QString *out = fragments.data();
+    const int *dirtyIndex = dirty.constData();
+    const int dirtyCount = int(dirty.size());
+    std::atomic<bool> canceled{false};
+    auto generateRange = [&](const Range &range) {
+        for (int d = range.begin; d < range.end; ++d) {
+            if (canceled.load(std::memory_order_relaxed)) {
+                return;
+            }
+            if (isCanceled && isCanceled()) {
+                canceled.store(true, std::memory_order_relaxed);
+                return;
+            }
+            const int i = dirtyIndex[d];
+            out[i] = stateFragment(states[i], fsmName);
+        }
+    };
+    if (m_parallel && dirtyCount >= ParallelThreshold) {
+        QVector<Range> chunks;
+        for (int begin = 0; begin < dirtyCount; begin += ChunkSize) {
+            chunks.append(Range{begin, qMin(begin + ChunkSize, dirtyCount)});
+        }
+        QtConcurrent::blockingMap(chunks, generateRange);
+    } else {
+        generateRange(Range{0, dirtyCount});
+    }
+    if (canceled) {
+        return QString();
+    }
+    m_regeneratedFragments = dirtyCount;
+
+    // Keep only the fragments of this run, so deleted and edited states do
+    // not pile up in the cache
+    QHash<size_t, StateFragment> used;
+    used.reserve(states.size());
+    for (int i = 0; i < states.size(); ++i) {
+        used.insert(keys[i], {fsmName, states[i], fragments[i]});
+    }
+    m_stateFragments = used;
+
+    if (m_headerKey != fsmName) {
+        m_header = headerFragment(fsmName);
+        m_headerKey = fsmName;
+    }
+
+    QStringList contextKey{fsmName};
+    if (snapshot.initialState() >= 0) {
+        contextKey.append(states[snapshot.initialState()].name);
+    }
+    if (m_contextKey != contextKey) {
+        m_context = contextFragment(
+            fsmName, contextKey.size() > 1 ? &contextKey[1] : nullptr);
+        m_contextKey = contextKey;
+    }
+
+    qsizetype length = m_header.size() + m_context.size();
+    for (const QString &fragment : fragments) {
+        length += fragment.size();
+    }
+    QString code;
+    code.reserve(length);
+    code += m_header;
+    for (const QString &fragment : fragments) {
+        code += fragment;
+    }
+    code += m_context;
+    return code;
+}
+
+void CodeGenerator::clearCache()
+{
+    m_stateFragments.clear();
+    m_headerKey.clear();
+    m_header.clear();
+    m_contextKey.clear();
+    m_context.clear();
+    m_regeneratedFragments = 0;
+}
+
+QString CodeGenerator::headerFragment(const QString &fsmName)
+{
     QString code;
     QTextStream out(&code);
-    
-    QString fsmName = fsm->name().isEmpty() ? "MyFSM" : fsm->name();
+
     QString baseStateName = fsmName + "StateBase";
     QString contextName = fsmName + "Context";
-    
+
     // Header comment
     out << "// Auto-generated FSM Code - " << fsmName << "\n";
     out << "// Generated by QtFSM Designer\n\n";
-    
+
     // Includes
     out << "#include <memory>\n";
     out << "#include <string>\n\n";
-    
+
     // Event structure
     out << "// Event structure\n";
     out << "struct Event {\n";
     out << "    std::string type;\n";
     out << "    // Add your event data here\n";
     out << "};\n\n";
-    
+
     // Forward declaration
     out << "class " << contextName << ";\n\n";
-    
+
     // Base State class
     out << "// Base State class\n";
     out << "class " << baseStateName << " {\n";
@@ -54,64 +178,85 @@ QString CodeGenerator::generate(const FSM *fsm)
     out << "    virtual " << baseStateName << "* handle(" << contextName << "* context, const Event& event) = 0;\n";
     out << "    virtual std::string getName() const = 0;\n";
     out << "};\n\n";
-    
-    // Generate concrete state classes
-    for (State *state : fsm->states()) {
-        QString stateName = sanitizeName(state->name());
-        QString className = stateName + "State";
-        
-        out << "// " << stateName << " State\n";
-        out << "class " << className << " : public " << baseStateName << " {\n";
-        out << "public:\n";
-        out << "    void onEntry(" << contextName << "* context) override {\n";
-        if (!state->entryAction().isEmpty()) {
-            out << "        " << state->entryAction() << "\n";
-        } else {
-            out << "        // Entry action for " << stateName << "\n";
-        }
-        out << "    }\n\n";
-        
-        out << "    void onExit(" << contextName << "* context) override {\n";
-        if (!state->exitAction().isEmpty()) {
-            out << "        " << state->exitAction() << "\n";
-        } else {
-            out << "        // Exit action for " << stateName << "\n";
-        }
-        out << "    }\n\n";
-        
-        out << "    " << baseStateName << "* handle(" << contextName << "* context, const Event& event) override {\n";
-        
-        // Find transitions from this state
-        // Use state->transitions() directly as we updated the model to support it
-        // previous logic relied on FSM::transitions() which might be empty if not strictly maintained
-        if (!state->transitions().isEmpty()) {
-            for (Transition *trans : state->transitions()) {
-                QString targetName = sanitizeName(trans->targetState()->name());
-                QString eventName = trans->event().isEmpty() ? "EVENT" : trans->event();
-                
-                out << "        if (event.type == \"" << eventName << "\"";
-                if (!trans->guard().isEmpty()) {
-                    out << " && " << trans->guard();
-                }
-                out << ") {\n";
-                
-                if (!trans->action().isEmpty()) {
-                    out << "            " << trans->action() << "\n";
-                }
-                out << "            return new " << targetName << "State();\n";
-                out << "        }\n";
+
+    out.flush();
+    return code;
+}
+
+QString CodeGenerator::stateFragment(const CodeSnapshot::StateData &state,
+                                     const QString &fsmName)
+{
+    QString code;
+    QTextStream out(&code);
+
+    QString baseStateName = fsmName + "StateBase";
+    QString contextName = fsmName + "Context";
+    QString stateName = sanitizeName(state.name);
+    QString className = stateName + "State";
+
+    out << "// " << stateName << " State\n";
+    out << "class " << className << " : public " << baseStateName << " {\n";
+    out << "public:\n";
+    out << "    void onEntry(" << contextName << "* context) override {\n";
+    if (!state.entryAction.isEmpty()) {
+        out << "        " << state.entryAction << "\n";
+    } else {
+        out << "        // Entry action for " << stateName << "\n";
+    }
+    out << "    }\n\n";
+
+    out << "    void onExit(" << contextName << "* context) override {\n";
+    if (!state.exitAction.isEmpty()) {
+        out << "        " << state.exitAction << "\n";
+    } else {
+        out << "        // Exit action for " << stateName << "\n";
+    }
+    out << "    }\n\n";
+
+    out << "    " << baseStateName << "* handle(" << contextName << "* context, const Event& event) override {\n";
+
+    // Transitions from this state: the snapshot copies state->transitions(),
+    // since FSM::transitions() might be empty if not strictly maintained
+    if (!state.transitions.isEmpty()) {
+        for (const CodeSnapshot::TransitionData &trans : state.transitions) {
+            QString targetName = sanitizeName(trans.targetName);
+            QString eventName = trans.event.isEmpty() ? "EVENT" : trans.event;
+
+            out << "        if (event.type == \"" << eventName << "\"";
+            if (!trans.guard.isEmpty()) {
+                out << " && " << trans.guard;
             }
-        } else {
-            out << "        // No transitions defined\n";
+            out << ") {\n";
+
+            if (!trans.action.isEmpty()) {
+                out << "            " << trans.action << "\n";
+            }
+            out << "            return new " << targetName << "State();\n";
+            out << "        }\n";
         }
-        
-        out << "        return nullptr; // Stay in current state\n";
-        out << "    }\n\n";
-        
-        out << "    std::string getName() const override { return \"" << stateName << "\"; }\n";
-        out << "};\n\n";
+    } else {
+        out << "        // No transitions defined\n";
     }
-    
+
+    out << "        return nullptr; // Stay in current state\n";
+    out << "    }\n\n";
+
+    out << "    std::string getName() const override { return \"" << stateName << "\"; }\n";
+    out << "};\n\n";
+
+    out.flush();
+    return code;
+}
+
+QString CodeGenerator::contextFragment(const QString &fsmName,
+                                       const QString *initialStateName)
+{
+    QString code;
+    QTextStream out(&code);
+
+    QString baseStateName = fsmName + "StateBase";
+    QString contextName = fsmName + "Context";
+
     // FSM Context class
     out << "// FSM Context Manager\n";
     out << "class " << contextName << " {\n";
@@ -119,21 +264,21 @@ QString CodeGenerator::generate(const FSM *fsm)
     out << "    " << baseStateName << "* currentState;\n\n";
     out << "public:\n";
     out << "    " << contextName << "() {\n";
-    
+
     // Set initial state
-    if (fsm->initialState()) {
-        QString initialName = sanitizeName(fsm->initialState()->name());
+    if (initialStateName) {
+        QString initialName = sanitizeName(*initialStateName);
         out << "        currentState = new " << initialName << "State();\n";
         out << "        currentState->onEntry(this);\n";
     } else {
         out << "        currentState = nullptr;\n";
     }
     out << "    }\n\n";
-    
+
     out << "    ~" << contextName << "() {\n";
     out << "        delete currentState;\n";
     out << "    }\n\n";
-    
+
     out << "    void processEvent(const Event& event) {\n";
     out << "        if (currentState) {\n";
     out << "            " << baseStateName << "* newState = currentState->handle(this, event);\n";
@@ -145,18 +290,19 @@ QString CodeGenerator::generate(const FSM *fsm)
     out << "            }\n";
     out << "        }\n";
     out << "    }\n\n";
-    
+
     out << "    std::string getCurrentStateName() const {\n";
     out << "        return currentState ? currentState->getName() : \"None\";\n";
     out << "    }\n";
     out << "};\n\n";
-    
+
     // Usage example
     out << "// Usage Example:\n";
     out << "// " << contextName << " fsm;\n";
     out << "// Event evt{\"EVENT_NAME\"};\n";
     out << "// fsm.processEvent(evt);\n";
-    
+
+    out.flush();
     return code;
 }
 
@@ -1,8 +1,12 @@
 #ifndef CODEGENERATOR_H
 #define CODEGENERATOR_H
 
+#include "CodeSnapshot.h"
+#include <QHash>
 #include <QObject>
 #include <QString>
+#include <QStringList>
+#include <functional>
 
 class FSM;
 
@@ -15,6 +19,16 @@ class FSM;
  * the header and source code (returned as a single string or managed
  * otherwise).
  *
+ * The code of each state class, of the context class and of the common
+ * header is cached. Generating again only rebuilds the fragments whose
+ * inputs changed, looked up by a content hash of the state and its outgoing
+ * transitions, and joins them with the cached rest. Keep one generator
+ * around for repeated generation of the same FSM.
+ *
+ * When many state classes have to be rebuilt, they are generated in parallel
+ * on the global thread pool. The output does not depend on that: it is the
+ * same, byte for byte, as when generating on one thread.
+ *
  * @ingroup Codegen
  */
 class CodeGenerator : public QObject {
@@ -40,14 +54,63 @@ public:
    */
   QString generate(const FSM *fsm);
 
+  /**
+   * @brief Generates the C++ code for a captured FSM.
+   *
+   * Reads nothing but the snapshot and the fragment cache, so it may run on
+   * any thread as long as calls on one generator do not overlap.
+   * @param snapshot The FSM contents, see CodeSnapshot::capture().
+   * @param isCanceled Checked between states, possibly from several
+   * threads at once; when it returns true, generation stops and an empty
+   * string is returned.
+   * @return The generated code, the same as generate(const FSM *) gives.
+   */
+  QString generate(const CodeSnapshot &snapshot,
+                   const std::function<bool()> &isCanceled = {});
+
+  /**
+   * @brief Drops all cached fragments.
+   */
+  void clearCache();
+
+  /**
+   * @brief Enables or disables generating state classes in parallel.
+   * Enabled by default; the output is the same either way.
+   */
+  void setParallel(bool enabled) { m_parallel = enabled; }
+
+  /// Number of state classes the last generate() call had to rebuild
+  int regeneratedFragments() const { return m_regeneratedFragments; }
+
 private:
+  struct StateFragment {
+    QString fsmName;
+    CodeSnapshot::StateData state; ///< Compared on lookup to rule out collisions
+    QString code;
+  };
+
+  static QString headerFragment(const QString &fsmName);
+  static QString stateFragment(const CodeSnapshot::StateData &state,
+                               const QString &fsmName);
+  /// @param initialStateName Name of the initial state, or nullptr
+  static QString contextFragment(const QString &fsmName,
+                                 const QString *initialStateName);
+
   /**
    * @brief Sanitizes a string to ensure it is a valid C++ identifier.
    * Removes spaces, special characters, etc.
    * @param name The raw name.
    * @return The sanitized identifier.
    */
-  QString sanitizeName(const QString &name);
+  static QString sanitizeName(const QString &name);
+
+  QHash<size_t, StateFragment> m_stateFragments;
+  QString m_headerKey; ///< FSM name the cached header was generated for
+  QString m_header;
+  QStringList m_contextKey; ///< FSM name and initial state name, if any
+  QString m_context;
+  int m_regeneratedFragments = 0;
+  bool m_parallel = true;
 };
 
 #endif // CODEGENERATOR_H
@@ -0,0 +1,62 @@
+#include "CodeSnapshot.h"
+#include "../model/FSM.h"
+#include "../model/State.h"
+#include "../model/Transition.h"
+
+bool CodeSnapshot::TransitionData::operator==(
+    const TransitionData &other) const {
+  return targetName == other.targetName && event == other.event &&
+         guard == other.guard && action == other.action;
+}
+
+bool CodeSnapshot::StateData::operator==(const StateData &other) const {
+  return name == other.name && entryAction == other.entryAction &&
+         exitAction == other.exitAction && transitions == other.transitions;
+}
+
+size_t qHash(const CodeSnapshot::TransitionData &transition, size_t seed) {
+  return qHashMulti(seed, transition.targetName, transition.event,
+                    transition.guard, transition.action);
+}
+
+size_t qHash(const CodeSnapshot::StateData &state, size_t seed) {
+  return qHashMulti(seed, state.name, state.entryAction, state.exitAction,
+                    qHashRange(state.transitions.cbegin(),
+                               state.transitions.cend(), seed));
+}
+
+CodeSnapshot CodeSnapshot::capture(const FSM *fsm) {
+  CodeSnapshot snapshot;
+  if (!fsm) {
+    return snapshot;
+  }
+
+  snapshot.m_name = fsm->name();
+  const QList<State *> states = fsm->states();
+  snapshot.m_states.reserve(states.size());
+  for (const State *state : states) {
+    if (state == fsm->initialState()) {
+      snapshot.m_initialState = snapshot.m_states.size();
+    }
+
+    StateData data;
+    data.name = state->name();
+    data.entryAction = state->entryAction();
+    data.exitAction = state->exitAction();
+    const QList<Transition *> transitions = state->transitions();
+    data.transitions.reserve(transitions.size());
+    for (const Transition *transition : transitions) {
+      if (!transition->targetState()) {
+        continue;
+      }
+      TransitionData t;
+      t.targetName = transition->targetState()->name();
+      t.event = transition->event();
+      t.guard = transition->guard();
+      t.action = transition->action();
+      data.transitions.append(t);
+    }
+    snapshot.m_states.append(data);
+  }
+  return snapshot;
+}
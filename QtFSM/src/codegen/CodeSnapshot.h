@@ -0,0 +1,66 @@
+#ifndef CODESNAPSHOT_H
+#define CODESNAPSHOT_H
+
+#include <QHashFunctions>
+#include <QString>
+#include <QVector>
+
+class FSM;
+
+/**
+ * @brief Immutable copy of the parts of an FSM that the generated code
+ * depends on.
+ *
+ * Like @ref FSMSnapshot it holds plain, implicitly shared values, so it is
+ * cheap to capture on the GUI thread and safe to generate from on a worker
+ * thread while the user keeps editing. Unlike FSMSnapshot it keeps each
+ * state's own list of outgoing transitions and the FSM's initial state,
+ * which is exactly what @ref CodeGenerator reads.
+ *
+ * @ingroup Codegen
+ */
+class CodeSnapshot {
+public:
+  struct TransitionData {
+    QString targetName;
+    QString event;
+    QString guard;
+    QString action;
+
+    bool operator==(const TransitionData &other) const;
+  };
+
+  struct StateData {
+    QString name;
+    QString entryAction;
+    QString exitAction;
+    QVector<TransitionData> transitions; ///< Outgoing, in the state's order
+
+    bool operator==(const StateData &other) const;
+  };
+
+  /**
+   * @brief Copies what the generator needs from an FSM. Must be called on
+   * the thread that owns the FSM.
+   * @param fsm The FSM to copy; nullptr gives an empty snapshot.
+   */
+  static CodeSnapshot capture(const FSM *fsm);
+
+  QString name() const { return m_name; }
+  const QVector<StateData> &states() const { return m_states; }
+  /// Index of the initial state in states(), or -1
+  int initialState() const { return m_initialState; }
+  bool isEmpty() const { return m_states.isEmpty(); }
+
+private:
+  QString m_name;
+  QVector<StateData> m_states;
+  int m_initialState = -1;
+};
+
+/// Content hash of a transition, for caching generated code
+size_t qHash(const CodeSnapshot::TransitionData &transition, size_t seed = 0);
+/// Content hash of a state and its outgoing transitions
+size_t qHash(const CodeSnapshot::StateData &state, size_t seed = 0);
+
+#endif // CODESNAPSHOT_H
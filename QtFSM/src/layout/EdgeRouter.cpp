@@ -0,0 +1,504 @@
+#include "EdgeRouter.h"
+#include "../model/Transition.h"
+#include <QSet>
+#include <QtMath>
+#include <algorithm>
+#include <limits>
+#include <queue>
+
+namespace {
+// Extra cost of a bend, in scene units; favours routes with few corners
+constexpr qreal BendCost = 60;
+
+// Liang-Barsky: the part of the segment p-q inside rect, as parameters
+// 0 <= t0 <= t1 <= 1 along the segment
+bool clipSegment(const QPointF &p, const QPointF &q, const QRectF &rect,
+                 qreal *t0, qreal *t1) {
+  const qreal dx = q.x() - p.x();
+  const qreal dy = q.y() - p.y();
+  const qreal dirs[4] = {-dx, dx, -dy, dy};
+  const qreal dists[4] = {p.x() - rect.left(), rect.right() - p.x(),
+                          p.y() - rect.top(), rect.bottom() - p.y()};
+  qreal lo = 0;
+  qreal hi = 1;
+  for (int i = 0; i < 4; ++i) {
+    if (dirs[i] == 0) {
+      if (dists[i] < 0)
+        return false; // Parallel to this side and outside it
+      continue;
+    }
+    const qreal t = dists[i] / dirs[i];
+    if (dirs[i] < 0)
+      lo = qMax(lo, t);
+    else
+      hi = qMin(hi, t);
+    if (lo > hi)
+      return false;
+  }
+  *t0 = lo;
+  *t1 = hi;
+  return true;
+}
+
+bool crosses(const QPointF &p, const QPointF &q, const QRectF &rect) {
+  qreal t0, t1;
+  return clipSegment(p, q, rect, &t0, &t1);
+}
+
+bool routeCrosses(const QVector<QPointF> &route, const QRectF &rect) {
+  for (int i = 1; i < route.size(); ++i) {
+    if (crosses(route[i - 1], route[i], rect))
+      return true;
+  }
+  return false;
+}
+} // namespace
+
+EdgeRouter::EdgeRouter() : EdgeRouter(Options()) {}
+
+EdgeRouter::EdgeRouter(const Options &options) : m_options(options) {}
+
+void EdgeRouter::clear() {
+  m_rects.clear();
+  m_stateCells.clear();
+  m_edges.clear();
+  m_incident.clear();
+  m_routeCells.clear();
+}
+
+QList<Transition *> EdgeRouter::setStateRect(State *state,
+                                             const QRectF &rect) {
+  QList<Transition *> stale;
+  QRectF oldRect;
+  auto it = m_rects.find(state);
+  const bool moved = it != m_rects.end();
+  if (moved) {
+    if (*it == rect)
+      return stale;
+    oldRect = *it;
+    for (const Cell &cell : cellsOf(oldRect)) {
+      auto states = m_stateCells.find(cell);
+      states->removeOne(state);
+      if (states->isEmpty())
+        m_stateCells.erase(states);
+    }
+    *it = rect;
+  } else {
+    m_rects.insert(state, rect);
+  }
+  for (const Cell &cell : cellsOf(rect)) {
+    m_stateCells[cell].append(state);
+  }
+
+  // Own transitions first: they are reported even if already invalid
+  for (Transition *transition : m_incident.value(state)) {
+    invalidate(transition, nullptr);
+    stale.append(transition);
+  }
+  if (moved) {
+    const qreal m = 2 * m_options.margin;
+    collectCrossing(oldRect.adjusted(-m, -m, m, m), true, &stale);
+  }
+  collectCrossing(rect, false, &stale);
+  return stale;
+}
+
+QList<Transition *> EdgeRouter::removeState(State *state) {
+  QList<Transition *> stale;
+  if (!m_rects.contains(state))
+    return stale;
+
+  const QRectF rect = m_rects.take(state);
+  for (const Cell &cell : cellsOf(rect)) {
+    auto states = m_stateCells.find(cell);
+    if (states == m_stateCells.end())
+      continue;
+    states->removeOne(state);
+    if (states->isEmpty())
+      m_stateCells.erase(states);
+  }
+  for (Transition *transition : m_incident.take(state)) {
+    invalidate(transition, nullptr);
+  }
+
+  const qreal m = 2 * m_options.margin;
+  collectCrossing(rect.adjusted(-m, -m, m, m), true, &stale);
+  return stale;
+}
+
+void EdgeRouter::addEdge(Transition *transition) {
+  if (!transition || m_edges.contains(transition))
+    return;
+
+  Edge edge;
+  edge.source = transition->sourceState();
+  edge.target = transition->targetState();
+  if (!edge.source || !edge.target)
+    return;
+
+  m_edges.insert(transition, edge);
+  m_incident[edge.source].append(transition);
+  if (edge.target != edge.source)
+    m_incident[edge.target].append(transition);
+}
+
+void EdgeRouter::removeEdge(Transition *transition) {
+  auto it = m_edges.find(transition);
+  if (it == m_edges.end())
+    return;
+
+  invalidate(transition, nullptr);
+  for (State *state : {it->source, it->target}) {
+    auto incident = m_incident.find(state);
+    if (incident != m_incident.end())
+      incident->removeAll(transition);
+  }
+  m_edges.erase(it);
+}
+
+QVector<QPointF> EdgeRouter::route(Transition *transition) {
+  auto it = m_edges.find(transition);
+  if (it == m_edges.end())
+    return QVector<QPointF>();
+  if (it->valid)
+    return it->route;
+
+  it->route = computeRoute(*it);
+  it->valid = true;
+  ++m_computedRoutes;
+
+  // Register the route in the cells it passes so that states moving there
+  // can find it
+  QVector<Cell> cells;
+  for (int i = 1; i < it->route.size(); ++i) {
+    cells += cellsOf(it->route[i - 1], it->route[i]);
+  }
+  std::sort(cells.begin(), cells.end());
+  cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+  for (const Cell &cell : std::as_const(cells)) {
+    m_routeCells[cell].append(transition);
+  }
+  it->cells = cells;
+  return it->route;
+}
+
+bool EdgeRouter::hasRoute(Transition *transition) const {
+  auto it = m_edges.constFind(transition);
+  return it != m_edges.constEnd() && it->valid;
+}
+
+QList<State *> EdgeRouter::statesIn(const QRectF &area) const {
+  QList<State *> result;
+  QSet<State *> seen;
+  for (const Cell &cell : cellsOf(area)) {
+    auto states = m_stateCells.constFind(cell);
+    if (states == m_stateCells.constEnd())
+      continue;
+    for (State *state : *states) {
+      if (m_rects.value(state).intersects(area) && !seen.contains(state)) {
+        seen.insert(state);
+        result.append(state);
+      }
+    }
+  }
+  return result;
+}
+
+QPointF EdgeRouter::borderPoint(const QRectF &rect, const QPointF &toward) {
+  const QPointF center = rect.center();
+  const QPointF d = toward - center;
+  if (d.isNull())
+    return center;
+
+  // Scale the direction until it reaches the nearer pair of sides
+  const qreal inf = std::numeric_limits<qreal>::infinity();
+  const qreal tx = d.x() != 0 ? rect.width() / 2 / qAbs(d.x()) : inf;
+  const qreal ty = d.y() != 0 ? rect.height() / 2 / qAbs(d.y()) : inf;
+  return center + d * qMin(tx, ty);
+}
+
+QVector<EdgeRouter::Cell> EdgeRouter::cellsOf(const QRectF &rect) const {
+  QVector<Cell> cells;
+  if (rect.isNull())
+    return cells;
+
+  const qreal size = m_options.cellSize;
+  const int left = qFloor(rect.left() / size);
+  const int right = qFloor(rect.right() / size);
+  const int top = qFloor(rect.top() / size);
+  const int bottom = qFloor(rect.bottom() / size);
+  cells.reserve((right - left + 1) * (bottom - top + 1));
+  for (int x = left; x <= right; ++x) {
+    for (int y = top; y <= bottom; ++y) {
+      cells.append(Cell(x, y));
+    }
+  }
+  return cells;
+}
+
+QVector<EdgeRouter::Cell> EdgeRouter::cellsOf(const QPointF &from,
+                                              const QPointF &to) const {
+  // Walk the columns the segment spans; in each, take the rows between the
+  // segment's heights at the column's borders
+  const qreal size = m_options.cellSize;
+  const QPointF a = from.x() <= to.x() ? from : to;
+  const QPointF b = from.x() <= to.x() ? to : from;
+  const qreal slope = b.x() > a.x() ? (b.y() - a.y()) / (b.x() - a.x()) : 0;
+
+  QVector<Cell> cells;
+  const int first = qFloor(a.x() / size);
+  const int last = qFloor(b.x() / size);
+  for (int column = first; column <= last; ++column) {
+    const qreal x0 = qMax(a.x(), column * size);
+    const qreal x1 = qMin(b.x(), (column + 1) * size);
+    qreal y0 = a.y() + (x0 - a.x()) * slope;
+    qreal y1 = a.y() + (x1 - a.x()) * slope;
+    if (first == last) {
+      y0 = a.y();
+      y1 = b.y();
+    }
+    const int top = qFloor(qMin(y0, y1) / size);
+    const int bottom = qFloor(qMax(y0, y1) / size);
+    for (int row = top; row <= bottom; ++row) {
+      cells.append(Cell(column, row));
+    }
+  }
+  return cells;
+}
+
+bool EdgeRouter::isBlocked(const QPointF &from, const QPointF &to,
+                           const State *source, const State *target) const {
+  for (const Cell &cell : cellsOf(from, to)) {
+    auto states = m_stateCells.constFind(cell);
+    if (states == m_stateCells.constEnd())
+      continue;
+    for (State *state : *states) {
+      if (state != source && state != target &&
+          crosses(from, to, m_rects.value(state)))
+        return true;
+    }
+  }
+  return false;
+}
+
+QVector<QPointF> EdgeRouter::computeRoute(const Edge &edge) const {
+  if (edge.source == edge.target || !m_rects.contains(edge.source) ||
+      !m_rects.contains(edge.target))
+    return QVector<QPointF>();
+
+  const QRectF sourceRect = m_rects.value(edge.source);
+  const QRectF targetRect = m_rects.value(edge.target);
+  const QPointF sourceCenter = sourceRect.center();
+  const QPointF targetCenter = targetRect.center();
+  const QVector<QPointF> straight{borderPoint(sourceRect, targetCenter),
+                                  borderPoint(targetRect, sourceCenter)};
+  if (!isBlocked(sourceCenter, targetCenter, edge.source, edge.target))
+    return straight;
+
+  // Search for a detour among the states around both ends
+  const qreal reach = m_options.cellSize;
+  QList<State *> obstacles = statesIn(
+      sourceRect.united(targetRect).adjusted(-reach, -reach, reach, reach));
+  obstacles.removeAll(edge.source);
+  obstacles.removeAll(edge.target);
+  if (obstacles.size() > m_options.maxObstacles)
+    return straight;
+
+  const QVector<QPointF> path = detour(sourceRect, targetRect, obstacles);
+  return path.isEmpty() ? straight : path;
+}
+
+QVector<QPointF> EdgeRouter::detour(const QRectF &sourceRect,
+                                    const QRectF &targetRect,
+                                    const QList<State *> &obstacles) const {
+  const qreal m = m_options.margin;
+  QVector<QRectF> rects;
+  rects.reserve(obstacles.size());
+  QRectF area = sourceRect.united(targetRect);
+  for (State *state : obstacles) {
+    rects.append(m_rects.value(state));
+    area |= rects.last();
+  }
+  area.adjust(-2 * m, -2 * m, 2 * m, 2 * m);
+
+  // Candidate coordinates: both centers, the area's border and the lines
+  // one margin outside every obstacle
+  const QPointF start = sourceRect.center();
+  const QPointF goal = targetRect.center();
+  QVector<qreal> xs{start.x(), goal.x(), area.left(), area.right()};
+  QVector<qreal> ys{start.y(), goal.y(), area.top(), area.bottom()};
+  for (const QRectF &rect : std::as_const(rects)) {
+    xs << rect.left() - m << rect.right() + m;
+    ys << rect.top() - m << rect.bottom() + m;
+  }
+  for (QVector<qreal> *coords : {&xs, &ys}) {
+    std::sort(coords->begin(), coords->end());
+    coords->erase(std::unique(coords->begin(), coords->end()), coords->end());
+  }
+  const int nx = xs.size();
+  const int ny = ys.size();
+  auto node = [ny](int i, int j) { return i * ny + j; };
+
+  // Which grid points and grid segments are free of obstacles
+  QVector<bool> pointFree(nx * ny, true);
+  QVector<bool> rightFree(nx * ny, true); // (i, j) -> (i + 1, j)
+  QVector<bool> downFree(nx * ny, true);  // (i, j) -> (i, j + 1)
+  for (int i = 0; i < nx; ++i) {
+    for (int j = 0; j < ny; ++j) {
+      const int v = node(i, j);
+      for (const QRectF &rect : std::as_const(rects)) {
+        const bool insideX = xs[i] > rect.left() && xs[i] < rect.right();
+        const bool insideY = ys[j] > rect.top() && ys[j] < rect.bottom();
+        if (insideX && insideY)
+          pointFree[v] = false;
+        if (i + 1 < nx && insideY && xs[i] < rect.right() &&
+            xs[i + 1] > rect.left())
+          rightFree[v] = false;
+        if (j + 1 < ny && insideX && ys[j] < rect.bottom() &&
+            ys[j + 1] > rect.top())
+          downFree[v] = false;
+      }
+    }
+  }
+
+  const int startNode = node(xs.indexOf(start.x()), ys.indexOf(start.y()));
+  const int goalNode = node(xs.indexOf(goal.x()), ys.indexOf(goal.y()));
+
+  // A* over (grid point, direction of arrival); turning costs extra
+  enum Direction { Right, Left, Down, Up };
+  const int di[4] = {1, -1, 0, 0};
+  const int dj[4] = {0, 0, 1, -1};
+  const qreal inf = std::numeric_limits<qreal>::infinity();
+  QVector<qreal> cost(nx * ny * 4, inf);
+  QVector<int> previous(nx * ny * 4, -1);
+  using Entry = QPair<qreal, int>; // (estimate, node * 4 + direction)
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+  auto estimate = [&](int v) {
+    return qAbs(xs[v / ny] - goal.x()) + qAbs(ys[v % ny] - goal.y());
+  };
+  for (int d = 0; d < 4; ++d) {
+    cost[startNode * 4 + d] = 0;
+    open.push(Entry(estimate(startNode), startNode * 4 + d));
+  }
+
+  int reached = -1;
+  while (!open.empty()) {
+    const Entry entry = open.top();
+    open.pop();
+    const int key = entry.second;
+    const int v = key / 4;
+    const int d = key % 4;
+    if (entry.first > cost[key] + estimate(v))
+      continue; // Outdated entry
+    if (v == goalNode) {
+      reached = key;
+      break;
+    }
+
+    const int i = v / ny;
+    const int j = v % ny;
+    for (int nd = 0; nd < 4; ++nd) {
+      const int ni = i + di[nd];
+      const int nj = j + dj[nd];
+      if (ni < 0 || ni >= nx || nj < 0 || nj >= ny)
+        continue;
+      const int w = node(ni, nj);
+      const bool passable = nd == Right  ? rightFree[v]
+                            : nd == Left ? rightFree[w]
+                            : nd == Down ? downFree[v]
+                                         : downFree[w];
+      if (!passable || !pointFree[w])
+        continue;
+
+      const qreal step = qAbs(xs[ni] - xs[i]) + qAbs(ys[nj] - ys[j]) +
+                         (nd != d && v != startNode ? BendCost : 0);
+      const int next = w * 4 + nd;
+      if (cost[key] + step < cost[next]) {
+        cost[next] = cost[key] + step;
+        previous[next] = key;
+        open.push(Entry(cost[next] + estimate(w), next));
+      }
+    }
+  }
+  if (reached < 0)
+    return QVector<QPointF>();
+
+  // Walk back, keeping only the corners
+  QVector<QPointF> points;
+  for (int key = reached; key >= 0; key = previous[key]) {
+    const QPointF p(xs[key / 4 / ny], ys[key / 4 % ny]);
+    if (points.size() >= 2) {
+      const QPointF &a = points[points.size() - 2];
+      const QPointF &b = points.last();
+      if ((a.x() == b.x() && b.x() == p.x()) ||
+          (a.y() == b.y() && b.y() == p.y())) {
+        points.last() = p;
+        continue;
+      }
+    }
+    if (points.isEmpty() || points.last() != p)
+      points.append(p);
+  }
+  std::reverse(points.begin(), points.end());
+
+  // Start and end on the borders of the two states
+  int first = 1;
+  while (first < points.size() && sourceRect.contains(points[first]))
+    ++first;
+  int last = points.size() - 2;
+  while (last >= 0 && targetRect.contains(points[last]))
+    --last;
+  if (first >= points.size() || last < 0 || first > last + 1)
+    return QVector<QPointF>(); // The states overlap
+
+  qreal t0, t1;
+  QVector<QPointF> route;
+  const QPointF &in = points[first - 1];
+  const QPointF &out = points[first];
+  clipSegment(in, out, sourceRect, &t0, &t1);
+  route.append(in + (out - in) * t1);
+  for (int k = first; k <= last; ++k) {
+    route.append(points[k]);
+  }
+  const QPointF &before = points[last];
+  const QPointF &after = points[last + 1];
+  clipSegment(before, after, targetRect, &t0, &t1);
+  route.append(before + (after - before) * t0);
+  return route;
+}
+
+void EdgeRouter::invalidate(Transition *transition,
+                            QList<Transition *> *stale) {
+  auto it = m_edges.find(transition);
+  if (it == m_edges.end() || !it->valid)
+    return;
+
+  for (const Cell &cell : std::as_const(it->cells)) {
+    auto transitions = m_routeCells.find(cell);
+    if (transitions == m_routeCells.end())
+      continue;
+    transitions->removeOne(transition);
+    if (transitions->isEmpty())
+      m_routeCells.erase(transitions);
+  }
+  it->cells.clear();
+  it->route.clear();
+  it->valid = false;
+  if (stale)
+    stale->append(transition);
+}
+
+void EdgeRouter::collectCrossing(const QRectF &rect, bool detoursOnly,
+                                 QList<Transition *> *stale) {
+  for (const Cell &cell : cellsOf(rect)) {
+    // invalidate() edits the cell's list
+    const QList<Transition *> candidates = m_routeCells.value(cell);
+    for (Transition *transition : candidates) {
+      const Edge &edge = m_edges[transition];
+      if (!edge.valid || (detoursOnly && edge.route.size() <= 2))
+        continue;
+      if (routeCrosses(edge.route, rect))
+        invalidate(transition, stale);
+    }
+  }
+}
@@ -0,0 +1,133 @@
+#ifndef EDGEROUTER_H
+#define EDGEROUTER_H
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QPointF>
+#include <QRectF>
+#include <QVector>
+
+class State;
+class Transition;
+
+/**
+ * @brief Routes transitions around the states in their way and remembers the
+ * routes until something in their way changes.
+ *
+ * State rectangles are kept in a uniform grid, so finding the states near a
+ * line or an area only looks at the cells it covers. A transition is drawn
+ * as a straight line between the borders of its states when no other state
+ * is in the way; otherwise it gets an orthogonal route that keeps a margin
+ * around the states nearby.
+ *
+ * Routes are computed on demand and memoized. Moving a state invalidates the
+ * routes of its own transitions, the routes its new rectangle now blocks and
+ * the detours that went around its old rectangle; all other routes are kept.
+ * The grid also records the cells each route passes through, so finding
+ * those routes does not look at the rest of the diagram.
+ *
+ * Self-loops have no route; the view draws them next to their state.
+ *
+ * @ingroup Layout
+ */
+class EdgeRouter {
+public:
+  struct Options {
+    qreal cellSize = 240; ///< Side of a grid cell, about two states wide
+    qreal margin = 16;    ///< Clearance between a detour and a state
+    /// Detours are only searched among this many nearby states; denser
+    /// areas get a straight line
+    int maxObstacles = 32;
+  };
+
+  EdgeRouter();
+  explicit EdgeRouter(const Options &options);
+
+  /**
+   * @brief Forgets all states, transitions and routes.
+   */
+  void clear();
+
+  /**
+   * @brief Adds a state or updates its rectangle.
+   * @param state The state.
+   * @param rect Its outline in scene coordinates.
+   * @return The transitions whose routes are no longer valid.
+   */
+  QList<Transition *> setStateRect(State *state, const QRectF &rect);
+
+  /**
+   * @brief Removes a state. Its transitions should be removed first.
+   * @return The transitions whose routes went around the state.
+   */
+  QList<Transition *> removeState(State *state);
+
+  /**
+   * @brief Starts routing a transition between its source and target state.
+   */
+  void addEdge(Transition *transition);
+
+  /**
+   * @brief Stops routing a transition and drops its route.
+   */
+  void removeEdge(Transition *transition);
+
+  /**
+   * @brief Gets the route of a transition, computing it if necessary.
+   * @return The points from the source border to the target border; empty
+   * for self-loops and unknown transitions.
+   */
+  QVector<QPointF> route(Transition *transition);
+
+  /**
+   * @brief Checks whether the route of a transition is memoized.
+   */
+  bool hasRoute(Transition *transition) const;
+
+  /**
+   * @brief Gets the states whose rectangles intersect an area.
+   */
+  QList<State *> statesIn(const QRectF &area) const;
+
+  /// Number of routes computed so far (memoized results not counted)
+  int computedRoutes() const { return m_computedRoutes; }
+
+  /**
+   * @brief Gets the point where the line from the center of a rectangle
+   * toward another point leaves the rectangle.
+   */
+  static QPointF borderPoint(const QRectF &rect, const QPointF &toward);
+
+private:
+  using Cell = QPair<int, int>;
+
+  struct Edge {
+    State *source = nullptr;
+    State *target = nullptr;
+    QVector<QPointF> route;
+    QVector<Cell> cells; ///< Cells the route is registered in
+    bool valid = false;
+  };
+
+  QVector<Cell> cellsOf(const QRectF &rect) const;
+  QVector<Cell> cellsOf(const QPointF &from, const QPointF &to) const;
+  bool isBlocked(const QPointF &from, const QPointF &to, const State *source,
+                 const State *target) const;
+  QVector<QPointF> computeRoute(const Edge &edge) const;
+  QVector<QPointF> detour(const QRectF &sourceRect, const QRectF &targetRect,
+                          const QList<State *> &obstacles) const;
+  void invalidate(Transition *transition, QList<Transition *> *stale);
+  void collectCrossing(const QRectF &rect, bool detoursOnly,
+                       QList<Transition *> *stale);
+
+  Options m_options;
+  QHash<State *, QRectF> m_rects;
+  QHash<Cell, QVector<State *>> m_stateCells;
+  QHash<Transition *, Edge> m_edges;
+  QHash<State *, QList<Transition *>> m_incident;
+  QHash<Cell, QList<Transition *>> m_routeCells;
+  int m_computedRoutes = 0;
+};
+
+#endif // EDGEROUTER_H
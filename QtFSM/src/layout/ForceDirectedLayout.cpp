@@ -0,0 +1,374 @@
+#include "ForceDirectedLayout.h"
+#include "../model/FSM.h"
+#include "../model/State.h"
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QVarLengthArray>
+#include <QtConcurrent>
+#include <QtMath>
+#include <cmath>
+
+namespace {
+// Below this many states the forces are computed on the worker alone;
+// spreading a few hundred bodies over the pool costs more than it saves
+constexpr int ParallelThreshold = 2000;
+constexpr int ChunkSize = 512;
+constexpr int ProgressIntervalMs = 30;
+
+// Barnes-Hut quadtree over the current positions. Nodes live in one array
+// and refer to their children by index.
+class QuadTree {
+public:
+  explicit QuadTree(const QVector<QPointF> &points) : m_points(points) {
+    QRectF bounds;
+    for (const QPointF &p : points) {
+      bounds |= QRectF(p, QSizeF(1, 1));
+    }
+    const qreal half = qMax(bounds.width(), bounds.height()) / 2 + 1;
+
+    m_nodes.reserve(points.size() * 2 + 1);
+    m_nodes.append(Node{bounds.center(), half});
+    for (int i = 0; i < points.size(); ++i) {
+      insert(i);
+    }
+  }
+
+  // Sum of k^2 / d pushes from all bodies, with distant groups of bodies
+  // approximated by their centre of mass
+  QPointF repulsion(const QPointF &p, qreal k2, qreal theta2) const {
+    QPointF force;
+    QVarLengthArray<int, 64> stack;
+    stack.append(0);
+    while (!stack.isEmpty()) {
+      const Node &node = m_nodes[stack.takeLast()];
+      if (node.mass == 0)
+        continue;
+
+      const QPointF delta = p - node.massCenter;
+      const qreal d2 = QPointF::dotProduct(delta, delta);
+      const qreal size = node.half * 2;
+      if (node.isLeaf() || size * size < theta2 * d2) {
+        if (d2 > 1e-4) // Skip the body itself
+          force += delta * (k2 * node.mass / d2);
+        continue;
+      }
+      for (int child : node.children) {
+        if (child >= 0)
+          stack.append(child);
+      }
+    }
+    return force;
+  }
+
+private:
+  // Bodies that are still together at this depth are lumped into one leaf
+  static constexpr int MaxDepth = 24;
+
+  struct Node {
+    QPointF center;
+    qreal half = 0;
+    QPointF massCenter;
+    int mass = 0;
+    int body = -1; ///< The only body in a leaf, -1 otherwise
+    int children[4] = {-1, -1, -1, -1};
+
+    bool isLeaf() const {
+      return children[0] < 0 && children[1] < 0 && children[2] < 0 &&
+             children[3] < 0;
+    }
+  };
+
+  int childFor(int index, const QPointF &p) {
+    const QPointF center = m_nodes[index].center;
+    const int quadrant = (p.x() >= center.x() ? 1 : 0) |
+                         (p.y() >= center.y() ? 2 : 0);
+    int child = m_nodes[index].children[quadrant];
+    if (child < 0) {
+      const qreal half = m_nodes[index].half / 2;
+      const QPointF offset(quadrant & 1 ? half : -half,
+                           quadrant & 2 ? half : -half);
+      child = m_nodes.size();
+      m_nodes.append(Node{center + offset, half});
+      m_nodes[index].children[quadrant] = child;
+    }
+    return child;
+  }
+
+  void insert(int body) {
+    const QPointF p = m_points[body];
+    int index = 0;
+    for (int depth = 0;; ++depth) {
+      Node &node = m_nodes[index];
+      const int mass = node.mass;
+      node.massCenter = (node.massCenter * mass + p) / (mass + 1);
+      node.mass = mass + 1;
+
+      if (mass == 0) {
+        node.body = body;
+        return;
+      }
+      if (depth >= MaxDepth) {
+        node.body = -1;
+        return;
+      }
+      if (node.body >= 0) {
+        // A leaf with one body becomes internal: move that body down first
+        const int existing = node.body;
+        node.body = -1;
+        Node &child = m_nodes[childFor(index, m_points[existing])];
+        child.mass = 1;
+        child.massCenter = m_points[existing];
+        child.body = existing;
+      }
+      index = childFor(index, p);
+    }
+  }
+
+  const QVector<QPointF> &m_points;
+  QVector<Node> m_nodes;
+};
+
+struct Range {
+  int begin;
+  int end;
+};
+} // namespace
+
+ForceDirectedLayout::ForceDirectedLayout(QObject *parent) : QObject(parent) {
+  m_pool.setMaxThreadCount(1);
+  connect(&m_watcher, &QFutureWatcher<QVector<QPointF>>::finished, this,
+          [this]() {
+            // waitForFinished() may already have handled this run
+            if (m_running && m_watcher.isFinished()) {
+              finishCurrent();
+            }
+          });
+}
+
+ForceDirectedLayout::~ForceDirectedLayout() {
+  m_cancelled = true;
+  m_watcher.waitForFinished();
+}
+
+void ForceDirectedLayout::start(FSM *fsm) {
+  if (m_running) {
+    cancel();
+  }
+  if (!fsm || fsm->states().isEmpty()) {
+    return;
+  }
+
+  QList<State *> states;
+  const LayoutGraph graph = LayoutGraph::capture(fsm, &states);
+  m_fsm = fsm;
+  m_startPositions = graph.positions;
+  m_states.clear();
+  m_states.reserve(states.size());
+  for (State *state : states) {
+    m_states.append(state);
+  }
+
+  m_cancelled = false;
+  m_running = true;
+  m_watcher.setFuture(
+      QtConcurrent::run(&m_pool, [this, graph, options = m_options]() {
+        return run(graph, options, [this](const QVector<QPointF> &positions) {
+          publish(positions);
+          return !m_cancelled.load();
+        });
+      }));
+}
+
+void ForceDirectedLayout::cancel() {
+  if (!m_running) {
+    return;
+  }
+  m_cancelled = true;
+  m_watcher.waitForFinished();
+  finishCurrent();
+}
+
+void ForceDirectedLayout::waitForFinished() {
+  if (m_running) {
+    m_watcher.waitForFinished();
+    finishCurrent();
+  }
+}
+
+QVector<QPointF> ForceDirectedLayout::run(const LayoutGraph &graph,
+                                          const Options &options,
+                                          const Progress &progress) {
+  QVector<QPointF> positions = graph.positions;
+  const int n = positions.size();
+  if (n < 2) {
+    return positions;
+  }
+
+  // Spread states that sit exactly on top of each other (imports often
+  // place everything at the origin); no force can separate those
+  for (int i = 0; i < n; ++i) {
+    positions[i] += QPointF(std::cos(i * 2.39996), std::sin(i * 2.39996)) *
+                    (0.5 + i % 7);
+  }
+
+  const qreal k = options.edgeLength;
+  const qreal k2 = k * k;
+  const qreal theta2 = options.theta * options.theta;
+
+  // Start with moves of about a tenth of the diagram and cool linearly
+  QRectF bounds;
+  for (const QPointF &p : std::as_const(positions)) {
+    bounds |= QRectF(p, QSizeF(1, 1));
+  }
+  const qreal startTemperature =
+      qMax(k, std::hypot(bounds.width(), bounds.height()) / 10);
+
+  QVector<Range> chunks;
+  for (int begin = 0; begin < n; begin += ChunkSize) {
+    chunks.append(Range{begin, qMin(begin + ChunkSize, n)});
+  }
+
+  QVector<QPointF> displacement(n);
+  QElapsedTimer sinceProgress;
+  sinceProgress.start();
+
+  for (int iteration = 0; iteration < options.iterations; ++iteration) {
+    const qreal temperature =
+        startTemperature * (1.0 - qreal(iteration) / options.iterations);
+
+    // Repulsion, through the quadtree; each state only writes its own slot
+    const QuadTree tree(positions);
+    QPointF centroid;
+    for (const QPointF &p : std::as_const(positions)) {
+      centroid += p;
+    }
+    centroid /= n;
+    const QPointF *current = positions.constData();
+    QPointF *out = displacement.data();
+    auto repel = [&](const Range &range) {
+      for (int i = range.begin; i < range.end; ++i) {
+        // A weak pull to the centre keeps unconnected parts from drifting
+        out[i] = tree.repulsion(current[i], k2, theta2) -
+                 (current[i] - centroid) * 0.01;
+      }
+    };
+    if (n >= ParallelThreshold) {
+      QtConcurrent::blockingMap(chunks, repel);
+    } else {
+      for (const Range &range : std::as_const(chunks)) {
+        repel(range);
+      }
+    }
+
+    // Attraction along the transitions: d^2 / k
+    for (const QPair<int, int> &edge : graph.edges) {
+      if (edge.first == edge.second)
+        continue;
+      const QPointF delta = positions[edge.first] - positions[edge.second];
+      const qreal distance = std::hypot(delta.x(), delta.y());
+      if (distance < 1e-3)
+        continue;
+      const QPointF pull = delta * (distance / k);
+      displacement[edge.first] -= pull;
+      displacement[edge.second] += pull;
+    }
+
+    // Move, never further than the current temperature
+    qreal largestMove = 0;
+    for (int i = 0; i < n; ++i) {
+      const QPointF d = displacement[i];
+      const qreal length = std::hypot(d.x(), d.y());
+      if (length < 1e-6)
+        continue;
+      const qreal step = qMin(length, temperature);
+      positions[i] += d * (step / length);
+      largestMove = qMax(largestMove, step);
+    }
+
+    if (largestMove < 0.5) {
+      break; // Converged
+    }
+
+    if (progress && sinceProgress.elapsed() >= ProgressIntervalMs) {
+      sinceProgress.restart();
+      if (!progress(positions)) {
+        break;
+      }
+    }
+  }
+
+  return positions;
+}
+
+void ForceDirectedLayout::publish(const QVector<QPointF> &positions) {
+  QMutexLocker locker(&m_mutex);
+  m_latest = positions;
+  if (!m_updatePending) {
+    m_updatePending = true;
+    QMetaObject::invokeMethod(this, &ForceDirectedLayout::applyLatest,
+                              Qt::QueuedConnection);
+  }
+}
+
+void ForceDirectedLayout::applyLatest() {
+  QVector<QPointF> positions;
+  {
+    QMutexLocker locker(&m_mutex);
+    positions.swap(m_latest);
+    m_updatePending = false;
+  }
+  // An update posted just before the run finished is already superseded
+  if (m_running && !m_cancelled) {
+    apply(positions);
+  }
+}
+
+void ForceDirectedLayout::apply(const QVector<QPointF> &positions) {
+  if (!m_fsm) {
+    return;
+  }
+  QList<State *> states;
+  QVector<QPointF> targets;
+  const int count = qMin(positions.size(), m_states.size());
+  states.reserve(count);
+  targets.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    if (State *state = m_states[i]) {
+      states.append(state);
+      targets.append(positions[i]);
+    }
+  }
+  m_fsm->moveStates(states, targets);
+}
+
+void ForceDirectedLayout::finishCurrent() {
+  const bool completed = !m_cancelled;
+  m_running = false;
+  {
+    QMutexLocker locker(&m_mutex);
+    m_latest.clear();
+  }
+
+  QList<State *> states;
+  QVector<QPointF> from;
+  if (!completed) {
+    // The steps applied so far are not on the undo stack; put the states
+    // back so a cancelled run leaves the diagram as the user had it
+    apply(m_startPositions);
+  } else {
+    apply(m_watcher.result());
+    for (int i = 0; i < m_states.size(); ++i) {
+      if (State *state = m_states[i]) {
+        states.append(state);
+        from.append(m_startPositions[i]);
+      }
+    }
+  }
+  m_fsm = nullptr;
+  m_states.clear();
+  m_startPositions.clear();
+
+  if (completed) {
+    emit finished(states, from);
+  }
+}
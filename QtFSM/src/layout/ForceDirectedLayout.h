@@ -0,0 +1,125 @@
+#ifndef FORCEDIRECTEDLAYOUT_H
+#define FORCEDIRECTEDLAYOUT_H
+
+#include "LayoutGraph.h"
+#include <QFutureWatcher>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QThreadPool>
+#include <QVector>
+#include <atomic>
+#include <functional>
+
+class FSM;
+class State;
+
+/**
+ * @brief Force-directed auto-layout that runs in the background and
+ * streams its progress into the model.
+ *
+ * States push each other apart and transitions pull their endpoints
+ * together (Fruchterman-Reingold). The repulsion between all pairs is
+ * approximated with a Barnes-Hut quadtree, so an iteration costs
+ * O(n log n) instead of O(n^2), and the per-state forces are computed in
+ * parallel on the global thread pool.
+ *
+ * start() lays out a LayoutGraph copy of the FSM on a worker thread.
+ * Intermediate positions are handed back to the GUI thread about 30 times a
+ * second and written with one FSM::moveStates() call, so the diagram is seen
+ * to converge. When the GUI falls behind, only the latest positions are
+ * applied. A cancelled layout restores the starting positions, so only a
+ * completed one needs an undo step.
+ *
+ * @ingroup Layout
+ */
+class ForceDirectedLayout : public QObject {
+  Q_OBJECT
+
+public:
+  struct Options {
+    int iterations = 300;
+    qreal edgeLength = 250; ///< Preferred distance between connected states
+    qreal theta = 0.9;      ///< Barnes-Hut opening angle; 0 is exact
+  };
+
+  /**
+   * @brief Called with the current positions while run() iterates.
+   * @return false to stop early.
+   */
+  using Progress = std::function<bool(const QVector<QPointF> &)>;
+
+  explicit ForceDirectedLayout(QObject *parent = nullptr);
+
+  /**
+   * @brief Cancels a running layout and waits for the worker.
+   */
+  ~ForceDirectedLayout();
+
+  /**
+   * @brief Starts laying out the FSM in the background, cancelling a
+   * layout that is still running.
+   * @param fsm The FSM to arrange; states removed meanwhile are skipped.
+   */
+  void start(FSM *fsm);
+
+  /**
+   * @brief Stops the running layout and moves the states back to where they
+   * were when it started. finished() is not emitted.
+   */
+  void cancel();
+
+  /**
+   * @brief Blocks until the running layout has finished and applies its
+   * final positions.
+   */
+  void waitForFinished();
+
+  bool isRunning() const { return m_running; }
+
+  void setOptions(const Options &options) { m_options = options; }
+  Options options() const { return m_options; }
+
+  /**
+   * @brief Lays out a graph synchronously; this is what the worker runs.
+   * @param graph The graph; its positions are the starting point.
+   * @param options Layout parameters.
+   * @param progress Optional callback, invoked at most every 30 ms.
+   * @return The final positions, in the order of graph.positions.
+   */
+  static QVector<QPointF> run(const LayoutGraph &graph, const Options &options,
+                              const Progress &progress = Progress());
+
+signals:
+  /**
+   * @brief Emitted when a layout has run to completion and its final
+   * positions have been applied.
+   * @param states The states that were moved (and still exist).
+   * @param from Their positions before the layout, e.g. to record an undo
+   * step.
+   */
+  void finished(const QList<State *> &states, const QVector<QPointF> &from);
+
+private:
+  void publish(const QVector<QPointF> &positions);
+  void applyLatest();
+  void apply(const QVector<QPointF> &positions);
+  void finishCurrent();
+
+  Options m_options;
+  QPointer<FSM> m_fsm;
+  QVector<QPointer<State>> m_states;
+  QVector<QPointF> m_startPositions;
+  QThreadPool m_pool; ///< Runs the iteration loop; forces use the global pool
+  QFutureWatcher<QVector<QPointF>> m_watcher;
+  bool m_running = false;
+  std::atomic<bool> m_cancelled{false};
+
+  // Latest intermediate positions, handed from the worker to the GUI thread
+  QMutex m_mutex;
+  QVector<QPointF> m_latest;
+  bool m_updatePending = false;
+};
+
+#endif // FORCEDIRECTEDLAYOUT_H
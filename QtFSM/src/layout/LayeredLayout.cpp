@@ -0,0 +1,229 @@
+#include "LayeredLayout.h"
+#include <algorithm>
+
+namespace {
+// Adjacency lists in one array: the neighbours of node v are
+// targets[offsets[v]] .. targets[offsets[v + 1] - 1]
+struct Adjacency {
+  QVector<int> offsets;
+  QVector<int> targets;
+
+  Adjacency(int nodeCount, const QVector<QPair<int, int>> &edges,
+            bool reversed)
+      : offsets(nodeCount + 1, 0), targets(edges.size()) {
+    for (const QPair<int, int> &edge : edges) {
+      ++offsets[(reversed ? edge.second : edge.first) + 1];
+    }
+    for (int v = 0; v < nodeCount; ++v) {
+      offsets[v + 1] += offsets[v];
+    }
+    QVector<int> fill(offsets.cbegin(), offsets.cend() - 1);
+    for (const QPair<int, int> &edge : edges) {
+      const int from = reversed ? edge.second : edge.first;
+      targets[fill[from]++] = reversed ? edge.first : edge.second;
+    }
+  }
+
+  int begin(int v) const { return offsets[v]; }
+  int end(int v) const { return offsets[v + 1]; }
+};
+
+// Phase 1: the edges of an acyclic graph, with back edges reversed
+QVector<QPair<int, int>> breakCycles(const LayoutGraph &graph, int root) {
+  const int n = graph.positions.size();
+  QVector<QPair<int, int>> edges;
+  edges.reserve(graph.edges.size());
+  for (const QPair<int, int> &edge : graph.edges) {
+    if (edge.first != edge.second) // Self-loops do not affect layering
+      edges.append(edge);
+  }
+  const Adjacency out(n, edges, false);
+
+  enum Mark : char { New, OnPath, Done };
+  QVector<char> mark(n, New);
+  QVector<QPair<int, int>> dag;
+  dag.reserve(edges.size());
+  QVector<QPair<int, int>> stack; // (node, next adjacency index)
+
+  auto search = [&](int start) {
+    mark[start] = OnPath;
+    stack.append(qMakePair(start, out.begin(start)));
+    while (!stack.isEmpty()) {
+      const int u = stack.last().first;
+      const int next = stack.last().second;
+      if (next == out.end(u)) {
+        mark[u] = Done;
+        stack.removeLast();
+        continue;
+      }
+      ++stack.last().second;
+
+      const int v = out.targets[next];
+      if (mark[v] == OnPath || v == root) {
+        // Closes a cycle (or enters the root): keep the root on top
+        dag.append(qMakePair(v, u));
+      } else {
+        dag.append(qMakePair(u, v));
+        if (mark[v] == New) {
+          mark[v] = OnPath;
+          stack.append(qMakePair(v, out.begin(v)));
+        }
+      }
+    }
+  };
+
+  if (root >= 0 && root < n)
+    search(root);
+  for (int v = 0; v < n; ++v) {
+    if (mark[v] == New)
+      search(v);
+  }
+  return dag;
+}
+} // namespace
+
+QVector<QPointF> LayeredLayout::run(const LayoutGraph &graph, int root,
+                                    const Options &options) {
+  const int n = graph.positions.size();
+  QVector<QPointF> positions(n);
+  if (n == 0) {
+    return positions;
+  }
+
+  const QVector<QPair<int, int>> dag = breakCycles(graph, root);
+  const Adjacency successors(n, dag, false);
+  const Adjacency predecessors(n, dag, true);
+
+  // Phase 2: longest-path layering in topological order (Kahn)
+  QVector<int> inDegree(n, 0);
+  for (const QPair<int, int> &edge : dag) {
+    ++inDegree[edge.second];
+  }
+  QVector<int> topological;
+  topological.reserve(n);
+  if (root >= 0 && root < n && inDegree[root] == 0)
+    topological.append(root);
+  for (int v = 0; v < n; ++v) {
+    if (inDegree[v] == 0 && v != root)
+      topological.append(v);
+  }
+  QVector<int> layer(n, 0);
+  for (int i = 0; i < topological.size(); ++i) {
+    const int u = topological[i];
+    for (int e = successors.begin(u); e < successors.end(u); ++e) {
+      const int v = successors.targets[e];
+      layer[v] = qMax(layer[v], layer[u] + 1);
+      if (--inDegree[v] == 0)
+        topological.append(v);
+    }
+  }
+
+  int layerCount = 0;
+  for (int v = 0; v < n; ++v) {
+    layerCount = qMax(layerCount, layer[v] + 1);
+  }
+  QVector<QVector<int>> layers(layerCount);
+  for (int v : std::as_const(topological)) {
+    layers[layer[v]].append(v);
+  }
+
+  // Phase 3: barycentric crossing reduction. Ranks are normalised to [0, 1)
+  // so that neighbours in layers of different widths are comparable.
+  QVector<qreal> rank(n);
+  auto updateRanks = [&](const QVector<int> &nodes) {
+    for (int i = 0; i < nodes.size(); ++i) {
+      rank[nodes[i]] = (i + 0.5) / nodes.size();
+    }
+  };
+  for (const QVector<int> &nodes : std::as_const(layers)) {
+    updateRanks(nodes);
+  }
+
+  QVector<qreal> key(n);
+  auto sortLayer = [&](QVector<int> &nodes, const Adjacency &neighbours) {
+    for (int v : std::as_const(nodes)) {
+      const int begin = neighbours.begin(v);
+      const int end = neighbours.end(v);
+      if (begin == end) {
+        key[v] = rank[v]; // Nothing to align with; stay put
+        continue;
+      }
+      qreal sum = 0;
+      for (int e = begin; e < end; ++e) {
+        sum += rank[neighbours.targets[e]];
+      }
+      key[v] = sum / (end - begin);
+    }
+    std::stable_sort(nodes.begin(), nodes.end(),
+                     [&](int a, int b) { return key[a] < key[b]; });
+    updateRanks(nodes);
+  };
+
+  for (int sweep = 0; sweep < options.sweeps; ++sweep) {
+    for (int l = 1; l < layerCount; ++l) {
+      sortLayer(layers[l], predecessors);
+    }
+    for (int l = layerCount - 2; l >= 0; --l) {
+      sortLayer(layers[l], successors);
+    }
+  }
+
+  // Phase 4: x coordinates. Start centred, then pull each layer toward its
+  // neighbours while keeping the order and the spacing.
+  const qreal spacing = options.stateSpacing;
+  QVector<qreal> x(n);
+  for (const QVector<int> &nodes : std::as_const(layers)) {
+    for (int i = 0; i < nodes.size(); ++i) {
+      x[nodes[i]] = (i - (nodes.size() - 1) / 2.0) * spacing;
+    }
+  }
+
+  QVector<qreal> desired;
+  auto alignLayer = [&](const QVector<int> &nodes,
+                        const Adjacency &neighbours) {
+    const int count = nodes.size();
+    desired.resize(count);
+    for (int i = 0; i < count; ++i) {
+      const int v = nodes[i];
+      const int begin = neighbours.begin(v);
+      const int end = neighbours.end(v);
+      qreal sum = 0;
+      for (int e = begin; e < end; ++e) {
+        sum += x[neighbours.targets[e]];
+      }
+      desired[i] = begin == end ? x[v] : sum / (end - begin);
+    }
+
+    // Closest placement to the desired one that keeps the spacing: push
+    // right from the left, then left from the right, and average the two
+    QVector<qreal> left(count), right(count);
+    for (int i = 0; i < count; ++i) {
+      left[i] = i == 0 ? desired[i] : qMax(desired[i], left[i - 1] + spacing);
+    }
+    for (int i = count - 1; i >= 0; --i) {
+      right[i] = i == count - 1 ? desired[i]
+                                : qMin(desired[i], right[i + 1] - spacing);
+    }
+    qreal previous = 0;
+    for (int i = 0; i < count; ++i) {
+      qreal value = (left[i] + right[i]) / 2;
+      if (i > 0)
+        value = qMax(value, previous + spacing);
+      x[nodes[i]] = previous = value;
+    }
+  };
+
+  for (int pass = 0; pass < 2; ++pass) {
+    for (int l = 1; l < layerCount; ++l) {
+      alignLayer(layers[l], predecessors);
+    }
+    for (int l = layerCount - 2; l >= 0; --l) {
+      alignLayer(layers[l], successors);
+    }
+  }
+
+  for (int v = 0; v < n; ++v) {
+    positions[v] = QPointF(x[v], layer[v] * options.layerSpacing);
+  }
+  return positions;
+}
@@ -0,0 +1,34 @@
+#include "LayoutGraph.h"
+#include "../model/FSM.h"
+#include "../model/State.h"
+#include "../model/Transition.h"
+#include <QHash>
+
+LayoutGraph LayoutGraph::capture(const FSM *fsm, QList<State *> *states) {
+  LayoutGraph graph;
+  if (!fsm)
+    return graph;
+
+  const QList<State *> fsmStates = fsm->states();
+  QHash<const State *, int> index;
+  index.reserve(fsmStates.size());
+  graph.positions.reserve(fsmStates.size());
+  for (State *state : fsmStates) {
+    index.insert(state, graph.positions.size());
+    graph.positions.append(state->position());
+  }
+
+  const QList<Transition *> transitions = fsm->transitions();
+  graph.edges.reserve(transitions.size());
+  for (Transition *t : transitions) {
+    const int source = index.value(t->sourceState(), -1);
+    const int target = index.value(t->targetState(), -1);
+    if (source >= 0 && target >= 0) {
+      graph.edges.append(qMakePair(source, target));
+    }
+  }
+
+  if (states)
+    *states = fsmStates;
+  return graph;
+}
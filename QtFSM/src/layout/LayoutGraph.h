@@ -0,0 +1,34 @@
+#ifndef LAYOUTGRAPH_H
+#define LAYOUTGRAPH_H
+
+#include <QList>
+#include <QPair>
+#include <QPointF>
+#include <QVector>
+
+class FSM;
+class State;
+
+/**
+ * @brief Plain copy of the parts of an FSM a layout engine needs: one
+ * position per state and the transitions as pairs of state indices.
+ *
+ * The graph holds values only, so it can be laid out on a worker thread while
+ * the GUI keeps running. The engines return positions in the same order as
+ * the states passed to capture().
+ *
+ * @ingroup Layout
+ */
+struct LayoutGraph {
+  QVector<QPointF> positions;
+  QVector<QPair<int, int>> edges; ///< (source, target) indices into positions
+
+  /**
+   * @brief Copies the state positions and transition endpoints of an FSM.
+   * @param fsm The FSM to copy.
+   * @param states If given, receives the states in index order.
+   */
+  static LayoutGraph capture(const FSM *fsm, QList<State *> *states = nullptr);
+};
+
+#endif // LAYOUTGRAPH_H
@@ -1,17 +1,69 @@
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+#include "model/FSM.h"
+#include "parsing/CodeParser.h"
 #include "view/MainWindow.h"
 
+// Headless `--stats <file>`: import the file once and print the pipeline stats
+static int printImportStats(const QString &path)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    // Same path the UI takes for large files: mapped and lexed as UTF-8
+    CodeParser parser;
+    FSM *fsm = parser.parseFile(path);
+    if (!fsm) {
+        err << "Import failed: " << parser.lastError() << Qt::endl;
+        return 1;
+    }
+    delete fsm;
+
+    out << path << Qt::endl << parser.stats().report() << Qt::endl;
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
-    QApplication app(argc, argv);
-    
     // Set application metadata
-    QApplication::setOrganizationName("QtFSM");
-    QApplication::setApplicationName("QtFSM Designer");
-    QApplication::setApplicationVersion("1.0.0");
+    QCoreApplication::setOrganizationName("QtFSM");
+    QCoreApplication::setApplicationName("QtFSM Designer");
+    QCoreApplication::setApplicationVersion("1.0.0");
+
+    QCommandLineParser cli;
+    cli.setApplicationDescription("Visual designer for C++ finite state machines");
+    cli.addHelpOption();
+    cli.addVersionOption();
+    QCommandLineOption statsOption("stats",
+        "Print timings and counters of the C++ import pipeline. With a file, "
+        "import it without opening a window; otherwise log them after every "
+        "diagram update from code.");
+    cli.addOption(statsOption);
+    cli.addPositionalArgument("file", "C++ file to import with --stats.", "[file]");
+
+    // Look at the arguments before any application object exists, so the
+    // headless import does not need a GUI platform plugin (e.g. over SSH)
+    QStringList arguments;
+    for (int i = 0; i < argc; ++i) {
+        arguments.append(QString::fromLocal8Bit(argv[i]));
+    }
+    if (cli.parse(arguments) && cli.isSet(statsOption) &&
+        !cli.positionalArguments().isEmpty()) {
+        QCoreApplication app(argc, argv);
+        cli.process(app);
+        return printImportStats(cli.positionalArguments().first());
+    }
+
+    QApplication app(argc, argv);
+    cli.process(app);
+    const bool stats = cli.isSet(statsOption);
     
     // Create and show main window
     MainWindow mainWindow;
+    mainWindow.setStatsLoggingEnabled(stats);
     mainWindow.show();
     
     return app.exec();
@@ -1,5 +1,6 @@
 #include "FSM.h"
 #include <QSet>
+#include <QSignalBlocker>
 
 FSM::FSM(QObject *parent) : QObject(parent), m_initialState(nullptr) {}
 
@@ -29,6 +30,25 @@ void FSM::addState(State *state) {
   }
 }
 
+void FSM::addStates(const QList<State *> &states) {
+  QSet<State *> known(m_states.cbegin(), m_states.cend());
+  m_states.reserve(m_states.size() + states.size());
+
+  bool added = false;
+  for (State *state : states) {
+    if (!state || known.contains(state))
+      continue;
+    known.insert(state);
+    m_states.append(state);
+    state->setParent(this);
+    emit stateAdded(state);
+    added = true;
+  }
+
+  if (added)
+    emit modified();
+}
+
 void FSM::removeState(State *state) {
   if (!m_states.contains(state)) {
     return;
@@ -43,8 +63,12 @@ void FSM::removeState(State *state) {
     }
   }
 
-  // Remove collected transitions
+  // Remove collected transitions, also from the lists of the source states
+  // that stay, which would otherwise keep pointers to deleted transitions
   for (Transition *trans : transitionsToRemove) {
+    if (State *source = trans->sourceState()) {
+      source->removeTransition(trans);
+    }
     removeTransition(trans);
   }
 
@@ -101,6 +125,26 @@ State *FSM::stateById(const QString &id) const {
   return nullptr;
 }
 
+void FSM::moveStates(const QList<State *> &states,
+                     const QVector<QPointF> &positions) {
+  const int count = qMin(states.size(), positions.size());
+  QList<State *> moved;
+  moved.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    State *state = states[i];
+    if (!state || state->position() == positions[i])
+      continue;
+    const QSignalBlocker blocker(state);
+    state->setPosition(positions[i]);
+    moved.append(state);
+  }
+
+  if (!moved.isEmpty()) {
+    emit statesMoved(moved);
+    emit modified();
+  }
+}
+
 void FSM::addTransition(Transition *transition) {
   if (transition && !m_transitions.contains(transition)) {
     m_transitions.append(transition);
@@ -110,6 +154,25 @@ void FSM::addTransition(Transition *transition) {
   }
 }
 
+void FSM::addTransitions(const QList<Transition *> &transitions) {
+  QSet<Transition *> known(m_transitions.cbegin(), m_transitions.cend());
+  m_transitions.reserve(m_transitions.size() + transitions.size());
+
+  bool added = false;
+  for (Transition *transition : transitions) {
+    if (!transition || known.contains(transition))
+      continue;
+    known.insert(transition);
+    m_transitions.append(transition);
+    transition->setParent(this);
+    emit transitionAdded(transition);
+    added = true;
+  }
+
+  if (added)
+    emit modified();
+}
+
 void FSM::removeTransition(Transition *transition) {
   if (m_transitions.removeOne(transition)) {
     emit transitionRemoved(transition);
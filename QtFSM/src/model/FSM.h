@@ -6,7 +6,9 @@
 #include "Transition.h"
 #include <QList>
 #include <QObject>
+#include <QPointF>
 #include <QString>
+#include <QVector>
 
 /**
  * @brief The FSM (Finite State Machine) class serves as the root container and
@@ -78,8 +80,19 @@ public:
    */
   void addState(State *state);
 
+  /**
+   * @brief Adds many States at once, e.g. when loading a project.
+   * Duplicates are filtered with a hash lookup instead of a list scan, and
+   * modified() is emitted once for the whole batch.
+   * @param states The States to add; the FSM takes ownership.
+   * @emit stateAdded for each added state
+   */
+  void addStates(const QList<State *> &states);
+
   /**
    * @brief Removes a State from the FSM and deletes it.
+   * Transitions from or to the state are removed and deleted too, and taken
+   * out of their source state's transition list.
    * @param state Pointer to the State to remove.
    * @emit stateRemoved
    */
@@ -107,6 +120,17 @@ public:
    */
   State *stateById(const QString &id) const;
 
+  /**
+   * @brief Moves many States at once, e.g. after an auto-layout.
+   * The states do not emit positionChanged; listeners get one statesMoved()
+   * for the whole batch instead. States already at their target are skipped.
+   * @param states The States to move.
+   * @param positions The new positions, in the same order as @p states.
+   * @emit statesMoved
+   */
+  void moveStates(const QList<State *> &states,
+                  const QVector<QPointF> &positions);
+
   // =========================================================================
   // Transition Management
   // =========================================================================
@@ -119,6 +143,15 @@ public:
    */
   void addTransition(Transition *transition);
 
+  /**
+   * @brief Adds many Transitions at once, e.g. after importing code.
+   * Duplicates are filtered with a hash lookup instead of a list scan, and
+   * modified() is emitted once for the whole batch.
+   * @param transitions The Transitions to add; the FSM takes ownership.
+   * @emit transitionAdded for each added transition
+   */
+  void addTransitions(const QList<Transition *> &transitions);
+
   /**
    * @brief Removes a Transition from the FSM and deletes it.
    * @param transition Pointer to the Transition to remove.
@@ -206,6 +239,12 @@ signals:
    */
   void stateRemoved(State *state);
 
+  /**
+   * @brief Emitted once when moveStates() has moved a batch of states.
+   * @param states The states whose position changed.
+   */
+  void statesMoved(const QList<State *> &states);
+
   /**
    * @brief Emitted when a new transition is added.
    * @param transition The added transition.
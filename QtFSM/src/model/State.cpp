@@ -1,5 +1,6 @@
 #include "State.h"
 #include "Transition.h"
+#include <QSet>
 #include <QUuid>
 
 State::State(QObject *parent)
@@ -84,6 +85,17 @@ void State::addTransition(Transition *transition) {
   }
 }
 
+void State::addTransitions(const QList<Transition *> &transitions) {
+  QSet<Transition *> known(m_transitions.cbegin(), m_transitions.cend());
+  m_transitions.reserve(m_transitions.size() + transitions.size());
+  for (Transition *transition : transitions) {
+    if (transition && !known.contains(transition)) {
+      known.insert(transition);
+      m_transitions.append(transition);
+    }
+  }
+}
+
 void State::removeTransition(Transition *transition) {
   m_transitions.removeAll(transition);
 }
@@ -166,6 +166,12 @@ public:
    */
   void addTransition(Transition *transition);
 
+  /**
+   * @brief Adds several outgoing transitions, skipping ones already present.
+   * @param transitions The transitions to add.
+   */
+  void addTransitions(const QList<Transition *> &transitions);
+
   /**
    * @brief Removes an outgoing transition from this state.
    * @param transition Pointer to the transition to remove.
@@ -2,13 +2,15 @@
 
 #include <QString>
 #include <QVector>
-#include <memory>
 
 namespace FSMParser {
 
 // Forward declarations
 class ASTVisitor;
 
+// All nodes are allocated in the ASTArena of the CppParser that produced them.
+// Child pointers are non-owning; the arena destroys every node at once.
+
 // Base AST Node
 class ASTNode {
 public:
@@ -40,9 +42,9 @@ public:
 
 class BinaryExpr : public Expression {
 public:
-  std::unique_ptr<Expression> left;
+  Expression *left;
   QString op;
-  std::unique_ptr<Expression> right;
+  Expression *right;
 
   BinaryExpr(Expression *l, const QString &o, Expression *r)
       : left(l), op(o), right(r) {}
@@ -51,7 +53,7 @@ public:
 
 class MemberAccessExpr : public Expression {
 public:
-  std::unique_ptr<Expression> object;
+  Expression *object;
   QString member;
 
   MemberAccessExpr(Expression *obj, const QString &mem)
@@ -75,7 +77,7 @@ public:
 
 class ReturnStatement : public Statement {
 public:
-  std::unique_ptr<Expression> value;
+  Expression *value;
 
   explicit ReturnStatement(Expression *v = nullptr) : value(v) {}
   void accept(ASTVisitor *visitor) override;
@@ -83,15 +85,11 @@ public:
 
 class IfStatement : public Statement {
 public:
-  std::unique_ptr<Expression> condition;
+  Expression *condition;
   QVector<Statement *> thenBlock;
   QVector<Statement *> elseBlock;
 
   IfStatement(Expression *cond) : condition(cond) {}
-  ~IfStatement() {
-    qDeleteAll(thenBlock);
-    qDeleteAll(elseBlock);
-  }
   void accept(ASTVisitor *visitor) override;
 };
 
@@ -116,7 +114,6 @@ public:
 
   FunctionDecl(const QString &ret, const QString &n)
       : returnType(ret), name(n) {}
-  ~FunctionDecl() { qDeleteAll(body); }
   void accept(ASTVisitor *visitor) override;
 };
 
@@ -125,9 +122,10 @@ public:
   QString name;
   QString baseClass;
   QVector<FunctionDecl *> methods;
+  int sourceBegin = 0; // Offset of 'class' in the source
+  int sourceEnd = 0;   // One past the closing '}' (or ';')
 
   ClassDecl(const QString &n) : name(n) {}
-  ~ClassDecl() { qDeleteAll(methods); }
   void accept(ASTVisitor *visitor) override;
 };
 
@@ -0,0 +1,50 @@
+#include "ASTArena.h"
+
+#include <cstdint>
+
+namespace FSMParser {
+
+ASTArena::~ASTArena() { release(); }
+
+void *ASTArena::allocate(std::size_t size, std::size_t alignment) {
+  auto cursor = reinterpret_cast<std::uintptr_t>(m_cursor);
+  std::uintptr_t aligned = (cursor + alignment - 1) & ~(alignment - 1);
+
+  if (!m_cursor || aligned + size > reinterpret_cast<std::uintptr_t>(m_end)) {
+    // Start a new block. Oversized requests get a block of their own.
+    std::size_t blockSize = qMax(BlockSize, size + alignment);
+    char *block = static_cast<char *>(::operator new(blockSize));
+    m_blocks.append(block);
+    m_cursor = block;
+    m_end = block + blockSize;
+
+    cursor = reinterpret_cast<std::uintptr_t>(m_cursor);
+    aligned = (cursor + alignment - 1) & ~(alignment - 1);
+  }
+
+  char *result = reinterpret_cast<char *>(aligned);
+  m_bytesUsed += (result + size) - m_cursor;
+  m_nodeCount++;
+  m_cursor = result + size;
+  return result;
+}
+
+void ASTArena::release() {
+  // Node destructors never touch their children, so this is a flat loop
+  // rather than a recursive teardown of the tree.
+  for (auto it = m_destructors.crbegin(); it != m_destructors.crend(); ++it) {
+    it->destroy(it->object);
+  }
+  m_destructors.clear();
+
+  for (char *block : m_blocks) {
+    ::operator delete(block);
+  }
+  m_blocks.clear();
+  m_cursor = nullptr;
+  m_end = nullptr;
+  m_bytesUsed = 0;
+  m_nodeCount = 0;
+}
+
+} // namespace FSMParser
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QVector>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace FSMParser {
+
+/**
+ * @brief The ASTArena class is a bump-pointer allocator for AST nodes.
+ *
+ * All nodes produced by one CppParser run are placement-constructed into
+ * large blocks owned by the arena. Child pointers inside the tree are
+ * therefore non-owning; instead of a recursive delete cascade the arena runs
+ * each node's own destructor (releasing its QStrings and QVectors) in reverse
+ * creation order and frees the blocks in one go.
+ *
+ * @ingroup Parsing
+ */
+class ASTArena {
+public:
+  ASTArena() = default;
+  ~ASTArena();
+
+  ASTArena(const ASTArena &) = delete;
+  ASTArena &operator=(const ASTArena &) = delete;
+
+  /**
+   * @brief Constructs a node of type T inside the arena.
+   * @param args Constructor arguments forwarded to T.
+   * @return Pointer to the node, valid until release() or destruction.
+   */
+  template <typename T, typename... Args> T *create(Args &&...args) {
+    void *memory = allocate(sizeof(T), alignof(T));
+    T *object = new (memory) T(std::forward<Args>(args)...);
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      m_destructors.append({object, &destroy<T>});
+    }
+    return object;
+  }
+
+  /**
+   * @brief Destroys every node and frees all blocks.
+   */
+  void release();
+
+  /**
+   * @brief Gets the number of memory blocks currently allocated.
+   * @return The block count.
+   */
+  int blockCount() const { return m_blocks.size(); }
+
+  /**
+   * @brief Gets the number of bytes handed out to nodes (including padding).
+   * @return The used byte count.
+   */
+  std::size_t bytesUsed() const { return m_bytesUsed; }
+
+  /**
+   * @brief Gets the number of nodes created since the last release().
+   * @return The node count.
+   */
+  int nodeCount() const { return m_nodeCount; }
+
+private:
+  struct Destructor {
+    void *object;
+    void (*destroy)(void *);
+  };
+
+  template <typename T> static void destroy(void *object) {
+    static_cast<T *>(object)->~T();
+  }
+
+  void *allocate(std::size_t size, std::size_t alignment);
+
+  static constexpr std::size_t BlockSize = 64 * 1024;
+
+  QVector<char *> m_blocks;
+  char *m_cursor = nullptr;
+  char *m_end = nullptr;
+  std::size_t m_bytesUsed = 0;
+  int m_nodeCount = 0;
+  QVector<Destructor> m_destructors;
+};
+
+} // namespace FSMParser
@@ -9,7 +9,10 @@
 #include "Lexer.h"
 #include "ModelBuilder.h"
 
+#include <QByteArray>
+#include <QByteArrayView>
 #include <QDebug>
+#include <QFile>
 #include <QRegularExpression>
 
 using namespace FSMParser;
@@ -19,11 +22,51 @@ CodeParser::CodeParser() {}
 QString CodeParser::lastError() const { return m_lastError; }
 
 FSM *CodeParser::parse(const QString &code, QObject *parent) {
+  m_stats.clear();
   if (code.isEmpty()) {
     m_lastError = "Empty code";
     return nullptr;
   }
 
+  Lexer lexer(code);
+  return parseWith(lexer, parent);
+}
+
+FSM *CodeParser::parseFile(const QString &path, QObject *parent) {
+  m_stats.clear();
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    m_lastError = "Cannot open " + path + ": " + file.errorString();
+    return nullptr;
+  }
+
+  // The mapping stays valid until the file is closed, which outlives the
+  // lexer below. Files that cannot be mapped (pipes, some network drives)
+  // are read into memory instead.
+  QByteArray contents;
+  QByteArrayView source;
+  if (file.size() > 0) {
+    if (const uchar *mapped = file.map(0, file.size())) {
+      source = QByteArrayView(mapped, file.size());
+    } else {
+      contents = file.readAll();
+      source = contents;
+    }
+  }
+  if (source.startsWith("\xEF\xBB\xBF")) {
+    source = source.sliced(3); // UTF-8 byte order mark
+  }
+
+  if (source.isEmpty()) {
+    m_lastError = "Empty code";
+    return nullptr;
+  }
+
+  Lexer lexer = Lexer::fromUtf8(source);
+  return parseWith(lexer, parent);
+}
+
+FSM *CodeParser::parseWith(Lexer &lexer, QObject *parent) {
   FSM *fsm = new FSM(parent);
 
   // 1. Try to find FSM name
@@ -34,43 +77,35 @@ FSM *CodeParser::parse(const QString &code, QObject *parent) {
   // Parse States
   // Use new lexer-parser-AST system
   try {
-    // Step 1: Tokenize
-    Lexer lexer(code);
-    QVector<Token> tokens = lexer.tokenize();
-
-    // Debug: Show first tokens
-    // Debug: Show middle tokens
-    qDebug() << "=== Tokens 30-100 ===";
-    for (int i = 30; i < qMin(100, tokens.size()); i++) {
-      qDebug().nospace() << "[" << i << "] Line " << tokens[i].line << ": "
-                         << tokens[i].typeName() << " = '" << tokens[i].value
-                         << "'";
+    // Step 1 + 2: Tokenize and parse to AST. The parser pulls tokens from
+    // the lexer as it needs them, so the full token vector is never built.
+    CppParser parser(lexer);
+    QVector<ClassDecl *> classes;
+    {
+      ParseStageTimer timer(m_stats, ParseStats::Parsing);
+      classes = parser.parse();
     }
-
-    // Step 2: Parse to AST
-    CppParser parser(tokens);
-    QVector<ClassDecl *> classes = parser.parse();
+    m_stats.addParser(parser);
 
     if (parser.hasError()) {
       m_lastError = "Parser error: " + parser.errorMessage();
       qDebug() << m_lastError;
-      qDeleteAll(classes);
       delete fsm;
       return nullptr;
     }
 
     // Step 3: Build FSM model from AST
-    ModelBuilder builder(fsm);
-    builder.build(classes);
-
-    // Cleanup AST
-    qDeleteAll(classes);
-
-    qDebug() << "✅ New parser: Parsed" << fsm->states().size() << "states";
-    for (State *state : fsm->states()) {
-      qDebug() << "  State:" << state->name() << "with"
-               << state->transitions().size() << "transitions";
+    {
+      ParseStageTimer timer(m_stats, ParseStats::ModelBuilding);
+      ModelBuilder builder(fsm);
+      builder.build(classes);
     }
+    m_stats.setModel(fsm);
+    // Every state and transition is a new QObject
+    m_stats.allocations[ParseStats::ModelBuilding] =
+        m_stats.states + m_stats.transitions;
+
+    // The AST is released with the parser's arena when it goes out of scope
 
   } catch (...) {
     m_lastError = "Parser exception";
@@ -1,11 +1,16 @@
 #ifndef CODEPARSER_H
 #define CODEPARSER_H
 
+#include "ParseStats.h"
 #include <QString>
 
 class FSM;
 class QObject;
 
+namespace FSMParser {
+class Lexer;
+}
+
 /**
  * @brief The CodeParser class represents the high-level interface for parsing
  * C++ code.
@@ -35,14 +40,36 @@ public:
    */
   FSM *parse(const QString &code, QObject *parent = nullptr);
 
+  /**
+   * @brief Parses a UTF-8 C++ source file to reconstruct an FSM.
+   *
+   * The file is memory-mapped and lexed in place (see Lexer::fromUtf8), so
+   * large inputs are never copied into a QString. Falls back to reading the
+   * file when it cannot be mapped.
+   *
+   * @param path The file to parse.
+   * @param parent The parent QObject for the new FSM (for memory management).
+   * @return A pointer to the newly created FSM, or nullptr if parsing failed.
+   */
+  FSM *parseFile(const QString &path, QObject *parent = nullptr);
+
   /**
    * @brief Gets the last error message encountered during parsing.
    * @return A string description of the error, or empty string if success.
    */
   QString lastError() const;
 
+  /**
+   * @brief Gets timings and counters of the last parse() call.
+   * @return The stats; the SceneRebuild stage is left to the caller.
+   */
+  const ParseStats &stats() const { return m_stats; }
+
 private:
+  FSM *parseWith(FSMParser::Lexer &lexer, QObject *parent);
+
   QString m_lastError;
+  ParseStats m_stats;
 };
 
 #endif // CODEPARSER_H
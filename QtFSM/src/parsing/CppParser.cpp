@@ -3,24 +3,24 @@
 
 namespace FSMParser {
 
-CppParser::CppParser(const QVector<Token> &tokens) : m_tokens(tokens) {}
+CppParser::CppParser(const QVector<Token> &tokens) : m_stream(tokens) {}
 
-Token CppParser::peek() const {
-  if (m_current >= m_tokens.size()) {
-    return Token(TokenType::EndOfFile);
-  }
-  return m_tokens[m_current];
-}
+CppParser::CppParser(Lexer &lexer) : m_stream(&lexer), m_lexer(&lexer) {}
+
+Token CppParser::peek() const { return m_stream.at(m_current); }
 
 Token CppParser::previous() const {
   if (m_current <= 0)
     return Token();
-  return m_tokens[m_current - 1];
+  return m_stream.at(m_current - 1);
 }
 
 Token CppParser::advance() {
-  if (!isAtEnd())
+  if (!isAtEnd()) {
     m_current++;
+    // Keep previous() available, everything older can be dropped
+    m_stream.release(m_current - 1);
+  }
   return previous();
 }
 
@@ -47,12 +47,55 @@ Token CppParser::consume(TokenType type, const QString &message) {
   return Token();
 }
 
+int CppParser::mark() {
+  // Pin the token before the mark too, so previous() still works after rewind
+  m_stream.mark(m_current - 1);
+  return m_current;
+}
+
+void CppParser::skipBlock(int openIndex) {
+  // Jump straight to the closing brace, then step over it like advance()
+  m_current = m_stream.matchingBrace(openIndex);
+  advance();
+}
+
+bool CppParser::atFunctionBody() const {
+  // Class bodies are entered by parseClass(); any other '{' at namespace scope
+  // after one of these opens a function body or an initializer
+  if (!check(TokenType::LeftBrace))
+    return false;
+  switch (previous().type) {
+  case TokenType::RightParen:
+  case TokenType::Keyword_Const:
+  case TokenType::Keyword_Override:
+  case TokenType::Keyword_Final:
+  case TokenType::Equal:
+    return true;
+  default:
+    return false;
+  }
+}
+
+void CppParser::rewind(int position) {
+  m_current = position;
+  m_stream.unmark();
+}
+
 void CppParser::error(const QString &message) {
   Token token = peek();
-  m_errorMessage = QString("Parse error at line %1: %2 (got '%3')")
-                       .arg(token.line)
-                       .arg(message)
-                       .arg(token.value);
+  m_errorOffset = token.offset;
+  m_errorDetail = QString("%1 (got '%2')").arg(message).arg(token.value);
+  if (!m_lexer) {
+    // Pre-tokenized input, no source to resolve the line against; callers
+    // with the source use errorOffset()
+    m_errorMessage = QString("Parse error at offset %1: %2")
+                         .arg(token.offset)
+                         .arg(m_errorDetail);
+    return;
+  }
+  m_errorMessage = QString("Parse error at line %1: %2")
+                       .arg(m_lexer->location(token.offset).line)
+                       .arg(m_errorDetail);
 }
 
 void CppParser::synchronize() {
@@ -74,10 +117,17 @@ QVector<ClassDecl *> CppParser::parse() {
   while (!isAtEnd()) {
     // Skip until we find 'class'
     if (match(TokenType::Keyword_Class)) {
+      int begin = previous().offset;
       ClassDecl *classDecl = parseClass();
       if (classDecl) {
+        Token last = previous();
+        classDecl->sourceBegin = begin;
+        classDecl->sourceEnd = last.offset + int(last.value.size());
         classes.append(classDecl);
       }
+    } else if (atFunctionBody()) {
+      // Out-of-line member definitions and free functions hold no states
+      skipBlock(m_current);
     } else {
       advance(); // Skip other tokens
     }
@@ -92,21 +142,21 @@ ClassDecl *CppParser::parseClass() {
   if (hasError())
     return nullptr;
 
-  ClassDecl *classDecl = new ClassDecl(nameToken.value);
+  QStringView className = nameToken.value;
 
   // Check for forward declaration: class Name;
   if (match(TokenType::Semicolon)) {
     // Forward declaration, skip it
-    delete classDecl;
     return nullptr;
   }
 
   // Optional: : public BaseClass
+  QStringView baseClass;
   if (match(TokenType::Colon)) {
     match(TokenType::Keyword_Public); // Skip access specifier
     Token baseToken =
         consume(TokenType::Identifier, "Expected base class name");
-    classDecl->baseClass = baseToken.value;
+    baseClass = baseToken.value;
   }
 
   // {
@@ -114,27 +164,21 @@ ClassDecl *CppParser::parseClass() {
 
   // Check if this is an FSM state class - only parse those in detail
   bool isFSMState =
-      (classDecl->baseClass == "MyFSMStateBase" ||
-       classDecl->baseClass == "State" || classDecl->name == "MyFSMStateBase" ||
-       classDecl->name.endsWith("StateBase") ||
-       (classDecl->name.endsWith("State") && classDecl->name != "BaseState"));
+      (baseClass == u"MyFSMStateBase" || baseClass == u"State" ||
+       className == u"MyFSMStateBase" || className.endsWith(u"StateBase") ||
+       (className.endsWith(u"State") && className != u"BaseState"));
 
   if (!isFSMState) {
-    // Skip non-FSM classes by consuming tokens until the closing brace
-    int braceCount = 1;
-    while (braceCount > 0 && !isAtEnd()) {
-      if (match(TokenType::LeftBrace)) {
-        braceCount++;
-      } else if (match(TokenType::RightBrace)) {
-        braceCount--;
-      } else {
-        advance();
-      }
-    }
-    delete classDecl;
+    // Skip non-FSM classes in one jump to the closing brace
+    if (previous().type == TokenType::LeftBrace)
+      skipBlock(m_current - 1);
     return nullptr;
   }
 
+  // Only FSM classes get a node in the arena
+  ClassDecl *classDecl = m_arena.create<ClassDecl>(className.toString());
+  classDecl->baseClass = baseClass.toString();
+
   // Parse class body (only for FSM state classes)
   while (!check(TokenType::RightBrace) && !isAtEnd()) {
     // Skip access specifiers
@@ -161,15 +205,8 @@ ClassDecl *CppParser::parseClass() {
       }
 
       if (check(TokenType::LeftBrace)) {
-        // Destructor with body, use brace counting
-        int braceCount = 0;
-        do {
-          if (check(TokenType::LeftBrace))
-            braceCount++;
-          if (check(TokenType::RightBrace))
-            braceCount--;
-          advance();
-        } while (braceCount > 0 && !isAtEnd());
+        // Destructor with body
+        skipBlock(m_current);
       }
 
       match(TokenType::Semicolon);
@@ -180,7 +217,7 @@ ClassDecl *CppParser::parseClass() {
     if (check(TokenType::Identifier) || check(TokenType::Keyword_Void) ||
         check(TokenType::Keyword_Const) || check(TokenType::Keyword_Auto)) {
       // Peek ahead to see if this looks like a function
-      int saved = m_current;
+      int saved = mark();
       Token first = advance(); //  Return type or constructor name
 
       if (first.type == TokenType::Keyword_Const) {
@@ -224,7 +261,7 @@ ClassDecl *CppParser::parseClass() {
 
         if (check(TokenType::LeftParen)) {
           // It IS a function!
-          m_current = saved;
+          rewind(saved);
           FunctionDecl *func = parseFunction();
           if (func) {
             func->isVirtual = isVirtual;
@@ -232,10 +269,8 @@ ClassDecl *CppParser::parseClass() {
           }
         } else {
           // Not a function (e.g. member variable: Type* name;)
-          qDebug() << "parseClass: Not a function (no LeftParen), skipping "
-                      "member variable";
           // Skip until semicolon
-          m_current = saved;
+          rewind(saved);
           while (!check(TokenType::Semicolon) &&
                  !check(TokenType::RightBrace) && !isAtEnd()) {
             advance();
@@ -245,20 +280,12 @@ ClassDecl *CppParser::parseClass() {
       } else if (check(TokenType::LeftParen) &&
                  first.value == classDecl->name) {
         // Constructor - only if the identifier matches the class name
-        qDebug() << "parseClass: Constructor detected, skipping";
-        m_current = saved;
+        rewind(saved);
         while (!check(TokenType::Semicolon) && !check(TokenType::RightBrace) &&
                !isAtEnd()) {
           if (check(TokenType::LeftBrace)) {
             // Constructor with body
-            int braceCount = 0;
-            do {
-              if (check(TokenType::LeftBrace))
-                braceCount++;
-              if (check(TokenType::RightBrace))
-                braceCount--;
-              advance();
-            } while (braceCount > 0 && !isAtEnd());
+            skipBlock(m_current);
             break;
           }
           advance();
@@ -266,7 +293,7 @@ ClassDecl *CppParser::parseClass() {
         match(TokenType::Semicolon);
       } else {
         // Unknown, skip
-        m_current = saved;
+        rewind(saved);
         advance();
       }
     } else {
@@ -351,7 +378,7 @@ FunctionDecl *CppParser::parseFunction() {
   QString funcName;
 
   if (check(TokenType::Identifier)) {
-    funcName = advance().value;
+    funcName = advance().value.toString();
 
     // Check for qualified function name (e.g., MyClass::myMethod)
     while (match(TokenType::DoubleColon)) {
@@ -367,16 +394,13 @@ FunctionDecl *CppParser::parseFunction() {
     return nullptr;
   }
 
-  FunctionDecl *func = new FunctionDecl(returnType, funcName);
+  FunctionDecl *func = m_arena.create<FunctionDecl>(returnType, funcName);
 
   // (
   consume(TokenType::LeftParen, "Expected '(' after function name");
 
   // Parameters
   while (!check(TokenType::RightParen) && !isAtEnd()) {
-    // Save position in case we need to backtrack
-    int savedPos = m_current;
-
     // Parse the qualified type (handles std::string, const MyClass&, etc.)
     QString typeStr = parseQualifiedType();
 
@@ -386,7 +410,7 @@ FunctionDecl *CppParser::parseFunction() {
     if (check(TokenType::Identifier)) {
       // We have both type and name: Type name
       param.type = typeStr;
-      param.name = advance().value;
+      param.name = advance().value.toString();
     } else if (!typeStr.isEmpty()) {
       // Only type, no name (unnamed parameter)
       param.type = typeStr;
@@ -426,17 +450,11 @@ FunctionDecl *CppParser::parseFunction() {
   if (!match(TokenType::LeftBrace)) {
     // Function declaration without body
     match(TokenType::Semicolon);
-    delete func;
-    return nullptr;
+    return nullptr; // The node stays in the arena until the parser goes away
   }
 
-  qDebug() << "parseFunction: Body loop start at" << m_current
-           << peek().typeName();
-
   // Parse function body
   while (!check(TokenType::RightBrace) && !isAtEnd()) {
-    qDebug() << "parseFunction: calling parseStatement at token" << m_current;
-
     Statement *stmt = parseStatement();
     if (stmt) {
       func->body.append(stmt);
@@ -470,6 +488,21 @@ Statement *CppParser::parseStatement() {
 }
 
 IfStatement *CppParser::parseIfStatement() {
+  if (m_depth >= MaxNestingDepth) {
+    // Nested ifs (and else-if chains) recurse, so pathological input could
+    // exhaust the stack. Skip the statement wholesale instead.
+    error("If statements nested too deeply");
+    while (!check(TokenType::LeftBrace) && !check(TokenType::Semicolon) &&
+           !check(TokenType::RightBrace) && !isAtEnd()) {
+      advance();
+    }
+    if (check(TokenType::LeftBrace)) {
+      skipBlock(m_current);
+    }
+    return nullptr;
+  }
+  m_depth++;
+
   // (
   consume(TokenType::LeftParen, "Expected '(' after 'if'");
 
@@ -479,7 +512,7 @@ IfStatement *CppParser::parseIfStatement() {
   // )
   consume(TokenType::RightParen, "Expected ')' after condition");
 
-  IfStatement *ifStmt = new IfStatement(condition);
+  IfStatement *ifStmt = m_arena.create<IfStatement>(condition);
 
   // {
   consume(TokenType::LeftBrace, "Expected '{' after if condition");
@@ -517,6 +550,7 @@ IfStatement *CppParser::parseIfStatement() {
     }
   }
 
+  m_depth--;
   return ifStmt;
 }
 
@@ -529,7 +563,7 @@ ReturnStatement *CppParser::parseReturnStatement() {
 
   consume(TokenType::Semicolon, "Expected ';' after return");
 
-  return new ReturnStatement(value);
+  return m_arena.create<ReturnStatement>(value);
 }
 
 Expression *CppParser::parseExpression() { return parseEquality(); }
@@ -538,9 +572,9 @@ Expression *CppParser::parseEquality() {
   Expression *expr = parseComparison();
 
   while (match(TokenType::EqualEqual) || match(TokenType::ExclaimEqual)) {
-    QString op = previous().value;
+    QString op = previous().value.toString();
     Expression *right = parseComparison();
-    expr = new BinaryExpr(expr, op, right);
+    expr = m_arena.create<BinaryExpr>(expr, op, right);
   }
 
   return expr;
@@ -558,7 +592,7 @@ Expression *CppParser::parsePostfix() {
   while (true) {
     if (match(TokenType::Dot)) {
       Token member = consume(TokenType::Identifier, "Expected member name");
-      expr = new MemberAccessExpr(expr, member.value);
+      expr = m_arena.create<MemberAccessExpr>(expr, member.value.toString());
     } else {
       break;
     }
@@ -581,15 +615,15 @@ Expression *CppParser::parsePrimary() {
         advance();
       consume(TokenType::RightParen, "Expected ')' after constructor args");
     }
-    return new NewExpr(typeName.value);
+    return m_arena.create<NewExpr>(typeName.value.toString());
   }
 
   if (match(TokenType::StringLiteral)) {
-    return new StringLiteralExpr(previous().value);
+    return m_arena.create<StringLiteralExpr>(previous().value.toString());
   }
 
   if (match(TokenType::Identifier)) {
-    QString name = previous().value;
+    QString name = previous().value.toString();
     while (match(TokenType::DoubleColon)) {
       name += "::";
       if (check(TokenType::Identifier)) {
@@ -602,12 +636,12 @@ Expression *CppParser::parsePrimary() {
       }
       consume(TokenType::RightParen, "Expected ')' after call");
     }
-    return new IdentifierExpr(name);
+    return m_arena.create<IdentifierExpr>(name);
   }
 
   // Unknown - skip
   advance();
-  return new IdentifierExpr("unknown");
+  return m_arena.create<IdentifierExpr>(QStringLiteral("unknown"));
 }
 
 Expression *CppParser::parseStaticCastExpression() {
@@ -651,7 +685,7 @@ Expression *CppParser::parseStaticCastExpression() {
     return innerExpr;
   }
 
-  return new IdentifierExpr("static_cast");
+  return m_arena.create<IdentifierExpr>(QStringLiteral("static_cast"));
 }
 
 void CppParser::skipEnumDeclaration() {
@@ -663,16 +697,7 @@ void CppParser::skipEnumDeclaration() {
   }
 
   if (match(TokenType::LeftBrace)) {
-    int braceCount = 1;
-    while (braceCount > 0 && !isAtEnd()) {
-      if (match(TokenType::LeftBrace)) {
-        braceCount++;
-      } else if (match(TokenType::RightBrace)) {
-        braceCount--;
-      } else {
-        advance();
-      }
-    }
+    skipBlock(m_current - 1);
     match(TokenType::Semicolon);
     return;
   }
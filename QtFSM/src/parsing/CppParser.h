@@ -1,7 +1,9 @@
 #pragma once
 
 #include "AST.h"
+#include "ASTArena.h"
 #include "Lexer.h"
+#include "TokenStream.h"
 #include <QString>
 #include <QVector>
 
@@ -26,10 +28,20 @@ public:
    */
   explicit CppParser(const QVector<Token> &tokens);
 
+  /**
+   * @brief Constructs a parser that pulls tokens from the lexer on demand.
+   *
+   * Lexing and parsing are interleaved; only the parser's lookahead window is
+   * buffered instead of the whole token vector.
+   * @param lexer The lexer to read from. Must outlive the parser.
+   */
+  explicit CppParser(Lexer &lexer);
+
   /**
    * @brief Parses the token stream into a list of class declarations.
    * This is the main entry point for the parsing process.
-   * @return A vector of pointers to ClassDecl AST nodes.
+   * @return A vector of pointers to ClassDecl AST nodes. The nodes are owned
+   * by the parser's arena and stay valid until the parser is destroyed.
    */
   QVector<ClassDecl *> parse();
 
@@ -45,10 +57,47 @@ public:
    */
   bool hasError() const { return !m_errorMessage.isEmpty(); }
 
+  /**
+   * @brief Gets the source offset of the token the error was reported at.
+   *
+   * Pre-tokenized input has no source to resolve lines against, so callers
+   * that have the source turn this into a line and column themselves, e.g.
+   * with Lexer::location().
+   * @return Token::offset of the offending token, or -1 without an error.
+   */
+  int errorOffset() const { return m_errorOffset; }
+
+  /**
+   * @brief Gets the error message without its location prefix.
+   * @return e.g. "Expected class name (got '{')".
+   */
+  QString errorDetail() const { return m_errorDetail; }
+
+  /**
+   * @brief Gets the token stream, e.g. for its token count and lexing time.
+   * @return The stream feeding this parser.
+   */
+  const TokenStream &tokenStream() const { return m_stream; }
+
+  /**
+   * @brief Gets the arena holding the AST, e.g. for its node count.
+   * @return The parser's arena.
+   */
+  const ASTArena &arena() const { return m_arena; }
+
 private:
-  QVector<Token> m_tokens;
+  // Deeper if-statement nesting is reported as an error rather than recursed
+  // into; ModelBuilder walks the same tree recursively.
+  static constexpr int MaxNestingDepth = 256;
+
+  mutable TokenStream m_stream; // Lexes lazily, hence mutable for peek()
+  const Lexer *m_lexer = nullptr; // For line numbers in diagnostics
   int m_current = 0;
+  int m_depth = 0; // Current if-statement nesting, see MaxNestingDepth
   QString m_errorMessage;
+  QString m_errorDetail;
+  int m_errorOffset = -1;
+  ASTArena m_arena; // Owns every node produced by parse()
 
   // Token navigation
   Token peek() const;
@@ -58,6 +107,8 @@ private:
   bool match(TokenType type);
   bool isAtEnd() const;
   Token consume(TokenType type, const QString &message);
+  int mark();
+  void rewind(int position);
 
   // Error handling
   void error(const QString &message);
@@ -84,6 +135,8 @@ private:
   void skipTo(TokenType type);
   void skipUntilBrace();
   void skipEnumDeclaration();
+  void skipBlock(int openIndex);
+  bool atFunctionBody() const;
   QString parseQualifiedType();
 };
 
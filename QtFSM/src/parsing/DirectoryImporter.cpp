@@ -0,0 +1,310 @@
+#include "DirectoryImporter.h"
+#include "../model/FSM.h"
+#include "../model/State.h"
+#include "CppParser.h"
+#include "Lexer.h"
+#include "ModelBuilder.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSharedPointer>
+#include <QtConcurrent>
+#include <atomic>
+
+using namespace FSMParser;
+
+namespace {
+
+// One top-level class of a file. The tokens view into source, which is
+// shared (not copied) between all classes of the file.
+struct ClassChunk {
+  QString file;
+  QString source;
+  QVector<Token> tokens;
+};
+
+struct FileScan {
+  QString error;
+  QVector<ClassChunk> chunks;
+};
+
+// The parser owns the AST arena, so it has to live until the model is built
+struct ParsedChunk {
+  QString file;
+  QString source;
+  QSharedPointer<CppParser> parser;
+  QVector<ClassDecl *> classes;
+  QString error;
+  int errorOffset = -1; ///< Where a parse error was reported, see error
+};
+
+FileScan scanFile(const QString &fileName) {
+  FileScan scan;
+
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    scan.error = QString("%1: %2").arg(fileName, file.errorString());
+    return scan;
+  }
+  QString source = QString::fromUtf8(file.readAll());
+
+  Lexer lexer(source);
+  QVector<Token> tokens = lexer.tokenize();
+
+  const auto ranges = DirectoryImporter::topLevelClassRanges(tokens);
+  for (const auto &range : ranges) {
+    scan.chunks.append(
+        {fileName, source, tokens.mid(range.first, range.second - range.first)});
+  }
+  return scan;
+}
+
+ParsedChunk parseChunk(const ClassChunk &chunk) {
+  ParsedChunk parsed;
+  parsed.file = chunk.file;
+  parsed.source = chunk.source;
+  parsed.parser = QSharedPointer<CppParser>::create(chunk.tokens);
+  try {
+    parsed.classes = parsed.parser->parse();
+    if (parsed.parser->hasError()) {
+      // Resolved to file:line:col once the parallel stage is done
+      parsed.error = parsed.parser->errorDetail();
+      parsed.errorOffset = parsed.parser->errorOffset();
+    }
+  } catch (...) {
+    parsed.error = QString("%1: Parser exception").arg(chunk.file);
+  }
+  return parsed;
+}
+
+} // namespace
+
+DirectoryImporter::DirectoryImporter() {}
+
+QStringList DirectoryImporter::nameFilters() {
+  return {"*.h", "*.hh", "*.hpp", "*.hxx", "*.cpp", "*.cc", "*.cxx"};
+}
+
+QVector<QPair<int, int>>
+DirectoryImporter::topLevelClassRanges(const QVector<Token> &tokens) {
+  QVector<QPair<int, int>> ranges;
+  QVector<bool> braceIsNamespace; // One entry per open brace
+  int depth = 0;                  // Open non-namespace braces
+  int classStart = -1;
+  bool pendingNamespace = false;
+  bool pendingTemplate = false;
+  int templateDepth = 0; // Open '<' of template parameter lists
+
+  for (int i = 0; i < tokens.size(); ++i) {
+    const Token &token = tokens.at(i);
+
+    switch (token.type) {
+    case TokenType::Identifier:
+      if (depth == 0 && classStart < 0 && token.value == u"namespace") {
+        pendingNamespace = true;
+      } else if (depth == 0 && token.value == u"template") {
+        pendingTemplate = true;
+      }
+      break;
+
+    case TokenType::Less:
+      if (depth == 0 && (pendingTemplate || templateDepth > 0)) {
+        templateDepth++;
+      }
+      pendingTemplate = false;
+      break;
+
+    case TokenType::Greater:
+      if (templateDepth > 0) {
+        templateDepth--;
+      }
+      break;
+
+    case TokenType::StringLiteral:
+      // extern "C" { ... } is transparent like a namespace
+      if (depth == 0 && classStart < 0 && i > 0 &&
+          tokens.at(i - 1).value == u"extern") {
+        pendingNamespace = true;
+      }
+      break;
+
+    case TokenType::Keyword_Class:
+      // 'class' inside template <...> names a parameter, not a class, so
+      // template <class T> void f() {} is no class range
+      if (depth == 0 && templateDepth == 0) {
+        classStart = i;
+      }
+      break;
+
+    case TokenType::LeftBrace:
+      braceIsNamespace.append(pendingNamespace);
+      if (!pendingNamespace) {
+        depth++;
+      }
+      pendingNamespace = false;
+      break;
+
+    case TokenType::RightBrace: {
+      if (braceIsNamespace.isEmpty())
+        break;
+      bool wasNamespace = braceIsNamespace.takeLast();
+      if (wasNamespace)
+        break;
+      depth--;
+      if (depth == 0 && classStart >= 0) {
+        int end = i + 1;
+        if (end < tokens.size() && tokens.at(end).type == TokenType::Semicolon)
+          end++;
+        ranges.append({classStart, end});
+        classStart = -1;
+        i = end - 1;
+      }
+      break;
+    }
+
+    case TokenType::Semicolon:
+      // Forward declaration or namespace alias
+      if (depth == 0) {
+        classStart = -1;
+        pendingNamespace = false;
+        pendingTemplate = false;
+        templateDepth = 0;
+      }
+      break;
+
+    default:
+      break;
+    }
+
+    if (token.type == TokenType::EndOfFile)
+      break;
+  }
+
+  return ranges;
+}
+
+FSM *DirectoryImporter::importDirectory(const QString &directory,
+                                        QObject *parent,
+                                        const Progress &progress) {
+  if (!QFileInfo(directory).isDir()) {
+    m_lastError = QString("Not a directory: %1").arg(directory);
+    return nullptr;
+  }
+
+  QStringList files;
+  QDirIterator it(directory, nameFilters(), QDir::Files,
+                  QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    files.append(it.next());
+  }
+  // Directory iteration order is platform dependent; sort for a stable model
+  files.sort();
+
+  FSM *fsm = importFiles(files, parent, progress);
+  if (fsm && fsm->name().isEmpty()) {
+    fsm->setName(QDir(directory).dirName());
+  }
+  return fsm;
+}
+
+FSM *DirectoryImporter::importFiles(const QStringList &files,
+                                    QObject *parent,
+                                    const Progress &progress) {
+  m_lastError.clear();
+  m_warnings.clear();
+  m_fileCount = files.size();
+  m_classCount = 0;
+
+  // Once canceled, the remaining files and classes are skipped
+  std::atomic<int> done{0};
+  std::atomic<bool> canceled{false};
+  int total = files.size();
+  auto step = [&]() {
+    if (progress && !progress(++done, total)) {
+      canceled = true;
+    }
+  };
+
+  // Stage 1: read, tokenize and prescan every file in parallel
+  const QList<FileScan> scans = QtConcurrent::blockingMapped<QList<FileScan>>(
+      files, [&](const QString &fileName) {
+        if (canceled) {
+          return FileScan();
+        }
+        FileScan scan = scanFile(fileName);
+        step();
+        return scan;
+      });
+  if (canceled) {
+    m_lastError = "Import canceled";
+    return nullptr;
+  }
+
+  QList<ClassChunk> chunks;
+  for (const FileScan &scan : scans) {
+    if (!scan.error.isEmpty()) {
+      m_warnings.append(scan.error);
+    }
+    chunks.append(scan.chunks);
+  }
+  m_classCount = chunks.size();
+  total += m_classCount;
+
+  // Stage 2: parse every class on its own, also in parallel. Results come
+  // back in input order, which keeps the model deterministic.
+  const QList<ParsedChunk> parsed =
+      QtConcurrent::blockingMapped<QList<ParsedChunk>>(
+          chunks, [&](const ClassChunk &chunk) {
+            if (canceled) {
+              return ParsedChunk();
+            }
+            ParsedChunk result = parseChunk(chunk);
+            step();
+            return result;
+          });
+  if (canceled) {
+    m_lastError = "Import canceled";
+    return nullptr;
+  }
+
+  QVector<ClassDecl *> classes;
+  for (const ParsedChunk &chunk : parsed) {
+    if (!chunk.error.isEmpty()) {
+      // A broken class must not take the whole import down. The newline
+      // index is only built for files that have an error.
+      if (chunk.errorOffset >= 0) {
+        const SourceLocation location =
+            Lexer(chunk.source).location(chunk.errorOffset);
+        m_warnings.append(QString("%1:%2:%3: %4")
+                              .arg(chunk.file)
+                              .arg(location.line)
+                              .arg(location.column)
+                              .arg(chunk.error));
+      } else {
+        m_warnings.append(chunk.error);
+      }
+      continue;
+    }
+    classes.append(chunk.classes);
+  }
+
+  // Stage 3: one ModelBuilder pass over the merged ASTs, so cross-file
+  // transitions resolve to the same states
+  FSM *fsm = new FSM(parent);
+  ModelBuilder builder(fsm);
+  builder.build(classes);
+
+  if (fsm->states().isEmpty()) {
+    m_lastError = "No state classes found";
+    delete fsm;
+    return nullptr;
+  }
+
+  // Set first found state as initial
+  fsm->setInitialState(fsm->states().first());
+  fsm->states().first()->setInitial(true);
+
+  return fsm;
+}
@@ -0,0 +1,117 @@
+#ifndef DIRECTORYIMPORTER_H
+#define DIRECTORYIMPORTER_H
+
+#include "Token.h"
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+
+class FSM;
+class QObject;
+
+/**
+ * @brief The DirectoryImporter class reverse-engineers one FSM from many C++
+ * files at once.
+ *
+ * Work is spread over the global thread pool in two stages. First every file
+ * is read, tokenized and pre-scanned for top-level `class` ranges (namespace
+ * braces are looked through); then every class range is parsed on its own.
+ * Code outside those ranges (free functions, includes, ...) is never parsed.
+ * The resulting ASTs are merged in file order and handed to a single
+ * `ModelBuilder` pass, so transitions may target states declared in other
+ * files.
+ *
+ * Nothing touches the GUI, so a whole import may itself run on a worker
+ * thread; a progress callback reports the work done and can cancel it.
+ *
+ * @ingroup Parsing
+ */
+class DirectoryImporter {
+public:
+  /**
+   * @brief Constructs a new DirectoryImporter.
+   */
+  DirectoryImporter();
+
+  /**
+   * @brief Reports progress: files read, then files read plus classes
+   * parsed, out of a total that grows once the classes are known.
+   *
+   * Called from the worker threads, possibly several at once.
+   * @return false to cancel the import.
+   */
+  using Progress = std::function<bool(int done, int total)>;
+
+  /**
+   * @brief Imports all C++ sources and headers below a directory
+   * (recursively).
+   * @param directory The root directory to scan.
+   * @param parent The parent QObject for the new FSM.
+   * @param progress Optional progress callback.
+   * @return The new FSM, or nullptr if no state class was found or the
+   * import was canceled.
+   */
+  FSM *importDirectory(const QString &directory, QObject *parent = nullptr,
+                       const Progress &progress = Progress());
+
+  /**
+   * @brief Imports the given C++ files.
+   * @param files Paths of the files to parse.
+   * @param parent The parent QObject for the new FSM.
+   * @param progress Optional progress callback.
+   * @return The new FSM, or nullptr if no state class was found or the
+   * import was canceled.
+   */
+  FSM *importFiles(const QStringList &files, QObject *parent = nullptr,
+                   const Progress &progress = Progress());
+
+  /**
+   * @brief Gets the last error message encountered during import.
+   * @return A description of the fatal error, or an empty string.
+   */
+  QString lastError() const { return m_lastError; }
+
+  /**
+   * @brief Gets the non-fatal problems of the last import (unreadable files,
+   * classes that failed to parse and were skipped).
+   * @return One message per problem.
+   */
+  QStringList warnings() const { return m_warnings; }
+
+  /**
+   * @brief Gets the number of files read by the last import.
+   */
+  int fileCount() const { return m_fileCount; }
+
+  /**
+   * @brief Gets the number of class ranges parsed by the last import.
+   */
+  int classCount() const { return m_classCount; }
+
+  /**
+   * @brief Gets the file name patterns picked up by importDirectory().
+   */
+  static QStringList nameFilters();
+
+  /**
+   * @brief Finds the token ranges [begin, end) of top-level classes.
+   *
+   * Braces of `namespace` and `extern "C"` blocks do not count as nesting,
+   * so classes inside them are found too. Forward declarations are skipped.
+   *
+   * @param tokens Tokens of a whole file.
+   * @return Token index ranges, in source order.
+   */
+  static QVector<QPair<int, int>>
+  topLevelClassRanges(const QVector<FSMParser::Token> &tokens);
+
+private:
+  QString m_lastError;
+  QStringList m_warnings;
+  int m_fileCount = 0;
+  int m_classCount = 0;
+};
+
+#endif // DIRECTORYIMPORTER_H
@@ -0,0 +1,308 @@
+#include "IncrementalParser.h"
+#include "../model/FSM.h"
+#include "../model/State.h"
+#include "../model/Transition.h"
+#include "CppParser.h"
+#include "Lexer.h"
+#include "ModelBuilder.h"
+#include <QHash>
+#include <QSet>
+#include <algorithm>
+
+using namespace FSMParser;
+
+namespace {
+
+// A block comment opened but not closed inside the window would hide code
+// after it, which only a full parse handles correctly.
+bool hasOpenBlockComment(QStringView text) {
+  return text.lastIndexOf(u"/*") > text.lastIndexOf(u"*/");
+}
+
+// Likewise a brace left open inside the window (say, an unfinished function
+// body): a full parse skips that block to the end of the file and drops every
+// class after it, while the window would end cleanly and keep them.
+bool hasOpenBrace(QStringView text) {
+  Lexer lexer(text);
+  const QVector<Token> tokens = lexer.tokenize();
+  return std::any_of(tokens.cbegin(), tokens.cend(), [](const Token &token) {
+    return token.type == TokenType::LeftBrace && token.match == 0;
+  });
+}
+
+QString transitionKey(const QString &event, const QString &target) {
+  return target + QLatin1Char('\n') + event;
+}
+
+// FSM::removeTransition does not touch the source state's list
+void removeTransition(FSM *fsm, Transition *transition) {
+  if (State *source = transition->sourceState()) {
+    source->removeTransition(transition);
+  }
+  fsm->removeTransition(transition);
+}
+
+} // namespace
+
+IncrementalParser::IncrementalParser() {}
+
+void IncrementalParser::reset() {
+  m_fsm = nullptr;
+  m_code.clear();
+  m_segments.clear();
+}
+
+bool IncrementalParser::update(FSM *fsm, const QString &code) {
+  m_stats.clear();
+  m_lastError.clear();
+  m_addedStates.clear();
+  m_removedStateCount = 0;
+  m_reparsedClassCount = 0;
+
+  if (!fsm) {
+    m_lastError = "No FSM to update";
+    return false;
+  }
+  if (m_fsm != fsm) {
+    reset();
+  }
+
+  // 1. Find the edited span. Everything in the common prefix and suffix of
+  // the old and new code is untouched.
+  const int oldLength = m_code.size();
+  const int newLength = code.size();
+  const int maxCommon = qMin(oldLength, newLength);
+  const QChar *oldData = m_code.constData();
+  const QChar *newData = code.constData();
+
+  const int prefix = int(
+      std::mismatch(oldData, oldData + maxCommon, newData).first - oldData);
+  int suffix = 0;
+  while (suffix < maxCommon - prefix &&
+         oldData[oldLength - 1 - suffix] == newData[newLength - 1 - suffix]) {
+    suffix++;
+  }
+  const int changedEnd = oldLength - suffix; // In old coordinates
+  const int delta = newLength - oldLength;
+
+  // 2. Keep the classes entirely outside the edited span and reparse the
+  // window between the nearest kept classes on either side.
+  QVector<ClassSegment> before;
+  QVector<ClassSegment> after;
+  for (const ClassSegment &segment : std::as_const(m_segments)) {
+    if (segment.end <= prefix) {
+      before.append(segment);
+    } else if (segment.begin >= changedEnd) {
+      ClassSegment moved = segment;
+      moved.begin += delta;
+      moved.end += delta;
+      after.append(moved);
+    }
+  }
+
+  int windowBegin = before.isEmpty() ? 0 : before.last().end;
+  int windowEnd = after.isEmpty() ? newLength : after.first().begin;
+
+  const QStringView window =
+      QStringView(code).mid(windowBegin, windowEnd - windowBegin);
+  if (hasOpenBlockComment(window) ||
+      (!after.isEmpty() && hasOpenBrace(window))) {
+    before.clear();
+    after.clear();
+    windowBegin = 0;
+    windowEnd = newLength;
+  }
+
+  QVector<ClassSegment> reparsed;
+  if (!parseWindow(code, windowBegin, windowEnd, reparsed)) {
+    if (windowBegin == 0 && windowEnd == newLength) {
+      return false;
+    }
+    // The edit may have moved class boundaries; a full parse settles it and
+    // reports errors with real line numbers.
+    before.clear();
+    after.clear();
+    reparsed.clear();
+    m_lastError.clear();
+    if (!parseWindow(code, 0, newLength, reparsed)) {
+      return false;
+    }
+  }
+  m_reparsedClassCount = reparsed.size();
+
+  m_fsm = fsm;
+  m_code = code;
+  m_segments = before + reparsed + after;
+
+  // 3. Bring the live FSM in line with the segments
+  {
+    ParseStageTimer timer(m_stats, ParseStats::ModelBuilding);
+    apply(fsm);
+  }
+  m_stats.setModel(fsm);
+  return true;
+}
+
+bool IncrementalParser::parseWindow(const QString &code, int begin, int end,
+                                    QVector<ClassSegment> &segments) {
+  try {
+    // The lexer views the window in place, offsets are window-relative
+    Lexer lexer(QStringView(code).mid(begin, end - begin));
+    CppParser parser(lexer);
+    QVector<ClassDecl *> classes;
+    {
+      ParseStageTimer timer(m_stats, ParseStats::Parsing);
+      classes = parser.parse();
+    }
+    m_stats.addParser(parser);
+
+    if (parser.hasError()) {
+      m_lastError = "Parser error: " + parser.errorMessage();
+      return false;
+    }
+
+    // Let ModelBuilder interpret the window into a scratch FSM, then record
+    // what each state class contributed to it
+    ParseStageTimer timer(m_stats, ParseStats::ModelBuilding);
+    FSM scratch;
+    ModelBuilder builder(&scratch);
+    builder.build(classes);
+    m_stats.allocations[ParseStats::ModelBuilding] +=
+        int(scratch.states().size() + scratch.transitions().size());
+
+    QHash<QString, State *> scratchStates;
+    for (State *state : scratch.states()) {
+      scratchStates.insert(state->name(), state);
+    }
+
+    for (const ClassDecl *decl : classes) {
+      if (!ModelBuilder::isStateClass(decl))
+        continue;
+      State *state =
+          scratchStates.value(ModelBuilder::extractStateName(decl->name));
+      if (!state)
+        continue;
+
+      ClassSegment segment;
+      segment.begin = begin + decl->sourceBegin;
+      segment.end = begin + decl->sourceEnd;
+      segment.stateName = state->name();
+      segment.entryAction = state->entryAction();
+      segment.exitAction = state->exitAction();
+      segment.functions = state->customFunctions();
+      for (Transition *transition : state->transitions()) {
+        segment.transitions.append(
+            {transition->event(), transition->targetState()->name()});
+      }
+      segments.append(segment);
+    }
+  } catch (...) {
+    m_lastError = "Parser exception";
+    return false;
+  }
+  return true;
+}
+
+void IncrementalParser::apply(FSM *fsm) {
+  // Desired states: every class state in source order, then the states that
+  // are only referenced as transition targets (ModelBuilder's order)
+  QHash<QString, const ClassSegment *> declared;
+  QStringList order;
+  for (const ClassSegment &segment : std::as_const(m_segments)) {
+    if (!declared.contains(segment.stateName)) {
+      declared.insert(segment.stateName, &segment);
+      order.append(segment.stateName);
+    }
+  }
+  QSet<QString> wantedStates(order.cbegin(), order.cend());
+  for (const ClassSegment &segment : std::as_const(m_segments)) {
+    for (const auto &transition : segment.transitions) {
+      if (!wantedStates.contains(transition.second)) {
+        wantedStates.insert(transition.second);
+        order.append(transition.second);
+      }
+    }
+  }
+
+  // Remove states that are gone; FSM::removeState() takes every transition
+  // touching them along
+  QHash<QString, State *> live;
+  for (State *state : fsm->states()) {
+    if (wantedStates.contains(state->name()) && !live.contains(state->name())) {
+      live.insert(state->name(), state);
+      continue;
+    }
+    fsm->removeState(state);
+    ++m_removedStateCount;
+  }
+
+  // Add new states
+  for (const QString &name : std::as_const(order)) {
+    if (!live.contains(name)) {
+      State *state = new State(name, name, fsm);
+      fsm->addState(state);
+      live.insert(name, state);
+      m_addedStates.append(state);
+    }
+  }
+
+  QHash<State *, QList<Transition *>> liveTransitions;
+  for (Transition *transition : fsm->transitions()) {
+    liveTransitions[transition->sourceState()].append(transition);
+  }
+
+  // Update actions, functions and outgoing transitions of every state.
+  // Referenced-only states get an empty segment, as in a full parse.
+  const ClassSegment noClass;
+  for (const QString &name : std::as_const(order)) {
+    State *state = live.value(name);
+    const ClassSegment &segment = *declared.value(name, &noClass);
+
+    state->setEntryAction(segment.entryAction);
+    state->setExitAction(segment.exitAction);
+    for (const QString &function : state->customFunctions()) {
+      if (!segment.functions.contains(function))
+        state->removeFunction(function);
+    }
+    for (const QString &function : segment.functions) {
+      state->addFunction(function);
+    }
+
+    QSet<QString> wanted;
+    for (const auto &transition : segment.transitions) {
+      wanted.insert(transitionKey(transition.first, transition.second));
+    }
+
+    QSet<QString> present;
+    for (Transition *transition : liveTransitions.value(state)) {
+      QString key = transitionKey(transition->event(),
+                                  transition->targetState()
+                                      ? transition->targetState()->name()
+                                      : QString());
+      if (!wanted.contains(key) || present.contains(key)) {
+        removeTransition(fsm, transition);
+      } else {
+        present.insert(key);
+      }
+    }
+
+    for (const auto &transition : segment.transitions) {
+      QString key = transitionKey(transition.first, transition.second);
+      State *target = live.value(transition.second);
+      if (present.contains(key) || !target)
+        continue;
+      present.insert(key);
+      Transition *added = new Transition(state, target);
+      added->setEvent(transition.first);
+      state->addTransition(added);
+      fsm->addTransition(added);
+    }
+  }
+
+  // Keep the user's initial state if it survived, otherwise use the first one
+  QList<State *> states = fsm->states();
+  if (!states.isEmpty() && !states.contains(fsm->initialState())) {
+    fsm->setInitialState(states.first());
+    states.first()->setInitial(true);
+  }
+}
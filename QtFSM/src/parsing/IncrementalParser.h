@@ -0,0 +1,123 @@
+#ifndef INCREMENTALPARSER_H
+#define INCREMENTALPARSER_H
+
+#include "ParseStats.h"
+#include <QList>
+#include <QPair>
+#include <QPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class FSM;
+class State;
+
+/**
+ * @brief The IncrementalParser class keeps an FSM in sync with edited C++
+ * code without reparsing the whole file.
+ *
+ * It remembers the source range of every state class from the previous run.
+ * On update() it finds the edited span with a prefix/suffix comparison,
+ * relexes and reparses only the window between the nearest untouched classes,
+ * and then applies the resulting difference to the existing @ref FSM in
+ * place: unchanged states, transitions and their positions keep their
+ * identity, only what actually changed is added, removed or modified.
+ *
+ * The result matches what @ref CodeParser would build from the same code:
+ * when the window could change how the code after it is read (an unclosed
+ * block comment or brace), the whole code is parsed instead.
+ *
+ * @ingroup Parsing
+ */
+class IncrementalParser {
+public:
+  /**
+   * @brief Constructs a new IncrementalParser with an empty cache.
+   */
+  IncrementalParser();
+
+  /**
+   * @brief Updates @p fsm in place so it reflects @p code.
+   *
+   * The first call (or a call with a different FSM) parses the whole code;
+   * later calls only reparse the classes touched since the previous call.
+   *
+   * @param fsm The FSM to update.
+   * @param code The complete, current C++ source.
+   * @return true on success, false on a parse error (the FSM is left as is).
+   */
+  bool update(FSM *fsm, const QString &code);
+
+  /**
+   * @brief Forgets the cached class ranges so the next update parses the
+   * whole code.
+   */
+  void reset();
+
+  /**
+   * @brief Gets the last error message encountered during parsing.
+   * @return A string description of the error, or empty string if success.
+   */
+  QString lastError() const { return m_lastError; }
+
+  /**
+   * @brief Gets the states created by the last update (they have no position
+   * yet).
+   * @return List of newly added states.
+   */
+  QList<State *> addedStates() const { return m_addedStates; }
+
+  /**
+   * @brief Gets the number of states removed by the last update. Removed
+   * states are deleted later, so anything still pointing at them (such as
+   * undo commands) has to be dropped by the caller.
+   * @return The removed state count.
+   */
+  int removedStateCount() const { return m_removedStateCount; }
+
+  /**
+   * @brief Gets the number of classes reparsed by the last update.
+   * @return The reparsed class count.
+   */
+  int reparsedClassCount() const { return m_reparsedClassCount; }
+
+  /**
+   * @brief Gets timings and counters of the last update. Counters cover the
+   * reparsed window only; states and transitions are those of the live FSM.
+   * @return The stats; the SceneRebuild stage is left to the caller.
+   */
+  const ParseStats &stats() const { return m_stats; }
+
+  /**
+   * @brief Mutable access so the caller can add the scene rebuild stage.
+   * @return The stats of the last update.
+   */
+  ParseStats &stats() { return m_stats; }
+
+private:
+  // What one state class contributes to the model
+  struct ClassSegment {
+    int begin = 0; // Source range of the class
+    int end = 0;
+    QString stateName;
+    QString entryAction;
+    QString exitAction;
+    QStringList functions;
+    QVector<QPair<QString, QString>> transitions; // (event, target state)
+  };
+
+  bool parseWindow(const QString &code, int begin, int end,
+                   QVector<ClassSegment> &segments);
+  void apply(FSM *fsm);
+
+  QPointer<FSM> m_fsm;
+  QString m_code;
+  QVector<ClassSegment> m_segments; // Ordered by source position
+  QString m_lastError;
+  QList<State *> m_addedStates;
+  int m_removedStateCount = 0;
+  int m_reparsedClassCount = 0;
+  ParseStats m_stats;
+};
+
+#endif // INCREMENTALPARSER_H
@@ -1,28 +1,339 @@
 #include "Lexer.h"
+#include "SimdScan.h"
+
+#include <algorithm>
 
 namespace FSMParser {
 
-Lexer::Lexer(const QString &source) : m_source(source) { initKeywords(); }
-
-void Lexer::initKeywords() {
-  m_keywords["class"] = TokenType::Keyword_Class;
-  m_keywords["struct"] = TokenType::Keyword_Struct;
-  m_keywords["enum"] = TokenType::Keyword_Enum;
-  m_keywords["public"] = TokenType::Keyword_Public;
-  m_keywords["private"] = TokenType::Keyword_Private;
-  m_keywords["protected"] = TokenType::Keyword_Protected;
-  m_keywords["virtual"] = TokenType::Keyword_Virtual;
-  m_keywords["override"] = TokenType::Keyword_Override;
-  m_keywords["if"] = TokenType::Keyword_If;
-  m_keywords["else"] = TokenType::Keyword_Else;
-  m_keywords["return"] = TokenType::Keyword_Return;
-  m_keywords["new"] = TokenType::Keyword_New;
-  m_keywords["this"] = TokenType::Keyword_This;
-  m_keywords["const"] = TokenType::Keyword_Const;
-  m_keywords["void"] = TokenType::Keyword_Void;
-  m_keywords["auto"] = TokenType::Keyword_Auto;
-  m_keywords["static_cast"] = TokenType::Keyword_StaticCast;
-  m_keywords["final"] = TokenType::Keyword_Final;
+namespace {
+
+// The scanning helpers below are shared by the UTF-16 and the UTF-8 input
+// paths; everything they look for is ASCII.
+
+// Skips whitespace and comments
+template <typename Char> const Char *skipBlank(const Char *p, const Char *end) {
+  for (;;) {
+    p = SimdScan::skipWhitespace(p, end);
+    if (p + 1 >= end || p[0] != Char('/'))
+      return p;
+
+    if (p[1] == Char('/')) {
+      // Line comment, the newline itself is skipped as whitespace
+      p = SimdScan::findNewline(p + 2, end);
+    } else if (p[1] == Char('*')) {
+      // Block comment
+      const Char *close = SimdScan::findBlockCommentEnd(p + 2, end);
+      p = close == end ? end : close + 2;
+    } else {
+      return p;
+    }
+  }
+}
+
+// Returns the closing '"' of a string literal starting at p (just after the
+// opening quote), or end if it is unterminated
+template <typename Char> const Char *stringEnd(const Char *p, const Char *end) {
+  for (;;) {
+    p = SimdScan::findQuoteOrBackslash(p, end);
+    if (p >= end)
+      return end;
+    if (*p == Char('"'))
+      return p;
+    p += 2; // Escape and the escaped char
+  }
+}
+
+// Returns the '}' closing the block depth levels up, or end
+template <typename Char>
+const Char *skipBlock(const Char *p, const Char *end, int depth) {
+  while (depth > 0) {
+    p = SimdScan::findStructural(p, end);
+    if (p >= end)
+      return end;
+
+    switch (*p) {
+    case Char('{'):
+      ++depth;
+      ++p;
+      break;
+    case Char('}'):
+      if (--depth == 0)
+        return p; // Left for the parser as the next token
+      ++p;
+      break;
+    case Char('"'): {
+      const Char *close = stringEnd(p + 1, end);
+      p = close == end ? end : close + 1;
+      break;
+    }
+    default: // '/', possibly starting a comment
+      if (p + 1 < end && (p[1] == Char('/') || p[1] == Char('*'))) {
+        p = skipBlank(p, end);
+      } else {
+        ++p;
+      }
+      break;
+    }
+  }
+  return p;
+}
+
+template <typename Char>
+void indexNewlines(const Char *begin, const Char *end, QVector<int> &newlines) {
+  for (const Char *p = SimdScan::findNewline(begin, end); p < end;
+       p = SimdScan::findNewline(p + 1, end)) {
+    newlines.append(int(p - begin));
+  }
+}
+
+// Numbers are ASCII digits only, in both input paths
+inline bool isDigit(uint c) { return c - '0' < 10; }
+
+// ASCII letters, digits and '_'
+inline bool isAsciiIdentifierChar(uint c) {
+  return (c | 0x20) - 'a' < 26 || isDigit(c) || c == '_';
+}
+
+// Identifiers are classified by code point, the same way for UTF-16 and
+// UTF-8 input: a letter or '_' starts one, letters, numbers and '_' continue
+// it. Any other non-ASCII character is an Unknown token.
+inline bool isIdentifierStart(char32_t c) {
+  return c < 0x80 ? isAsciiIdentifierChar(c) && !isDigit(c)
+                  : QChar::isLetter(c);
+}
+
+inline bool isIdentifierPart(char32_t c) {
+  return c < 0x80 ? isAsciiIdentifierChar(c) : QChar::isLetterOrNumber(c);
+}
+
+// Decodes the code point at p and sets length to its code units. A lone
+// surrogate is returned as is, which no classification accepts.
+char32_t codePointAt(const char16_t *p, const char16_t *end, int &length) {
+  length = 1;
+  if (QChar::isHighSurrogate(p[0]) && p + 1 < end &&
+      QChar::isLowSurrogate(p[1])) {
+    length = 2;
+    return QChar::surrogateToUcs4(p[0], p[1]);
+  }
+  return p[0];
+}
+
+// Decodes the code point at p and sets length to its bytes. Malformed input
+// decodes as U+FFFD one byte at a time.
+char32_t codePointAt(const char *p, const char *end, int &length) {
+  const uchar lead = uchar(p[0]);
+  length = 1;
+  if (lead < 0x80)
+    return lead;
+
+  int count;
+  if ((lead & 0xE0) == 0xC0) {
+    count = 2;
+  } else if ((lead & 0xF0) == 0xE0) {
+    count = 3;
+  } else if ((lead & 0xF8) == 0xF0) {
+    count = 4;
+  } else {
+    return QChar::ReplacementCharacter;
+  }
+  static constexpr char32_t MinValue[] = {0, 0, 0x80, 0x800, 0x10000};
+  char32_t c = lead & (0x7F >> count);
+  if (end - p < count)
+    return QChar::ReplacementCharacter;
+  for (int i = 1; i < count; ++i) {
+    const uchar next = uchar(p[i]);
+    if ((next & 0xC0) != 0x80)
+      return QChar::ReplacementCharacter;
+    c = (c << 6) | (next & 0x3F);
+  }
+  if (c < MinValue[count] || c > QChar::LastValidCodePoint ||
+      QChar::isSurrogate(c))
+    return QChar::ReplacementCharacter;
+  length = count;
+  return c;
+}
+
+// Classifies an operator or punctuation character. @p length is set to 2 when
+// @p next completes a two-character operator.
+TokenType punctuation(char16_t c, char16_t next, int &length) {
+  length = 1;
+  auto pair = [&](char16_t second, TokenType two, TokenType one) {
+    if (next != second)
+      return one;
+    length = 2;
+    return two;
+  };
+
+  switch (c) {
+  case u'{':
+    return TokenType::LeftBrace;
+  case u'}':
+    return TokenType::RightBrace;
+  case u'(':
+    return TokenType::LeftParen;
+  case u')':
+    return TokenType::RightParen;
+  case u';':
+    return TokenType::Semicolon;
+  case u',':
+    return TokenType::Comma;
+  case u'.':
+    return TokenType::Dot;
+  case u'*':
+    return TokenType::Star;
+  case u'&':
+    return TokenType::Ampersand;
+  case u'+':
+    return TokenType::Plus;
+  case u'~':
+    return TokenType::Tilde;
+  case u'<':
+    return pair(u'=', TokenType::LessEqual, TokenType::Less);
+  case u'>':
+    return pair(u'=', TokenType::GreaterEqual, TokenType::Greater);
+  case u'=':
+    return pair(u'=', TokenType::EqualEqual, TokenType::Equal);
+  case u'!':
+    return pair(u'=', TokenType::ExclaimEqual, TokenType::Exclaim);
+  case u':':
+    return pair(u':', TokenType::DoubleColon, TokenType::Colon);
+  case u'-':
+    return pair(u'>', TokenType::Arrow, TokenType::Minus);
+  default:
+    return TokenType::Unknown;
+  }
+}
+
+// Static text for punctuation tokens read from UTF-8 input
+QStringView spelling(TokenType type) {
+  switch (type) {
+  case TokenType::LeftBrace:
+    return u"{";
+  case TokenType::RightBrace:
+    return u"}";
+  case TokenType::LeftParen:
+    return u"(";
+  case TokenType::RightParen:
+    return u")";
+  case TokenType::Semicolon:
+    return u";";
+  case TokenType::Comma:
+    return u",";
+  case TokenType::Dot:
+    return u".";
+  case TokenType::Star:
+    return u"*";
+  case TokenType::Ampersand:
+    return u"&";
+  case TokenType::Plus:
+    return u"+";
+  case TokenType::Tilde:
+    return u"~";
+  case TokenType::Less:
+    return u"<";
+  case TokenType::LessEqual:
+    return u"<=";
+  case TokenType::Greater:
+    return u">";
+  case TokenType::GreaterEqual:
+    return u">=";
+  case TokenType::Equal:
+    return u"=";
+  case TokenType::EqualEqual:
+    return u"==";
+  case TokenType::Exclaim:
+    return u"!";
+  case TokenType::ExclaimEqual:
+    return u"!=";
+  case TokenType::Colon:
+    return u":";
+  case TokenType::DoubleColon:
+    return u"::";
+  case TokenType::Minus:
+    return u"-";
+  case TokenType::Arrow:
+    return u"->";
+  default:
+    return {};
+  }
+}
+
+} // namespace
+
+Lexer::Lexer(const QString &source) : m_owner(source), m_source(m_owner) {
+  m_begin = m_source.utf16();
+  m_end = m_begin + m_source.size();
+  m_length = int(m_source.size());
+}
+
+Lexer::Lexer(QStringView source) : m_source(source) {
+  m_begin = m_source.utf16();
+  m_end = m_begin + m_source.size();
+  m_length = int(m_source.size());
+}
+
+// Keywords are resolved with a switch on length followed by at most a few
+// comparisons, so lookup neither hashes nor allocates.
+TokenType Lexer::keywordType(QStringView text) {
+  switch (text.size()) {
+  case 2:
+    if (text == u"if")
+      return TokenType::Keyword_If;
+    break;
+  case 3:
+    if (text == u"new")
+      return TokenType::Keyword_New;
+    break;
+  case 4:
+    if (text == u"else")
+      return TokenType::Keyword_Else;
+    if (text == u"enum")
+      return TokenType::Keyword_Enum;
+    if (text == u"this")
+      return TokenType::Keyword_This;
+    if (text == u"void")
+      return TokenType::Keyword_Void;
+    if (text == u"auto")
+      return TokenType::Keyword_Auto;
+    break;
+  case 5:
+    if (text == u"class")
+      return TokenType::Keyword_Class;
+    if (text == u"const")
+      return TokenType::Keyword_Const;
+    if (text == u"final")
+      return TokenType::Keyword_Final;
+    break;
+  case 6:
+    if (text == u"public")
+      return TokenType::Keyword_Public;
+    if (text == u"return")
+      return TokenType::Keyword_Return;
+    if (text == u"struct")
+      return TokenType::Keyword_Struct;
+    break;
+  case 7:
+    if (text == u"private")
+      return TokenType::Keyword_Private;
+    if (text == u"virtual")
+      return TokenType::Keyword_Virtual;
+    break;
+  case 8:
+    if (text == u"override")
+      return TokenType::Keyword_Override;
+    break;
+  case 9:
+    if (text == u"protected")
+      return TokenType::Keyword_Protected;
+    break;
+  case 11:
+    if (text == u"static_cast")
+      return TokenType::Keyword_StaticCast;
+    break;
+  default:
+    break;
+  }
+  return TokenType::Identifier;
 }
 
 QChar Lexer::peek() const {
@@ -40,14 +351,7 @@ QChar Lexer::peekNext() const {
 QChar Lexer::advance() {
   if (isAtEnd())
     return '\0';
-  QChar c = m_source[m_current++];
-  if (c == '\n') {
-    m_line++;
-    m_column = 1;
-  } else {
-    m_column++;
-  }
-  return c;
+  return m_source[m_current++];
 }
 
 bool Lexer::match(QChar expected) {
@@ -60,99 +364,95 @@ bool Lexer::match(QChar expected) {
 }
 
 void Lexer::skipWhitespace() {
-  while (!isAtEnd()) {
-    QChar c = peek();
-    if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
-      advance();
-    } else if (c == '/' && peekNext() == '/') {
-      // Line comment
-      while (!isAtEnd() && peek() != '\n')
-        advance();
-    } else if (c == '/' && peekNext() == '*') {
-      // Block comment
-      advance(); // /
-      advance(); // *
-      while (!isAtEnd()) {
-        if (peek() == '*' && peekNext() == '/') {
-          advance(); // *
-          advance(); // /
-          break;
-        }
-        advance();
-      }
-    } else {
-      break;
-    }
-  }
+  m_current = int(skipBlank(m_begin + m_current, m_end) - m_begin);
 }
 
 Token Lexer::scanIdentifierOrKeyword() {
-  int start = m_current;
-  while (!isAtEnd() && (peek().isLetterOrNumber() || peek() == '_')) {
-    advance();
+  while (!isAtEnd()) {
+    int length;
+    if (!isIdentifierPart(codePointAt(m_begin + m_current, m_end, length)))
+      break;
+    m_current += length;
   }
 
-  QString text = m_source.mid(start, m_current - start);
-  if (m_keywords.contains(text)) {
-    return makeToken(m_keywords[text], text);
-  }
-  return makeToken(TokenType::Identifier, text);
+  QStringView text = QStringView(m_source).mid(m_tokenStart,
+                                               m_current - m_tokenStart);
+  return makeToken(keywordType(text));
 }
 
 Token Lexer::scanStringLiteral() {
-  int start = m_current;
-  advance(); // Opening "
-
-  while (!isAtEnd() && peek() != '"') {
-    if (peek() == '\\') {
-      advance(); // escape
-      if (!isAtEnd())
-        advance(); // escaped char
-    } else {
-      advance();
-    }
-  }
+  // Start after the opening "
+  const char16_t *p = stringEnd(m_begin + m_current + 1, m_end);
 
-  if (isAtEnd()) {
+  if (p == m_end) {
+    m_current = int(m_end - m_begin);
     m_errorMessage = "Unterminated string literal";
-    return makeToken(TokenType::Unknown);
+    return Token(TokenType::Unknown, {}, m_tokenStart);
   }
 
-  advance(); // Closing "
-  QString text = m_source.mid(start, m_current - start);
-  return makeToken(TokenType::StringLiteral, text);
+  m_current = int(p + 1 - m_begin); // Past the closing "
+  return makeToken(TokenType::StringLiteral);
 }
 
 Token Lexer::scanNumber() {
-  int start = m_current;
-  while (!isAtEnd() && peek().isDigit()) {
+  while (!isAtEnd() && isDigit(peek().unicode())) {
     advance();
   }
 
-  QString text = m_source.mid(start, m_current - start);
-  return makeToken(TokenType::NumberLiteral, text);
+  return makeToken(TokenType::NumberLiteral);
 }
 
-Token Lexer::makeToken(TokenType type, const QString &value) {
-  return Token(type, value, m_line, m_column);
+void Lexer::beginToken() { m_tokenStart = m_current; }
+
+Token Lexer::makeToken(TokenType type) {
+  return Token(type,
+               QStringView(m_source).mid(m_tokenStart,
+                                         m_current - m_tokenStart),
+               m_tokenStart);
+}
+
+SourceLocation Lexer::location(int offset) const {
+  if (!m_newlinesIndexed) {
+    if (m_utf8Begin) {
+      indexNewlines(m_utf8Begin, m_utf8End, m_newlines);
+    } else {
+      indexNewlines(m_begin, m_end, m_newlines);
+    }
+    m_newlinesIndexed = true;
+  }
+
+  // Number of newlines before the offset gives the 0-based line
+  auto it = std::lower_bound(m_newlines.cbegin(), m_newlines.cend(), offset);
+  SourceLocation loc;
+  loc.line = int(it - m_newlines.cbegin()) + 1;
+  int lineStart = it == m_newlines.cbegin() ? 0 : *(it - 1) + 1;
+  loc.column = offset - lineStart + 1;
+  return loc;
 }
 
 Token Lexer::nextToken() {
+  if (m_utf8Begin) {
+    return nextUtf8Token();
+  }
+
   skipWhitespace();
+  beginToken();
 
   if (isAtEnd()) {
     return makeToken(TokenType::EndOfFile);
   }
 
   QChar c = peek();
+  int length = 1;
+  const char32_t codePoint = codePointAt(m_begin + m_current, m_end, length);
 
   // Identifiers and keywords
-  if (c.isLetter() || c == '_') {
+  if (isIdentifierStart(codePoint)) {
     return scanIdentifierOrKeyword();
   }
 
   // Numbers
-  if (c.isDigit()) {
+  if (isDigit(codePoint)) {
     return scanNumber();
   }
 
@@ -161,78 +461,46 @@ Token Lexer::nextToken() {
     return scanStringLiteral();
   }
 
-  // Two-character operators
-  advance();
-  switch (c.toLatin1()) {
-  case '{':
-    return makeToken(TokenType::LeftBrace, "{");
-  case '}':
-    return makeToken(TokenType::RightBrace, "}");
-  case '(':
-    return makeToken(TokenType::LeftParen, "(");
-  case ')':
-    return makeToken(TokenType::RightParen, ")");
-  case ';':
-    return makeToken(TokenType::Semicolon, ";");
-  case ',':
-    return makeToken(TokenType::Comma, ",");
-  case '.':
-    return makeToken(TokenType::Dot, ".");
-  case '*':
-    return makeToken(TokenType::Star, "*");
-  case '&':
-    return makeToken(TokenType::Ampersand, "&");
-  case '+':
-    return makeToken(TokenType::Plus, "+");
-  case '~':
-    return makeToken(TokenType::Tilde, "~");
-  case '<':
-    if (match('='))
-      return makeToken(TokenType::LessEqual, "<=");
-    return makeToken(TokenType::Less, "<");
-  case '>':
-    if (match('='))
-      return makeToken(TokenType::GreaterEqual, ">=");
-    return makeToken(TokenType::Greater, ">");
-  case '=':
-    if (match('='))
-      return makeToken(TokenType::EqualEqual, "==");
-    return makeToken(TokenType::Equal, "=");
-  case '!':
-    if (match('='))
-      return makeToken(TokenType::ExclaimEqual, "!=");
-    return makeToken(TokenType::Exclaim, "!");
-  case ':':
-    if (match(':'))
-      return makeToken(TokenType::DoubleColon, "::");
-    return makeToken(TokenType::Colon, ":");
-  case '-':
-    if (match('>'))
-      return makeToken(TokenType::Arrow, "->");
-    return makeToken(TokenType::Minus, "-");
-  default:
-    return makeToken(TokenType::Unknown, QString(c));
+  // Any other non-ASCII character, surrogate pairs included
+  if (codePoint >= 0x80) {
+    m_current += length;
+    return makeToken(TokenType::Unknown);
   }
+
+  // Operators and punctuation, two characters at most
+  const TokenType type = punctuation(c.unicode(), peekNext().unicode(), length);
+  m_current += length;
+  return makeToken(type);
 }
 
 Token Lexer::peekToken() {
   int savedCurrent = m_current;
-  int savedLine = m_line;
-  int savedColumn = m_column;
+  int savedTokenStart = m_tokenStart;
 
   Token token = nextToken();
 
   m_current = savedCurrent;
-  m_line = savedLine;
-  m_column = savedColumn;
+  m_tokenStart = savedTokenStart;
 
   return token;
 }
 
 QVector<Token> Lexer::tokenize() {
   QVector<Token> tokens;
+  // Deliberately low: it skips the first few reallocations and the vector
+  // grows geometrically past it. A Token is 32 bytes, so reserving one per
+  // four characters would commit eight times the input up front.
+  tokens.reserve(m_source.size() / 16 + 1);
+  QVector<int> openBraces;
   while (!isAtEnd()) {
     Token token = nextToken();
+    if (token.type == TokenType::LeftBrace) {
+      openBraces.append(tokens.size());
+    } else if (token.type == TokenType::RightBrace && !openBraces.isEmpty()) {
+      const int open = openBraces.takeLast();
+      token.match = open - tokens.size();
+      tokens[open].match = tokens.size() - open;
+    }
     tokens.append(token);
     if (token.type == TokenType::EndOfFile)
       break;
@@ -240,4 +508,120 @@ QVector<Token> Lexer::tokenize() {
   return tokens;
 }
 
+void Lexer::skipBalanced(int depth) {
+  if (m_utf8Begin) {
+    m_current =
+        int(skipBlock(m_utf8Begin + m_current, m_utf8End, depth) - m_utf8Begin);
+  } else {
+    m_current = int(skipBlock(m_begin + m_current, m_end, depth) - m_begin);
+  }
+}
+
+Lexer Lexer::fromUtf8(QByteArrayView source) {
+  Lexer lexer;
+  lexer.m_utf8Begin = source.data();
+  lexer.m_utf8End = source.data() + source.size();
+  lexer.m_length = int(source.size());
+  return lexer;
+}
+
+Token Lexer::nextUtf8Token() {
+  const char *p = skipBlank(m_utf8Begin + m_current, m_utf8End);
+  m_tokenStart = int(p - m_utf8Begin);
+  m_current = m_tokenStart;
+
+  if (p == m_utf8End) {
+    return Token(TokenType::EndOfFile, {}, m_tokenStart);
+  }
+
+  const uchar c = uchar(*p);
+  const char *q = p + 1;
+  int codePointLength = 1;
+  const char32_t codePoint =
+      c < 0x80 ? c : codePointAt(p, m_utf8End, codePointLength);
+
+  // Identifiers and keywords. Non-ASCII characters are decoded and
+  // classified like the UTF-16 path does; ASCII needs no decoding.
+  if (isIdentifierStart(codePoint)) {
+    bool ascii = c < 0x80;
+    q = p + codePointLength;
+    while (q < m_utf8End) {
+      if (uchar(*q) < 0x80) {
+        if (!isAsciiIdentifierChar(uchar(*q)))
+          break;
+        ++q;
+        continue;
+      }
+      int length;
+      if (!isIdentifierPart(codePointAt(q, m_utf8End, length)))
+        break;
+      ascii = false;
+      q += length;
+    }
+    m_current = int(q - m_utf8Begin);
+    const QStringView text = storeText(p, q, ascii);
+    return Token(keywordType(text), text, m_tokenStart);
+  }
+
+  // Numbers
+  if (isDigit(c)) {
+    while (q < m_utf8End && isDigit(uchar(*q)))
+      ++q;
+    m_current = int(q - m_utf8Begin);
+    return Token(TokenType::NumberLiteral, storeText(p, q, true), m_tokenStart);
+  }
+
+  // String literals
+  if (c == '"') {
+    q = stringEnd(q, m_utf8End);
+    if (q == m_utf8End) {
+      m_current = m_length;
+      m_errorMessage = "Unterminated string literal";
+      return Token(TokenType::Unknown, {}, m_tokenStart);
+    }
+    ++q; // Past the closing "
+    m_current = int(q - m_utf8Begin);
+    return Token(TokenType::StringLiteral, storeText(p, q, false),
+                 m_tokenStart);
+  }
+
+  // Any other non-ASCII character
+  if (c >= 0x80) {
+    q = p + codePointLength;
+    m_current = int(q - m_utf8Begin);
+    return Token(TokenType::Unknown, storeText(p, q, false), m_tokenStart);
+  }
+
+  // Operators and punctuation view static spellings, nothing is stored
+  int length = 1;
+  const char16_t next = q < m_utf8End ? char16_t(uchar(*q)) : u'\0';
+  const TokenType type = punctuation(char16_t(c), next, length);
+  m_current = m_tokenStart + length;
+  if (type == TokenType::Unknown) {
+    return Token(type, storeText(p, q, true), m_tokenStart);
+  }
+  return Token(type, spelling(type), m_tokenStart);
+}
+
+QStringView Lexer::storeText(const char *begin, const char *end, bool ascii) {
+  // UTF-8 never needs more UTF-16 code units than it has bytes, so checking
+  // the byte count is enough to keep appends inside the chunk's capacity;
+  // the chunk is never reallocated and earlier views stay valid.
+  const qsizetype bytes = end - begin;
+  if (m_text.isEmpty() ||
+      m_text.last().capacity() - m_text.last().size() < bytes) {
+    m_text.append(QString());
+    m_text.last().reserve(qMax<qsizetype>(TextChunkSize, bytes));
+  }
+
+  QString &chunk = m_text.last();
+  const qsizetype start = chunk.size();
+  if (ascii) {
+    chunk.append(QLatin1String(begin, bytes)); // Plain widening
+  } else {
+    chunk.append(QString::fromUtf8(begin, bytes));
+  }
+  return QStringView(chunk).mid(start);
+}
+
 } // namespace FSMParser
@@ -1,12 +1,21 @@
 #pragma once
 
 #include "Token.h"
-#include <QMap>
+#include <QByteArrayView>
+#include <QList>
 #include <QString>
 #include <QVector>
 
 namespace FSMParser {
 
+/**
+ * @brief A 1-based line/column position in the source.
+ */
+struct SourceLocation {
+  int line = 1;
+  int column = 1;
+};
+
 /**
  * @brief The Lexer class performs lexical analysis (tokenization).
  *
@@ -14,6 +23,14 @@ namespace FSMParser {
  * called Tokens. It handles C++ identifiers, keywords, striung literals, and
  * various operators/symbols.
  *
+ * Tokens are views into the source string (no per-token allocation). The
+ * Lexer keeps a shallow copy of the source, so tokens stay valid for as long
+ * as either the Lexer or the caller's string is alive and unmodified.
+ *
+ * Whitespace, comments and string literals are skipped with the vectorized
+ * scanners in SimdScan. Line numbers are not tracked while scanning; they are
+ * computed from a newline index built on the first location() call.
+ *
  * @ingroup Parsing
  */
 class Lexer {
@@ -24,12 +41,43 @@ public:
    */
   Lexer(const QString &source);
 
+  /**
+   * @brief Constructs a Lexer over a view of a larger source, e.g. a single
+   * class when reparsing incrementally. Token offsets are relative to the
+   * start of the view. The viewed string must outlive the Lexer.
+   * @param source The C++ source code view.
+   */
+  explicit Lexer(QStringView source);
+
+  /**
+   * @brief Creates a Lexer that reads UTF-8 directly, e.g. a memory-mapped
+   * file, without converting the whole input to UTF-16 first.
+   *
+   * Only the text of identifiers, numbers, string literals and unknown
+   * characters is decoded, into storage owned by the Lexer; punctuation
+   * tokens view static strings. Non-ASCII characters are decoded and
+   * classified like in UTF-16 input, so both give the same tokens. Token
+   * offsets and columns count bytes. The viewed bytes must outlive the
+   * Lexer.
+   * @param source The UTF-8 encoded C++ source, without a byte order mark.
+   */
+  static Lexer fromUtf8(QByteArrayView source);
+
   /**
    * @brief Tokenizes the entire source code at once.
+   * Braces are paired in the same pass (see Token::match).
    * @return A vector containing all tokens found in the source.
    */
   QVector<Token> tokenize();
 
+  /**
+   * @brief Skips to the '}' closing the current block without producing
+   * tokens. Comments and string literals are honoured, so braces inside them
+   * do not count. The closing brace is left as the next token.
+   * @param depth Number of blocks currently open (1 right after a '{').
+   */
+  void skipBalanced(int depth);
+
   /**
    * @brief Reads and returns the next token from the stream.
    * Advances the current position.
@@ -47,7 +95,7 @@ public:
    * @brief Checks if the lexer has reached the end of the source.
    * @return true if at end of file (EOF).
    */
-  bool isAtEnd() const { return m_current >= m_source.length(); }
+  bool isAtEnd() const { return m_current >= m_length; }
 
   /**
    * @brief Gets the error message if tokenization failed (e.g., unknown char).
@@ -55,16 +103,36 @@ public:
    */
   QString errorMessage() const { return m_errorMessage; }
 
+  /**
+   * @brief Resolves a token offset to its line and column.
+   * The newline index is built lazily on the first call.
+   * @param offset Character (or, for UTF-8 input, byte) offset into the
+   * source (Token::offset).
+   * @return The 1-based source location.
+   */
+  SourceLocation location(int offset) const;
+
 private:
-  QString m_source;
+  Lexer() = default;
+
+  // Decoded text is appended to chunks of at least this many characters
+  static constexpr qsizetype TextChunkSize = 64 * 1024;
+
+  QString m_owner;     // Keeps the source alive when built from a QString
+  QStringView m_source;
+  const char16_t *m_begin = nullptr; // m_source as UTF-16, for the scanners
+  const char16_t *m_end = nullptr;
+  const char *m_utf8Begin = nullptr; // Set instead for UTF-8 input
+  const char *m_utf8End = nullptr;
+  QList<QString> m_text; // Decoded token text for UTF-8 input
+  int m_length = 0;      // Input length in code units
   int m_current = 0;
-  int m_line = 1;
-  int m_column = 1;
+  int m_tokenStart = 0;
   QString m_errorMessage;
+  mutable QVector<int> m_newlines; // Offsets of every '\n', built on demand
+  mutable bool m_newlinesIndexed = false;
 
-  QMap<QString, TokenType> m_keywords;
-
-  void initKeywords();
+  static TokenType keywordType(QStringView text);
 
   // Character inspection
   QChar peek() const;
@@ -76,11 +144,16 @@ private:
   void skipWhitespace();
   void skipComment();
 
+  // UTF-8 input
+  Token nextUtf8Token();
+  QStringView storeText(const char *begin, const char *end, bool ascii);
+
   // Token scanners
   Token scanIdentifierOrKeyword();
   Token scanStringLiteral();
   Token scanNumber();
-  Token makeToken(TokenType type, const QString &value = "");
+  void beginToken();
+  Token makeToken(TokenType type);
 };
 
 } // namespace FSMParser
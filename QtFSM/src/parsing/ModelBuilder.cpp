@@ -1,5 +1,4 @@
 #include "ModelBuilder.h"
-#include <QDebug>
 
 namespace FSMParser {
 
@@ -40,6 +39,32 @@ void ModelBuilder::build(const QVector<ClassDecl *> &classes) {
       classDecl->accept(this);
     }
   }
+
+  flushTransitions();
+}
+
+void ModelBuilder::addPendingTransition(State *target,
+                                        const QString &eventName) {
+  TransitionKey key{m_currentState, target, eventName};
+  if (m_transitionKeys.contains(key))
+    return;
+  m_transitionKeys.insert(key);
+
+  Transition *transition = new Transition(m_currentState, target);
+  transition->setEvent(eventName);
+  m_pendingTransitions.append(transition);
+  m_pendingBySource[m_currentState].append(transition);
+}
+
+void ModelBuilder::flushTransitions() {
+  for (auto it = m_pendingBySource.cbegin(); it != m_pendingBySource.cend();
+       ++it) {
+    it.key()->addTransitions(it.value());
+  }
+  m_fsm->addTransitions(m_pendingTransitions);
+
+  m_pendingBySource.clear();
+  m_pendingTransitions.clear();
 }
 
 void ModelBuilder::visitClassDecl(ClassDecl *node) {
@@ -50,9 +75,6 @@ void ModelBuilder::visitClassDecl(ClassDecl *node) {
 }
 
 void ModelBuilder::visitFunctionDecl(FunctionDecl *node) {
-  // Debug log
-  qDebug() << "ModelBuilder: Visiting function" << node->name;
-
   // Reconstruct signature
   QString signature = node->returnType + " " + node->name + "(";
   for (int i = 0; i < node->parameters.size(); ++i) {
@@ -122,30 +144,9 @@ void ModelBuilder::visitIfStatement(IfStatement *node) {
           targetState = new State(stateName, stateName, m_fsm);
           m_fsm->addState(targetState);
           m_stateMap.insert(m_currentTargetState, targetState);
-          qDebug() << "ModelBuilder: Lazily created state" << stateName
-                   << "from" << m_currentTargetState;
         }
 
-        if (targetState) {
-          // Check if transition already exists
-          bool exists = false;
-          for (Transition *t : m_currentState->transitions()) {
-            if (t->targetState() == targetState && t->event() == eventName) {
-              exists = true;
-              break;
-            }
-          }
-
-          if (!exists) {
-            Transition *transition =
-                new Transition(m_currentState, targetState);
-            transition->setEvent(eventName);
-            m_currentState->addTransition(transition);
-            m_fsm->addTransition(transition); // Add to FSM's transition list
-            qDebug() << "ModelBuilder: Added transition" << eventName << "->"
-                     << targetState->name();
-          }
-        }
+        addPendingTransition(targetState, eventName);
       }
     }
   }
@@ -179,19 +180,34 @@ void ModelBuilder::visitStringLiteralExpr(StringLiteralExpr *node) {
 }
 
 void ModelBuilder::visitBinaryExpr(BinaryExpr *node) {
-  // Visit both sides to extract event names
-  if (node->left) {
-    node->left->accept(this);
+  // Visit both sides to extract event names. Chains like a == b == c nest on
+  // the left, so walk that spine in a loop rather than recursing into it.
+  QVector<Expression *> rightSides;
+  Expression *expr = node;
+  while (auto *binary = dynamic_cast<BinaryExpr *>(expr)) {
+    rightSides.append(binary->right);
+    expr = binary->left;
   }
-  if (node->right) {
-    node->right->accept(this);
+
+  if (expr) {
+    expr->accept(this);
+  }
+  for (auto it = rightSides.crbegin(); it != rightSides.crend(); ++it) {
+    if (*it) {
+      (*it)->accept(this);
+    }
   }
 }
 
 void ModelBuilder::visitMemberAccessExpr(MemberAccessExpr *node) {
-  // Could be event.type - visit to extract context
-  if (node->object) {
-    node->object->accept(this);
+  // Could be event.type - visit to extract context. Long a.b.c chains nest
+  // on the object, which is walked in a loop for the same reason.
+  Expression *object = node->object;
+  while (auto *member = dynamic_cast<MemberAccessExpr *>(object)) {
+    object = member->object;
+  }
+  if (object) {
+    object->accept(this);
   }
 }
 
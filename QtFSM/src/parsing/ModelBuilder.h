@@ -4,7 +4,9 @@
 #include "../model/State.h"
 #include "../model/Transition.h"
 #include "AST.h"
+#include <QHash>
 #include <QMap>
+#include <QSet>
 #include <QString>
 
 namespace FSMParser {
@@ -43,21 +45,44 @@ public:
   void visitMemberAccessExpr(MemberAccessExpr *node) override;
   void visitNewExpr(NewExpr *node) override;
 
+  // Helper to extract state name from class name (e.g., "State1State" →
+  // "State1")
+  static QString extractStateName(const QString &className);
+
+  // Check if a class is a state class
+  static bool isStateClass(const ClassDecl *decl);
+
 private:
+  // Identity of a transition for de-duplication during a build
+  struct TransitionKey {
+    State *source;
+    State *target;
+    QString event;
+
+    bool operator==(const TransitionKey &other) const {
+      return source == other.source && target == other.target &&
+             event == other.event;
+    }
+    friend size_t qHash(const TransitionKey &key, size_t seed = 0) {
+      return qHashMulti(seed, key.source, key.target, key.event);
+    }
+  };
+
+  void addPendingTransition(State *target, const QString &eventName);
+  void flushTransitions();
+
   FSM *m_fsm;
   QMap<QString, State *> m_stateMap; // Class name → State
 
+  // Transitions found so far; added to the model in bulk at the end of build()
+  QSet<TransitionKey> m_transitionKeys;
+  QList<Transition *> m_pendingTransitions;
+  QHash<State *, QList<Transition *>> m_pendingBySource;
+
   // Current context during traversal
   State *m_currentState = nullptr;
   QString m_currentEventName;
   QString m_currentTargetState;
-
-  // Helper to extract state name from class name (e.g., "State1State" →
-  // "State1")
-  QString extractStateName(const QString &className);
-
-  // Check if a class is a state class
-  bool isStateClass(const ClassDecl *decl);
 };
 
 } // namespace FSMParser
@@ -0,0 +1,65 @@
+#include "ParseStats.h"
+#include "../model/FSM.h"
+#include "CppParser.h"
+
+void ParseStats::addParser(const FSMParser::CppParser &parser) {
+  const FSMParser::TokenStream &stream = parser.tokenStream();
+  nanoseconds[Lexing] += stream.lexNanoseconds();
+  nanoseconds[Parsing] -= stream.lexNanoseconds();
+  allocations[Lexing] += stream.ringAllocations();
+  allocations[Parsing] += parser.arena().blockCount();
+
+  tokens += stream.tokenCount();
+  astNodes += parser.arena().nodeCount();
+  astBytes += qint64(parser.arena().bytesUsed());
+}
+
+void ParseStats::setModel(const FSM *fsm) {
+  states = fsm ? int(fsm->states().size()) : 0;
+  transitions = fsm ? int(fsm->transitions().size()) : 0;
+}
+
+qint64 ParseStats::totalNanoseconds() const {
+  qint64 total = 0;
+  for (qint64 stage : nanoseconds) {
+    total += stage;
+  }
+  return total;
+}
+
+QString ParseStats::stageName(Stage stage) {
+  switch (stage) {
+  case Lexing:
+    return QStringLiteral("lexing");
+  case Parsing:
+    return QStringLiteral("parsing");
+  case ModelBuilding:
+    return QStringLiteral("model building");
+  case SceneRebuild:
+    return QStringLiteral("scene rebuild");
+  case StageCount:
+    break;
+  }
+  return QString();
+}
+
+QString ParseStats::report() const {
+  QString text;
+  for (int stage = 0; stage < StageCount; ++stage) {
+    text += QString("%1 %2 ms  %3 allocations\n")
+                .arg(stageName(Stage(stage)) + ':', -16)
+                .arg(nanoseconds[stage] / 1e6, 9, 'f', 3)
+                .arg(allocations[stage]);
+  }
+  text += QString("%1 %2 ms\n")
+              .arg(QStringLiteral("total:"), -16)
+              .arg(totalNanoseconds() / 1e6, 9, 'f', 3);
+  text += QString("tokens: %1  AST nodes: %2 (%3 bytes)  states: %4  "
+                  "transitions: %5")
+              .arg(tokens)
+              .arg(astNodes)
+              .arg(astBytes)
+              .arg(states)
+              .arg(transitions);
+  return text;
+}
@@ -0,0 +1,100 @@
+#ifndef PARSESTATS_H
+#define PARSESTATS_H
+
+#include <QElapsedTimer>
+#include <QString>
+
+class FSM;
+
+namespace FSMParser {
+class CppParser;
+}
+
+/**
+ * @brief Timings and counters for one run of the import pipeline.
+ *
+ * Filled in by CodeParser and IncrementalParser; MainWindow adds the scene
+ * rebuild. Every stage costs one QElapsedTimer read at its start and end and
+ * the counters come from data the pipeline already keeps, so collection is
+ * always on.
+ *
+ * Lexing runs interleaved with parsing when the parser streams tokens; the
+ * lexing time is measured inside the TokenStream and subtracted from the
+ * parsing stage.
+ *
+ * @ingroup Parsing
+ */
+struct ParseStats {
+  enum Stage { Lexing, Parsing, ModelBuilding, SceneRebuild, StageCount };
+
+  qint64 nanoseconds[StageCount] = {}; ///< Wall time per stage
+  int allocations[StageCount] = {};    ///< Buffer/block/object allocations
+
+  int tokens = 0;      ///< Tokens produced by the lexer
+  int astNodes = 0;    ///< Nodes created in the parser's arena
+  qint64 astBytes = 0; ///< Arena bytes handed out to nodes
+  int states = 0;      ///< States in the resulting FSM
+  int transitions = 0; ///< Transitions in the resulting FSM
+
+  /**
+   * @brief Resets all timings and counters.
+   */
+  void clear() { *this = ParseStats(); }
+
+  /**
+   * @brief Adds the token and AST counters of a finished parser run.
+   *
+   * Call after timing CppParser::parse() as the Parsing stage: the time the
+   * token stream spent in the lexer is moved from Parsing to Lexing.
+   * @param parser The parser that produced the AST.
+   */
+  void addParser(const FSMParser::CppParser &parser);
+
+  /**
+   * @brief Records the state and transition counts of the resulting model.
+   * @param fsm The FSM after model building.
+   */
+  void setModel(const FSM *fsm);
+
+  /**
+   * @brief Gets the total wall time over all stages.
+   * @return Nanoseconds.
+   */
+  qint64 totalNanoseconds() const;
+
+  /**
+   * @brief Gets the display name of a stage.
+   * @param stage The stage.
+   * @return e.g. "lexing".
+   */
+  static QString stageName(Stage stage);
+
+  /**
+   * @brief Formats the stats as a small multi-line table for logs and the
+   * `--stats` command line option.
+   * @return The report text.
+   */
+  QString report() const;
+};
+
+/**
+ * @brief Adds the time between construction and destruction to a stage.
+ */
+class ParseStageTimer {
+public:
+  ParseStageTimer(ParseStats &stats, ParseStats::Stage stage)
+      : m_stats(stats), m_stage(stage) {
+    m_timer.start();
+  }
+  ~ParseStageTimer() { m_stats.nanoseconds[m_stage] += m_timer.nsecsElapsed(); }
+
+  ParseStageTimer(const ParseStageTimer &) = delete;
+  ParseStageTimer &operator=(const ParseStageTimer &) = delete;
+
+private:
+  ParseStats &m_stats;
+  ParseStats::Stage m_stage;
+  QElapsedTimer m_timer;
+};
+
+#endif // PARSESTATS_H
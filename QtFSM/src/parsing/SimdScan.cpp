@@ -0,0 +1,233 @@
+#include "SimdScan.h"
+
+#include <QtGlobal>
+#include <QtAlgorithms>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FSM_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) ||                                \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FSM_SIMD_SSE2
+#endif
+
+namespace FSMParser {
+namespace SimdScan {
+
+namespace {
+
+// A thin layer over the intrinsics so each scanner below is written once for
+// both code unit types. bits() yields one mask bit per byte, so a lane of
+// sizeof(Char) bytes owns sizeof(Char) bits when turning a bit index into a
+// character offset.
+template <typename Char> struct Simd;
+
+#if defined(FSM_SIMD_AVX2)
+using Vector = __m256i;
+constexpr quint32 AllLanes = 0xFFFFFFFFu;
+inline Vector load(const void *p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+inline Vector either(Vector a, Vector b) { return _mm256_or_si256(a, b); }
+inline quint32 bits(Vector v) { return quint32(_mm256_movemask_epi8(v)); }
+
+template <> struct Simd<char16_t> {
+  static constexpr int Lanes = 16;
+  static Vector splat(char16_t c) { return _mm256_set1_epi16(short(c)); }
+  static Vector equal(Vector a, Vector b) { return _mm256_cmpeq_epi16(a, b); }
+};
+template <> struct Simd<char> {
+  static constexpr int Lanes = 32;
+  static Vector splat(char c) { return _mm256_set1_epi8(c); }
+  static Vector equal(Vector a, Vector b) { return _mm256_cmpeq_epi8(a, b); }
+};
+#elif defined(FSM_SIMD_SSE2)
+using Vector = __m128i;
+constexpr quint32 AllLanes = 0xFFFFu;
+inline Vector load(const void *p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+inline Vector either(Vector a, Vector b) { return _mm_or_si128(a, b); }
+inline quint32 bits(Vector v) { return quint32(_mm_movemask_epi8(v)); }
+
+template <> struct Simd<char16_t> {
+  static constexpr int Lanes = 8;
+  static Vector splat(char16_t c) { return _mm_set1_epi16(short(c)); }
+  static Vector equal(Vector a, Vector b) { return _mm_cmpeq_epi16(a, b); }
+};
+template <> struct Simd<char> {
+  static constexpr int Lanes = 16;
+  static Vector splat(char c) { return _mm_set1_epi8(c); }
+  static Vector equal(Vector a, Vector b) { return _mm_cmpeq_epi8(a, b); }
+};
+#endif
+
+template <typename Char> inline bool isSpace(Char c) {
+  return c == Char(' ') || c == Char('\t') || c == Char('\r') ||
+         c == Char('\n');
+}
+
+#if defined(FSM_SIMD_AVX2) || defined(FSM_SIMD_SSE2)
+template <typename Char>
+inline const Char *firstLane(const Char *p, quint32 mask) {
+  return p + qCountTrailingZeroBits(mask) / sizeof(Char);
+}
+
+// Returns the first character equal to either a or b, vector part only
+template <typename Char>
+const Char *findEither(const Char *p, const Char *end, Char a, Char b) {
+  using S = Simd<Char>;
+  const Vector va = S::splat(a);
+  const Vector vb = S::splat(b);
+  for (; end - p >= S::Lanes; p += S::Lanes) {
+    const Vector chunk = load(p);
+    const quint32 mask = bits(either(S::equal(chunk, va), S::equal(chunk, vb)));
+    if (mask)
+      return firstLane(p, mask);
+  }
+  return p;
+}
+#endif
+
+template <typename Char>
+const Char *skipWhitespaceImpl(const Char *p, const Char *end) {
+#if defined(FSM_SIMD_AVX2) || defined(FSM_SIMD_SSE2)
+  using S = Simd<Char>;
+  const Vector space = S::splat(Char(' '));
+  const Vector tab = S::splat(Char('\t'));
+  const Vector cr = S::splat(Char('\r'));
+  const Vector lf = S::splat(Char('\n'));
+  for (; end - p >= S::Lanes; p += S::Lanes) {
+    const Vector chunk = load(p);
+    const Vector ws =
+        either(either(S::equal(chunk, space), S::equal(chunk, tab)),
+               either(S::equal(chunk, cr), S::equal(chunk, lf)));
+    const quint32 mask = ~bits(ws) & AllLanes;
+    if (mask)
+      return firstLane(p, mask);
+  }
+#endif
+  while (p < end && isSpace(*p))
+    ++p;
+  return p;
+}
+
+template <typename Char>
+const Char *findNewlineImpl(const Char *p, const Char *end) {
+#if defined(FSM_SIMD_AVX2) || defined(FSM_SIMD_SSE2)
+  p = findEither(p, end, Char('\n'), Char('\n'));
+  if (p < end && *p == Char('\n'))
+    return p;
+#endif
+  while (p < end && *p != Char('\n'))
+    ++p;
+  return p;
+}
+
+template <typename Char>
+const Char *findBlockCommentEndImpl(const Char *p, const Char *end) {
+  while (p < end) {
+#if defined(FSM_SIMD_AVX2) || defined(FSM_SIMD_SSE2)
+    p = findEither(p, end, Char('*'), Char('*'));
+#endif
+    while (p < end && *p != Char('*'))
+      ++p;
+    if (p + 1 >= end)
+      return end;
+    if (p[1] == Char('/'))
+      return p;
+    ++p;
+  }
+  return end;
+}
+
+template <typename Char>
+const Char *findQuoteOrBackslashImpl(const Char *p, const Char *end) {
+#if defined(FSM_SIMD_AVX2) || defined(FSM_SIMD_SSE2)
+  p = findEither(p, end, Char('"'), Char('\\'));
+  if (p < end && (*p == Char('"') || *p == Char('\\')))
+    return p;
+#endif
+  while (p < end && *p != Char('"') && *p != Char('\\'))
+    ++p;
+  return p;
+}
+
+template <typename Char>
+const Char *findStructuralImpl(const Char *p, const Char *end) {
+#if defined(FSM_SIMD_AVX2) || defined(FSM_SIMD_SSE2)
+  using S = Simd<Char>;
+  const Vector open = S::splat(Char('{'));
+  const Vector close = S::splat(Char('}'));
+  const Vector quote = S::splat(Char('"'));
+  const Vector slash = S::splat(Char('/'));
+  for (; end - p >= S::Lanes; p += S::Lanes) {
+    const Vector chunk = load(p);
+    const quint32 mask =
+        bits(either(either(S::equal(chunk, open), S::equal(chunk, close)),
+                    either(S::equal(chunk, quote), S::equal(chunk, slash))));
+    if (mask)
+      return firstLane(p, mask);
+  }
+#endif
+  while (p < end && *p != Char('{') && *p != Char('}') && *p != Char('"') &&
+         *p != Char('/'))
+    ++p;
+  return p;
+}
+
+} // namespace
+
+const char16_t *skipWhitespace(const char16_t *p, const char16_t *end) {
+  return skipWhitespaceImpl(p, end);
+}
+
+const char *skipWhitespace(const char *p, const char *end) {
+  return skipWhitespaceImpl(p, end);
+}
+
+const char16_t *findNewline(const char16_t *p, const char16_t *end) {
+  return findNewlineImpl(p, end);
+}
+
+const char *findNewline(const char *p, const char *end) {
+  return findNewlineImpl(p, end);
+}
+
+const char16_t *findBlockCommentEnd(const char16_t *p, const char16_t *end) {
+  return findBlockCommentEndImpl(p, end);
+}
+
+const char *findBlockCommentEnd(const char *p, const char *end) {
+  return findBlockCommentEndImpl(p, end);
+}
+
+const char16_t *findQuoteOrBackslash(const char16_t *p, const char16_t *end) {
+  return findQuoteOrBackslashImpl(p, end);
+}
+
+const char *findQuoteOrBackslash(const char *p, const char *end) {
+  return findQuoteOrBackslashImpl(p, end);
+}
+
+const char16_t *findStructural(const char16_t *p, const char16_t *end) {
+  return findStructuralImpl(p, end);
+}
+
+const char *findStructural(const char *p, const char *end) {
+  return findStructuralImpl(p, end);
+}
+
+const char *backendName() {
+#if defined(FSM_SIMD_AVX2)
+  return "AVX2";
+#elif defined(FSM_SIMD_SSE2)
+  return "SSE2";
+#else
+  return "scalar";
+#endif
+}
+
+} // namespace SimdScan
+} // namespace FSMParser
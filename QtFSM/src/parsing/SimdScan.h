@@ -0,0 +1,58 @@
+#pragma once
+
+namespace FSMParser {
+
+/**
+ * @brief Vectorized character scanners used by the Lexer.
+ *
+ * Each function scans code units in [p, end) and returns a pointer to the
+ * first match, or @p end if there is none. Every scanner comes in a UTF-16
+ * flavour and a UTF-8 byte flavour; all characters searched for are ASCII,
+ * which never occurs inside a multi-byte UTF-8 sequence. The backend is chosen
+ * at compile time: AVX2 compares 32 bytes per step, SSE2 compares 16 bytes,
+ * and a plain loop is used everywhere else and for the tail of the input.
+ *
+ * @ingroup Parsing
+ */
+namespace SimdScan {
+
+/**
+ * @brief Finds the first character that is not a space, tab, CR or LF.
+ */
+const char16_t *skipWhitespace(const char16_t *p, const char16_t *end);
+const char *skipWhitespace(const char *p, const char *end);
+
+/**
+ * @brief Finds the next '\n'.
+ */
+const char16_t *findNewline(const char16_t *p, const char16_t *end);
+const char *findNewline(const char *p, const char *end);
+
+/**
+ * @brief Finds the '*' of the next "*\/" sequence.
+ */
+const char16_t *findBlockCommentEnd(const char16_t *p, const char16_t *end);
+const char *findBlockCommentEnd(const char *p, const char *end);
+
+/**
+ * @brief Finds the next '"' or '\\' (string literal terminator or escape).
+ */
+const char16_t *findQuoteOrBackslash(const char16_t *p, const char16_t *end);
+const char *findQuoteOrBackslash(const char *p, const char *end);
+
+/**
+ * @brief Finds the next '{', '}', '"' or '/' (everything that matters when
+ * skipping a balanced block).
+ */
+const char16_t *findStructural(const char16_t *p, const char16_t *end);
+const char *findStructural(const char *p, const char *end);
+
+/**
+ * @brief Gets the name of the backend compiled in ("AVX2", "SSE2" or
+ * "scalar").
+ */
+const char *backendName();
+
+} // namespace SimdScan
+
+} // namespace FSMParser
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <QString>
+#include <QStringView>
 
 namespace FSMParser {
 
@@ -62,15 +63,30 @@ enum class TokenType {
   Unknown
 };
 
+/**
+ * @brief A single lexeme produced by the Lexer.
+ *
+ * The token does not own its text: @ref value is a view into the source string
+ * the Lexer was constructed with, so that source must outlive the token. For
+ * a Lexer reading UTF-8 (Lexer::fromUtf8) the view points into text decoded
+ * by the Lexer instead, so the Lexer must outlive the token. Use
+ * `value.toString()` when the text has to be stored (e.g. in the AST).
+ *
+ * Only the character offset of the token is recorded; line and column are
+ * resolved on demand with Lexer::location() when a diagnostic needs them.
+ *
+ * For braces, Lexer::tokenize() also records @ref match, the distance in
+ * tokens to the matching brace, so the parser can jump over a block without
+ * walking it. The distance is relative, so it survives slicing the vector.
+ */
 struct Token {
   TokenType type;
-  QString value;
-  int line;
-  int column;
+  QStringView value;
+  int offset;
+  int match = 0; // Tokens to the matching brace (negative for '}'), 0 if none
 
-  Token(TokenType t = TokenType::Unknown, const QString &v = "", int l = 0,
-        int c = 0)
-      : type(t), value(v), line(l), column(c) {}
+  Token(TokenType t = TokenType::Unknown, QStringView v = {}, int o = 0)
+      : type(t), value(v), offset(o) {}
 
   bool isKeyword() const {
     return type >= TokenType::Keyword_Class &&
@@ -0,0 +1,131 @@
+#include "TokenStream.h"
+#include "Lexer.h"
+
+#include <QElapsedTimer>
+
+namespace FSMParser {
+
+namespace {
+// Enough for the parser's usual lookahead; the ring only grows while a mark
+// pins a longer backtracking window.
+constexpr int InitialRingSize = 64;
+// Tokens lexed per fill(), so the lexing clock is read once per batch
+constexpr int FillBatch = 16;
+} // namespace
+
+TokenStream::TokenStream(Lexer *lexer)
+    : m_lexer(lexer), m_ring(InitialRingSize),
+      m_endToken(TokenType::EndOfFile), m_ringAllocations(1) {}
+
+TokenStream::TokenStream(const QVector<Token> &tokens)
+    : m_tokens(tokens), m_endToken(TokenType::EndOfFile) {}
+
+const Token &TokenStream::at(int index) {
+  if (!m_lexer) {
+    if (index >= 0 && index < m_tokens.size())
+      return m_tokens.at(index);
+    return m_endToken;
+  }
+
+  if (index < m_head)
+    return m_endToken;
+
+  while (index >= m_tail && !m_lexerDone) {
+    fill();
+  }
+
+  if (index >= m_tail)
+    return m_endToken;
+  return m_ring[index & (m_ring.size() - 1)];
+}
+
+void TokenStream::fill() {
+  if (m_tail - m_head == m_ring.size()) {
+    grow();
+  }
+
+  // Lex ahead into the free part of the ring, without growing it for that
+  const int count = qMin(FillBatch, m_ring.size() - (m_tail - m_head));
+  QElapsedTimer timer;
+  timer.start();
+  for (int i = 0; i < count && !m_lexerDone; ++i) {
+    Token token = m_lexer->nextToken();
+    m_ring[m_tail & (m_ring.size() - 1)] = token;
+    m_tail++;
+
+    if (token.type == TokenType::EndOfFile) {
+      m_lexerDone = true;
+      m_endToken = token;
+    }
+  }
+  m_lexNanoseconds += timer.nsecsElapsed();
+}
+
+void TokenStream::grow() {
+  QVector<Token> ring(m_ring.size() * 2);
+  const int oldMask = m_ring.size() - 1;
+  const int newMask = ring.size() - 1;
+  for (int i = m_head; i < m_tail; ++i) {
+    ring[i & newMask] = m_ring[i & oldMask];
+  }
+  m_ring.swap(ring);
+  m_ringAllocations++;
+}
+
+int TokenStream::matchingBrace(int openIndex) {
+  if (!m_lexer) {
+    if (openIndex < 0 || openIndex >= m_tokens.size())
+      return m_tokens.size();
+    const int match = m_tokens.at(openIndex).match;
+    if (match > 0)
+      return openIndex + match;
+  }
+
+  // Count what is already available (hand-built vectors carry no index)
+  int depth = 0;
+  for (int i = openIndex;; ++i) {
+    const Token &token = at(i);
+    if (token.type == TokenType::EndOfFile)
+      return i;
+    if (token.type == TokenType::LeftBrace) {
+      depth++;
+    } else if (token.type == TokenType::RightBrace && --depth == 0) {
+      return i;
+    }
+    if (m_lexer && i + 1 == m_tail)
+      break;
+  }
+
+  // The rest of the block has not been lexed yet
+  QElapsedTimer timer;
+  timer.start();
+  m_lexer->skipBalanced(depth);
+  m_lexNanoseconds += timer.nsecsElapsed();
+
+  const int close = m_tail; // The '}' (or EndOfFile) is lexed next
+  fill();
+  return close;
+}
+
+void TokenStream::release(int index) {
+  if (!m_lexer)
+    return;
+
+  int limit = index;
+  for (int marked : m_marks) {
+    limit = qMin(limit, marked);
+  }
+
+  if (limit > m_head) {
+    m_head = qMin(limit, m_tail);
+  }
+}
+
+void TokenStream::mark(int index) { m_marks.append(index); }
+
+void TokenStream::unmark() {
+  if (!m_marks.isEmpty())
+    m_marks.removeLast();
+}
+
+} // namespace FSMParser
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Token.h"
+#include <QVector>
+
+namespace FSMParser {
+
+class Lexer;
+
+/**
+ * @brief The TokenStream class feeds tokens to the CppParser on demand.
+ *
+ * In streaming mode the stream pulls tokens from a Lexer into a small ring
+ * buffer as the parser looks ahead, so parsing starts before lexing has
+ * finished and memory is bounded by the parser's lookahead window rather than
+ * by the size of the source. Positions are absolute token indices. Tokens
+ * before the release point (the parser's previous token, or the oldest active
+ * mark when it backtracks) are dropped from the buffer.
+ *
+ * A pre-tokenized QVector<Token> can also be wrapped; in that mode all tokens
+ * stay available.
+ *
+ * @ingroup Parsing
+ */
+class TokenStream {
+public:
+  /**
+   * @brief Constructs a stream that pulls tokens lazily from a Lexer.
+   * @param lexer The lexer to read from. Must outlive the stream.
+   */
+  explicit TokenStream(Lexer *lexer);
+
+  /**
+   * @brief Constructs a stream over an already tokenized source.
+   * @param tokens The complete token vector (shared, not copied).
+   */
+  explicit TokenStream(const QVector<Token> &tokens);
+
+  /**
+   * @brief Returns the token at an absolute index, lexing up to it if needed.
+   * Indices past the end (or already released) yield the EndOfFile token.
+   * The reference is only valid until the next call on the stream.
+   * @param index Absolute token index.
+   */
+  const Token &at(int index);
+
+  /**
+   * @brief Finds the '}' closing the block opened at @p openIndex.
+   *
+   * Pre-tokenized streams answer from the brace index recorded by
+   * Lexer::tokenize(). Streaming mode counts the braces already buffered and
+   * lets the Lexer skip the remainder of the block as raw characters, so the
+   * body is never turned into tokens.
+   *
+   * @param openIndex Absolute index of a LeftBrace token.
+   * @return Index of the matching RightBrace, or of the EndOfFile token when
+   * the block is never closed.
+   */
+  int matchingBrace(int openIndex);
+
+  /**
+   * @brief Allows tokens before @p index to be dropped from the buffer.
+   * Ignored for positions still pinned by mark().
+   * @param index First absolute index that must stay available.
+   */
+  void release(int index);
+
+  /**
+   * @brief Pins @p index (and everything after it) so the parser can rewind.
+   * @param index Absolute index to keep available.
+   */
+  void mark(int index);
+
+  /**
+   * @brief Removes the most recent mark.
+   */
+  void unmark();
+
+  /**
+   * @brief Gets the number of tokens currently held in the ring buffer.
+   * @return Buffered token count (0 in pre-tokenized mode).
+   */
+  int bufferedCount() const { return m_tail - m_head; }
+
+  /**
+   * @brief Gets the number of tokens produced so far.
+   * @return Tokens lexed (streaming) or held (pre-tokenized).
+   */
+  int tokenCount() const { return m_lexer ? m_tail : m_tokens.size(); }
+
+  /**
+   * @brief Gets the time spent inside the Lexer (streaming mode only).
+   * Tokens are lexed in small batches, so the clock is read once per batch
+   * rather than once per token.
+   * @return Wall time in nanoseconds.
+   */
+  qint64 lexNanoseconds() const { return m_lexNanoseconds; }
+
+  /**
+   * @brief Gets how often the ring buffer was (re)allocated.
+   * @return Allocation count (0 in pre-tokenized mode).
+   */
+  int ringAllocations() const { return m_ringAllocations; }
+
+private:
+  void fill();
+  void grow();
+
+  Lexer *m_lexer = nullptr;
+  QVector<Token> m_tokens; // Pre-tokenized mode only
+
+  QVector<Token> m_ring; // Size is always a power of two
+  int m_head = 0;        // Oldest buffered absolute index
+  int m_tail = 0;        // One past the newest buffered absolute index
+  bool m_lexerDone = false;
+  QVector<int> m_marks;
+  Token m_endToken;
+  qint64 m_lexNanoseconds = 0;
+  int m_ringAllocations = 0;
+};
+
+} // namespace FSMParser
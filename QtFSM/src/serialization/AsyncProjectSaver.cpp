@@ -0,0 +1,107 @@
+#include "AsyncProjectSaver.h"
+#include "../model/FSM.h"
+#include "BinarySerializer.h"
+#include "JSONSerializer.h"
+#include <QDebug>
+#include <QSaveFile>
+#include <QSignalBlocker>
+#include <QtConcurrent>
+#include <utility>
+
+AsyncProjectSaver::AsyncProjectSaver(QObject *parent) : QObject(parent) {
+  connect(&m_watcher, &QFutureWatcher<QString>::finished, this, [this]() {
+    // waitForFinished() may already have handled this save
+    if (m_running && m_watcher.isFinished()) {
+      finishCurrent();
+    }
+  });
+}
+
+AsyncProjectSaver::~AsyncProjectSaver() {
+  // The owner may be half destroyed already, so nobody is notified
+  const QSignalBlocker blocker(this);
+  waitForFinished();
+}
+
+void AsyncProjectSaver::save(const FSM *fsm, const QString &filepath) {
+  save(FSMSnapshot::capture(fsm), filepath);
+}
+
+void AsyncProjectSaver::save(const FSMSnapshot &snapshot,
+                             const QString &filepath) {
+  // A queued save of the same file would only be overwritten
+  for (Request &request : m_queue) {
+    if (request.filepath == filepath) {
+      request.snapshot = snapshot;
+      return;
+    }
+  }
+  m_queue.append({snapshot, filepath});
+  if (!m_running) {
+    startNext();
+  }
+}
+
+void AsyncProjectSaver::waitForFinished() {
+  while (m_running) {
+    m_watcher.waitForFinished();
+    finishCurrent();
+  }
+}
+
+void AsyncProjectSaver::startNext() {
+  if (m_queue.isEmpty()) {
+    return;
+  }
+  Request request = m_queue.takeFirst();
+  m_currentPath = request.filepath;
+  m_running = true;
+  m_watcher.setFuture(QtConcurrent::run(
+      [snapshot = std::move(request.snapshot), filepath = m_currentPath]() {
+        return write(snapshot, filepath);
+      }));
+}
+
+void AsyncProjectSaver::finishCurrent() {
+  const QString error = m_watcher.result();
+  const QString filepath = m_currentPath;
+  m_running = false;
+  m_currentPath.clear();
+
+  // Start the next one first, so a slot calling save() only queues
+  startNext();
+
+  if (error.isEmpty()) {
+    emit saved(filepath);
+  } else {
+    qDebug() << "AsyncProjectSaver - Could not save" << filepath << error;
+    emit saveFailed(filepath, error);
+  }
+}
+
+QString AsyncProjectSaver::write(const FSMSnapshot &snapshot,
+                                 const QString &filepath) {
+  // Written straight from the snapshot; no FSM is built on this thread
+  QSaveFile file(filepath);
+  if (!file.open(QIODevice::WriteOnly)) {
+    return QString("Could not open %1 for writing: %2")
+        .arg(filepath, file.errorString());
+  }
+
+  if (BinarySerializer::isBinaryProject(filepath)) {
+    BinarySerializer serializer;
+    if (!serializer.save(snapshot, &file)) {
+      return serializer.lastError();
+    }
+  } else {
+    JSONSerializer serializer;
+    if (!serializer.save(snapshot, &file)) {
+      return QString("Could not write %1: %2")
+          .arg(filepath, file.errorString());
+    }
+  }
+  if (!file.commit()) {
+    return QString("Could not write %1: %2").arg(filepath, file.errorString());
+  }
+  return QString();
+}
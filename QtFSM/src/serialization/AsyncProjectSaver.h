@@ -0,0 +1,95 @@
+#ifndef ASYNCPROJECTSAVER_H
+#define ASYNCPROJECTSAVER_H
+
+#include "FSMSnapshot.h"
+#include <QFutureWatcher>
+#include <QList>
+#include <QObject>
+#include <QString>
+
+class FSM;
+
+/**
+ * @brief Saves projects on the thread pool so the editor never waits for
+ * serialization or the disk.
+ *
+ * save() takes an FSMSnapshot on the calling (GUI) thread and returns at once;
+ * the snapshot is serialized and written on a worker thread. The file is
+ * written through QSaveFile, which flushes it to disk and renames it over the
+ * old one, so a crash mid-save never leaves a truncated project.
+ *
+ * Saves run one at a time in request order. Requesting another save of a file
+ * that is still queued replaces the queued snapshot, so a burst of saves
+ * writes the latest state once.
+ *
+ * @ingroup Serialization
+ */
+class AsyncProjectSaver : public QObject {
+  Q_OBJECT
+
+public:
+  explicit AsyncProjectSaver(QObject *parent = nullptr);
+
+  /**
+   * @brief Finishes all queued saves (without emitting signals).
+   */
+  ~AsyncProjectSaver();
+
+  /**
+   * @brief Snapshots the FSM and saves it in the background.
+   * @param fsm The FSM to save; it may be edited as soon as this returns.
+   * @param filepath Destination; `.fsmb` files are binary, others JSON.
+   */
+  void save(const FSM *fsm, const QString &filepath);
+
+  /**
+   * @brief Saves an existing snapshot in the background.
+   */
+  void save(const FSMSnapshot &snapshot, const QString &filepath);
+
+  /**
+   * @brief Checks whether a save is running or queued.
+   */
+  bool isSaving() const { return m_running || !m_queue.isEmpty(); }
+
+  /**
+   * @brief Blocks until every queued save has been written, emitting the
+   * result signals from this call.
+   */
+  void waitForFinished();
+
+  /**
+   * @brief Writes a snapshot synchronously; this is what the worker runs.
+   * @param snapshot The project contents.
+   * @param filepath Destination; `.fsmb` files are binary, others JSON.
+   * @return An empty string on success, otherwise the error.
+   */
+  static QString write(const FSMSnapshot &snapshot, const QString &filepath);
+
+signals:
+  /**
+   * @brief Emitted when a file has been written completely.
+   */
+  void saved(const QString &filepath);
+
+  /**
+   * @brief Emitted when writing a file failed; the old file is unchanged.
+   */
+  void saveFailed(const QString &filepath, const QString &error);
+
+private:
+  struct Request {
+    FSMSnapshot snapshot;
+    QString filepath;
+  };
+
+  void startNext();
+  void finishCurrent();
+
+  QFutureWatcher<QString> m_watcher;
+  QList<Request> m_queue;
+  QString m_currentPath;
+  bool m_running = false;
+};
+
+#endif // ASYNCPROJECTSAVER_H
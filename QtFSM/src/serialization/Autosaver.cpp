@@ -0,0 +1,139 @@
+#include "Autosaver.h"
+#include "../model/FSM.h"
+#include "../model/State.h"
+#include "../model/Transition.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+
+namespace {
+
+const char *const RecoveryPattern = "autosave-*.fsmb";
+
+QString lockPath(const QString &recoveryFile) {
+  return recoveryFile + ".lock";
+}
+
+} // namespace
+
+Autosaver::Autosaver(const QString &directory, QObject *parent)
+    : QObject(parent), m_directory(directory) {
+  if (m_directory.isEmpty()) {
+    m_directory = QStandardPaths::writableLocation(
+                      QStandardPaths::AppLocalDataLocation) +
+                  "/autosave";
+  }
+  QDir().mkpath(m_directory);
+
+  // One file per instance; the lock tells a crashed instance from a running
+  m_recoveryFile = QDir(m_directory).filePath(
+      QString("autosave-%1.fsmb").arg(QCoreApplication::applicationPid()));
+  m_lock = std::make_unique<QLockFile>(lockPath(m_recoveryFile));
+  m_lock->tryLock(0);
+
+  connect(&m_saver, &AsyncProjectSaver::saveFailed, this,
+          [this](const QString &, const QString &error) {
+            m_hasFile = false; // Retried on the next autosave
+            emit autosaveFailed(error);
+          });
+}
+
+Autosaver::~Autosaver() = default;
+
+bool Autosaver::autosave(const FSM *fsm) {
+  if (!fsm || fsm->states().isEmpty()) {
+    return false;
+  }
+
+  if (fsm != m_fsm) {
+    watch(fsm);
+  }
+  if (m_hasFile && !m_dirty) {
+    return false;
+  }
+
+  m_dirty = false;
+  m_hasFile = true;
+  m_saver.save(FSMSnapshot::capture(fsm), m_recoveryFile);
+  return true;
+}
+
+void Autosaver::discard() {
+  m_saver.waitForFinished();
+  QFile::remove(m_recoveryFile);
+  m_hasFile = false;
+}
+
+void Autosaver::watch(const FSM *fsm) {
+  if (m_fsm) {
+    disconnect(m_fsm, nullptr, this, nullptr);
+    for (const State *state : m_fsm->states()) {
+      disconnect(state, nullptr, this, nullptr);
+    }
+    for (const Transition *transition : m_fsm->transitions()) {
+      disconnect(transition, nullptr, this, nullptr);
+    }
+  }
+  m_fsm = fsm;
+  m_dirty = true;
+
+  // FSM::modified covers structural edits and batched moves; property edits
+  // are only signalled by the states and transitions themselves
+  connect(fsm, &FSM::modified, this, &Autosaver::markDirty);
+  connect(fsm, &FSM::stateAdded, this, &Autosaver::watchState);
+  connect(fsm, &FSM::transitionAdded, this, &Autosaver::watchTransition);
+  for (const State *state : fsm->states()) {
+    watchState(state);
+  }
+  for (const Transition *transition : fsm->transitions()) {
+    watchTransition(transition);
+  }
+}
+
+void Autosaver::watchState(const State *state) {
+  connect(state, &State::idChanged, this, &Autosaver::markDirty);
+  connect(state, &State::nameChanged, this, &Autosaver::markDirty);
+  connect(state, &State::entryActionChanged, this, &Autosaver::markDirty);
+  connect(state, &State::exitActionChanged, this, &Autosaver::markDirty);
+  connect(state, &State::positionChanged, this, &Autosaver::markDirty);
+  connect(state, &State::initialChanged, this, &Autosaver::markDirty);
+  connect(state, &State::finalChanged, this, &Autosaver::markDirty);
+  connect(state, &State::customFunctionAdded, this, &Autosaver::markDirty);
+  connect(state, &State::customFunctionRemoved, this, &Autosaver::markDirty);
+}
+
+void Autosaver::watchTransition(const Transition *transition) {
+  connect(transition, &Transition::idChanged, this, &Autosaver::markDirty);
+  connect(transition, &Transition::sourceStateChanged, this,
+          &Autosaver::markDirty);
+  connect(transition, &Transition::targetStateChanged, this,
+          &Autosaver::markDirty);
+  connect(transition, &Transition::eventChanged, this, &Autosaver::markDirty);
+  connect(transition, &Transition::guardChanged, this, &Autosaver::markDirty);
+  connect(transition, &Transition::actionChanged, this, &Autosaver::markDirty);
+}
+
+QStringList Autosaver::recoverableFiles() const {
+  QStringList files;
+  const QDir dir(m_directory);
+  const QStringList names =
+      dir.entryList({RecoveryPattern}, QDir::Files, QDir::Time);
+  for (const QString &name : names) {
+    const QString file = dir.filePath(name);
+    if (file == m_recoveryFile) {
+      continue;
+    }
+    // Only succeeds if the owner is gone; the lock is released right away
+    QLockFile lock(lockPath(file));
+    if (lock.tryLock(0)) {
+      files.append(file);
+    }
+  }
+  return files;
+}
+
+void Autosaver::removeRecoveryFile(const QString &filepath) {
+  QFile::remove(filepath);
+  QFile::remove(lockPath(filepath));
+}
@@ -0,0 +1,107 @@
+#ifndef AUTOSAVER_H
+#define AUTOSAVER_H
+
+#include "AsyncProjectSaver.h"
+#include "FSMSnapshot.h"
+#include <QLockFile>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QStringList>
+#include <memory>
+
+class FSM;
+class State;
+class Transition;
+
+/**
+ * @brief Keeps a crash-recovery copy of the open project.
+ *
+ * Each running instance owns one binary recovery file in the autosave
+ * directory, guarded by a QLockFile. autosave() is meant to be called from a
+ * timer. The autosaver watches the FSM's change signals and only when
+ * something changed since the last autosave does it snapshot the FSM on the
+ * GUI thread and hand the snapshot to an AsyncProjectSaver, so an idle
+ * project costs nothing and editing never waits for the disk.
+ *
+ * On a clean exit discard() deletes the file. A recovery file whose lock is
+ * stale (its instance crashed) is reported by recoverableFiles() at the next
+ * start.
+ *
+ * @ingroup Serialization
+ */
+class Autosaver : public QObject {
+  Q_OBJECT
+
+public:
+  /**
+   * @brief Constructs an autosaver writing into a directory.
+   * @param directory The autosave directory; empty for the default one in
+   * the application data location.
+   * @param parent The parent QObject.
+   */
+  explicit Autosaver(const QString &directory = QString(),
+                     QObject *parent = nullptr);
+
+  /**
+   * @brief Waits for a running autosave; the recovery file is kept unless
+   * discard() was called.
+   */
+  ~Autosaver();
+
+  /**
+   * @brief Saves the FSM to the recovery file if it changed.
+   * @param fsm The current FSM; nullptr or an empty FSM is not saved.
+   * @return true if a save was started.
+   */
+  bool autosave(const FSM *fsm);
+
+  /**
+   * @brief Deletes this instance's recovery file, e.g. after a clean exit or
+   * a successful manual save.
+   */
+  void discard();
+
+  /**
+   * @brief Blocks until a running autosave has been written.
+   */
+  void waitForFinished() { m_saver.waitForFinished(); }
+
+  /**
+   * @brief Gets the recovery file of this instance.
+   */
+  QString recoveryFile() const { return m_recoveryFile; }
+
+  /**
+   * @brief Lists recovery files left behind by instances that did not exit
+   * cleanly. Files of instances that are still running are not listed.
+   */
+  QStringList recoverableFiles() const;
+
+  /**
+   * @brief Deletes a recovery file returned by recoverableFiles().
+   */
+  static void removeRecoveryFile(const QString &filepath);
+
+signals:
+  /**
+   * @brief Emitted when an autosave could not be written.
+   */
+  void autosaveFailed(const QString &error);
+
+private:
+  void watch(const FSM *fsm);
+  void watchState(const State *state);
+  void watchTransition(const Transition *transition);
+  void markDirty() { m_dirty = true; }
+
+  QString m_directory;
+  QString m_recoveryFile;
+  std::unique_ptr<QLockFile> m_lock;
+  AsyncProjectSaver m_saver;
+  QPointer<const FSM> m_fsm; ///< The watched FSM
+  bool m_dirty = true;        ///< Changed since the last autosave
+  bool m_hasFile = false;
+};
+
+#endif // AUTOSAVER_H
@@ -0,0 +1,530 @@
+#include "BinarySerializer.h"
+#include "../model/FSM.h"
+#include "../model/State.h"
+#include "../model/Transition.h"
+#include "FSMSnapshot.h"
+#include <QHash>
+#include <QSaveFile>
+#include <QVector>
+#include <cstring>
+#include <limits>
+
+// File layout, every section 8-byte aligned:
+//
+//   Header
+//   StringEntry[stringCount]     offset/length into the character data
+//   char16_t[charCount]          UTF-16LE text of all strings, deduplicated
+//   StateRecord[stateCount]
+//   TransitionRecord[transitionCount]
+//   quint32[functionCount]       string indices of the custom functions
+namespace FsmbFormat {
+
+constexpr char Magic[4] = {'F', 'S', 'M', 'B'};
+
+enum StateFlag : quint32 { Initial = 1, Final = 2 };
+
+struct Header {
+  char magic[4];
+  quint16_le version;
+  quint16_le headerSize;
+  quint32_le stringCount;
+  quint32_le stateCount;
+  quint32_le transitionCount;
+  quint32_le functionCount;
+  quint32_le nameString;
+  quint32_le reserved;
+  quint64_le stringsOffset;
+  quint64_le charsOffset;
+  quint64_le charCount;
+  quint64_le statesOffset;
+  quint64_le transitionsOffset;
+  quint64_le functionsOffset;
+};
+
+struct StringEntry {
+  quint32_le offset; // In characters
+  quint32_le length;
+};
+
+struct StateRecord {
+  quint32_le id;
+  quint32_le name;
+  quint32_le entryAction;
+  quint32_le exitAction;
+  quint32_le firstFunction;
+  quint32_le functionCount;
+  quint32_le flags;
+  quint32_le reserved;
+  quint64_le x; // IEEE 754 bits
+  quint64_le y;
+};
+
+struct TransitionRecord {
+  quint32_le id;
+  quint32_le source; // State index
+  quint32_le target;
+  quint32_le event;
+  quint32_le guard;
+  quint32_le action;
+};
+
+static_assert(sizeof(Header) == 80, "Header layout changed");
+static_assert(sizeof(StringEntry) == 8, "StringEntry layout changed");
+static_assert(sizeof(StateRecord) == 48, "StateRecord layout changed");
+static_assert(sizeof(TransitionRecord) == 24,
+              "TransitionRecord layout changed");
+
+} // namespace FsmbFormat
+
+using namespace FsmbFormat;
+
+namespace {
+
+quint64 align8(quint64 size) { return (size + 7) & ~quint64(7); }
+
+quint64 doubleBits(double value) {
+  quint64 bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+double bitsToDouble(quint64 bits) {
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// Collects every string once; records refer to them by index
+class StringTable {
+public:
+  quint32 add(const QString &text) {
+    auto it = m_indices.constFind(text);
+    if (it != m_indices.cend())
+      return it.value();
+    const quint32 index = quint32(m_strings.size());
+    m_indices.insert(text, index);
+    m_strings.append(text);
+    m_charCount += quint64(text.size());
+    return index;
+  }
+
+  const QVector<QString> &strings() const { return m_strings; }
+  quint64 charCount() const { return m_charCount; }
+
+private:
+  QHash<QString, quint32> m_indices;
+  QVector<QString> m_strings;
+  quint64 m_charCount = 0;
+};
+
+template <typename T> T *at(QByteArray &buffer, quint64 offset) {
+  return reinterpret_cast<T *>(buffer.data() + offset);
+}
+
+} // namespace
+
+// ============================================================================
+// BinaryProjectView
+// ============================================================================
+
+bool BinaryProjectView::open(const QString &filepath) {
+  m_file.close();
+  m_copy.clear();
+  m_file.setFileName(filepath);
+  if (!m_file.open(QIODevice::ReadOnly)) {
+    return fail(QString("Could not open %1: %2")
+                    .arg(filepath, m_file.errorString()));
+  }
+
+  // The mapping lives until the file is closed, i.e. as long as the view
+  const qint64 size = m_file.size();
+  if (const uchar *mapped = size > 0 ? m_file.map(0, size) : nullptr) {
+    m_data = QByteArrayView(mapped, size);
+  } else {
+    m_copy = m_file.readAll();
+    m_data = m_copy;
+  }
+  return validate();
+}
+
+bool BinaryProjectView::openData(QByteArrayView data) {
+  m_file.close();
+  m_copy.clear();
+  m_data = data;
+  return validate();
+}
+
+bool BinaryProjectView::fail(const QString &error) {
+  m_error = error;
+  m_header = nullptr;
+  m_data = {};
+  return false;
+}
+
+// Checks once that every offset, count and index is in range, so the
+// accessors can index the records without further checks.
+bool BinaryProjectView::validate() {
+  m_error.clear();
+  const quint64 size = quint64(m_data.size());
+  if (size < sizeof(Header))
+    return fail("Not a binary FSM project (file too small)");
+
+  const auto *header = reinterpret_cast<const Header *>(m_data.data());
+  if (std::memcmp(header->magic, Magic, sizeof(Magic)) != 0)
+    return fail("Not a binary FSM project");
+  if (header->version != BinarySerializer::Version)
+    return fail(QString("Unsupported binary project version %1")
+                    .arg(quint16(header->version)));
+  if (header->headerSize != sizeof(Header))
+    return fail("Corrupt binary project header");
+
+  // Section sizes fit in 64 bits because counts are 32-bit
+  auto inside = [size](quint64 offset, quint64 count, quint64 width) {
+    return offset % 8 == 0 && offset <= size && count * width <= size - offset;
+  };
+  const quint32 stringCount = header->stringCount;
+  const quint32 stateCount = header->stateCount;
+  const quint32 transitionCount = header->transitionCount;
+  const quint32 functionCount = header->functionCount;
+  const quint64 charCount = header->charCount;
+  if (!inside(header->stringsOffset, stringCount, sizeof(StringEntry)) ||
+      !inside(header->charsOffset, charCount, sizeof(char16_t)) ||
+      !inside(header->statesOffset, stateCount, sizeof(StateRecord)) ||
+      !inside(header->transitionsOffset, transitionCount,
+              sizeof(TransitionRecord)) ||
+      !inside(header->functionsOffset, functionCount, sizeof(quint32)) ||
+      stateCount > quint32(std::numeric_limits<int>::max()) ||
+      transitionCount > quint32(std::numeric_limits<int>::max())) {
+    return fail("Corrupt binary project (section out of range)");
+  }
+
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+  // Characters are viewed as native char16_t, so swap them once in a copy
+  if (m_copy.constData() != m_data.data()) {
+    m_copy = m_data.toByteArray();
+    m_data = m_copy;
+    header = reinterpret_cast<const Header *>(m_data.data());
+  }
+  qFromLittleEndian<quint16>(m_copy.constData() + header->charsOffset,
+                             qsizetype(charCount),
+                             m_copy.data() + header->charsOffset);
+#endif
+
+  const char *base = m_data.data();
+  m_header = header;
+  m_strings =
+      reinterpret_cast<const StringEntry *>(base + header->stringsOffset);
+  m_chars = reinterpret_cast<const char16_t *>(base + header->charsOffset);
+  m_states =
+      reinterpret_cast<const StateRecord *>(base + header->statesOffset);
+  m_transitions = reinterpret_cast<const TransitionRecord *>(
+      base + header->transitionsOffset);
+  m_functions = reinterpret_cast<const quint32_le *>(
+      base + header->functionsOffset);
+
+  for (quint32 i = 0; i < stringCount; ++i) {
+    const quint64 end = quint64(m_strings[i].offset) + m_strings[i].length;
+    if (end > charCount ||
+        m_strings[i].length > quint32(std::numeric_limits<int>::max()))
+      return fail("Corrupt binary project (string out of range)");
+  }
+  auto validString = [stringCount](quint32 index) {
+    return index < stringCount;
+  };
+  if (!validString(header->nameString))
+    return fail("Corrupt binary project (bad name)");
+  for (quint32 i = 0; i < functionCount; ++i) {
+    if (!validString(m_functions[i]))
+      return fail("Corrupt binary project (bad function)");
+  }
+  for (quint32 i = 0; i < stateCount; ++i) {
+    const StateRecord &s = m_states[i];
+    if (!validString(s.id) || !validString(s.name) ||
+        !validString(s.entryAction) || !validString(s.exitAction) ||
+        quint64(s.firstFunction) + s.functionCount > functionCount) {
+      return fail(QString("Corrupt binary project (state %1)").arg(i));
+    }
+  }
+  for (quint32 i = 0; i < transitionCount; ++i) {
+    const TransitionRecord &t = m_transitions[i];
+    if (!validString(t.id) || t.source >= stateCount ||
+        t.target >= stateCount || !validString(t.event) ||
+        !validString(t.guard) || !validString(t.action)) {
+      return fail(QString("Corrupt binary project (transition %1)").arg(i));
+    }
+  }
+  return true;
+}
+
+QStringView BinaryProjectView::string(quint32 index) const {
+  const StringEntry &entry = m_strings[index];
+  return QStringView(m_chars + entry.offset, qsizetype(entry.length));
+}
+
+const StateRecord &BinaryProjectView::state(int index) const {
+  return m_states[index];
+}
+
+const TransitionRecord &BinaryProjectView::transition(int index) const {
+  return m_transitions[index];
+}
+
+QStringView BinaryProjectView::name() const {
+  return m_header ? string(m_header->nameString) : QStringView();
+}
+
+int BinaryProjectView::stateCount() const {
+  return m_header ? int(m_header->stateCount) : 0;
+}
+
+int BinaryProjectView::transitionCount() const {
+  return m_header ? int(m_header->transitionCount) : 0;
+}
+
+QStringView BinaryProjectView::stateId(int index) const {
+  return string(state(index).id);
+}
+
+QStringView BinaryProjectView::stateName(int index) const {
+  return string(state(index).name);
+}
+
+QStringView BinaryProjectView::stateEntryAction(int index) const {
+  return string(state(index).entryAction);
+}
+
+QStringView BinaryProjectView::stateExitAction(int index) const {
+  return string(state(index).exitAction);
+}
+
+QPointF BinaryProjectView::statePosition(int index) const {
+  return QPointF(bitsToDouble(state(index).x), bitsToDouble(state(index).y));
+}
+
+bool BinaryProjectView::isInitialState(int index) const {
+  return state(index).flags & Initial;
+}
+
+bool BinaryProjectView::isFinalState(int index) const {
+  return state(index).flags & Final;
+}
+
+int BinaryProjectView::stateFunctionCount(int index) const {
+  return int(state(index).functionCount);
+}
+
+QStringView BinaryProjectView::stateFunction(int index, int function) const {
+  return string(m_functions[state(index).firstFunction + quint32(function)]);
+}
+
+QStringView BinaryProjectView::transitionId(int index) const {
+  return string(transition(index).id);
+}
+
+int BinaryProjectView::transitionSource(int index) const {
+  return int(transition(index).source);
+}
+
+int BinaryProjectView::transitionTarget(int index) const {
+  return int(transition(index).target);
+}
+
+QStringView BinaryProjectView::transitionEvent(int index) const {
+  return string(transition(index).event);
+}
+
+QStringView BinaryProjectView::transitionGuard(int index) const {
+  return string(transition(index).guard);
+}
+
+QStringView BinaryProjectView::transitionAction(int index) const {
+  return string(transition(index).action);
+}
+
+// ============================================================================
+// BinarySerializer
+// ============================================================================
+
+BinarySerializer::BinarySerializer(QObject *parent) : QObject(parent) {}
+
+bool BinarySerializer::save(const FSM *fsm, const QString &filepath) {
+  // Replaces the old file only once the new one is complete on disk
+  QSaveFile file(filepath);
+  if (!file.open(QIODevice::WriteOnly)) {
+    m_lastError = QString("Could not open %1 for writing: %2")
+                      .arg(filepath, file.errorString());
+    return false;
+  }
+  if (!save(fsm, &file)) {
+    return false;
+  }
+  if (!file.commit()) {
+    m_lastError = QString("Could not write %1: %2")
+                      .arg(filepath, file.errorString());
+    return false;
+  }
+  return true;
+}
+
+bool BinarySerializer::save(const FSM *fsm, QIODevice *device) {
+  if (!fsm) {
+    m_lastError = "FSM is null";
+    return false;
+  }
+  // The snapshot shares the model's strings, so this copies no text; it also
+  // drops transitions to states outside the FSM, which have no index
+  return save(FSMSnapshot::capture(fsm), device);
+}
+
+bool BinarySerializer::save(const FSMSnapshot &snapshot, QIODevice *device) {
+  m_lastError.clear();
+  const QVector<FSMSnapshot::StateData> &states = snapshot.states();
+  const QVector<FSMSnapshot::TransitionData> &transitions =
+      snapshot.transitions();
+
+  StringTable strings;
+  const quint32 nameString = strings.add(snapshot.name());
+  QVector<StateRecord> stateRecords(states.size());
+  QVector<quint32> functions;
+  for (int i = 0; i < states.size(); ++i) {
+    const FSMSnapshot::StateData &state = states[i];
+    StateRecord &record = stateRecords[i];
+    record.id = strings.add(state.id);
+    record.name = strings.add(state.name);
+    record.entryAction = strings.add(state.entryAction);
+    record.exitAction = strings.add(state.exitAction);
+    record.firstFunction = quint32(functions.size());
+    for (const QString &function : state.customFunctions) {
+      functions.append(strings.add(function));
+    }
+    record.functionCount = quint32(state.customFunctions.size());
+    record.flags = quint32((state.isInitial ? Initial : 0) |
+                           (state.isFinal ? Final : 0));
+    record.reserved = 0;
+    record.x = doubleBits(state.position.x());
+    record.y = doubleBits(state.position.y());
+  }
+
+  QVector<TransitionRecord> transitionRecords(transitions.size());
+  for (int i = 0; i < transitions.size(); ++i) {
+    const FSMSnapshot::TransitionData &transition = transitions[i];
+    TransitionRecord &record = transitionRecords[i];
+    record.id = strings.add(transition.id);
+    record.source = quint32(transition.source);
+    record.target = quint32(transition.target);
+    record.event = strings.add(transition.event);
+    record.guard = strings.add(transition.guard);
+    record.action = strings.add(transition.action);
+  }
+
+  // Lay out the sections, then fill one zeroed buffer and write it at once
+  const QVector<QString> &table = strings.strings();
+  Header header;
+  std::memcpy(header.magic, Magic, sizeof(Magic));
+  header.version = Version;
+  header.headerSize = sizeof(Header);
+  header.stringCount = quint32(table.size());
+  header.stateCount = quint32(stateRecords.size());
+  header.transitionCount = quint32(transitionRecords.size());
+  header.functionCount = quint32(functions.size());
+  header.nameString = nameString;
+  header.reserved = 0;
+  header.stringsOffset = align8(sizeof(Header));
+  header.charsOffset =
+      align8(header.stringsOffset + table.size() * sizeof(StringEntry));
+  header.charCount = strings.charCount();
+  header.statesOffset =
+      align8(header.charsOffset + strings.charCount() * sizeof(char16_t));
+  header.transitionsOffset =
+      align8(header.statesOffset + stateRecords.size() * sizeof(StateRecord));
+  header.functionsOffset = align8(header.transitionsOffset +
+                                  transitionRecords.size() *
+                                      sizeof(TransitionRecord));
+  const quint64 fileSize =
+      align8(header.functionsOffset + functions.size() * sizeof(quint32));
+
+  QByteArray buffer(qsizetype(fileSize), '\0');
+  std::memcpy(buffer.data(), &header, sizeof(Header));
+
+  StringEntry *entries = at<StringEntry>(buffer, header.stringsOffset);
+  char *chars = buffer.data() + header.charsOffset;
+  quint32 charOffset = 0;
+  for (int i = 0; i < table.size(); ++i) {
+    const QString &text = table[i];
+    entries[i].offset = charOffset;
+    entries[i].length = quint32(text.size());
+    qToLittleEndian<quint16>(text.utf16(), text.size(),
+                             chars + charOffset * sizeof(char16_t));
+    charOffset += quint32(text.size());
+  }
+
+  if (!stateRecords.isEmpty()) {
+    std::memcpy(buffer.data() + header.statesOffset, stateRecords.constData(),
+                stateRecords.size() * sizeof(StateRecord));
+  }
+  if (!transitionRecords.isEmpty()) {
+    std::memcpy(buffer.data() + header.transitionsOffset,
+                transitionRecords.constData(),
+                transitionRecords.size() * sizeof(TransitionRecord));
+  }
+  quint32_le *functionIndices = at<quint32_le>(buffer, header.functionsOffset);
+  for (int i = 0; i < functions.size(); ++i) {
+    functionIndices[i] = functions[i];
+  }
+
+  if (device->write(buffer) != buffer.size()) {
+    m_lastError = QString("Could not write: %1").arg(device->errorString());
+    return false;
+  }
+  return true;
+}
+
+FSM *BinarySerializer::load(const QString &filepath) {
+  m_lastError.clear();
+  BinaryProjectView view;
+  if (!view.open(filepath)) {
+    m_lastError = view.errorString();
+    return nullptr;
+  }
+  return load(view);
+}
+
+FSM *BinarySerializer::load(const BinaryProjectView &view) {
+  FSM *fsm = new FSM();
+  fsm->setName(view.name().toString());
+
+  // Records are already validated, so states can be created in file order
+  // and transitions resolve their endpoints by index
+  QList<State *> states;
+  states.reserve(view.stateCount());
+  for (int i = 0; i < view.stateCount(); ++i) {
+    State *state = new State(view.stateId(i).toString(),
+                             view.stateName(i).toString(), fsm);
+    state->setInitial(view.isInitialState(i));
+    state->setFinal(view.isFinalState(i));
+    state->setPosition(view.statePosition(i));
+    state->setEntryAction(view.stateEntryAction(i).toString());
+    state->setExitAction(view.stateExitAction(i).toString());
+    for (int f = 0; f < view.stateFunctionCount(i); ++f) {
+      state->addFunction(view.stateFunction(i, f).toString());
+    }
+    states.append(state);
+  }
+  fsm->addStates(states);
+
+  QList<Transition *> transitions;
+  transitions.reserve(view.transitionCount());
+  for (int i = 0; i < view.transitionCount(); ++i) {
+    Transition *transition =
+        new Transition(view.transitionId(i).toString(),
+                       states[view.transitionSource(i)],
+                       states[view.transitionTarget(i)], fsm);
+    transition->setEvent(view.transitionEvent(i).toString());
+    transition->setGuard(view.transitionGuard(i).toString());
+    transition->setAction(view.transitionAction(i).toString());
+    transitions.append(transition);
+  }
+  fsm->addTransitions(transitions);
+
+  return fsm;
+}
@@ -0,0 +1,190 @@
+#ifndef BINARYSERIALIZER_H
+#define BINARYSERIALIZER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QFile>
+#include <QObject>
+#include <QPointF>
+#include <QString>
+#include <QStringView>
+#include <QtEndian>
+
+class FSM;
+class FSMSnapshot;
+
+namespace FsmbFormat {
+struct Header;
+struct StringEntry;
+struct StateRecord;
+struct TransitionRecord;
+} // namespace FsmbFormat
+
+/**
+ * @brief Read-only view of a binary project (.fsmb) file.
+ *
+ * The file is memory-mapped and used in place: opening it checks the header
+ * and that every offset and index stays inside the file, but nothing is
+ * decoded or copied. Strings are returned as views into the mapping, so they
+ * stay valid for as long as the view is open. Headless tools can walk a
+ * project this way without building an FSM at all.
+ *
+ * @ingroup Serialization
+ */
+class BinaryProjectView {
+public:
+  BinaryProjectView() = default;
+  BinaryProjectView(const BinaryProjectView &) = delete;
+  BinaryProjectView &operator=(const BinaryProjectView &) = delete;
+
+  /**
+   * @brief Maps and validates a .fsmb file. Files that cannot be mapped are
+   * read into memory instead.
+   * @param filepath The file to open.
+   * @return true if the file is a valid binary project.
+   */
+  bool open(const QString &filepath);
+
+  /**
+   * @brief Validates and views a .fsmb image that is already in memory. The
+   * data must outlive the view.
+   * @param data The file contents.
+   * @return true if the data is a valid binary project.
+   */
+  bool openData(QByteArrayView data);
+
+  /**
+   * @brief Gets why the last open() or openData() failed.
+   * @return The error, or an empty string.
+   */
+  QString errorString() const { return m_error; }
+
+  /**
+   * @brief Gets the FSM name.
+   */
+  QStringView name() const;
+
+  int stateCount() const;
+  int transitionCount() const;
+
+  QStringView stateId(int index) const;
+  QStringView stateName(int index) const;
+  QStringView stateEntryAction(int index) const;
+  QStringView stateExitAction(int index) const;
+  QPointF statePosition(int index) const;
+  bool isInitialState(int index) const;
+  bool isFinalState(int index) const;
+  int stateFunctionCount(int index) const;
+  QStringView stateFunction(int index, int function) const;
+
+  QStringView transitionId(int index) const;
+  /// Index of the source state
+  int transitionSource(int index) const;
+  /// Index of the target state
+  int transitionTarget(int index) const;
+  QStringView transitionEvent(int index) const;
+  QStringView transitionGuard(int index) const;
+  QStringView transitionAction(int index) const;
+
+private:
+  bool fail(const QString &error);
+  bool validate();
+  QStringView string(quint32 index) const;
+  const FsmbFormat::StateRecord &state(int index) const;
+  const FsmbFormat::TransitionRecord &transition(int index) const;
+
+  QFile m_file;       // Owns the mapping
+  QByteArray m_copy;  // Used when the file cannot be mapped
+  QByteArrayView m_data;
+  const FsmbFormat::Header *m_header = nullptr;
+  const FsmbFormat::StringEntry *m_strings = nullptr;
+  const char16_t *m_chars = nullptr;
+  const FsmbFormat::StateRecord *m_states = nullptr;
+  const FsmbFormat::TransitionRecord *m_transitions = nullptr;
+  const quint32_le *m_functions = nullptr; // String indices
+  QString m_error;
+};
+
+/**
+ * @brief The BinarySerializer class stores the FSM model in a compact,
+ * versioned binary format (.fsmb).
+ *
+ * A file holds a fixed header, a table of deduplicated UTF-16 strings, and
+ * fixed-width state and transition records. Transitions reference their
+ * source and target by state index, so loading needs no id lookups and no
+ * text parsing: records are read straight from the memory-mapped file (see
+ * BinaryProjectView) and the model is populated in bulk. All fields are
+ * little-endian.
+ *
+ * @ingroup Serialization
+ */
+class BinarySerializer : public QObject {
+  Q_OBJECT
+
+public:
+  /// Current format version, bumped on incompatible layout changes
+  static constexpr quint16 Version = 1;
+
+  /**
+   * @brief Constructs a new BinarySerializer.
+   * @param parent The parent QObject.
+   */
+  explicit BinarySerializer(QObject *parent = nullptr);
+
+  /**
+   * @brief Saves the given FSM model to a binary project file.
+   * @param fsm The FSM model to serialize.
+   * @param filepath The absolute path to the destination file.
+   * @return true if saving was successful, false otherwise.
+   */
+  bool save(const FSM *fsm, const QString &filepath);
+
+  /**
+   * @brief Writes the given FSM model in the binary format to an open device.
+   * @param fsm The FSM model to serialize.
+   * @param device A writable device.
+   * @return true if all output was written.
+   */
+  bool save(const FSM *fsm, QIODevice *device);
+
+  /**
+   * @brief Writes a snapshot in the binary format to an open device, without
+   * building an FSM. Safe to call on any thread.
+   * @param snapshot The FSM contents to serialize.
+   * @param device A writable device.
+   * @return true if all output was written.
+   */
+  bool save(const FSMSnapshot &snapshot, QIODevice *device);
+
+  /**
+   * @brief Loads an FSM model from a binary project file.
+   * @param filepath The absolute path to the source file.
+   * @return A pointer to the deserialized FSM, or nullptr if loading failed.
+   */
+  FSM *load(const QString &filepath);
+
+  /**
+   * @brief Builds an FSM from an open view.
+   * @param view A successfully opened view.
+   * @return The new FSM (never nullptr).
+   */
+  static FSM *load(const BinaryProjectView &view);
+
+  /**
+   * @brief Gets the error of the last failed save() or load().
+   * @return The error, or an empty string.
+   */
+  QString lastError() const { return m_lastError; }
+
+  /**
+   * @brief Checks whether a file name has the binary project extension.
+   */
+  static bool isBinaryProject(const QString &filepath) {
+    return filepath.endsWith(QLatin1String(".fsmb"), Qt::CaseInsensitive);
+  }
+
+private:
+  QString m_lastError;
+};
+
+#endif // BINARYSERIALIZER_H
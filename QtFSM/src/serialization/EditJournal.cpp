@@ -0,0 +1,700 @@
+#include "EditJournal.h"
+#include "../model/FSM.h"
+#include "../model/State.h"
+#include "../model/Transition.h"
+#include "BinarySerializer.h"
+#include "FSMSnapshot.h"
+#include <QDataStream>
+#include <QDebug>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtConcurrent>
+#include <QtEndian>
+#include <cstring>
+
+// Base file (.fsmj):
+//
+//   char[4]   "FSMJ"
+//   quint32   format version
+//   quint64   log generation the image belongs to
+//   quint64   offset in that log up to which the image includes the edits
+//   ...       .fsmb image (BinarySerializer)
+//
+// Log file (.fsmj.log):
+//
+//   char[4]   "FSML"
+//   quint32   format version
+//   quint64   generation
+//   records:  quint32 payload size, quint32 CRC-16 of the payload, payload
+//
+// A compaction writes a base for generation G (covering the log up to some
+// offset), then rewrites the log as generation G + 1 holding only the records
+// past that offset. On open, a log of the base's generation is replayed from
+// the offset, a log of the next generation from its start, and any other log
+// is stale. Both files are replaced atomically, so every crash leaves one of
+// these three cases.
+//
+// All integers are little-endian; payloads are QDataStream encoded.
+namespace {
+
+constexpr char BaseMagic[4] = {'F', 'S', 'M', 'J'};
+constexpr char LogMagic[4] = {'F', 'S', 'M', 'L'};
+constexpr quint32 FormatVersion = 1;
+constexpr qsizetype BaseHeaderSize = 24;
+constexpr qsizetype LogHeaderSize = 16;
+constexpr qsizetype RecordHeaderSize = 8;
+
+/// Logs shorter than this are never worth compacting
+constexpr qint64 CompactionMinimum = 1024 * 1024;
+
+enum class Op : quint8 {
+  SetName = 1,
+  PutState,
+  RemoveState,
+  PutTransition,
+  RemoveTransition
+};
+
+QString logPath(const QString &filepath) { return filepath + ".log"; }
+
+template <typename T> void appendLittleEndian(QByteArray &buffer, T value) {
+  char bytes[sizeof(T)];
+  qToLittleEndian(value, bytes);
+  buffer.append(bytes, sizeof(T));
+}
+
+QByteArray logHeader(quint64 generation) {
+  QByteArray header(LogMagic, sizeof(LogMagic));
+  appendLittleEndian<quint32>(header, FormatVersion);
+  appendLittleEndian<quint64>(header, generation);
+  return header;
+}
+
+// Appends one framed record whose payload is written by `write`
+template <typename Write> void appendRecord(QByteArray &buffer, Write write) {
+  QByteArray payload;
+  QDataStream out(&payload, QIODevice::WriteOnly);
+  out.setVersion(QDataStream::Qt_6_0);
+  write(out);
+  appendLittleEndian<quint32>(buffer, quint32(payload.size()));
+  appendLittleEndian<quint32>(buffer, qChecksum(payload));
+  buffer.append(payload);
+}
+
+// Reads the record at `pos`. Returns false for a truncated or corrupt record,
+// which is where a crash interrupted the last append.
+bool nextRecord(const QByteArray &log, qsizetype &pos, QByteArray &payload) {
+  if (log.size() - pos < RecordHeaderSize) {
+    return false;
+  }
+  const quint32 size = qFromLittleEndian<quint32>(log.constData() + pos);
+  const quint32 checksum =
+      qFromLittleEndian<quint32>(log.constData() + pos + 4);
+  if (quint64(log.size() - pos - RecordHeaderSize) < size) {
+    return false;
+  }
+  payload = log.mid(pos + RecordHeaderSize, size);
+  if (qChecksum(payload) != checksum) {
+    return false;
+  }
+  pos += RecordHeaderSize + size;
+  return true;
+}
+
+// Applies the log records to the FSM loaded from the base image
+class Replay {
+public:
+  explicit Replay(FSM *fsm) : m_fsm(fsm) {
+    for (State *state : fsm->states()) {
+      m_states.insert(state->id(), state);
+    }
+    for (Transition *transition : fsm->transitions()) {
+      m_transitions.insert(transition->id(), transition);
+    }
+  }
+
+  bool apply(const QByteArray &payload) {
+    QDataStream in(payload);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint8 op = 0;
+    in >> op;
+
+    switch (Op(op)) {
+    case Op::SetName: {
+      QString name;
+      in >> name;
+      if (in.status() != QDataStream::Ok)
+        return false;
+      m_fsm->setName(name);
+      return true;
+    }
+    case Op::PutState:
+      return putState(in);
+    case Op::RemoveState: {
+      QString id;
+      in >> id;
+      if (in.status() != QDataStream::Ok)
+        return false;
+      removeState(id);
+      return true;
+    }
+    case Op::PutTransition:
+      return putTransition(in);
+    case Op::RemoveTransition: {
+      QString id;
+      in >> id;
+      if (in.status() != QDataStream::Ok)
+        return false;
+      if (Transition *transition = m_transitions.take(id)) {
+        m_fsm->removeTransition(transition);
+      }
+      return true;
+    }
+    }
+    return false; // Unknown operation
+  }
+
+private:
+  bool putState(QDataStream &in) {
+    QString id, name, entryAction, exitAction;
+    QStringList functions;
+    QPointF position;
+    bool isInitial = false;
+    bool isFinal = false;
+    in >> id >> name >> entryAction >> exitAction >> functions >> position >>
+        isInitial >> isFinal;
+    if (in.status() != QDataStream::Ok)
+      return false;
+
+    State *state = m_states.value(id);
+    if (!state) {
+      state = new State(id, name, m_fsm);
+      m_fsm->addState(state);
+      m_states.insert(id, state);
+    }
+    state->setName(name);
+    state->setEntryAction(entryAction);
+    state->setExitAction(exitAction);
+    state->setPosition(position);
+    state->setInitial(isInitial);
+    state->setFinal(isFinal);
+    if (state->customFunctions() != functions) {
+      for (const QString &function : state->customFunctions()) {
+        state->removeFunction(function);
+      }
+      for (const QString &function : functions) {
+        state->addFunction(function);
+      }
+    }
+    return true;
+  }
+
+  void removeState(const QString &id) {
+    State *state = m_states.take(id);
+    if (!state)
+      return;
+    // The FSM drops the state's transitions with it
+    for (Transition *transition : m_fsm->transitions()) {
+      if (transition->sourceState() == state ||
+          transition->targetState() == state) {
+        m_transitions.remove(transition->id());
+      }
+    }
+    m_fsm->removeState(state);
+  }
+
+  bool putTransition(QDataStream &in) {
+    QString id, sourceId, targetId, event, guard, action;
+    in >> id >> sourceId >> targetId >> event >> guard >> action;
+    if (in.status() != QDataStream::Ok)
+      return false;
+
+    State *source = m_states.value(sourceId);
+    State *target = m_states.value(targetId);
+    if (!source || !target) {
+      qDebug() << "EditJournal - Transition" << id
+               << "references a missing state";
+      return true;
+    }
+
+    Transition *transition = m_transitions.value(id);
+    if (!transition) {
+      transition = new Transition(id, source, target, m_fsm);
+      m_fsm->addTransition(transition);
+      m_transitions.insert(id, transition);
+    } else {
+      transition->setSourceState(source);
+      transition->setTargetState(target);
+    }
+    transition->setEvent(event);
+    transition->setGuard(guard);
+    transition->setAction(action);
+    return true;
+  }
+
+  FSM *m_fsm;
+  QHash<QString, State *> m_states;
+  QHash<QString, Transition *> m_transitions;
+};
+
+} // namespace
+
+EditJournal::EditJournal(QObject *parent) : QObject(parent) {
+  connect(&m_compaction, &QFutureWatcher<QString>::finished, this, [this]() {
+    // waitForCompaction() may already have handled it
+    if (m_compacting && m_compaction.isFinished()) {
+      finishCompaction();
+    }
+  });
+}
+
+EditJournal::~EditJournal() {
+  const QSignalBlocker blocker(this);
+  close();
+}
+
+bool EditJournal::fail(const QString &error) {
+  m_lastError = error;
+  qDebug() << "EditJournal -" << error;
+  return false;
+}
+
+bool EditJournal::create(FSM *fsm, const QString &filepath) {
+  close();
+  m_lastError.clear();
+  if (!fsm) {
+    return fail("FSM is null");
+  }
+
+  // The log goes first: if the base cannot be written, an old base next to
+  // it sees a log of a foreign generation and ignores it
+  m_filePath = filepath;
+  m_generation = 1;
+  if (!writeLog(m_generation, QByteArray())) {
+    m_filePath.clear();
+    return false;
+  }
+  const QString error = writeBase(FSMSnapshot::capture(fsm), filepath,
+                                  m_generation, LogHeaderSize);
+  if (!error.isEmpty() || !openLogForAppend()) {
+    m_filePath.clear();
+    return fail(error.isEmpty() ? m_lastError : error);
+  }
+
+  attach(fsm);
+  return true;
+}
+
+FSM *EditJournal::open(const QString &filepath) {
+  close();
+  m_lastError.clear();
+
+  // Base image
+  QFile base(filepath);
+  if (!base.open(QIODevice::ReadOnly)) {
+    fail(QString("Could not open %1: %2").arg(filepath, base.errorString()));
+    return nullptr;
+  }
+  const qint64 baseSize = base.size();
+  const uchar *data = base.map(0, baseSize);
+  QByteArray copy;
+  if (!data) {
+    copy = base.readAll();
+    data = reinterpret_cast<const uchar *>(copy.constData());
+  }
+  if (baseSize < BaseHeaderSize ||
+      std::memcmp(data, BaseMagic, sizeof(BaseMagic)) != 0 ||
+      qFromLittleEndian<quint32>(data + 4) != FormatVersion) {
+    fail(QString("%1 is not a journaled FSM project").arg(filepath));
+    return nullptr;
+  }
+  const quint64 baseGeneration = qFromLittleEndian<quint64>(data + 8);
+  const quint64 baseOffset = qFromLittleEndian<quint64>(data + 16);
+
+  BinaryProjectView view;
+  if (!view.openData(QByteArrayView(data + BaseHeaderSize,
+                                    baseSize - BaseHeaderSize))) {
+    fail(view.errorString());
+    return nullptr;
+  }
+  FSM *fsm = BinarySerializer::load(view);
+  base.close();
+
+  // Edits since the image was written
+  QFile log(logPath(filepath));
+  QByteArray records;
+  if (log.open(QIODevice::ReadOnly)) {
+    records = log.readAll();
+    log.close();
+  }
+  quint64 logGeneration = 0;
+  qsizetype start = -1; // No usable log
+  if (records.size() >= LogHeaderSize &&
+      std::memcmp(records.constData(), LogMagic, sizeof(LogMagic)) == 0 &&
+      qFromLittleEndian<quint32>(records.constData() + 4) == FormatVersion) {
+    logGeneration = qFromLittleEndian<quint64>(records.constData() + 8);
+    if (logGeneration == baseGeneration &&
+        baseOffset <= quint64(records.size())) {
+      start = qsizetype(baseOffset);
+    } else if (logGeneration == baseGeneration + 1) {
+      start = LogHeaderSize;
+    }
+  }
+
+  m_filePath = filepath;
+  if (start < 0) {
+    // Missing or stale log: start a new one after the image
+    m_generation = baseGeneration + 1;
+    if (!writeLog(m_generation, QByteArray())) {
+      delete fsm;
+      m_filePath.clear();
+      return nullptr;
+    }
+  } else {
+    Replay replay(fsm);
+    qsizetype pos = start;
+    qsizetype next = start;
+    QByteArray payload;
+    while (nextRecord(records, next, payload) && replay.apply(payload)) {
+      pos = next;
+    }
+    if (pos < records.size()) {
+      qDebug() << "EditJournal - Dropping" << records.size() - pos
+               << "bytes of an interrupted write in" << logPath(filepath);
+      records.truncate(pos);
+      if (!QFile::resize(logPath(filepath), pos)) {
+        fail(QString("Could not repair %1").arg(logPath(filepath)));
+        delete fsm;
+        m_filePath.clear();
+        return nullptr;
+      }
+    }
+    m_generation = logGeneration;
+  }
+
+  if (!openLogForAppend()) {
+    delete fsm;
+    m_filePath.clear();
+    return nullptr;
+  }
+  attach(fsm);
+  return fsm;
+}
+
+int EditJournal::pendingCount() const {
+  return (m_nameChanged ? 1 : 0) + m_changedStates.size() +
+         m_changedTransitions.size() + m_removedStates.size() +
+         m_removedTransitions.size();
+}
+
+bool EditJournal::flush() {
+  if (!m_fsm || !m_log.isOpen()) {
+    return fail("No journaled project is open");
+  }
+  if (pendingCount() == 0) {
+    return true;
+  }
+
+  // Removals first, so an id freed and reused in the same batch ends up
+  // with the new object; states before the transitions that reference them
+  QByteArray records;
+  if (m_nameChanged) {
+    appendRecord(records, [&](QDataStream &out) {
+      out << quint8(Op::SetName) << m_fsm->name();
+    });
+  }
+  for (const QString &id : std::as_const(m_removedTransitions)) {
+    appendRecord(records, [&](QDataStream &out) {
+      out << quint8(Op::RemoveTransition) << id;
+    });
+  }
+  for (const QString &id : std::as_const(m_removedStates)) {
+    appendRecord(records, [&](QDataStream &out) {
+      out << quint8(Op::RemoveState) << id;
+    });
+  }
+  for (State *state : std::as_const(m_changedStates)) {
+    appendRecord(records, [&](QDataStream &out) {
+      out << quint8(Op::PutState) << state->id() << state->name()
+          << state->entryAction() << state->exitAction()
+          << QStringList(state->customFunctions()) << state->position()
+          << state->isInitial() << state->isFinal();
+    });
+  }
+  for (Transition *transition : std::as_const(m_changedTransitions)) {
+    if (!transition->sourceState() || !transition->targetState()) {
+      continue;
+    }
+    appendRecord(records, [&](QDataStream &out) {
+      out << quint8(Op::PutTransition) << transition->id()
+          << transition->sourceState()->id()
+          << transition->targetState()->id() << transition->event()
+          << transition->guard() << transition->action();
+    });
+  }
+
+  if (m_log.write(records) != records.size() || !m_log.flush()) {
+    return fail(QString("Could not append to %1: %2")
+                    .arg(m_log.fileName(), m_log.errorString()));
+  }
+
+  m_nameChanged = false;
+  m_changedStates.clear();
+  m_changedTransitions.clear();
+  m_removedStates.clear();
+  m_removedTransitions.clear();
+  return true;
+}
+
+bool EditJournal::needsCompaction() const {
+  if (!m_log.isOpen()) {
+    return false;
+  }
+  const qint64 size = m_log.size();
+  return size > CompactionMinimum && size > QFileInfo(m_filePath).size();
+}
+
+void EditJournal::compact() {
+  if (m_compacting || !m_fsm || !flush()) {
+    return;
+  }
+
+  // The image covers everything flushed so far; later appends stay in the
+  // log and are carried over once the image is on disk
+  m_compactionOffset = quint64(m_log.size());
+  m_compacting = true;
+  m_compaction.setFuture(QtConcurrent::run(
+      &EditJournal::writeBase, FSMSnapshot::capture(m_fsm), m_filePath,
+      m_generation, m_compactionOffset));
+}
+
+void EditJournal::waitForCompaction() {
+  if (m_compacting) {
+    m_compaction.waitForFinished();
+    finishCompaction();
+  }
+}
+
+void EditJournal::finishCompaction() {
+  m_compacting = false;
+  const QString error = m_compaction.result();
+  if (!error.isEmpty()) {
+    fail(error);
+    emit compactionFailed(error);
+    return;
+  }
+
+  // The new base covers the log up to the offset; keep only what follows
+  m_log.seek(qint64(m_compactionOffset));
+  const QByteArray tail = m_log.readAll();
+  m_log.close();
+  if (writeLog(m_generation + 1, tail)) {
+    ++m_generation;
+  }
+  // On failure the old log still matches the new base
+  openLogForAppend();
+  emit compacted();
+}
+
+void EditJournal::close() {
+  waitForCompaction();
+  detach();
+  m_log.close();
+  m_filePath.clear();
+}
+
+bool EditJournal::writeLog(quint64 generation, const QByteArray &records) {
+  QSaveFile file(logPath(m_filePath));
+  if (!file.open(QIODevice::WriteOnly) ||
+      file.write(logHeader(generation)) != LogHeaderSize ||
+      file.write(records) != records.size() || !file.commit()) {
+    return fail(QString("Could not write %1: %2")
+                    .arg(file.fileName(), file.errorString()));
+  }
+  return true;
+}
+
+bool EditJournal::openLogForAppend() {
+  m_log.setFileName(logPath(m_filePath));
+  if (!m_log.open(QIODevice::ReadWrite | QIODevice::Append)) {
+    return fail(QString("Could not open %1: %2")
+                    .arg(m_log.fileName(), m_log.errorString()));
+  }
+  return true;
+}
+
+QString EditJournal::writeBase(const FSMSnapshot &snapshot,
+                               const QString &path, quint64 generation,
+                               quint64 logOffset) {
+  QByteArray header(BaseMagic, sizeof(BaseMagic));
+  appendLittleEndian<quint32>(header, FormatVersion);
+  appendLittleEndian<quint64>(header, generation);
+  appendLittleEndian<quint64>(header, logOffset);
+
+  QSaveFile file(path);
+  if (!file.open(QIODevice::WriteOnly)) {
+    return QString("Could not open %1 for writing: %2")
+        .arg(path, file.errorString());
+  }
+  file.write(header);
+
+  BinarySerializer serializer;
+  if (!serializer.save(snapshot, &file)) {
+    return serializer.lastError();
+  }
+  if (!file.commit()) {
+    return QString("Could not write %1: %2").arg(path, file.errorString());
+  }
+  return QString();
+}
+
+// ============================================================================
+// Change tracking
+// ============================================================================
+
+void EditJournal::attach(FSM *fsm) {
+  m_fsm = fsm;
+  for (State *state : fsm->states()) {
+    trackState(state);
+  }
+  for (Transition *transition : fsm->transitions()) {
+    trackTransition(transition);
+  }
+
+  connect(fsm, &FSM::nameChanged, this, [this]() { m_nameChanged = true; });
+  connect(fsm, &FSM::stateAdded, this, [this](State *state) {
+    trackState(state);
+    markState(state);
+  });
+  connect(fsm, &FSM::stateRemoved, this, &EditJournal::onStateRemoved);
+  connect(fsm, &FSM::statesMoved, this, [this](const QList<State *> &states) {
+    for (State *state : states) {
+      markState(state);
+    }
+  });
+  connect(fsm, &FSM::transitionAdded, this, [this](Transition *transition) {
+    trackTransition(transition);
+    markTransition(transition);
+  });
+  connect(fsm, &FSM::transitionRemoved, this,
+          &EditJournal::onTransitionRemoved);
+}
+
+void EditJournal::detach() {
+  // Without the FSM its states and transitions are gone as well
+  if (m_fsm) {
+    disconnect(m_fsm, nullptr, this, nullptr);
+    for (auto it = m_stateIds.cbegin(); it != m_stateIds.cend(); ++it) {
+      disconnect(it.key(), nullptr, this, nullptr);
+    }
+    for (auto it = m_transitionIds.cbegin(); it != m_transitionIds.cend();
+         ++it) {
+      disconnect(it.key(), nullptr, this, nullptr);
+    }
+  }
+  m_fsm = nullptr;
+  m_nameChanged = false;
+  m_changedStates.clear();
+  m_changedTransitions.clear();
+  m_removedStates.clear();
+  m_removedTransitions.clear();
+  m_stateIds.clear();
+  m_transitionIds.clear();
+}
+
+void EditJournal::trackState(State *state) {
+  if (m_stateIds.contains(state)) {
+    return;
+  }
+  m_stateIds.insert(state, state->id());
+
+  auto mark = [this, state]() { markState(state); };
+  connect(state, &State::idChanged, this,
+          [this, state]() { onStateIdChanged(state); });
+  connect(state, &State::nameChanged, this, mark);
+  connect(state, &State::entryActionChanged, this, mark);
+  connect(state, &State::exitActionChanged, this, mark);
+  connect(state, &State::positionChanged, this, mark);
+  connect(state, &State::initialChanged, this, mark);
+  connect(state, &State::finalChanged, this, mark);
+  connect(state, &State::customFunctionAdded, this, mark);
+  connect(state, &State::customFunctionRemoved, this, mark);
+}
+
+void EditJournal::trackTransition(Transition *transition) {
+  if (m_transitionIds.contains(transition)) {
+    return;
+  }
+  m_transitionIds.insert(transition, transition->id());
+
+  auto mark = [this, transition]() { markTransition(transition); };
+  connect(transition, &Transition::idChanged, this,
+          [this, transition]() { onTransitionIdChanged(transition); });
+  connect(transition, &Transition::sourceStateChanged, this, mark);
+  connect(transition, &Transition::targetStateChanged, this, mark);
+  connect(transition, &Transition::eventChanged, this, mark);
+  connect(transition, &Transition::guardChanged, this, mark);
+  connect(transition, &Transition::actionChanged, this, mark);
+}
+
+void EditJournal::markState(State *state) {
+  if (m_stateIds.contains(state)) {
+    m_changedStates.insert(state);
+  }
+}
+
+void EditJournal::markTransition(Transition *transition) {
+  if (m_transitionIds.contains(transition)) {
+    m_changedTransitions.insert(transition);
+  }
+}
+
+void EditJournal::onStateRemoved(State *state) {
+  if (!m_stateIds.contains(state)) {
+    return;
+  }
+  // Undo commands keep removed states alive; their edits are not journaled
+  disconnect(state, nullptr, this, nullptr);
+  m_removedStates.append(m_stateIds.take(state));
+  m_changedStates.remove(state);
+}
+
+void EditJournal::onTransitionRemoved(Transition *transition) {
+  if (!m_transitionIds.contains(transition)) {
+    return;
+  }
+  disconnect(transition, nullptr, this, nullptr);
+  m_removedTransitions.append(m_transitionIds.take(transition));
+  m_changedTransitions.remove(transition);
+}
+
+void EditJournal::onStateIdChanged(State *state) {
+  QString &journaledId = m_stateIds[state];
+  if (journaledId == state->id()) {
+    return;
+  }
+
+  // Replayed as remove + put; the remove drops the state's transitions, so
+  // they are written again under the new id
+  m_removedStates.append(journaledId);
+  journaledId = state->id();
+  markState(state);
+  if (m_fsm) {
+    for (Transition *transition : m_fsm->transitions()) {
+      if (transition->sourceState() == state ||
+          transition->targetState() == state) {
+        markTransition(transition);
+      }
+    }
+  }
+}
+
+void EditJournal::onTransitionIdChanged(Transition *transition) {
+  QString &journaledId = m_transitionIds[transition];
+  if (journaledId == transition->id()) {
+    return;
+  }
+  m_removedTransitions.append(journaledId);
+  journaledId = transition->id();
+  markTransition(transition);
+}
@@ -0,0 +1,164 @@
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include <QFile>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+class FSM;
+class FSMSnapshot;
+class State;
+class Transition;
+
+/**
+ * @brief Journaled project format (.fsmj): a base snapshot plus an
+ * append-only log of edits.
+ *
+ * A journaled project is two files. `name.fsmj` holds a small header and a
+ * binary (.fsmb) image of the FSM; `name.fsmj.log` holds the edits made since
+ * that image was written. The journal listens to the change signals of the
+ * FSM it is attached to and remembers which states and transitions changed;
+ * flush() appends one record per changed object. A save therefore costs
+ * O(edits) rather than O(model), and a drag that moved a state a hundred
+ * times writes it once.
+ *
+ * Records carry a length and a checksum. A record torn by a crash is
+ * detected on open and dropped together with everything after it.
+ *
+ * When the log has grown past the base image, compact() writes a new base
+ * on the thread pool while editing and flushing carry on. Base and log carry
+ * a generation number, so a crash at any point of a compaction still opens
+ * as the last flushed state.
+ *
+ * @ingroup Serialization
+ */
+class EditJournal : public QObject {
+  Q_OBJECT
+
+public:
+  explicit EditJournal(QObject *parent = nullptr);
+
+  /**
+   * @brief Waits for a running compaction and closes the log.
+   */
+  ~EditJournal();
+
+  /**
+   * @brief Writes the FSM as a new journaled project and starts journaling
+   * its edits.
+   * @param fsm The FSM to save; the caller keeps ownership.
+   * @param filepath The project file (.fsmj); the log is written next to it.
+   * @return true on success; see lastError() otherwise.
+   */
+  bool create(FSM *fsm, const QString &filepath);
+
+  /**
+   * @brief Loads a journaled project (base image plus log) and starts
+   * journaling the returned FSM.
+   * @param filepath The project file (.fsmj).
+   * @return The loaded FSM, owned by the caller, or nullptr on error.
+   */
+  FSM *open(const QString &filepath);
+
+  /**
+   * @brief Appends the edits made since the last flush to the log.
+   * @return true if the log was written (or nothing was pending).
+   */
+  bool flush();
+
+  /**
+   * @brief Writes a new base image in the background and drops the log
+   * records it contains. Does nothing while a compaction is running.
+   */
+  void compact();
+
+  /**
+   * @brief Checks whether the log has grown enough that compacting pays off.
+   */
+  bool needsCompaction() const;
+
+  /**
+   * @brief Blocks until a running compaction has finished.
+   */
+  void waitForCompaction();
+
+  /**
+   * @brief Stops journaling; unflushed edits are dropped.
+   */
+  void close();
+
+  /// The FSM being journaled, or nullptr.
+  FSM *fsm() const { return m_fsm; }
+  /// The project file, or an empty string when closed.
+  QString filePath() const { return m_filePath; }
+  /// Number of changed objects waiting for flush().
+  int pendingCount() const;
+  /// Current size of the log file in bytes.
+  qint64 logSize() const { return m_log.size(); }
+
+  QString lastError() const { return m_lastError; }
+
+  /**
+   * @brief Checks whether a file name has the journaled project extension.
+   */
+  static bool isJournalProject(const QString &filepath) {
+    return filepath.endsWith(QLatin1String(".fsmj"), Qt::CaseInsensitive);
+  }
+
+signals:
+  /**
+   * @brief Emitted when a compaction has replaced the base image.
+   */
+  void compacted();
+
+  /**
+   * @brief Emitted when writing a new base image failed; the project is
+   * unchanged.
+   */
+  void compactionFailed(const QString &error);
+
+private:
+  bool fail(const QString &error);
+  void attach(FSM *fsm);
+  void detach();
+  void trackState(State *state);
+  void trackTransition(Transition *transition);
+  void markState(State *state);
+  void markTransition(Transition *transition);
+  void onStateRemoved(State *state);
+  void onTransitionRemoved(Transition *transition);
+  void onStateIdChanged(State *state);
+  void onTransitionIdChanged(Transition *transition);
+  bool writeLog(quint64 generation, const QByteArray &records);
+  bool openLogForAppend();
+  void finishCompaction();
+  static QString writeBase(const FSMSnapshot &snapshot, const QString &path,
+                           quint64 generation, quint64 logOffset);
+
+  QPointer<FSM> m_fsm;
+  QString m_filePath;
+  QFile m_log;
+  quint64 m_generation = 0;
+  QString m_lastError;
+
+  // Edits since the last flush
+  bool m_nameChanged = false;
+  QSet<State *> m_changedStates;
+  QSet<Transition *> m_changedTransitions;
+  QStringList m_removedStates;      ///< Ids as last written
+  QStringList m_removedTransitions; ///< Ids as last written
+  QHash<State *, QString> m_stateIds;           ///< Id as last written
+  QHash<Transition *, QString> m_transitionIds; ///< Id as last written
+
+  // Running compaction: the log offset its base image covers
+  QFutureWatcher<QString> m_compaction;
+  quint64 m_compactionOffset = 0;
+  bool m_compacting = false;
+};
+
+#endif // EDITJOURNAL_H
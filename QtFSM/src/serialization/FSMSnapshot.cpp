@@ -0,0 +1,106 @@
+#include "FSMSnapshot.h"
+#include "../model/FSM.h"
+#include "../model/State.h"
+#include "../model/Transition.h"
+#include <QHash>
+
+bool FSMSnapshot::StateData::operator==(const StateData &other) const {
+  return id == other.id && name == other.name &&
+         entryAction == other.entryAction && exitAction == other.exitAction &&
+         customFunctions == other.customFunctions &&
+         position == other.position && isInitial == other.isInitial &&
+         isFinal == other.isFinal;
+}
+
+bool FSMSnapshot::TransitionData::operator==(
+    const TransitionData &other) const {
+  return id == other.id && source == other.source && target == other.target &&
+         event == other.event && guard == other.guard &&
+         action == other.action;
+}
+
+bool FSMSnapshot::operator==(const FSMSnapshot &other) const {
+  return m_name == other.m_name && m_states == other.m_states &&
+         m_transitions == other.m_transitions;
+}
+
+FSMSnapshot FSMSnapshot::capture(const FSM *fsm) {
+  FSMSnapshot snapshot;
+  if (!fsm) {
+    return snapshot;
+  }
+
+  snapshot.m_name = fsm->name();
+  const QList<State *> states = fsm->states();
+  QHash<const State *, int> stateIndex;
+  stateIndex.reserve(states.size());
+  snapshot.m_states.reserve(states.size());
+  for (const State *state : states) {
+    stateIndex.insert(state, snapshot.m_states.size());
+    StateData data;
+    data.id = state->id();
+    data.name = state->name();
+    data.entryAction = state->entryAction();
+    data.exitAction = state->exitAction();
+    data.customFunctions = state->customFunctions();
+    data.position = state->position();
+    data.isInitial = state->isInitial();
+    data.isFinal = state->isFinal();
+    snapshot.m_states.append(data);
+  }
+
+  // Transitions to states outside the FSM cannot be saved
+  const QList<Transition *> transitions = fsm->transitions();
+  snapshot.m_transitions.reserve(transitions.size());
+  for (const Transition *transition : transitions) {
+    const int source = stateIndex.value(transition->sourceState(), -1);
+    const int target = stateIndex.value(transition->targetState(), -1);
+    if (source < 0 || target < 0) {
+      continue;
+    }
+    TransitionData data;
+    data.id = transition->id();
+    data.source = source;
+    data.target = target;
+    data.event = transition->event();
+    data.guard = transition->guard();
+    data.action = transition->action();
+    snapshot.m_transitions.append(data);
+  }
+  return snapshot;
+}
+
+FSM *FSMSnapshot::toFsm() const {
+  FSM *fsm = new FSM();
+  fsm->setName(m_name);
+
+  QList<State *> states;
+  states.reserve(m_states.size());
+  for (const StateData &data : m_states) {
+    State *state = new State(data.id, data.name, fsm);
+    state->setInitial(data.isInitial);
+    state->setFinal(data.isFinal);
+    state->setPosition(data.position);
+    state->setEntryAction(data.entryAction);
+    state->setExitAction(data.exitAction);
+    for (const QString &function : data.customFunctions) {
+      state->addFunction(function);
+    }
+    states.append(state);
+  }
+
+  QList<Transition *> transitions;
+  transitions.reserve(m_transitions.size());
+  for (const TransitionData &data : m_transitions) {
+    Transition *transition = new Transition(data.id, states[data.source],
+                                            states[data.target], fsm);
+    transition->setEvent(data.event);
+    transition->setGuard(data.guard);
+    transition->setAction(data.action);
+    transitions.append(transition);
+  }
+
+  fsm->addStates(states);
+  fsm->addTransitions(transitions);
+  return fsm;
+}
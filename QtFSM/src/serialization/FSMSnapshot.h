@@ -0,0 +1,75 @@
+#ifndef FSMSNAPSHOT_H
+#define FSMSNAPSHOT_H
+
+#include <QPointF>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class FSM;
+
+/**
+ * @brief Immutable copy of everything a project file stores about an FSM.
+ *
+ * A snapshot holds plain values only (the strings are implicitly shared with
+ * the model, so capturing one is a pass over the states and transitions
+ * without copying any text). It can be handed to a worker thread and written
+ * there while the user keeps editing the live FSM.
+ *
+ * @ingroup Serialization
+ */
+class FSMSnapshot {
+public:
+  struct StateData {
+    QString id;
+    QString name;
+    QString entryAction;
+    QString exitAction;
+    QStringList customFunctions;
+    QPointF position;
+    bool isInitial = false;
+    bool isFinal = false;
+
+    bool operator==(const StateData &other) const;
+  };
+
+  struct TransitionData {
+    QString id;
+    int source = -1; ///< Index into states()
+    int target = -1; ///< Index into states()
+    QString event;
+    QString guard;
+    QString action;
+
+    bool operator==(const TransitionData &other) const;
+  };
+
+  /**
+   * @brief Copies the current contents of an FSM. Must be called on the
+   * thread that owns the FSM.
+   * @param fsm The FSM to copy; nullptr gives an empty snapshot.
+   */
+  static FSMSnapshot capture(const FSM *fsm);
+
+  /**
+   * @brief Builds a new FSM (without a parent) from the snapshot.
+   *
+   * Safe to call on any thread; the FSM belongs to the calling thread.
+   */
+  FSM *toFsm() const;
+
+  QString name() const { return m_name; }
+  const QVector<StateData> &states() const { return m_states; }
+  const QVector<TransitionData> &transitions() const { return m_transitions; }
+  bool isEmpty() const { return m_states.isEmpty(); }
+
+  bool operator==(const FSMSnapshot &other) const;
+  bool operator!=(const FSMSnapshot &other) const { return !(*this == other); }
+
+private:
+  QString m_name;
+  QVector<StateData> m_states;
+  QVector<TransitionData> m_transitions;
+};
+
+#endif // FSMSNAPSHOT_H
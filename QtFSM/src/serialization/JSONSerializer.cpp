@@ -2,11 +2,73 @@
 #include "../model/FSM.h"
 #include "../model/State.h"
 #include "../model/Transition.h"
+#include "FSMSnapshot.h"
+#include "JsonStreamReader.h"
+#include "JsonStreamWriter.h"
 #include <QDebug>
 #include <QFile>
-#include <QJsonArray>
-#include <QJsonDocument>
-#include <QJsonObject>
+#include <QHash>
+#include <QSaveFile>
+
+namespace {
+
+// Fields of a transition record. Kept until the end of the document only if
+// a referenced state has not been read yet.
+struct TransitionRecord {
+  QString id;
+  QString sourceId;
+  QString targetId;
+  QString source; // Old format: state names
+  QString target;
+  QString event;
+  QString guard;
+  QString action;
+};
+
+// Reads a string member value; other types are skipped and read as empty
+QString readString(JsonStreamReader &reader) {
+  switch (reader.readNext()) {
+  case JsonStreamReader::String:
+    return reader.stringValue();
+  case JsonStreamReader::BeginObject:
+  case JsonStreamReader::BeginArray:
+    reader.skipContainer();
+    break;
+  default:
+    break;
+  }
+  return QString();
+}
+
+double readNumber(JsonStreamReader &reader, double fallback) {
+  switch (reader.readNext()) {
+  case JsonStreamReader::Number:
+    return reader.numberValue();
+  case JsonStreamReader::BeginObject:
+  case JsonStreamReader::BeginArray:
+    reader.skipContainer();
+    break;
+  default:
+    break;
+  }
+  return fallback;
+}
+
+bool readBool(JsonStreamReader &reader, bool fallback) {
+  switch (reader.readNext()) {
+  case JsonStreamReader::Bool:
+    return reader.boolValue();
+  case JsonStreamReader::BeginObject:
+  case JsonStreamReader::BeginArray:
+    reader.skipContainer();
+    break;
+  default:
+    break;
+  }
+  return fallback;
+}
+
+} // namespace
 
 JSONSerializer::JSONSerializer(QObject *parent) : QObject(parent) {}
 
@@ -18,107 +80,238 @@ bool JSONSerializer::save(const FSM *fsm, const QString &filepath) {
     return false;
   }
 
-  QJsonObject root;
-  root["name"] = fsm->name();
+  // Written to a temporary file first, so a failed save keeps the old file
+  QSaveFile file(filepath);
+  if (!file.open(QIODevice::WriteOnly)) {
+    qDebug() << "JSONSerializer::save - Could not open file for writing:"
+             << filepath;
+    return false;
+  }
 
-  // Serialize states
-  QJsonArray statesArray;
-  for (State *state : fsm->states()) {
-    QJsonObject stateObj;
+  if (!save(fsm, &file) || !file.commit()) {
+    qDebug() << "JSONSerializer::save - Could not write" << filepath;
+    return false;
+  }
 
-    // Core identifiers
-    stateObj["id"] = state->id();
-    stateObj["name"] = state->name();
+  qDebug() << "FSM saved to" << filepath;
+  return true;
+}
 
-    // State flags
-    stateObj["isInitial"] = state->isInitial();
-    stateObj["isFinal"] = state->isFinal();
+bool JSONSerializer::save(const FSM *fsm, QIODevice *device) {
+  if (!fsm) {
+    return false;
+  }
+  // The snapshot shares the model's strings, so this copies no text
+  return save(FSMSnapshot::capture(fsm), device);
+}
 
-    // Visual position
-    stateObj["positionX"] = state->position().x();
-    stateObj["positionY"] = state->position().y();
+// Members are written in alphabetical order, as QJsonObject used to, so
+// files keep diffing cleanly against earlier saves
+bool JSONSerializer::save(const FSMSnapshot &snapshot, QIODevice *device) {
+  const QVector<FSMSnapshot::StateData> &states = snapshot.states();
 
-    // Actions
-    stateObj["entryAction"] = state->entryAction();
-    stateObj["exitAction"] = state->exitAction();
+  JsonStreamWriter writer(device);
+  writer.beginObject();
+  writer.key("name");
+  writer.value(snapshot.name());
+
+  // Serialize states
+  writer.key("states");
+  writer.beginArray();
+  for (const FSMSnapshot::StateData &state : states) {
+    writer.beginObject();
 
     // Custom functions
-    QJsonArray functionsArray;
-    for (const QString &func : state->customFunctions()) {
-      functionsArray.append(func);
+    writer.key("customFunctions");
+    writer.beginArray();
+    for (const QString &func : state.customFunctions) {
+      writer.value(func);
     }
-    stateObj["customFunctions"] = functionsArray;
+    writer.endArray();
 
-    statesArray.append(stateObj);
-  }
-  root["states"] = statesArray;
+    // Actions
+    writer.key("entryAction");
+    writer.value(state.entryAction);
+    writer.key("exitAction");
+    writer.value(state.exitAction);
 
-  // Serialize transitions
-  QJsonArray transitionsArray;
-  for (Transition *transition : fsm->transitions()) {
-    QJsonObject transObj;
+    // Core identifiers
+    writer.key("id");
+    writer.value(state.id);
 
-    // Core identifiers (use IDs not names for robustness)
-    transObj["id"] = transition->id();
-    transObj["sourceId"] = transition->sourceState()->id();
-    transObj["targetId"] = transition->targetState()->id();
+    // State flags
+    writer.key("isFinal");
+    writer.value(state.isFinal);
+    writer.key("isInitial");
+    writer.value(state.isInitial);
 
-    // Transition properties
-    transObj["event"] = transition->event();
-    transObj["guard"] = transition->guard();
-    transObj["action"] = transition->action();
+    writer.key("name");
+    writer.value(state.name);
 
-    transitionsArray.append(transObj);
-  }
-  root["transitions"] = transitionsArray;
+    // Visual position
+    writer.key("positionX");
+    writer.value(state.position.x());
+    writer.key("positionY");
+    writer.value(state.position.y());
 
-  // Write to file
-  QJsonDocument doc(root);
-  QFile file(filepath);
-  if (!file.open(QIODevice::WriteOnly)) {
-    qDebug() << "JSONSerializer::save - Could not open file for writing:"
-             << filepath;
-    return false;
+    writer.endObject();
   }
+  writer.endArray();
 
-  file.write(doc.toJson(QJsonDocument::Indented));
-  file.close();
+  // Serialize transitions; the snapshot only keeps those between its states
+  writer.key("transitions");
+  writer.beginArray();
+  for (const FSMSnapshot::TransitionData &transition : snapshot.transitions()) {
+    writer.beginObject();
 
-  qDebug() << "FSM saved to" << filepath;
-  return true;
+    // Transition properties
+    writer.key("action");
+    writer.value(transition.action);
+    writer.key("event");
+    writer.value(transition.event);
+    writer.key("guard");
+    writer.value(transition.guard);
+
+    // Core identifiers (use IDs not names for robustness)
+    writer.key("id");
+    writer.value(transition.id);
+    writer.key("sourceId");
+    writer.value(states[transition.source].id);
+    writer.key("targetId");
+    writer.value(states[transition.target].id);
+
+    writer.endObject();
+  }
+  writer.endArray();
+
+  writer.endObject();
+  return writer.flush();
 }
 
 FSM *JSONSerializer::load(const QString &filepath) {
   QFile file(filepath);
   if (!file.open(QIODevice::ReadOnly)) {
+    m_lastError = file.errorString();
     qDebug() << "JSONSerializer::load - Could not open file:" << filepath;
     return nullptr;
   }
 
-  QByteArray data = file.readAll();
-  file.close();
+  FSM *fsm = load(&file);
+  if (fsm) {
+    qDebug() << "FSM loaded from" << filepath;
+  }
+  return fsm;
+}
 
-  QJsonDocument doc = QJsonDocument::fromJson(data);
-  if (doc.isNull() || !doc.isObject()) {
+// States and transitions are created as their records are read; only the
+// id lookups and the object lists grow with the document.
+FSM *JSONSerializer::load(QIODevice *device) {
+  m_lastError.clear();
+  JsonStreamReader reader(device);
+  if (reader.readNext() != JsonStreamReader::BeginObject) {
+    m_lastError = reader.hasError() ? reader.errorString()
+                                    : QString("Invalid JSON document");
     qDebug() << "JSONSerializer::load - Invalid JSON document";
     return nullptr;
   }
 
-  QJsonObject root = doc.object();
-
   FSM *fsm = new FSM();
-  fsm->setName(root["name"].toString());
+  QList<State *> states;
+  QList<Transition *> transitions;
+  QHash<QString, State *> stateMapById;   // Map by ID for transitions
+  QHash<QString, State *> stateMapByName; // Map by name for backward compat
+  QList<TransitionRecord> pending;        // Records naming states not yet read
+
+  auto addTransition = [&](const TransitionRecord &record, bool final) {
+    // Support both new ID-based and old name-based references
+    const QString sourceId =
+        record.sourceId.isEmpty() ? record.source : record.sourceId;
+    const QString targetId =
+        record.targetId.isEmpty() ? record.target : record.targetId;
+
+    // Try ID-based lookup first, then name-based (for old files)
+    State *source = stateMapById.value(sourceId);
+    if (!source) {
+      source = stateMapByName.value(sourceId);
+    }
+    State *target = stateMapById.value(targetId);
+    if (!target) {
+      target = stateMapByName.value(targetId);
+    }
 
-  // Load states
-  QMap<QString, State *> stateMapById;   // Map by ID for transitions
-  QMap<QString, State *> stateMapByName; // Map by name for backward compat
-  QJsonArray statesArray = root["states"].toArray();
-  for (const QJsonValue &value : statesArray) {
-    QJsonObject stateObj = value.toObject();
+    if (!source || !target) {
+      if (!final) {
+        pending.append(record);
+      } else {
+        qDebug() << "JSONSerializer::load - Could not find source or target "
+                    "state for transition";
+      }
+      return;
+    }
 
-    // Support both old (name-only) and new (id + name) formats
-    QString stateId = stateObj.value("id").toString();
-    QString stateName = stateObj["name"].toString();
+    // Old format: no ID
+    Transition *trans =
+        record.id.isEmpty() ? new Transition(source, target, fsm)
+                            : new Transition(record.id, source, target, fsm);
+    trans->setEvent(record.event);
+    trans->setGuard(record.guard);
+    trans->setAction(record.action);
+    transitions.append(trans);
+  };
+
+  auto readState = [&]() {
+    QString stateId;
+    QString stateName;
+    bool isInitial = false;
+    bool isFinal = false;
+    double posX = 0.0;
+    double posY = 0.0;
+    QString entryAction;
+    QString exitAction;
+    QStringList functions;
+
+    while (reader.readNext() == JsonStreamReader::Key) {
+      if (reader.keyIs("id")) {
+        stateId = readString(reader);
+      } else if (reader.keyIs("name")) {
+        stateName = readString(reader);
+      } else if (reader.keyIs("isInitial")) {
+        isInitial = readBool(reader, false);
+      } else if (reader.keyIs("isFinal")) {
+        isFinal = readBool(reader, false);
+      } else if (reader.keyIs("positionX")) {
+        posX = readNumber(reader, 0.0);
+      } else if (reader.keyIs("positionY")) {
+        posY = readNumber(reader, 0.0);
+      } else if (reader.keyIs("entryAction")) {
+        entryAction = readString(reader);
+      } else if (reader.keyIs("exitAction")) {
+        exitAction = readString(reader);
+      } else if (reader.keyIs("customFunctions")) {
+        if (reader.readNext() == JsonStreamReader::BeginArray) {
+          for (;;) {
+            const JsonStreamReader::Token token = reader.readNext();
+            if (token == JsonStreamReader::String) {
+              functions.append(reader.stringValue());
+            } else if (token == JsonStreamReader::BeginObject ||
+                       token == JsonStreamReader::BeginArray) {
+              reader.skipContainer();
+            } else if (token != JsonStreamReader::Number &&
+                       token != JsonStreamReader::Bool &&
+                       token != JsonStreamReader::Null) {
+              break; // EndArray or an error
+            }
+          }
+        } else if (reader.token() == JsonStreamReader::BeginObject) {
+          reader.skipContainer();
+        }
+      } else {
+        reader.skipValue();
+      }
+    }
+    if (reader.hasError()) {
+      return;
+    }
 
     // Backward compat: if no ID, use name as ID
     if (stateId.isEmpty()) {
@@ -126,85 +319,99 @@ FSM *JSONSerializer::load(const QString &filepath) {
     }
 
     State *state = new State(stateId, stateName, fsm);
-
-    // Load state flags
-    state->setInitial(stateObj.value("isInitial").toBool(false));
-    state->setFinal(stateObj.value("isFinal").toBool(false));
-
-    // Load position (defaults to 0,0 if not present)
-    double posX = stateObj.value("positionX").toDouble(0.0);
-    double posY = stateObj.value("positionY").toDouble(0.0);
+    state->setInitial(isInitial);
+    state->setFinal(isFinal);
     state->setPosition(QPointF(posX, posY));
-
-    // Load actions
-    state->setEntryAction(stateObj.value("entryAction").toString());
-    state->setExitAction(stateObj.value("exitAction").toString());
-
-    // Load custom functions
-    QJsonArray functionsArray = stateObj.value("customFunctions").toArray();
-    for (const QJsonValue &funcValue : functionsArray) {
-      state->addFunction(funcValue.toString());
+    state->setEntryAction(entryAction);
+    state->setExitAction(exitAction);
+    for (const QString &function : functions) {
+      state->addFunction(function);
     }
 
     stateMapById[state->id()] = state;
     stateMapByName[state->name()] = state;
-    fsm->addState(state);
-  }
-
-  // Load transitions
-  QJsonArray transitionsArray = root["transitions"].toArray();
-  for (const QJsonValue &value : transitionsArray) {
-    QJsonObject transObj = value.toObject();
-
-    // Support both new ID-based and old name-based references
-    QString sourceId = transObj.value("sourceId").toString();
-    QString targetId = transObj.value("targetId").toString();
-
-    // Backward compat: fall back to name-based lookup if no IDs
-    if (sourceId.isEmpty()) {
-      sourceId =
-          transObj["source"].toString(); // Old format used "source" with name
+    states.append(state);
+  };
+
+  auto readTransition = [&]() {
+    TransitionRecord record;
+    while (reader.readNext() == JsonStreamReader::Key) {
+      if (reader.keyIs("id")) {
+        record.id = readString(reader);
+      } else if (reader.keyIs("sourceId")) {
+        record.sourceId = readString(reader);
+      } else if (reader.keyIs("targetId")) {
+        record.targetId = readString(reader);
+      } else if (reader.keyIs("source")) {
+        // Old format used "source"/"target" with names
+        record.source = readString(reader);
+      } else if (reader.keyIs("target")) {
+        record.target = readString(reader);
+      } else if (reader.keyIs("event")) {
+        record.event = readString(reader);
+      } else if (reader.keyIs("guard")) {
+        record.guard = readString(reader);
+      } else if (reader.keyIs("action")) {
+        record.action = readString(reader);
+      } else {
+        reader.skipValue();
+      }
     }
-    if (targetId.isEmpty()) {
-      targetId =
-          transObj["target"].toString(); // Old format used "target" with name
+    if (!reader.hasError()) {
+      addTransition(record, false);
     }
+  };
 
-    // Try ID-based lookup first, then name-based (for old files)
-    State *source = stateMapById.value(sourceId);
-    if (!source) {
-      source = stateMapByName.value(sourceId);
-    }
-
-    State *target = stateMapById.value(targetId);
-    if (!target) {
-      target = stateMapByName.value(targetId);
+  // Reads an array of records, skipping anything that is not an object
+  auto readArray = [&](const auto &readRecord) {
+    if (reader.readNext() != JsonStreamReader::BeginArray) {
+      if (reader.token() == JsonStreamReader::BeginObject) {
+        reader.skipContainer();
+      }
+      return;
     }
-
-    if (source && target) {
-      QString transitionId = transObj.value("id").toString();
-      Transition *trans;
-
-      if (transitionId.isEmpty()) {
-        // Old format: no ID
-        trans = new Transition(source, target, fsm);
-      } else {
-        // New format: has ID
-        trans = new Transition(transitionId, source, target, fsm);
+    for (;;) {
+      const JsonStreamReader::Token token = reader.readNext();
+      if (token == JsonStreamReader::BeginObject) {
+        readRecord();
+      } else if (token == JsonStreamReader::BeginArray) {
+        reader.skipContainer();
+      } else if (token == JsonStreamReader::EndArray ||
+                 token == JsonStreamReader::Invalid) {
+        return;
       }
-
-      // Load transition properties
-      trans->setEvent(transObj.value("event").toString());
-      trans->setGuard(transObj.value("guard").toString());
-      trans->setAction(transObj.value("action").toString());
-
-      fsm->addTransition(trans);
+    }
+  };
+
+  while (reader.readNext() == JsonStreamReader::Key) {
+    if (reader.keyIs("name")) {
+      fsm->setName(readString(reader));
+    } else if (reader.keyIs("states")) {
+      readArray(readState);
+    } else if (reader.keyIs("transitions")) {
+      readArray(readTransition);
     } else {
-      qDebug() << "JSONSerializer::load - Could not find source or target "
-                  "state for transition";
+      reader.skipValue();
     }
   }
 
-  qDebug() << "FSM loaded from" << filepath;
+  // Only whitespace may follow the root object
+  if (reader.token() != JsonStreamReader::EndObject ||
+      reader.readNext() != JsonStreamReader::EndOfDocument) {
+    m_lastError = reader.hasError() ? reader.errorString()
+                                    : QString("Invalid JSON document");
+    qDebug() << "JSONSerializer::load - Invalid JSON document:"
+             << m_lastError;
+    delete fsm;
+    return nullptr;
+  }
+
+  // Transitions listed before their states
+  for (const TransitionRecord &record : std::as_const(pending)) {
+    addTransition(record, true);
+  }
+
+  fsm->addStates(states);
+  fsm->addTransitions(transitions);
   return fsm;
 }
@@ -5,6 +5,8 @@
 #include <QString>
 
 class FSM;
+class FSMSnapshot;
+class QIODevice;
 
 /**
  * @brief The JSONSerializer class - Serializes/deserializes FSM to/from JSON
@@ -15,6 +17,8 @@ class FSM;
  *
  * It provides methods to save the current FSM state to a file and load it back,
  * ensuring all properties (identifiers, names, layout positions) are preserved.
+ * Both directions stream through JsonStreamWriter/JsonStreamReader, so no
+ * document tree is held in memory next to the model.
  *
  * @ingroup Serialization
  */
@@ -41,12 +45,45 @@ public:
    */
   bool save(const FSM *fsm, const QString &filepath);
 
+  /**
+   * @brief Writes the given FSM model as JSON to an open device.
+   * @param fsm The FSM model to serialize.
+   * @param device A writable device.
+   * @return true if all output was written.
+   */
+  bool save(const FSM *fsm, QIODevice *device);
+
+  /**
+   * @brief Writes a snapshot as JSON to an open device, without building an
+   * FSM. Safe to call on any thread.
+   * @param snapshot The FSM contents to serialize.
+   * @param device A writable device.
+   * @return true if all output was written.
+   */
+  bool save(const FSMSnapshot &snapshot, QIODevice *device);
+
   /**
    * @brief Loads an FSM model from a JSON file.
    * @param filepath The absolute path to the source file.
    * @return A pointer to the deserialized FSM, or nullptr if loading failed.
    */
   FSM *load(const QString &filepath);
+
+  /**
+   * @brief Reads an FSM model from an open device.
+   * @param device A readable device positioned at the start of the document.
+   * @return A pointer to the deserialized FSM, or nullptr if loading failed.
+   */
+  FSM *load(QIODevice *device);
+
+  /**
+   * @brief Gets the error of the last failed load().
+   * @return The error, or an empty string.
+   */
+  QString lastError() const { return m_lastError; }
+
+private:
+  QString m_lastError;
 };
 
 #endif // JSONSERIALIZER_H
@@ -0,0 +1,290 @@
+#include "JsonStreamReader.h"
+#include <QIODevice>
+#include <cstring>
+
+JsonStreamReader::JsonStreamReader(QIODevice *device) : m_device(device) {}
+
+// Returns the next byte without consuming it, or -1 at the end of input
+int JsonStreamReader::peek() {
+  if (m_pos == m_chunk.size()) {
+    m_consumed += m_chunk.size();
+    m_chunk = m_device->read(ChunkSize);
+    m_pos = 0;
+    if (m_chunk.isEmpty())
+      return -1;
+  }
+  return uchar(m_chunk.at(m_pos));
+}
+
+int JsonStreamReader::skipWhitespace() {
+  for (;;) {
+    const int c = peek();
+    if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+      return c;
+    ++m_pos;
+  }
+}
+
+bool JsonStreamReader::expect(char c) {
+  if (skipWhitespace() != c) {
+    fail(QString("Expected '%1'").arg(QLatin1Char(c)));
+    return false;
+  }
+  ++m_pos;
+  return true;
+}
+
+JsonStreamReader::Token JsonStreamReader::fail(const QString &error) {
+  if (m_token != Invalid) {
+    m_error = QString("%1 at offset %2").arg(error).arg(m_consumed + m_pos);
+  }
+  return m_token = Invalid;
+}
+
+JsonStreamReader::Token JsonStreamReader::readNext() {
+  if (m_token == Invalid || m_token == EndOfDocument)
+    return m_token;
+
+  int c = skipWhitespace();
+
+  if (m_open.isEmpty()) {
+    if (m_afterValue) {
+      return c == -1 ? m_token = EndOfDocument
+                     : fail("Unexpected data after the document");
+    }
+  } else if (m_afterValue) {
+    // After a member or element: a separator or the end of the container
+    if (c == m_open.last()) {
+      ++m_pos;
+      m_open.removeLast();
+      return m_token = c == '}' ? EndObject : EndArray;
+    }
+    if (c != ',')
+      return fail("Expected ',' or closing bracket");
+    ++m_pos;
+    m_afterValue = false;
+    c = skipWhitespace();
+  } else if (!m_afterKey && c == m_open.last()) {
+    // Empty container
+    ++m_pos;
+    m_open.removeLast();
+    m_afterValue = true;
+    return m_token = c == '}' ? EndObject : EndArray;
+  }
+
+  // Inside an object every value is preceded by its key
+  if (!m_open.isEmpty() && m_open.last() == '}' && !m_afterKey) {
+    if (c != '"')
+      return fail("Expected a key");
+    if (!readString() || !expect(':'))
+      return m_token;
+    m_afterKey = true;
+    return m_token = Key;
+  }
+
+  m_afterKey = false;
+  switch (c) {
+  case '{':
+  case '[':
+    ++m_pos;
+    m_open.append(c == '{' ? '}' : ']');
+    m_afterValue = false;
+    return m_token = c == '{' ? BeginObject : BeginArray;
+  case '"':
+    if (!readString())
+      return m_token;
+    m_afterValue = true;
+    return m_token = String;
+  case -1:
+    return fail("Unexpected end of input");
+  default:
+    m_afterValue = true;
+    if (c == '-' || (c >= '0' && c <= '9'))
+      return readNumber();
+    return readLiteral();
+  }
+}
+
+// Nested containers are tracked by the same stack, so reading until it is
+// shorter than now stops at the bracket matching the current one
+bool JsonStreamReader::skipContainer() {
+  const int depth = m_open.size();
+  while (m_open.size() >= depth) {
+    if (readNext() == Invalid)
+      return false;
+  }
+  return true;
+}
+
+bool JsonStreamReader::skipValue() {
+  const Token token = readNext();
+  if (token == BeginObject || token == BeginArray)
+    return skipContainer();
+  return token != Invalid;
+}
+
+void JsonStreamReader::appendUtf8(uint codePoint) {
+  if (codePoint < 0x80) {
+    m_text += char(codePoint);
+  } else if (codePoint < 0x800) {
+    m_text += char(0xC0 | (codePoint >> 6));
+    m_text += char(0x80 | (codePoint & 0x3F));
+  } else if (codePoint < 0x10000) {
+    m_text += char(0xE0 | (codePoint >> 12));
+    m_text += char(0x80 | ((codePoint >> 6) & 0x3F));
+    m_text += char(0x80 | (codePoint & 0x3F));
+  } else {
+    m_text += char(0xF0 | (codePoint >> 18));
+    m_text += char(0x80 | ((codePoint >> 12) & 0x3F));
+    m_text += char(0x80 | ((codePoint >> 6) & 0x3F));
+    m_text += char(0x80 | (codePoint & 0x3F));
+  }
+}
+
+// Reads a string literal (current byte is the opening quote) into m_text as
+// UTF-8, with escapes resolved
+bool JsonStreamReader::readString() {
+  m_text.resize(0); // Keeps the capacity
+  ++m_pos;
+
+  auto readHex = [this](uint &value) {
+    value = 0;
+    for (int i = 0; i < 4; ++i) {
+      const int c = peek();
+      int digit;
+      if (c >= '0' && c <= '9')
+        digit = c - '0';
+      else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+        digit = (c | 0x20) - 'a' + 10;
+      else
+        return false;
+      value = value * 16 + uint(digit);
+      ++m_pos;
+    }
+    return true;
+  };
+
+  for (;;) {
+    // Copy the run up to the next quote, escape or control character
+    const char *data = m_chunk.constData();
+    qsizetype end = m_pos;
+    while (end < m_chunk.size() && data[end] != '"' && data[end] != '\\' &&
+           uchar(data[end]) >= 0x20) {
+      ++end;
+    }
+    m_text.append(data + m_pos, end - m_pos);
+    m_pos = end;
+
+    const int c = peek();
+    if (c == -1) {
+      fail("Unterminated string");
+      return false;
+    }
+    if (c == '"') {
+      ++m_pos;
+      return true;
+    }
+    if (c != '\\') {
+      if (c < 0x20) {
+        fail("Control character in string");
+        return false;
+      }
+      continue; // Next chunk
+    }
+
+    ++m_pos;
+    const int escape = peek();
+    if (escape == -1) {
+      fail("Unterminated string");
+      return false;
+    }
+    ++m_pos;
+    switch (escape) {
+    case '"':
+    case '\\':
+    case '/':
+      m_text += char(escape);
+      break;
+    case 'b':
+      m_text += '\b';
+      break;
+    case 'f':
+      m_text += '\f';
+      break;
+    case 'n':
+      m_text += '\n';
+      break;
+    case 'r':
+      m_text += '\r';
+      break;
+    case 't':
+      m_text += '\t';
+      break;
+    case 'u': {
+      uint unit;
+      if (!readHex(unit)) {
+        fail("Invalid \\u escape");
+        return false;
+      }
+      if (unit >= 0xD800 && unit < 0xDC00 && peek() == '\\') {
+        // High surrogate, combined with a following low surrogate
+        ++m_pos;
+        uint low;
+        if (peek() != 'u' || (++m_pos, !readHex(low))) {
+          fail("Invalid \\u escape");
+          return false;
+        }
+        if (low >= 0xDC00 && low < 0xE000) {
+          appendUtf8(0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00));
+        } else {
+          appendUtf8(0xFFFD);
+          appendUtf8(low >= 0xD800 && low < 0xE000 ? 0xFFFD : low);
+        }
+      } else if (unit >= 0xD800 && unit < 0xE000) {
+        appendUtf8(0xFFFD); // Lone surrogate
+      } else {
+        appendUtf8(unit);
+      }
+      break;
+    }
+    default:
+      fail("Invalid escape sequence");
+      return false;
+    }
+  }
+}
+
+JsonStreamReader::Token JsonStreamReader::readNumber() {
+  m_text.resize(0);
+  for (int c = peek(); c != -1; c = peek()) {
+    if (!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' ||
+          c == 'e' || c == 'E'))
+      break;
+    m_text += char(c);
+    ++m_pos;
+  }
+
+  bool ok = false;
+  m_number = m_text.toDouble(&ok);
+  if (!ok)
+    return fail("Invalid number");
+  return m_token = Number;
+}
+
+JsonStreamReader::Token JsonStreamReader::readLiteral() {
+  m_text.resize(0);
+  for (int c = peek(); c >= 'a' && c <= 'z'; c = peek()) {
+    m_text += char(c);
+    ++m_pos;
+    if (m_text.size() > 5)
+      break;
+  }
+
+  if (m_text == "true" || m_text == "false") {
+    m_bool = m_text == "true";
+    return m_token = Bool;
+  }
+  if (m_text == "null")
+    return m_token = Null;
+  return fail("Unexpected character");
+}
@@ -0,0 +1,113 @@
+#ifndef JSONSTREAMREADER_H
+#define JSONSTREAMREADER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+class QIODevice;
+
+/**
+ * @brief Pull parser reading JSON from a QIODevice one token at a time.
+ *
+ * The device is read in fixed-size chunks and no document tree is built, so
+ * memory use is bounded by the longest string in the input rather than by
+ * the size of the document. Call readNext() to advance; the value of the
+ * current Key, String, Number or Bool token is available until the next call.
+ *
+ * The input is checked for well-formedness as it is read. Any error turns
+ * the current token into Invalid and errorString() describes it.
+ *
+ * @ingroup Serialization
+ */
+class JsonStreamReader {
+public:
+  enum Token {
+    NoToken,
+    BeginObject,
+    EndObject,
+    BeginArray,
+    EndArray,
+    Key,
+    String,
+    Number,
+    Bool,
+    Null,
+    EndOfDocument,
+    Invalid
+  };
+
+  /**
+   * @brief Constructs a reader for an open, readable device.
+   * @param device The device to read from; it must outlive the reader.
+   */
+  explicit JsonStreamReader(QIODevice *device);
+
+  /**
+   * @brief Reads the next token.
+   * @return The new current token.
+   */
+  Token readNext();
+
+  /**
+   * @brief Skips the value that follows a Key, including nested objects
+   * and arrays.
+   * @return false on a syntax error.
+   */
+  bool skipValue();
+
+  /**
+   * @brief Skips the rest of the object or array whose Begin token is
+   * current.
+   * @return false on a syntax error.
+   */
+  bool skipContainer();
+
+  Token token() const { return m_token; }
+
+  /**
+   * @brief Checks the text of the current Key token without allocating.
+   * @param name Plain ASCII key.
+   */
+  bool keyIs(const char *name) const { return m_text == name; }
+
+  /**
+   * @brief Gets the text of the current Key or String token.
+   */
+  QString stringValue() const { return QString::fromUtf8(m_text); }
+
+  double numberValue() const { return m_number; }
+  bool boolValue() const { return m_bool; }
+
+  bool hasError() const { return m_token == Invalid; }
+  QString errorString() const { return m_error; }
+
+private:
+  static constexpr qsizetype ChunkSize = 64 * 1024;
+
+  int peek();
+  int skipWhitespace();
+  bool expect(char c);
+  Token fail(const QString &error);
+  bool readString();
+  Token readNumber();
+  Token readLiteral();
+  void appendUtf8(uint codePoint);
+
+  QIODevice *m_device;
+  QByteArray m_chunk;
+  qsizetype m_pos = 0;
+  qint64 m_consumed = 0; // Bytes of earlier chunks, for error offsets
+
+  QVector<char> m_open;     // Closing bracket of each open container
+  bool m_afterValue = false; // A complete value was just read
+  bool m_afterKey = false;   // A key was read, its value comes next
+
+  Token m_token = NoToken;
+  QByteArray m_text; // UTF-8 text of the current Key or String
+  double m_number = 0;
+  bool m_bool = false;
+  QString m_error;
+};
+
+#endif // JSONSTREAMREADER_H
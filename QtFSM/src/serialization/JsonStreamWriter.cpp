@@ -0,0 +1,145 @@
+#include "JsonStreamWriter.h"
+#include <QIODevice>
+#include <QLocale>
+#include <cmath>
+
+JsonStreamWriter::JsonStreamWriter(QIODevice *device) : m_device(device) {
+  m_buffer.reserve(FlushSize + 1024);
+}
+
+JsonStreamWriter::~JsonStreamWriter() { flush(); }
+
+bool JsonStreamWriter::flush() {
+  if (!m_buffer.isEmpty() && !m_error) {
+    m_error = m_device->write(m_buffer) != m_buffer.size();
+  }
+  m_buffer.resize(0); // Keeps the capacity
+  return !m_error;
+}
+
+// Same layout as QJsonDocument::Indented: one member or element per line,
+// four spaces per level
+void JsonStreamWriter::newline(int depth) {
+  m_buffer += '\n';
+  m_buffer.append(depth * 4, ' ');
+}
+
+void JsonStreamWriter::beginValue() {
+  if (m_afterKey) {
+    m_afterKey = false;
+    return;
+  }
+  if (m_empty.isEmpty())
+    return; // Top-level value
+
+  if (!m_empty.last())
+    m_buffer += ',';
+  m_empty.last() = false;
+  newline(m_empty.size());
+}
+
+void JsonStreamWriter::begin(char bracket) {
+  beginValue();
+  m_buffer += bracket;
+  m_empty.append(true);
+}
+
+void JsonStreamWriter::end(char bracket) {
+  const bool empty = m_empty.takeLast();
+  if (!empty)
+    newline(m_empty.size());
+  m_buffer += bracket;
+
+  if (m_empty.isEmpty()) {
+    m_buffer += '\n'; // End of the document
+  }
+  if (m_buffer.size() >= FlushSize)
+    flush();
+}
+
+void JsonStreamWriter::beginObject() { begin('{'); }
+
+void JsonStreamWriter::endObject() { end('}'); }
+
+void JsonStreamWriter::beginArray() { begin('['); }
+
+void JsonStreamWriter::endArray() { end(']'); }
+
+void JsonStreamWriter::key(const char *name) {
+  beginValue();
+  m_buffer += '"';
+  m_buffer += name;
+  m_buffer += "\": ";
+  m_afterKey = true;
+}
+
+void JsonStreamWriter::value(const QString &text) {
+  beginValue();
+  writeString(text);
+}
+
+void JsonStreamWriter::value(double number) {
+  beginValue();
+  if (std::isfinite(number)) {
+    m_buffer += QByteArray::number(number, 'g',
+                                   QLocale::FloatingPointShortest);
+  } else {
+    m_buffer += "null"; // JSON has no NaN or infinity
+  }
+}
+
+void JsonStreamWriter::value(bool flag) {
+  beginValue();
+  m_buffer += flag ? "true" : "false";
+}
+
+void JsonStreamWriter::writeString(QStringView text) {
+  static const char hex[] = "0123456789abcdef";
+  m_buffer += '"';
+
+  // Runs of characters that need no escaping are converted in one go
+  qsizetype runStart = 0;
+  auto flushRun = [&](qsizetype end) {
+    if (end > runStart)
+      m_buffer += text.mid(runStart, end - runStart).toUtf8();
+  };
+  for (qsizetype i = 0; i < text.size(); ++i) {
+    const char16_t c = text[i].unicode();
+    if (c >= 0x20 && c != u'"' && c != u'\\')
+      continue;
+
+    flushRun(i);
+    runStart = i + 1;
+    m_buffer += '\\';
+    switch (c) {
+    case u'"':
+      m_buffer += '"';
+      break;
+    case u'\\':
+      m_buffer += '\\';
+      break;
+    case u'\b':
+      m_buffer += 'b';
+      break;
+    case u'\f':
+      m_buffer += 'f';
+      break;
+    case u'\n':
+      m_buffer += 'n';
+      break;
+    case u'\r':
+      m_buffer += 'r';
+      break;
+    case u'\t':
+      m_buffer += 't';
+      break;
+    default:
+      m_buffer += "u00";
+      m_buffer += hex[c >> 4];
+      m_buffer += hex[c & 0xf];
+      break;
+    }
+  }
+  flushRun(text.size());
+  m_buffer += '"';
+}
@@ -0,0 +1,75 @@
+#ifndef JSONSTREAMWRITER_H
+#define JSONSTREAMWRITER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+class QIODevice;
+
+/**
+ * @brief Writes indented JSON straight to a QIODevice.
+ *
+ * Values are appended to a small buffer that is flushed to the device
+ * whenever it grows past FlushSize, so memory use does not depend on the size
+ * of the document. The caller is responsible for emitting a well-formed
+ * sequence of calls (a key before every value inside an object).
+ *
+ * @ingroup Serialization
+ */
+class JsonStreamWriter {
+public:
+  /**
+   * @brief Constructs a writer for an open, writable device.
+   * @param device The device to write to; it must outlive the writer.
+   */
+  explicit JsonStreamWriter(QIODevice *device);
+
+  /**
+   * @brief Flushes whatever is still buffered.
+   */
+  ~JsonStreamWriter();
+
+  void beginObject();
+  void endObject();
+  void beginArray();
+  void endArray();
+
+  /**
+   * @brief Writes the key of the next object member.
+   * @param name The key, plain ASCII.
+   */
+  void key(const char *name);
+
+  void value(const QString &text);
+  void value(double number);
+  void value(bool flag);
+
+  /**
+   * @brief Writes the buffered output to the device.
+   * @return false if the device reported a write error (now or earlier).
+   */
+  bool flush();
+
+  /**
+   * @brief Checks whether any write to the device failed.
+   */
+  bool hasError() const { return m_error; }
+
+private:
+  static constexpr qsizetype FlushSize = 64 * 1024;
+
+  void beginValue();
+  void begin(char bracket);
+  void end(char bracket);
+  void newline(int depth);
+  void writeString(QStringView text);
+
+  QIODevice *m_device;
+  QByteArray m_buffer;
+  QVector<bool> m_empty; // Per open container: nothing written into it yet
+  bool m_afterKey = false;
+  bool m_error = false;
+};
+
+#endif // JSONSTREAMWRITER_H
@@ -0,0 +1,65 @@
+#include "ClusterItem.h"
+#include "../model/State.h"
+#include "StateItem.h"
+#include <QHash>
+#include <QPainter>
+#include <QPen>
+#include <QtMath>
+
+ClusterItem::ClusterItem(QGraphicsItem *parent)
+    : QGraphicsItem(parent), m_maxCount(1) {
+  setZValue(-1); // below everything else, like the states it replaces
+}
+
+QVector<ClusterItem::Cell> ClusterItem::cluster(const QList<State *> &states,
+                                                qreal cellSize) {
+  QHash<QPair<int, int>, int> index;
+  QVector<Cell> cells;
+  for (State *state : states) {
+    const QPointF pos = state->position();
+    const QPair<int, int> key(qFloor(pos.x() / cellSize),
+                              qFloor(pos.y() / cellSize));
+    const QRectF rect = StateItem::outlineRect().translated(pos);
+
+    auto it = index.constFind(key);
+    if (it == index.constEnd()) {
+      index.insert(key, cells.size());
+      cells.append(Cell{rect, 1});
+    } else {
+      Cell &cell = cells[*it];
+      cell.rect = cell.rect.united(rect);
+      ++cell.count;
+    }
+  }
+  return cells;
+}
+
+void ClusterItem::setCells(const QVector<Cell> &cells) {
+  prepareGeometryChange();
+  m_cells = cells;
+  m_bounds = QRectF();
+  m_maxCount = 1;
+  for (const Cell &cell : m_cells) {
+    m_bounds = m_bounds.united(cell.rect);
+    m_maxCount = qMax(m_maxCount, cell.count);
+  }
+}
+
+QRectF ClusterItem::boundingRect() const { return m_bounds; }
+
+void ClusterItem::paint(QPainter *painter,
+                        const QStyleOptionGraphicsItem *option,
+                        QWidget *widget) {
+  Q_UNUSED(option);
+  Q_UNUSED(widget);
+
+  painter->setRenderHint(QPainter::Antialiasing, false);
+  painter->setPen(QPen(QColor(70, 130, 180), 0)); // Steel blue hairline
+
+  for (const Cell &cell : m_cells) {
+    // Denser cells are drawn more opaque
+    const int alpha = 60 + 160 * cell.count / m_maxCount;
+    painter->setBrush(QColor(70, 130, 180, alpha));
+    painter->drawRect(cell.rect);
+  }
+}
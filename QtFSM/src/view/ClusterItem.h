@@ -0,0 +1,57 @@
+#ifndef CLUSTERITEM_H
+#define CLUSTERITEM_H
+
+#include <QGraphicsItem>
+#include <QList>
+#include <QVector>
+
+class State;
+
+/**
+ * @brief The ClusterItem class draws aggregated groups of states when the
+ * diagram is zoomed out too far for individual states to be told apart.
+ *
+ * States are binned into a square grid; each occupied cell becomes one
+ * shaded rectangle covering its states, darker the more states it holds.
+ * A single item paints every cell, so a 20k-state diagram costs a few
+ * hundred rectangles per frame instead of 20k items.
+ *
+ * @ingroup View
+ */
+class ClusterItem : public QGraphicsItem {
+public:
+  /**
+   * @brief One occupied grid cell.
+   */
+  struct Cell {
+    QRectF rect; ///< Union of the states' outlines in the cell
+    int count = 0;
+  };
+
+  explicit ClusterItem(QGraphicsItem *parent = nullptr);
+
+  /**
+   * @brief Groups states by grid cell.
+   * @param states The states to aggregate.
+   * @param cellSize Cell edge length in scene units.
+   * @return One entry per occupied cell.
+   */
+  static QVector<Cell> cluster(const QList<State *> &states, qreal cellSize);
+
+  /**
+   * @brief Replaces the cells drawn by this item.
+   */
+  void setCells(const QVector<Cell> &cells);
+
+  QRectF boundingRect() const override;
+
+  void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+             QWidget *widget) override;
+
+private:
+  QVector<Cell> m_cells;
+  QRectF m_bounds;
+  int m_maxCount;
+};
+
+#endif // CLUSTERITEM_H
@@ -4,12 +4,27 @@
 #include <QFont>
 #include <QHBoxLayout>
 #include <QLabel>
+#include <QPromise>
 #include <QPushButton>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
 #include <QTextEdit>
+#include <QTimer>
 #include <QVBoxLayout>
+#include <QtConcurrent>
 
 CodePreviewPanel::CodePreviewPanel(QWidget *parent)
-    : QWidget(parent), m_isInternalUpdate(false) {
+    : QWidget(parent), m_isInternalUpdate(false), m_restartPending(false) {
+  m_generator = new CodeGenerator(this);
+  m_debounceTimer = new QTimer(this);
+  m_debounceTimer->setSingleShot(true);
+  m_debounceTimer->setInterval(DebounceMs);
+  connect(m_debounceTimer, &QTimer::timeout, this,
+          &CodePreviewPanel::startGeneration);
+  connect(&m_watcher, &QFutureWatcher<QString>::finished, this,
+          &CodePreviewPanel::finishGeneration);
+
   QVBoxLayout *layout = new QVBoxLayout(this);
   layout->setSpacing(5);
   layout->setContentsMargins(5, 5, 5, 5);
@@ -90,7 +105,12 @@ CodePreviewPanel::CodePreviewPanel(QWidget *parent)
     )");
 }
 
-CodePreviewPanel::~CodePreviewPanel() {}
+CodePreviewPanel::~CodePreviewPanel() {
+  // The job uses the panel's generator, so it must not outlive the panel
+  disconnect(&m_watcher, nullptr, this, nullptr);
+  m_watcher.cancel();
+  m_watcher.waitForFinished();
+}
 
 void CodePreviewPanel::updateCode(FSM *fsm) {
   if (!fsm || fsm->states().isEmpty()) {
@@ -98,22 +118,122 @@ void CodePreviewPanel::updateCode(FSM *fsm) {
     return;
   }
 
-  // Generate code
-  CodeGenerator generator;
-  QString code = generator.generate(fsm);
+  // Restart the quiet period; the model is captured when it ends
+  m_pendingFsm = fsm;
+  m_debounceTimer->start();
+}
+
+void CodePreviewPanel::startGeneration() {
+  if (m_watcher.isRunning()) {
+    // Outdated: stop it and start over once it has returned
+    m_restartPending = true;
+    m_watcher.cancel();
+    return;
+  }
+  if (!m_pendingFsm) {
+    return;
+  }
+
+  const CodeSnapshot snapshot = CodeSnapshot::capture(m_pendingFsm);
+  m_watcher.setFuture(
+      QtConcurrent::run([snapshot, generator = m_generator](
+                            QPromise<QString> &promise) {
+        const QString code = generator->generate(
+            snapshot, [&promise]() { return promise.isCanceled(); });
+        if (!promise.isCanceled()) {
+          promise.addResult(code);
+        }
+      }));
+}
+
+void CodePreviewPanel::finishGeneration() {
+  if (m_restartPending) {
+    m_restartPending = false;
+    startGeneration();
+    return;
+  }
+  if (m_watcher.isCanceled() || m_watcher.future().resultCount() == 0) {
+    return;
+  }
 
   // Display code - use flag to prevent circular signal
   m_isInternalUpdate = true;
+  applyCode(m_watcher.result());
+  m_isInternalUpdate = false;
+}
 
-  // Only update if content is different to preserve cursor if possible
-  if (m_codeEdit->toPlainText() != code) {
-    m_codeEdit->setPlainText(code);
+void CodePreviewPanel::cancelGeneration() {
+  m_debounceTimer->stop();
+  m_pendingFsm = nullptr;
+  m_restartPending = false;
+  if (m_watcher.isRunning()) {
+    m_watcher.cancel();
   }
+}
 
-  m_isInternalUpdate = false;
+void CodePreviewPanel::applyCode(const QString &code) {
+  // Replace only the lines between the unchanged head and tail. A small
+  // model edit then touches a few blocks instead of re-laying out the whole
+  // document, and the cursor stays where it was.
+  const QStringList lines = code.split('\n');
+  QTextDocument *document = m_codeEdit->document();
+  const int oldCount = document->blockCount();
+  const int newCount = lines.size();
+
+  int head = 0;
+  for (QTextBlock block = document->begin();
+       block.isValid() && head < newCount && block.text() == lines[head];
+       block = block.next()) {
+    ++head;
+  }
+  if (head == oldCount && head == newCount) {
+    return; // Unchanged
+  }
+
+  int tail = 0;
+  for (QTextBlock block = document->lastBlock();
+       block.isValid() && tail < oldCount - head && tail < newCount - head &&
+       block.text() == lines[newCount - 1 - tail];
+       block = block.previous()) {
+    ++tail;
+  }
+
+  const QStringList middle = lines.mid(head, newCount - head - tail);
+  int start;
+  int end;
+  QString text;
+  if (tail > 0) {
+    // Whole lines, each ending in a newline
+    start = document->findBlockByNumber(head).position();
+    end = document->findBlockByNumber(oldCount - tail).position();
+    for (const QString &line : middle) {
+      text += line + '\n';
+    }
+  } else {
+    // Up to the end of the document, which has no final newline
+    if (head > 0) {
+      const QTextBlock last = document->findBlockByNumber(head - 1);
+      start = last.position() + last.length() - 1;
+      if (!middle.isEmpty()) {
+        text = "\n";
+      }
+    } else {
+      start = 0;
+    }
+    end = document->characterCount() - 1;
+    text += middle.join('\n');
+  }
+
+  QTextCursor cursor(document);
+  cursor.beginEditBlock();
+  cursor.setPosition(start);
+  cursor.setPosition(end, QTextCursor::KeepAnchor);
+  cursor.insertText(text);
+  cursor.endEditBlock();
 }
 
 void CodePreviewPanel::clearCode() {
+  cancelGeneration();
   m_isInternalUpdate = true;
   m_codeEdit->clear();
   m_isInternalUpdate = false;
@@ -126,6 +246,7 @@ void CodePreviewPanel::setReadOnly(bool readOnly) {
 }
 
 void CodePreviewPanel::setCode(const QString &code) {
+  cancelGeneration();
   m_isInternalUpdate = true;
   m_codeEdit->setPlainText(code);
   m_isInternalUpdate = false;
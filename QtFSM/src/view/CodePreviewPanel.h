@@ -1,24 +1,42 @@
 #ifndef CODEPREVIEWPANEL_H
 #define CODEPREVIEWPANEL_H
 
+#include <QFutureWatcher>
+#include <QPointer>
 #include <QWidget>
 
 class QTextEdit;
+class QTimer;
 class FSM;
+class CodeGenerator;
 
 /**
  * @brief The CodePreviewPanel class - Shows generated C++ code in real-time
+ *
+ * Code is generated on the thread pool from a @ref CodeSnapshot, so large
+ * machines never block the GUI. Requests are debounced, a newer request
+ * cancels the job that is still running, and the result is applied as an
+ * edit of only the lines that changed. All jobs share one @ref CodeGenerator,
+ * so each only rebuilds the state classes that were edited.
  */
 class CodePreviewPanel : public QWidget {
   Q_OBJECT
 
 public:
   explicit CodePreviewPanel(QWidget *parent = nullptr);
+
+  /**
+   * @brief Cancels and waits for a running generation.
+   */
   ~CodePreviewPanel();
 
   QString code() const;
 
 public slots:
+  /**
+   * @brief Regenerates the code for an FSM in the background. A burst of
+   * calls generates once, from the FSM as it is when the burst ends.
+   */
   void updateCode(FSM *fsm);
   void clearCode();
   void setReadOnly(bool readOnly);
@@ -30,8 +48,21 @@ signals:
   void generateCodeRequested();
 
 private:
+  void startGeneration();
+  void finishGeneration();
+  void cancelGeneration();
+  void applyCode(const QString &code);
+
+  /// Quiet time after the last request before generating
+  static constexpr int DebounceMs = 150;
+
   QTextEdit *m_codeEdit;
   bool m_isInternalUpdate;
+  QTimer *m_debounceTimer;
+  QPointer<FSM> m_pendingFsm;        ///< FSM of the latest request
+  QFutureWatcher<QString> m_watcher; ///< Running generation
+  CodeGenerator *m_generator; ///< Used by one job at a time, keeps the cache
+  bool m_restartPending; ///< A newer request arrived while a job was running
 };
 
 #endif // CODEPREVIEWPANEL_H
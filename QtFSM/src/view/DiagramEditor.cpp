@@ -3,6 +3,7 @@
 #include "../model/State.h"
 #include "../model/Transition.h"
 #include "../viewmodel/DiagramViewModel.h"
+#include "ClusterItem.h"
 #include "StateItem.h"
 #include "TransitionDialog.h"
 #include "TransitionItem.h"
@@ -10,12 +11,18 @@
 #include <QGraphicsTextItem>
 #include <QKeyEvent>
 #include <QMessageBox>
+#include <QMouseEvent>
 #include <QPainter>
+#include <QTimer>
 #include <QWheelEvent>
+#include <QtMath>
+#include <cmath>
 
 DiagramEditor::DiagramEditor(QWidget *parent)
     : QGraphicsView(parent), m_viewModel(nullptr), m_fsm(nullptr),
-      m_welcomeText(nullptr), m_titleItem(nullptr) {
+      m_welcomeText(nullptr), m_titleItem(nullptr),
+      m_routeUpdatePending(false), m_clusterItem(nullptr),
+      m_clusterCellSize(0), m_clusterUpdatePending(false) {
   m_scene = new QGraphicsScene(this);
   setScene(m_scene);
 
@@ -33,8 +40,13 @@ DiagramEditor::DiagramEditor(QWidget *parent)
   // Set background
   setBackgroundBrush(QBrush(QColor(250, 250, 250)));
 
-  // Set viewport update mode for better performance
-  setViewportUpdateMode(QGraphicsView::FullViewportUpdate);
+  // Repaint only the regions that changed: dragging a state touches the
+  // state and its edges, not everything on screen. Items keep their bounding
+  // rects tight (and states are cached) so these regions stay small.
+  setViewportUpdateMode(QGraphicsView::MinimalViewportUpdate);
+
+  // The background is a flat fill; render it once per viewport size
+  setCacheMode(QGraphicsView::CacheBackground);
 
   // Enable mouse tracking
   setMouseTracking(true);
@@ -47,36 +59,31 @@ DiagramEditor::~DiagramEditor() {}
 
 // Helper to rebuild scene from FSM model
 void DiagramEditor::rebuildScene() {
-  qDebug() << "DiagramEditor::rebuildScene() called - FSM has"
-           << (m_fsm ? m_fsm->states().size() : 0) << "states";
   m_scene->clear();
+  m_stateItems.clear();
+  m_transitionItems.clear();
+  m_router.clear();
+  m_movedItems.clear();
+  m_draggedItems.clear();
   m_titleItem = nullptr;
   m_welcomeText = nullptr;
+  m_clusterItem = nullptr;
+  m_clusterCellSize = 0;
 
   if (!m_fsm)
     return;
 
   // 1. Create State Items
-  QMap<State *, StateItem *> stateItemMap;
+  m_stateItems.reserve(m_fsm->states().size());
   for (State *state : m_fsm->states()) {
-    StateItem *item = new StateItem(state);
-    m_scene->addItem(item);
-    stateItemMap.insert(state, item);
+    addStateItem(state);
   }
 
-  // 2. Create Transition Items
-  for (State *state : m_fsm->states()) {
-    for (Transition *t : state->transitions()) {
-      StateItem *sourceItem = stateItemMap.value(t->sourceState());
-      StateItem *targetItem = stateItemMap.value(t->targetState());
-
-      if (sourceItem && targetItem) {
-        TransitionItem *tItem = new TransitionItem(t, sourceItem, targetItem);
-        m_scene->addItem(tItem);
-        sourceItem->addTransitionItem(tItem);
-        targetItem->addTransitionItem(tItem);
-      }
-    }
+  // 2. Create Transition Items (the FSM's list also holds transitions that
+  // were never registered with their source state)
+  m_transitionItems.reserve(m_fsm->transitions().size());
+  for (Transition *t : m_fsm->transitions()) {
+    addTransitionItem(t);
   }
 
   // 3. Create Title
@@ -85,18 +92,237 @@ void DiagramEditor::rebuildScene() {
   m_titleItem->setDefaultTextColor(QColor(60, 60, 60));
   m_titleItem->setPos(mapToScene(20, 20));
   m_titleItem->setZValue(100);
+
+  // 4. Aggregate the new items if we are zoomed out that far
+  updateLevelOfDetail();
+}
+
+void DiagramEditor::addStateItem(State *state) {
+  if (!state || m_stateItems.contains(state))
+    return;
+
+  StateItem *item = new StateItem(state);
+  m_scene->addItem(item);
+  m_stateItems.insert(state, item);
+  connect(item, &StateItem::moved, this,
+          [this, item]() { stateItemMoved(item); });
+  updateStateRect(item); // Reroutes the transitions it now blocks
+
+  if (m_clusterItem) {
+    item->setVisible(false);
+    scheduleClusterUpdate();
+  }
+}
+
+void DiagramEditor::removeStateItem(State *state) {
+  StateItem *item = m_stateItems.take(state);
+  if (!item)
+    return;
+
+  // The FSM removes a state's transitions first; drop any visual that is
+  // still attached so it does not keep a pointer to the deleted item
+  for (TransitionItem *tItem : item->transitionItems()) {
+    removeTransitionItem(tItem->transition());
+  }
+
+  m_movedItems.remove(item);
+  m_draggedItems.remove(item);
+  m_scene->removeItem(item);
+  delete item;
+  rerouteTransitions(m_router.removeState(state));
+
+  if (m_clusterItem)
+    scheduleClusterUpdate();
+}
+
+void DiagramEditor::addTransitionItem(Transition *transition) {
+  if (!transition || m_transitionItems.contains(transition))
+    return;
+
+  StateItem *sourceItem = m_stateItems.value(transition->sourceState());
+  StateItem *targetItem = m_stateItems.value(transition->targetState());
+  if (!sourceItem || !targetItem)
+    return;
+
+  TransitionItem *tItem = new TransitionItem(transition, sourceItem, targetItem);
+  tItem->setVisible(!m_clusterItem);
+  m_scene->addItem(tItem);
+  m_transitionItems.insert(transition, tItem);
+
+  // Register for updates
+  sourceItem->addTransitionItem(tItem);
+  targetItem->addTransitionItem(tItem);
+  m_router.addEdge(transition);
+  tItem->setRoute(m_router.route(transition));
+}
+
+void DiagramEditor::removeTransitionItem(Transition *transition) {
+  TransitionItem *tItem = m_transitionItems.take(transition);
+  if (!tItem)
+    return;
+
+  tItem->sourceItem()->removeTransitionItem(tItem);
+  tItem->targetItem()->removeTransitionItem(tItem);
+  m_router.removeEdge(transition);
+
+  m_scene->removeItem(tItem);
+  delete tItem;
+}
+
+void DiagramEditor::moveStateItems(const QList<State *> &states) {
+  // Batched moves (layouts, undo of a move) do not go through the states'
+  // positionChanged signals
+  for (State *state : states) {
+    if (StateItem *item = m_stateItems.value(state)) {
+      item->setPos(state->position());
+    }
+  }
+
+  if (m_clusterItem)
+    scheduleClusterUpdate();
+}
+
+void DiagramEditor::stateItemMoved(StateItem *item) {
+  // A drag moves the item on every mouse event; the model follows when the
+  // mouse is released
+  if (item->pos() != item->state()->position())
+    m_draggedItems.insert(item);
+  else
+    m_draggedItems.remove(item);
+
+  // The edges follow once per frame, at the latest positions
+  m_movedItems.insert(item);
+  if (m_routeUpdatePending)
+    return;
+
+  m_routeUpdatePending = true;
+  QTimer::singleShot(FrameInterval, Qt::PreciseTimer, this, [this]() {
+    m_routeUpdatePending = false;
+    updateMovedItems();
+  });
+}
+
+void DiagramEditor::updateMovedItems() {
+  // Transitions between two moved states are rerouted once
+  QSet<Transition *> stale;
+  for (StateItem *item : std::as_const(m_movedItems)) {
+    const QList<Transition *> transitions = m_router.setStateRect(
+        item->state(), item->mapRectToScene(StateItem::outlineRect()));
+    for (Transition *transition : transitions) {
+      stale.insert(transition);
+    }
+  }
+  m_movedItems.clear();
+  rerouteTransitions(stale.values());
+}
+
+void DiagramEditor::updateStateRect(StateItem *item) {
+  m_movedItems.remove(item);
+  rerouteTransitions(m_router.setStateRect(
+      item->state(), item->mapRectToScene(StateItem::outlineRect())));
+}
+
+void DiagramEditor::rerouteTransitions(const QList<Transition *> &transitions) {
+  for (Transition *transition : transitions) {
+    if (TransitionItem *tItem = m_transitionItems.value(transition)) {
+      tItem->setRoute(m_router.route(transition));
+    }
+  }
+}
+
+void DiagramEditor::commitDraggedStates() {
+  if (m_draggedItems.isEmpty() || !m_fsm)
+    return;
+
+  QList<State *> states;
+  QVector<QPointF> positions;
+  for (StateItem *item : std::as_const(m_draggedItems)) {
+    states.append(item->state());
+    positions.append(item->pos());
+  }
+  m_draggedItems.clear();
+
+  if (m_viewModel) {
+    m_viewModel->moveStates(states, positions);
+  } else {
+    m_fsm->moveStates(states, positions);
+  }
+}
+
+void DiagramEditor::updateLevelOfDetail() {
+  const qreal viewScale = transform().m11();
+  if (!m_fsm || viewScale >= ClusterScale) {
+    if (m_clusterItem) {
+      m_scene->removeItem(m_clusterItem);
+      delete m_clusterItem;
+      m_clusterItem = nullptr;
+      setItemsVisible(true);
+    }
+    return;
+  }
+
+  // Snap the cell size to a power of two so that most wheel steps reuse the
+  // existing clusters
+  const qreal cellSize =
+      qPow(2.0, qCeil(std::log2(ClusterCellPixels / viewScale)));
+
+  if (!m_clusterItem) {
+    m_clusterItem = new ClusterItem();
+    m_scene->addItem(m_clusterItem);
+    setItemsVisible(false);
+    m_clusterCellSize = 0;
+  }
+
+  if (cellSize != m_clusterCellSize) {
+    m_clusterItem->setCells(ClusterItem::cluster(m_fsm->states(), cellSize));
+    m_clusterCellSize = cellSize;
+  }
+}
+
+void DiagramEditor::scheduleClusterUpdate() {
+  // Re-binning is O(states); batch the edits of one event loop pass (a
+  // parse or a multi-delete) into a single pass
+  m_clusterCellSize = 0;
+  if (m_clusterUpdatePending)
+    return;
+
+  m_clusterUpdatePending = true;
+  QTimer::singleShot(0, this, [this]() {
+    m_clusterUpdatePending = false;
+    updateLevelOfDetail();
+  });
+}
+
+void DiagramEditor::setItemsVisible(bool visible) {
+  for (StateItem *item : std::as_const(m_stateItems)) {
+    item->setVisible(visible);
+  }
+  for (TransitionItem *item : std::as_const(m_transitionItems)) {
+    item->setVisible(visible);
+  }
 }
 
 void DiagramEditor::setFSM(FSM *fsm) {
   if (m_fsm != fsm) {
     if (m_fsm) {
-      disconnect(m_fsm, &FSM::nameChanged, this, &DiagramEditor::updateTitle);
+      disconnect(m_fsm, nullptr, this, nullptr);
     }
 
     m_fsm = fsm;
 
     if (m_fsm) {
       connect(m_fsm, &FSM::nameChanged, this, &DiagramEditor::updateTitle);
+
+      // Keep the scene in step with the model one object at a time; this
+      // covers view model commands, undo/redo and the legacy direct edits
+      connect(m_fsm, &FSM::stateAdded, this, &DiagramEditor::addStateItem);
+      connect(m_fsm, &FSM::stateRemoved, this,
+              &DiagramEditor::removeStateItem);
+      connect(m_fsm, &FSM::transitionAdded, this,
+              &DiagramEditor::addTransitionItem);
+      connect(m_fsm, &FSM::transitionRemoved, this,
+              &DiagramEditor::removeTransitionItem);
+      connect(m_fsm, &FSM::statesMoved, this, &DiagramEditor::moveStateItems);
     }
 
     rebuildScene();
@@ -113,9 +339,8 @@ void DiagramEditor::setViewModel(DiagramViewModel *viewModel) {
   if (m_viewModel) {
     setFSM(m_viewModel->fsm());
 
-    // Connect to modelChanged signal to rebuild scene on any change
-    connect(m_viewModel, &DiagramViewModel::modelChanged, this,
-            &DiagramEditor::rebuildScene);
+    // No modelChanged -> rebuildScene connection: commands, undo and redo
+    // all go through the FSM, whose signals update the scene item by item
   }
 }
 
@@ -131,7 +356,7 @@ FSM *DiagramEditor::fsm() const { return m_fsm; }
 
 void DiagramEditor::addState() {
   if (!m_fsm) {
-    m_fsm = new FSM(this);
+    setFSM(new FSM(this));
   }
 
   // Remove welcome message on first state
@@ -196,7 +421,6 @@ void DiagramEditor::addState() {
     m_fsm->addState(state);
   }
 
-  rebuildScene();
   emit fsmChanged();
 }
 
@@ -243,16 +467,6 @@ void DiagramEditor::deleteSelected() {
       }
     }
   }
-
-  // If we didn't use ViewModel (legacy path), we might need to manually ensure
-  // cleanup/rebuild
-  if (!m_viewModel) {
-    // Just ensure scene is clean for non-VM path
-    // Note: removeState/removeTransition usually trigger modified() -> signals?
-    // In this class setFSM connects FSM::nameChanged only.
-    // But we probably want rebuildScene if we did manual changes.
-    rebuildScene();
-  }
 }
 
 void DiagramEditor::startTransitionMode() {
@@ -276,32 +490,8 @@ void DiagramEditor::startTransitionMode() {
         transition->setEvent(eventName);
       }
       source->addTransition(transition);
-      m_fsm->addTransition(transition); // Register with FSM to emit signal
-
-      // Create Visual
-      StateItem *sourceItem = nullptr;
-      StateItem *targetItem = nullptr;
-
-      // Find items for states
-      for (QGraphicsItem *item : m_scene->items()) {
-        StateItem *sItem = dynamic_cast<StateItem *>(item);
-        if (sItem) {
-          if (sItem->state() == source)
-            sourceItem = sItem;
-          if (sItem->state() == target)
-            targetItem = sItem;
-        }
-      }
-
-      if (sourceItem && targetItem) {
-        TransitionItem *tItem =
-            new TransitionItem(transition, sourceItem, targetItem);
-        m_scene->addItem(tItem);
-
-        // Register for updates
-        sourceItem->addTransitionItem(tItem);
-        targetItem->addTransitionItem(tItem);
-      }
+      // Register with FSM; its transitionAdded signal creates the visual
+      m_fsm->addTransition(transition);
 
       // Notify change to update code
       emit fsmChanged();
@@ -332,4 +522,11 @@ void DiagramEditor::wheelEvent(QWheelEvent *event) {
   } else {
     scale(1.0 / scaleFactor, 1.0 / scaleFactor);
   }
+
+  updateLevelOfDetail();
+}
+
+void DiagramEditor::mouseReleaseEvent(QMouseEvent *event) {
+  QGraphicsView::mouseReleaseEvent(event);
+  commitDraggedStates();
 }
@@ -1,10 +1,18 @@
 #ifndef DIAGRAMEDITOR_H
 #define DIAGRAMEDITOR_H
 
+#include "../layout/EdgeRouter.h"
 #include <QGraphicsScene>
 #include <QGraphicsView>
+#include <QHash>
+#include <QSet>
 
 class FSM;
+class State;
+class Transition;
+class StateItem;
+class TransitionItem;
+class ClusterItem;
 class DiagramViewModel;
 
 /**
@@ -75,6 +83,9 @@ public:
    * @brief Completely clears and rebuilds the graphical scene from the
    * ViewModel data. Use this when a bulk update (like parsing code) has
    * occurred.
+   *
+   * Single edits (including undo and redo) do not need this: the editor
+   * follows the FSM's add/remove signals and only touches the items involved.
    */
   void rebuildScene();
 
@@ -101,12 +112,56 @@ protected:
    */
   void wheelEvent(QWheelEvent *event) override;
 
+  /**
+   * @brief Finishes a drag: the states that were dragged are written to the
+   * model as one undoable move.
+   */
+  void mouseReleaseEvent(QMouseEvent *event) override;
+
 private:
+  // Incremental scene updates, driven by the FSM's signals
+  void addStateItem(State *state);
+  void removeStateItem(State *state);
+  void addTransitionItem(Transition *transition);
+  void removeTransitionItem(Transition *transition);
+  void moveStateItems(const QList<State *> &states);
+
+  // Edge routing: a moved state updates its rectangle in m_router, and only
+  // the transitions whose routes that invalidates are redrawn. Moves are
+  // collected and applied once per frame.
+  void stateItemMoved(StateItem *item);
+  void updateMovedItems();
+  void updateStateRect(StateItem *item);
+  void rerouteTransitions(const QList<Transition *> &transitions);
+  void commitDraggedStates();
+
+  // Switches between individual items and aggregated clusters depending on
+  // the zoom level; cheap when nothing needs to change
+  void updateLevelOfDetail();
+  void scheduleClusterUpdate();
+  void setItemsVisible(bool visible);
+
+  /// View scale below which states are drawn as clusters
+  static constexpr qreal ClusterScale = 0.05;
+  /// Approximate on-screen size of a cluster cell in pixels
+  static constexpr qreal ClusterCellPixels = 24.0;
+  /// Milliseconds between edge updates while states move (60 Hz)
+  static constexpr int FrameInterval = 16;
+
   QGraphicsScene *m_scene;
   DiagramViewModel *m_viewModel;
   FSM *m_fsm; // Direct access - will be phased out
   QGraphicsTextItem *m_welcomeText;
   QGraphicsTextItem *m_titleItem;
+  QHash<State *, StateItem *> m_stateItems;
+  QHash<Transition *, TransitionItem *> m_transitionItems;
+  EdgeRouter m_router;
+  QSet<StateItem *> m_movedItems;   ///< Moved since the last edge update
+  QSet<StateItem *> m_draggedItems; ///< Moved ahead of their State
+  bool m_routeUpdatePending;
+  ClusterItem *m_clusterItem;
+  qreal m_clusterCellSize; ///< Cell size of m_clusterItem, 0 if stale
+  bool m_clusterUpdatePending;
 
 signals:
   /**
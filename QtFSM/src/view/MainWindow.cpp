@@ -1,7 +1,14 @@
 #include "MainWindow.h"
 #include "../codegen/CodeGenerator.h"
+#include "../layout/ForceDirectedLayout.h"
+#include "../layout/LayeredLayout.h"
 #include "../model/FSM.h"
 #include "../parsing/CodeParser.h"
+#include "../parsing/DirectoryImporter.h"
+#include "../serialization/AsyncProjectSaver.h"
+#include "../serialization/Autosaver.h"
+#include "../serialization/BinarySerializer.h"
+#include "../serialization/EditJournal.h"
 #include "../serialization/JSONSerializer.h"
 #include "../viewmodel/DiagramViewModel.h"
 #include "AboutDialog.h"
@@ -11,29 +18,99 @@
 #include "StateItem.h"
 #include <QAction>
 #include <QApplication>
+#include <QCloseEvent>
+#include <QDateTime>
 #include <QDebug>
 #include <QDockWidget>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QFont>
+#include <QFutureWatcher>
 #include <QGraphicsItem>
+#include <QGraphicsScene>
 #include <QInputDialog>
 #include <QLabel>
+#include <QLocale>
 #include <QMenuBar>
 #include <QMessageBox>
+#include <QProgressDialog>
+#include <QPromise>
+#include <QSharedPointer>
 #include <QStatusBar>
 #include <QStyle>
 #include <QTextStream>
+#include <QThread>
+#include <QTimer>
 #include <QToolBar>
+#include <QUndoStack>
+#include <QtConcurrent>
+#include <atomic>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent), m_diagramEditor(nullptr), m_viewModel(nullptr),
-      m_propertiesPanel(nullptr), m_darkTheme(false) {
+      m_propertiesPanel(nullptr), m_projectSaver(nullptr),
+      m_autosaver(nullptr), m_journal(nullptr), m_autosaveTimer(nullptr),
+      m_forceLayout(nullptr), m_darkTheme(false) {
   setupUi();
   createActions();
   createMenus();
   createToolBars();
   createDockWidgets();
 
+  // Projects are written on the thread pool; the editor stays usable
+  m_projectSaver = new AsyncProjectSaver(this);
+  connect(m_projectSaver, &AsyncProjectSaver::saved, this,
+          [this](const QString &fileName) {
+            statusBar()->showMessage(tr("Project saved: %1").arg(fileName),
+                                     3000);
+          });
+  connect(m_projectSaver, &AsyncProjectSaver::saveFailed, this,
+          [this](const QString &fileName, const QString &error) {
+            QMessageBox::critical(this, tr("Save Failed"),
+                                  tr("Failed to save project to %1.\n%2")
+                                      .arg(fileName)
+                                      .arg(error));
+          });
+
+  // Crash recovery: periodic background copies of the open project
+  m_autosaver = new Autosaver(QString(), this);
+  connect(m_autosaver, &Autosaver::autosaveFailed, this,
+          [this](const QString &error) {
+            statusBar()->showMessage(tr("Autosave failed: %1").arg(error),
+                                     5000);
+          });
+  m_autosaveTimer = new QTimer(this);
+  m_autosaveTimer->setInterval(AutosaveInterval);
+  connect(m_autosaveTimer, &QTimer::timeout, this, &MainWindow::autosave);
+  m_autosaveTimer->start();
+  QTimer::singleShot(0, this, &MainWindow::recoverAutosaves);
+
+  // Journaled projects save by appending edits; compaction runs off-thread
+  m_journal = new EditJournal(this);
+  connect(m_journal, &EditJournal::compactionFailed, this,
+          [this](const QString &error) {
+            statusBar()->showMessage(
+                tr("Could not compact the project journal: %1").arg(error),
+                5000);
+          });
+
+  // Kept across exports so only edited states are generated again
+  m_codeGenerator = new CodeGenerator(this);
+
+  // Auto-layout runs on worker threads and streams positions into the model
+  m_forceLayout = new ForceDirectedLayout(this);
+  connect(m_forceLayout, &ForceDirectedLayout::finished, this,
+          [this](const QList<State *> &states, const QVector<QPointF> &from) {
+            // The states are already in place; record the move for undo
+            QVector<QPointF> to;
+            to.reserve(states.size());
+            for (State *state : states) {
+              to.append(state->position());
+            }
+            m_viewModel->moveStates(states, from, to);
+            statusBar()->showMessage(tr("Layout finished"), 3000);
+          });
+
   setWindowTitle("QtFSM Designer");
   resize(1400, 900);
 
@@ -46,6 +123,15 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow() {}
 
+void MainWindow::closeEvent(QCloseEvent *event) {
+  // Saves still being written must reach the disk before the process exits
+  m_autosaveTimer->stop();
+  m_forceLayout->cancel();
+  m_projectSaver->waitForFinished();
+  m_autosaver->discard();
+  QMainWindow::closeEvent(event);
+}
+
 void MainWindow::setupUi() {
   // Create central diagram editor
   m_diagramEditor = new DiagramEditor(this);
@@ -87,7 +173,8 @@ void MainWindow::createActions() {
   // Import JSON action
   m_importJsonAction = new QAction(tr("Import &JSON..."), this);
   m_importJsonAction->setShortcuts(QKeySequence::Open);
-  m_importJsonAction->setStatusTip(tr("Import FSM from JSON file"));
+  m_importJsonAction->setStatusTip(
+      tr("Import FSM from a JSON or binary project file"));
   connect(m_importJsonAction, &QAction::triggered, this,
           &MainWindow::importJson);
 
@@ -96,6 +183,13 @@ void MainWindow::createActions() {
   m_importCppAction->setStatusTip(tr("Import FSM from C++ code file"));
   connect(m_importCppAction, &QAction::triggered, this, &MainWindow::importCpp);
 
+  // Import C++ directory action
+  m_importCppDirAction = new QAction(tr("Import C++ &Directory..."), this);
+  m_importCppDirAction->setStatusTip(
+      tr("Import FSM from all C++ files in a directory"));
+  connect(m_importCppDirAction, &QAction::triggered, this,
+          &MainWindow::importCppDirectory);
+
   // Save action
   m_saveAction = new QAction(tr("&Save"), this);
   m_saveAction->setShortcuts(QKeySequence::Save);
@@ -142,6 +236,23 @@ void MainWindow::createActions() {
   connect(m_viewModel, &DiagramViewModel::undoRedoStateChanged, this,
           [this]() { m_redoAction->setEnabled(m_viewModel->canRedo()); });
 
+  // Auto layout action
+  m_autoLayoutAction = new QAction(tr("Auto &Layout"), this);
+  m_autoLayoutAction->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_L));
+  m_autoLayoutAction->setStatusTip(
+      tr("Arrange the states so that they do not overlap"));
+  connect(m_autoLayoutAction, &QAction::triggered, this,
+          &MainWindow::autoLayout);
+
+  // Layered layout action
+  m_layeredLayoutAction = new QAction(tr("La&yered Layout"), this);
+  m_layeredLayoutAction->setShortcut(
+      QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_L));
+  m_layeredLayoutAction->setStatusTip(
+      tr("Arrange the states in layers below the initial state"));
+  connect(m_layeredLayoutAction, &QAction::triggered, this,
+          &MainWindow::layeredLayout);
+
   // Toggle theme action
   m_toggleThemeAction = new QAction(tr("Dark Theme"), this);
   m_toggleThemeAction->setCheckable(true);
@@ -163,6 +274,7 @@ void MainWindow::createMenus() {
   fileMenu->addAction(m_newAction);
   fileMenu->addAction(m_importJsonAction);
   fileMenu->addAction(m_importCppAction);
+  fileMenu->addAction(m_importCppDirAction);
   fileMenu->addAction(m_saveAction);
   fileMenu->addSeparator();
   fileMenu->addAction(m_exportAction);
@@ -174,6 +286,9 @@ void MainWindow::createMenus() {
   QMenu *editMenu = menuBar()->addMenu(tr("&Edit"));
   editMenu->addAction(m_undoAction);
   editMenu->addAction(m_redoAction);
+  editMenu->addSeparator();
+  editMenu->addAction(m_autoLayoutAction);
+  editMenu->addAction(m_layeredLayoutAction);
 
   QMenu *viewMenu = menuBar()->addMenu(tr("&View"));
   viewMenu->addAction(m_toggleThemeAction);
@@ -249,8 +364,9 @@ void MainWindow::createDockWidgets() {
 
 void MainWindow::updateCodePreview() {
   if (m_diagramEditor && m_diagramEditor->fsm()) {
+    // Generated in the background; the preview fills in when it is done
     m_codePreviewPanel->updateCode(m_diagramEditor->fsm());
-    statusBar()->showMessage(tr("Code generated from FSM model"), 1000);
+    statusBar()->showMessage(tr("Generating code from FSM model"), 1000);
   } else {
     m_codePreviewPanel->clearCode();
   }
@@ -268,10 +384,12 @@ void MainWindow::newProject() {
   }
 
   // Create new FSM
+  m_forceLayout->cancel();
   FSM *fsm = new FSM(this);
   fsm->setName(fsmName);
   m_diagramEditor->setFSM(fsm);
   m_propertiesPanel->setFSM(fsm);
+  m_viewModel->setFSM(fsm);
 
   // Disable automatic updates for "Manual Mode"
   // connect(fsm, &FSM::modified, this, &MainWindow::updateCodePreview);
@@ -287,10 +405,13 @@ void MainWindow::newProject() {
 }
 
 void MainWindow::importJson() {
-  QString selectedFilter = tr("JSON Files (*.json)");
+  QString selectedFilter = tr("FSM Projects (*.json *.fsmb *.fsmj)");
   QString fileName = QFileDialog::getOpenFileName(
       this, tr("Import FSM from JSON"), "",
-      tr("JSON Files (*.json);;All Files (*)"), &selectedFilter);
+      tr("FSM Projects (*.json *.fsmb *.fsmj);;JSON Files (*.json);;"
+         "Binary FSM Projects (*.fsmb);;Journaled FSM Projects (*.fsmj);;"
+         "All Files (*)"),
+      &selectedFilter);
 
   if (fileName.isEmpty()) {
     return;
@@ -304,17 +425,33 @@ void MainWindow::importJson() {
     return;
   }
 
-  // Load JSON using JSONSerializer
-  JSONSerializer serializer;
-  FSM *loadedFsm = serializer.load(fileName);
+  // Binary projects are loaded straight from a memory mapping
+  FSM *loadedFsm = nullptr;
+  QString error;
+  if (BinarySerializer::isBinaryProject(fileName)) {
+    BinarySerializer serializer;
+    loadedFsm = serializer.load(fileName);
+    error = serializer.lastError();
+  } else if (EditJournal::isJournalProject(fileName)) {
+    // Base image plus replayed edits; later saves append to the log
+    loadedFsm = m_journal->open(fileName);
+    error = m_journal->lastError();
+  } else {
+    JSONSerializer serializer;
+    loadedFsm = serializer.load(fileName);
+    error = serializer.lastError();
+  }
 
   if (!loadedFsm) {
     QMessageBox::warning(this, tr("Error"),
-                         tr("Failed to load FSM from %1.").arg(fileName));
+                         tr("Failed to load FSM from %1.\n%2")
+                             .arg(fileName)
+                             .arg(error));
     return;
   }
 
   // Set loaded FSM to the editor
+  m_forceLayout->cancel();
   m_diagramEditor->setFSM(loadedFsm);
   m_propertiesPanel->setFSM(loadedFsm);
 
@@ -335,6 +472,31 @@ void MainWindow::importCpp() {
     return;
   }
 
+  // Large sources are parsed straight from a memory mapping. Loading them into
+  // the editor would copy the file twice and make every keystroke reparse it.
+  if (QFileInfo(fileName).size() > DirectImportSize) {
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    CodeParser parser;
+    FSM *fsm = parser.parseFile(fileName, this);
+    QApplication::restoreOverrideCursor();
+
+    if (!fsm) {
+      QMessageBox::warning(
+          this, tr("Import Failed"),
+          tr("Could not import %1:\n%2").arg(fileName).arg(parser.lastError()));
+      return;
+    }
+
+    showImportedFsm(fsm);
+    m_codePreviewPanel->clearCode();
+    statusBar()->showMessage(
+        tr("Imported %1 states from %2 (too large to show in the editor)")
+            .arg(fsm->states().count())
+            .arg(fileName),
+        5000);
+    return;
+  }
+
   QFile file(fileName);
   if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
     QMessageBox::warning(
@@ -354,6 +516,132 @@ void MainWindow::importCpp() {
       tr("C++ code loaded. Click 'Update Diagram' to parse."), 5000);
 }
 
+void MainWindow::importCppDirectory() {
+  QString directory = QFileDialog::getExistingDirectory(
+      this, tr("Import C++ Directory"), "");
+
+  if (directory.isEmpty()) {
+    return;
+  }
+
+  // The whole import runs on the thread pool, so the window keeps painting.
+  // The future always delivers its result, even when canceled, so the FSM
+  // cannot be lost; cancelling goes through a flag the importer polls.
+  using Import = QPair<DirectoryImporter, FSM *>;
+  auto canceled = QSharedPointer<std::atomic<bool>>::create(false);
+  auto *watcher = new QFutureWatcher<Import>(this);
+  auto *progress = new QProgressDialog(tr("Importing %1...").arg(directory),
+                                       tr("Cancel"), 0, 0, this);
+  progress->setWindowModality(Qt::WindowModal);
+  progress->setMinimumDuration(300);
+  // The total grows once the classes are known; keep the dialog up until
+  // the import is done
+  progress->setAutoReset(false);
+  progress->setAutoClose(false);
+  connect(progress, &QProgressDialog::canceled, this,
+          [canceled]() { *canceled = true; });
+  connect(watcher, &QFutureWatcher<Import>::progressRangeChanged, progress,
+          &QProgressDialog::setRange);
+  connect(watcher, &QFutureWatcher<Import>::progressValueChanged, progress,
+          &QProgressDialog::setValue);
+  connect(watcher, &QFutureWatcher<Import>::finished, this,
+          [this, watcher, progress, directory, canceled]() {
+            progress->deleteLater();
+            watcher->deleteLater();
+            m_importCppDirAction->setEnabled(true);
+
+            const Import result = watcher->result();
+            const DirectoryImporter &importer = result.first;
+            FSM *fsm = result.second;
+            if (*canceled) {
+              delete fsm;
+              statusBar()->showMessage(tr("Import canceled"), 3000);
+              return;
+            }
+            if (!fsm) {
+              QMessageBox::warning(this, tr("Import Failed"),
+                                   tr("Could not import %1:\n%2")
+                                       .arg(directory)
+                                       .arg(importer.lastError()));
+              return;
+            }
+
+            fsm->setParent(this);
+            showImportedFsm(fsm);
+            statusBar()->showMessage(
+                tr("Imported %1 states from %2 files (%3 classes, %4 "
+                   "skipped)")
+                    .arg(fsm->states().count())
+                    .arg(importer.fileCount())
+                    .arg(importer.classCount())
+                    .arg(importer.warnings().size()),
+                5000);
+
+            if (!importer.warnings().isEmpty()) {
+              QMessageBox box(QMessageBox::Warning, tr("Import Warnings"),
+                              tr("%n file(s) or class(es) could not be "
+                                 "imported and were skipped.",
+                                 "", int(importer.warnings().size())),
+                              QMessageBox::Ok, this);
+              box.setDetailedText(importer.warnings().join('\n'));
+              box.exec();
+            }
+          });
+
+  m_importCppDirAction->setEnabled(false);
+  QThread *guiThread = thread();
+  watcher->setFuture(QtConcurrent::run(
+      [directory, canceled, guiThread](QPromise<Import> &promise) {
+        DirectoryImporter importer;
+        FSM *fsm = importer.importDirectory(
+            directory, nullptr, [&promise, canceled](int done, int total) {
+              promise.setProgressRange(0, total);
+              promise.setProgressValue(done);
+              return !canceled->load();
+            });
+        if (fsm) {
+          // Created on this thread; hand it and its states to the GUI
+          fsm->moveToThread(guiThread);
+        }
+        promise.addResult(Import(importer, fsm));
+      }));
+}
+
+void MainWindow::showImportedFsm(FSM *fsm) {
+  // Fresh Grid Layout
+  QList<State *> states = fsm->states();
+  int cols = qCeil(qSqrt(states.count()));
+  int spacing = 300;
+  for (int i = 0; i < states.count(); ++i) {
+    states[i]->setPosition(QPointF((i % cols) * spacing, (i / cols) * spacing));
+  }
+
+  replaceFsm(fsm);
+  m_currentFile.clear();
+  setWindowTitle(QString("QtFSM Designer - %1").arg(fsm->name()));
+
+  // The grid only spreads the states out; arrange them by their transitions
+  autoLayout();
+}
+
+void MainWindow::replaceFsm(FSM *fsm) {
+  m_forceLayout->cancel();
+
+  FSM *oldFsm = m_diagramEditor->fsm();
+  m_diagramEditor->setFSM(fsm);
+  m_propertiesPanel->setFSM(fsm);
+  m_viewModel->setFSM(fsm);
+
+  // Window title sync
+  connect(fsm, &FSM::nameChanged, this, [this](const QString &name) {
+    setWindowTitle(QString("QtFSM Designer - %1").arg(name));
+  });
+
+  if (oldFsm && oldFsm != fsm) {
+    oldFsm->deleteLater();
+  }
+}
+
 void MainWindow::saveProject() {
   FSM *fsm = m_diagramEditor->fsm();
 
@@ -369,16 +657,14 @@ void MainWindow::saveProject() {
     return;
   }
 
-  // Save using JSONSerializer
-  JSONSerializer serializer;
-  if (!serializer.save(fsm, m_currentFile)) {
-    QMessageBox::critical(
-        this, tr("Save Failed"),
-        tr("Failed to save project to %1.").arg(m_currentFile));
+  if (EditJournal::isJournalProject(m_currentFile)) {
+    saveJournaledProject(fsm, m_currentFile);
     return;
   }
 
-  statusBar()->showMessage(tr("Project saved: %1").arg(m_currentFile), 3000);
+  // Snapshot now, write in the background; saved()/saveFailed() report back
+  m_projectSaver->save(fsm, m_currentFile);
+  statusBar()->showMessage(tr("Saving %1...").arg(m_currentFile));
 }
 
 void MainWindow::saveAsProject() {
@@ -391,30 +677,61 @@ void MainWindow::saveAsProject() {
   }
 
   // Always ask for a file path (this is "Save As")
+  const QString binaryFilter = tr("Binary FSM Projects (*.fsmb)");
+  const QString journalFilter = tr("Journaled FSM Projects (*.fsmj)");
+  QString selectedFilter;
   QString fileName = QFileDialog::getSaveFileName(
       this, tr("Save FSM Project As"), "",
-      tr("FSM Project Files (*.json);;All Files (*)"));
+      tr("FSM Project Files (*.json);;%1;;%2;;All Files (*)")
+          .arg(binaryFilter)
+          .arg(journalFilter),
+      &selectedFilter);
 
   if (fileName.isEmpty()) {
     return;
   }
 
-  // Ensure .json extension
-  if (!fileName.endsWith(".json", Qt::CaseInsensitive)) {
-    fileName += ".json";
+  // Ensure a project extension, .json unless another format was picked
+  if (!fileName.endsWith(".json", Qt::CaseInsensitive) &&
+      !BinarySerializer::isBinaryProject(fileName) &&
+      !EditJournal::isJournalProject(fileName)) {
+    if (selectedFilter == binaryFilter) {
+      fileName += ".fsmb";
+    } else if (selectedFilter == journalFilter) {
+      fileName += ".fsmj";
+    } else {
+      fileName += ".json";
+    }
   }
 
-  // Save using JSONSerializer
-  JSONSerializer serializer;
-  if (!serializer.save(fsm, fileName)) {
-    QMessageBox::critical(this, tr("Save Failed"),
-                          tr("Failed to save project to %1.").arg(fileName));
+  if (EditJournal::isJournalProject(fileName)) {
+    m_currentFile = fileName;
+    saveJournaledProject(fsm, fileName);
     return;
   }
 
-  // Update current file
+  // Update current file; a failed save is reported by saveFailed()
   m_currentFile = fileName;
-  statusBar()->showMessage(tr("Project saved: %1").arg(m_currentFile), 3000);
+  m_projectSaver->save(fsm, m_currentFile);
+  statusBar()->showMessage(tr("Saving %1...").arg(m_currentFile));
+}
+
+void MainWindow::saveJournaledProject(FSM *fsm, const QString &fileName) {
+  const bool tracked =
+      m_journal->fsm() == fsm && m_journal->filePath() == fileName;
+  if (!(tracked ? m_journal->flush() : m_journal->create(fsm, fileName))) {
+    QMessageBox::critical(this, tr("Save Failed"),
+                          tr("Failed to save project to %1.\n%2")
+                              .arg(fileName)
+                              .arg(m_journal->lastError()));
+    return;
+  }
+
+  // Fold the log into a new base image once it outgrows the old one
+  if (m_journal->needsCompaction()) {
+    m_journal->compact();
+  }
+  statusBar()->showMessage(tr("Project saved: %1").arg(fileName), 3000);
 }
 
 void MainWindow::exportCpp() {
@@ -435,8 +752,7 @@ void MainWindow::exportCpp() {
   }
 
   // Generate C++ code
-  CodeGenerator generator;
-  QString code = generator.generate(m_diagramEditor->fsm());
+  QString code = m_codeGenerator->generate(m_diagramEditor->fsm());
 
   // Write to file
   QFile file(fileName);
@@ -512,64 +828,57 @@ void MainWindow::updateDiagramFromCode() {
     return;
   }
 
-  // Parse code
-  CodeParser parser;
-  FSM *newFsm = parser.parse(code, this);
+  FSM *fsm = m_diagramEditor->fsm();
+  bool freshFsm = !fsm;
+  if (freshFsm) {
+    fsm = new FSM(this);
+  }
 
-  if (!newFsm) {
+  // Parse code. Only the classes touched since the last update are
+  // reparsed, and the FSM is updated in place: untouched states keep their
+  // identity and position, so no migration by name is needed.
+  if (!m_incrementalParser.update(fsm, code)) {
     QMessageBox::warning(
         this, tr("Parsing Failed"),
-        tr("Could not parse code:\n%1").arg(parser.lastError()));
+        tr("Could not parse code:\n%1").arg(m_incrementalParser.lastError()));
+    if (freshFsm) {
+      delete fsm;
+    }
     return;
   }
 
-  // Preserve FSM name if not found in code
-  if (newFsm->name().isEmpty() && m_diagramEditor->fsm()) {
-    newFsm->setName(m_diagramEditor->fsm()->name());
+  // Removed states are deleted later; undo commands may still point at them
+  if (!freshFsm && m_incrementalParser.removedStateCount() > 0) {
+    m_viewModel->undoStack()->clear();
   }
 
-  // Switch FSM
-  // Note: Old FSM memory management depends on ownership policy.
-  // They are children of MainWindow so they will be eventually deleted,
-  // but good practice to delete old one if we replace it.
-  FSM *oldFsm = m_diagramEditor->fsm();
-
-  m_diagramEditor->setFSM(newFsm);
+  QList<State *> states = fsm->states();
+  QList<State *> addedStates = m_incrementalParser.addedStates();
+  QSet<State *> added(addedStates.cbegin(), addedStates.cend());
 
-  // 1. Capture old positions
-  QMap<QString, QPointF> oldPositions;
+  // 1. Look at the states that already had a position
   QRectF bounds;
-  if (m_diagramEditor->fsm()) {
-    for (State *s : m_diagramEditor->fsm()->states()) {
-      oldPositions.insert(s->name(), s->position());
-      // Track bounds to know where to put new stuff
-      if (bounds.isNull())
-        bounds = QRectF(s->position(), QSizeF(10, 10));
-      else
-        bounds = bounds.united(QRectF(s->position(), QSizeF(100, 100)));
-    }
-  }
-
-  // 2. Apply positions to new FSM
-  QList<State *> states = newFsm->states();
-
-  // Check how many we can preserve and if they are overlapping
-  int preservedCount = 0;
   QSet<QString>
       distinctPositions; // Use string representation of point to check overlap
   bool hasOverlap = false;
-
   for (State *s : states) {
-    if (oldPositions.contains(s->name())) {
-      preservedCount++;
-      QPointF pos = oldPositions.value(s->name());
-      QString posKey = QString("%1,%2").arg(pos.x()).arg(pos.y());
-      if (distinctPositions.contains(posKey)) {
-        hasOverlap = true;
-      }
-      distinctPositions.insert(posKey);
+    if (added.contains(s)) {
+      continue;
+    }
+    QPointF pos = s->position();
+    // Track bounds to know where to put new stuff
+    if (bounds.isNull())
+      bounds = QRectF(pos, QSizeF(10, 10));
+    else
+      bounds = bounds.united(QRectF(pos, QSizeF(100, 100)));
+
+    QString posKey = QString("%1,%2").arg(pos.x()).arg(pos.y());
+    if (distinctPositions.contains(posKey)) {
+      hasOverlap = true;
     }
+    distinctPositions.insert(posKey);
   }
+  int preservedCount = states.count() - added.count();
 
   // Strategy:
   // 1. Fresh Import (preservedCount == 0) -> GRID
@@ -592,40 +901,43 @@ void MainWindow::updateDiagramFromCode() {
         tr("Diagram updated: Fresh Grid Layout applied (%1 states)")
             .arg(states.count()));
   } else {
-    // Preserve + Append
+    // Preserve + Append: new states are placed to the right
     double nextX = bounds.isNull() ? 0 : bounds.right() + 300;
     double nextY = bounds.isNull() ? 0 : bounds.top();
 
-    for (int i = 0; i < states.count(); ++i) {
-      State *s = states[i];
-      if (oldPositions.contains(s->name())) {
-        s->setPosition(oldPositions.value(s->name()));
-      } else {
-        // New state found! Place it to the right
-        s->setPosition(QPointF(nextX, nextY));
-        nextX += 300;
-      }
+    for (State *s : std::as_const(addedStates)) {
+      s->setPosition(QPointF(nextX, nextY));
+      nextX += 300;
     }
-    statusBar()->showMessage(tr("Diagram updated: Layout Preserved (%1 states)")
-                                 .arg(states.count()));
+    statusBar()->showMessage(
+        tr("Diagram updated: Layout Preserved (%1 states, %2 classes "
+           "reparsed)")
+            .arg(states.count())
+            .arg(m_incrementalParser.reparsedClassCount()));
   }
 
-  // Switch FSM (DiagramEditor will handle scene rebuild safe and clean)
-  m_diagramEditor->setFSM(newFsm);
-  m_propertiesPanel->setFSM(newFsm); // Connect properties panel
-
-  // Window title sync
-  connect(newFsm, &FSM::nameChanged, this, [this](const QString &name) {
-    setWindowTitle(QString("QtFSM Designer - %1").arg(name));
-  });
-  setWindowTitle(QString("QtFSM Designer - %1").arg(newFsm->name()));
+  // An FSM that is already shown has updated its scene items through the
+  // model signals while the parser edited it
+  ParseStats &stats = m_incrementalParser.stats();
+  if (freshFsm) {
+    ParseStageTimer timer(stats, ParseStats::SceneRebuild);
+    m_diagramEditor->setFSM(fsm);
+    m_propertiesPanel->setFSM(fsm); // Connect properties panel
+    m_viewModel->setFSM(fsm);       // Undo steps apply to this FSM
+
+    // Window title sync
+    connect(fsm, &FSM::nameChanged, this, [this](const QString &name) {
+      setWindowTitle(QString("QtFSM Designer - %1").arg(name));
+    });
+  }
+  if (m_logStats) {
+    qInfo().noquote() << "Diagram update from code:\n" + stats.report();
+  }
 
-  // Manual Mode: No auto-connect
-  // connect(newFsm, &FSM::modified, this, &MainWindow::updateCodePreview);
+  setWindowTitle(QString("QtFSM Designer - %1").arg(fsm->name()));
 
-  // Delete old FSM if it existed
-  if (oldFsm) {
-    oldFsm->deleteLater();
+  if (useGridLayout) {
+    autoLayout();
   }
 }
 
@@ -781,3 +1093,82 @@ void MainWindow::showAbout() {
   AboutDialog dialog(this);
   dialog.exec();
 }
+
+void MainWindow::autoLayout() {
+  FSM *fsm = m_diagramEditor->fsm();
+  if (!fsm || fsm->states().count() < 2) {
+    return;
+  }
+  m_forceLayout->start(fsm);
+  statusBar()->showMessage(
+      tr("Arranging %1 states...").arg(fsm->states().count()));
+}
+
+void MainWindow::layeredLayout() {
+  FSM *fsm = m_diagramEditor->fsm();
+  if (!fsm || fsm->states().count() < 2) {
+    return;
+  }
+  // Puts back the states a running force layout has moved, so the
+  // positions captured below are the ones the user had
+  m_forceLayout->cancel();
+
+  QList<State *> states;
+  const LayoutGraph graph = LayoutGraph::capture(fsm, &states);
+  State *initial = fsm->initialState();
+  if (!initial) {
+    for (State *state : std::as_const(states)) {
+      if (state->isInitial()) {
+        initial = state;
+        break;
+      }
+    }
+  }
+
+  const QVector<QPointF> positions = LayeredLayout::run(
+      graph, states.indexOf(initial), LayeredLayout::Options());
+  m_viewModel->moveStates(states, graph.positions, positions);
+  statusBar()->showMessage(
+      tr("Layered layout applied (%1 states)").arg(states.count()), 3000);
+}
+
+void MainWindow::autosave() { m_autosaver->autosave(m_diagramEditor->fsm()); }
+
+void MainWindow::recoverAutosaves() {
+  // Newest first; once one project is restored the rest wait for next time
+  const QStringList files = m_autosaver->recoverableFiles();
+  for (const QString &file : files) {
+    const QString time = QLocale().toString(QFileInfo(file).lastModified(),
+                                            QLocale::ShortFormat);
+    const QMessageBox::StandardButton answer = QMessageBox::question(
+        this, tr("Recover Project"),
+        tr("QtFSM Designer did not exit cleanly.\n\nRestore the project "
+           "autosaved at %1?")
+            .arg(time),
+        QMessageBox::Yes | QMessageBox::No);
+
+    FSM *recoveredFsm = nullptr;
+    if (answer == QMessageBox::Yes) {
+      BinarySerializer serializer;
+      recoveredFsm = serializer.load(file);
+      if (!recoveredFsm) {
+        QMessageBox::warning(this, tr("Error"),
+                             tr("Failed to recover the project.\n%1")
+                                 .arg(serializer.lastError()));
+      }
+    }
+    Autosaver::removeRecoveryFile(file);
+
+    if (recoveredFsm) {
+      recoveredFsm->setParent(this);
+      replaceFsm(recoveredFsm);
+
+      // Not saved anywhere yet
+      m_currentFile.clear();
+      setWindowTitle(
+          QString("QtFSM Designer - %1").arg(recoveredFsm->name()));
+      statusBar()->showMessage(tr("Recovered autosaved project"), 3000);
+      return;
+    }
+  }
+}
@@ -1,12 +1,19 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include "../parsing/IncrementalParser.h"
 #include <QMainWindow>
 
 class DiagramEditor;
 class PropertiesPanel;
 class CodePreviewPanel;
 class DiagramViewModel;
+class AsyncProjectSaver;
+class Autosaver;
+class EditJournal;
+class ForceDirectedLayout;
+class CodeGenerator;
+class QTimer;
 
 /**
  * @brief The MainWindow class is the primary container for the entire
@@ -33,6 +40,20 @@ public:
    */
   ~MainWindow();
 
+  /**
+   * @brief Logs the import pipeline's timings and counters after every
+   * diagram update from code (the `--stats` command line option).
+   * @param enabled True to log the stats.
+   */
+  void setStatsLoggingEnabled(bool enabled) { m_logStats = enabled; }
+
+protected:
+  /**
+   * @brief Finishes pending saves and removes the recovery file on a clean
+   * exit.
+   */
+  void closeEvent(QCloseEvent *event) override;
+
 private:
   /**
    * @brief Sets up the initial UI layout.
@@ -75,6 +96,11 @@ private slots:
    */
   void importCpp();
 
+  /**
+   * @brief Imports every C++ file below a directory into one FSM.
+   */
+  void importCppDirectory();
+
   /**
    * @brief Saves the current project to a JSON file.
    */
@@ -116,6 +142,28 @@ private slots:
    */
   void showAbout();
 
+  /**
+   * @brief Arranges the current FSM with the force-directed layout, which
+   * runs in the background and moves the states as it converges.
+   */
+  void autoLayout();
+
+  /**
+   * @brief Arranges the current FSM in layers flowing down from the initial
+   * state, as a single undoable step.
+   */
+  void layeredLayout();
+
+  /**
+   * @brief Writes the current FSM to the crash-recovery file if it changed.
+   */
+  void autosave();
+
+  /**
+   * @brief Offers to restore projects autosaved by instances that crashed.
+   */
+  void recoverAutosaves();
+
 private:
   /**
    * @brief Applies the selected color theme (Light/Dark) to the application
@@ -123,6 +171,34 @@ private:
    */
   void applyTheme();
 
+  /**
+   * @brief Lays out a freshly imported FSM on a grid and makes it the current
+   * one, replacing (and deleting) the previous FSM.
+   */
+  void showImportedFsm(FSM *fsm);
+
+  /**
+   * @brief Makes an FSM the current one and deletes the previous FSM.
+   *
+   * A running auto-layout is cancelled first, so it does not keep writing
+   * into the FSM that is going away.
+   */
+  void replaceFsm(FSM *fsm);
+
+  /**
+   * @brief Saves a journaled (.fsmj) project: appends the edits since the
+   * last save if the journal already tracks this FSM and file, otherwise
+   * writes a new project.
+   */
+  void saveJournaledProject(FSM *fsm, const QString &fileName);
+
+  /// Files above this size are imported directly instead of being loaded
+  /// into the code editor first.
+  static constexpr qint64 DirectImportSize = 8 * 1024 * 1024;
+
+  /// Milliseconds between crash-recovery autosaves.
+  static constexpr int AutosaveInterval = 60 * 1000;
+
   // Central widget
   DiagramEditor *m_diagramEditor; ///< The central canvas for drawing the FSM.
 
@@ -140,17 +216,31 @@ private:
   QAction *m_newAction;
   QAction *m_importJsonAction;
   QAction *m_importCppAction;
+  QAction *m_importCppDirAction;
   QAction *m_saveAction;
   QAction *m_exportAction;
   QAction *m_exportJsonAction;
   QAction *m_exitAction;
   QAction *m_undoAction;
   QAction *m_redoAction;
+  QAction *m_autoLayoutAction;
+  QAction *m_layeredLayoutAction;
   QAction *m_toggleThemeAction;
   QAction *m_aboutAction;
 
+  IncrementalParser
+      m_incrementalParser; ///< Keeps the diagram in sync with edited code.
+
+  AsyncProjectSaver *m_projectSaver; ///< Writes Save/Save As in the background.
+  Autosaver *m_autosaver;            ///< Keeps the crash-recovery file.
+  EditJournal *m_journal;            ///< Edit log of the open .fsmj project.
+  QTimer *m_autosaveTimer;           ///< Drives autosave().
+  ForceDirectedLayout *m_forceLayout; ///< Background auto-layout.
+  CodeGenerator *m_codeGenerator; ///< Export; caches unchanged states.
+
   QString m_currentFile; ///< The currently open project file path.
   bool m_darkTheme;      ///< True if dark theme is currently active.
+  bool m_logStats = false; ///< Log ParseStats after each update from code.
 };
 
 #endif // MAINWINDOW_H
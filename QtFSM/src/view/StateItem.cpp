@@ -7,6 +7,13 @@
 #include <QGraphicsSceneMouseEvent>
 #include <QCursor>
 
+namespace {
+// Level of detail (screen pixels per scene unit) below which the
+// decorations are dropped; a state is 120 units wide
+constexpr qreal TextLod = 0.4;   // Name below ~48 px is unreadable
+constexpr qreal ShapeLod = 0.15; // Below ~18 px a plain rect looks the same
+} // namespace
+
 StateItem::StateItem(State *state, QGraphicsItem *parent)
     : QGraphicsItem(parent)
     , m_state(state)
@@ -16,12 +23,21 @@ StateItem::StateItem(State *state, QGraphicsItem *parent)
     setFlag(QGraphicsItem::ItemSendsGeometryChanges);
     setCursor(Qt::OpenHandCursor);
     
+    // Moving a state only translates its cached pixmap; it is re-rendered
+    // when its look changes (update()) or the zoom level does
+    setCacheMode(QGraphicsItem::DeviceCoordinateCache);
+    
     // Connect to state changes
     if (m_state) {
         connect(m_state, &State::nameChanged, this, [this]() { update(); });
         connect(m_state, &State::initialChanged, this, [this]() { update(); });
         connect(m_state, &State::finalChanged, this, [this]() { update(); });
         
+        // Follow positions written by the model (auto-layout, undo); setting
+        // the position we just reported back is a no-op
+        connect(m_state, &State::positionChanged, this,
+                [this](const QPointF &pos) { setPos(pos); });
+        
         // Set initial position from model
         setPos(m_state->position());
     }
@@ -43,16 +59,28 @@ void StateItem::addTransitionItem(TransitionItem *item)
     }
 }
 
+void StateItem::removeTransitionItem(TransitionItem *item)
+{
+    m_connectedTransitions.removeOne(item);
+}
+
+QList<TransitionItem *> StateItem::transitionItems() const
+{
+    return m_connectedTransitions;
+}
+
 QRectF StateItem::boundingRect() const
 {
-    return QRectF(-60, -40, 120, 80);
+    // Half of the widest border pen (3.5) on every side, and the shadow's
+    // 3 px offset to the bottom right
+    return outlineRect().adjusted(-2, -2, 4, 4);
 }
 
 void StateItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
 {
     Q_UNUSED(widget);
     
-    painter->setRenderHint(QPainter::Antialiasing);
+    const qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
     
     // Determine colors based on state type
     QColor fillColor = Qt::white;
@@ -77,18 +105,31 @@ void StateItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
         borderWidth = 3.5;
     }
     
+    // Far zoomed out: a plain, aliased rect with a hairline border
+    if (lod < ShapeLod) {
+        painter->setRenderHint(QPainter::Antialiasing, false);
+        painter->setPen(QPen(borderColor, 0));
+        painter->setBrush(fillColor);
+        painter->drawRect(outlineRect());
+        return;
+    }
+    
+    painter->setRenderHint(QPainter::Antialiasing);
+    
     // Shadow effect
-    painter->setPen(Qt::NoPen);
-    painter->setBrush(QColor(0, 0, 0, 30));
-    painter->drawRoundedRect(boundingRect().adjusted(3, 3, 3, 3), 12, 12);
+    if (lod >= TextLod) {
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(QColor(0, 0, 0, 30));
+        painter->drawRoundedRect(outlineRect().adjusted(3, 3, 3, 3), 12, 12);
+    }
     
     // Main state rectangle
     painter->setPen(QPen(borderColor, borderWidth));
     painter->setBrush(fillColor);
-    painter->drawRoundedRect(boundingRect(), 12, 12);
+    painter->drawRoundedRect(outlineRect(), 12, 12);
     
     // Draw state name
-    if (m_state) {
+    if (m_state && lod >= TextLod) {
         painter->setPen(Qt::black);
         QFont font = painter->font();
         font.setPointSize(11);
@@ -96,7 +137,7 @@ void StateItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
         painter->setFont(font);
         
         QString displayName = m_state->name().isEmpty() ? "State" : m_state->name();
-        painter->drawText(boundingRect().adjusted(5, -20, -5, 20), 
+        painter->drawText(outlineRect().adjusted(5, -20, -5, 20), 
                          Qt::AlignCenter, displayName);
         
         // Draw initial/final indicators
@@ -107,12 +148,12 @@ void StateItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
         
         if (m_state->isInitial()) {
             painter->setPen(QColor(0, 100, 0));
-            painter->drawText(boundingRect().adjusted(5, 15, -5, -5), 
+            painter->drawText(outlineRect().adjusted(5, 15, -5, -5), 
                             Qt::AlignCenter, "[Initial]");
         }
         if (m_state->isFinal()) {
             painter->setPen(QColor(150, 0, 0));
-            painter->drawText(boundingRect().adjusted(5, 15, -5, -5), 
+            painter->drawText(outlineRect().adjusted(5, 15, -5, -5), 
                             Qt::AlignCenter, "[Final]");
         }
     }
@@ -121,14 +162,9 @@ void StateItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
 QVariant StateItem::itemChange(GraphicsItemChange change, const QVariant &value)
 {
     if (change == ItemPositionHasChanged && m_state) {
-        // Update model position when item moves
-        m_state->setPosition(value.toPointF());
-        // qDebug() << "StateItem moved: " << m_state->name() << " to " << value.toPointF();
-        
-        // Notify transitions
-        for (TransitionItem *item : m_connectedTransitions) {
-            item->updatePosition();
-        }
+        // The editor reroutes the transitions this move affects and writes
+        // the position to the model when a drag ends
+        emit moved();
     }
     return QGraphicsItem::itemChange(change, value);
 }
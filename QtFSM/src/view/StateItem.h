@@ -14,8 +14,9 @@ class TransitionItem;
  * corresponding to a @ref State.
  *
  * It handles rendering the circle/oval shape, displaying the state name, and
- * processing mouse input for selection and movement. It maintains a list of
- * connected @ref TransitionItem objects to update them when the state moves.
+ * processing mouse input for selection and movement. It keeps a list of the
+ * connected @ref TransitionItem objects and reports its moves with moved(),
+ * so the editor can reroute the transitions affected.
  *
  * @ingroup View
  */
@@ -38,10 +39,17 @@ public:
 
   /**
    * @brief Returns the bounding rectangle for this item.
+   * Covers the outline plus the border pen and drop shadow.
    * @return QRectF defining the paintable area.
    */
   QRectF boundingRect() const override;
 
+  /**
+   * @brief Returns the state's rectangle in item coordinates, without the
+   * border and shadow. Transitions attach to its edges.
+   */
+  static QRectF outlineRect() { return QRectF(-60, -40, 120, 80); }
+
   /**
    * @brief Paints the state item (circle, text, selection highlight).
    * @param painter The painter to use.
@@ -59,12 +67,27 @@ public:
 
   /**
    * @brief Registers a connected TransitionItem.
-   * This is used to notify transitions when this state moves so they can
-   * redraw.
    * @param item Pointer to the TransitionItem.
    */
   void addTransitionItem(TransitionItem *item);
 
+  /**
+   * @brief Stops updating a transition item when this state moves.
+   * @param item The transition visual that is being removed.
+   */
+  void removeTransitionItem(TransitionItem *item);
+
+  /**
+   * @brief Gets the transition visuals attached to this state.
+   */
+  QList<TransitionItem *> transitionItems() const;
+
+signals:
+  /**
+   * @brief Emitted after the item has moved on the scene.
+   */
+  void moved();
+
 protected:
   /**
    * @brief Handles property changes (like position changes).
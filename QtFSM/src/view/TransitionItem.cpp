@@ -1,9 +1,30 @@
 #include "TransitionItem.h"
 #include "StateItem.h"
+#include "../layout/EdgeRouter.h"
 #include "../model/Transition.h"
+#include <QFontMetrics>
 #include <QPainter>
 #include <QtMath>
 #include <QPen>
+#include <QStyleOptionGraphicsItem>
+
+namespace {
+// Level of detail below which edges are drawn as hairlines without
+// arrowheads or labels; matches the point where state names disappear
+constexpr qreal DetailLod = 0.4;
+
+// The one font labels are measured and drawn with, whatever font the
+// painter comes with
+const QFont &labelFont()
+{
+    static const QFont font = [] {
+        QFont f;
+        f.setPointSize(9);
+        return f;
+    }();
+    return font;
+}
+} // namespace
 
 TransitionItem::TransitionItem(Transition *transition, StateItem *source, StateItem *target, QGraphicsItem *parent)
     : QGraphicsItem(parent)
@@ -25,48 +46,27 @@ void TransitionItem::updatePosition()
 
     prepareGeometryChange();
     
-    // Calculate centers
-    QPointF sourceCenter = m_sourceItem->scenePos();
-    QPointF targetCenter = m_targetItem->scenePos();
-    
-    QLineF centerLine(sourceCenter, targetCenter);
+    // Straight line between the borders; the border point is found directly
+    // from the direction instead of intersecting all four sides
+    QRectF sourceRect = m_sourceItem->mapRectToScene(StateItem::outlineRect());
+    QRectF targetRect = m_targetItem->mapRectToScene(StateItem::outlineRect());
     
-    // Calculate intersection points with borders
-    // We map the state's rect to scene to get scene rect
-    QRectF sourceRect = m_sourceItem->mapToScene(m_sourceItem->boundingRect()).boundingRect();
-    QRectF targetRect = m_targetItem->mapToScene(m_targetItem->boundingRect()).boundingRect();
-    
-    m_sourcePoint = getIntersectionPoint(centerLine, sourceRect);
-    m_targetPoint = getIntersectionPoint(QLineF(targetCenter, sourceCenter), targetRect);
+    m_points = {EdgeRouter::borderPoint(sourceRect, targetRect.center()),
+                EdgeRouter::borderPoint(targetRect, sourceRect.center())};
     
     calculatePath();
 }
 
-// Helper to find intersection between a line (from center) and a rect
-QPointF TransitionItem::getIntersectionPoint(const QLineF &line, const QRectF &rect) const
+void TransitionItem::setRoute(const QVector<QPointF> &route)
 {
-    QPointF intersection;
-    
-    // Define the 4 lines of the rect
-    QList<QLineF> borders;
-    borders << QLineF(rect.topLeft(), rect.topRight());
-    borders << QLineF(rect.topRight(), rect.bottomRight());
-    borders << QLineF(rect.bottomRight(), rect.bottomLeft());
-    borders << QLineF(rect.bottomLeft(), rect.topLeft());
-    
-    QPointF p1 = line.p1();
-    QPointF p2 = line.p2();
-    QLineF polyLine(p1, p2);
-
-    for (const QLineF &border : borders) {
-        // We use BoundedIntersection because we only care if it hits the rect border
-        if (polyLine.intersects(border, &intersection) == QLineF::BoundedIntersection) {
-            return intersection;
-        }
+    if (route.size() < 2 || m_sourceItem == m_targetItem) {
+        updatePosition();
+        return;
     }
     
-    // Fallback if inside or error
-    return line.p1();
+    prepareGeometryChange();
+    m_points = route;
+    calculatePath();
 }
 
 void TransitionItem::calculatePath()
@@ -75,41 +75,65 @@ void TransitionItem::calculatePath()
     
     // If self-transition (Source == Target)
     if (m_sourceItem == m_targetItem) {
-        QRectF rect = m_sourceItem->mapToScene(m_sourceItem->boundingRect()).boundingRect();
-        QPointF topLeft = rect.topLeft();
+        QRectF rect = m_sourceItem->mapRectToScene(StateItem::outlineRect());
         
         // Loop on the top-left corner
         m_path.moveTo(rect.right() - 20, rect.top());
         m_path.cubicTo(rect.right() + 40, rect.top() - 60,
                        rect.right() + 80, rect.top() + 40,
                        rect.right(), rect.top() + 20);
-        return;
+    } else {
+        // Straight line or routed polyline between borders
+        m_path.moveTo(m_points.first());
+        for (int i = 1; i < m_points.size(); ++i) {
+            m_path.lineTo(m_points[i]);
+        }
     }
     
-    // Straight line between borders
-    m_path.moveTo(m_sourcePoint);
-    m_path.lineTo(m_targetPoint);
+    // Arrowhead (10 px) plus half of the selected pen; kept tight so that
+    // moving a state only repaints the area its edges really cover
+    m_boundingRect = m_path.controlPointRect().adjusted(-12, -12, 12, 12);
+    
+    // Label text, centered on the path; paint() draws it in this rect
+    m_labelRect = QRectF();
+    if (m_transition && !m_transition->event().isEmpty()) {
+        QFontMetrics fm(labelFont());
+        QPointF mid = m_path.pointAtPercent(0.5);
+        int textWidth = fm.horizontalAdvance(m_transition->event());
+        int textHeight = fm.height();
+        m_labelRect = QRectF(mid.x() - textWidth / 2.0, mid.y() - textHeight / 2.0,
+                             textWidth, textHeight);
+        m_boundingRect |= m_labelRect.adjusted(-6, -6, 6, 2);
+    }
 }
 
 QRectF TransitionItem::boundingRect() const
 {
-    if (m_sourceItem == m_targetItem) {
-        // Enforce a large enough rect for self-loops
-        QRectF rect = m_sourceItem->mapToScene(m_sourceItem->boundingRect()).boundingRect();
-        return QRectF(rect.right() - 20, rect.top() - 60, 120, 120);
-    }
-    
-    // Padding for arrow head and text
-    return m_path.boundingRect().adjusted(-50, -50, 50, 50); 
+    return m_boundingRect;
+}
+
+QPainterPath TransitionItem::shape() const
+{
+    QPainterPathStroker stroker;
+    stroker.setWidth(8);
+    return stroker.createStroke(m_path);
 }
 
 void TransitionItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
 {
-    Q_UNUSED(option);
     Q_UNUSED(widget);
     
     if (!m_sourceItem || !m_targetItem) return;
     
+    // Zoomed out: a single aliased hairline
+    if (option->levelOfDetailFromTransform(painter->worldTransform()) < DetailLod) {
+        painter->setRenderHint(QPainter::Antialiasing, false);
+        painter->setPen(QPen(isSelected() ? Qt::blue : Qt::black, 0));
+        painter->setBrush(Qt::NoBrush);
+        painter->drawPath(m_path);
+        return;
+    }
+    
     painter->setRenderHint(QPainter::Antialiasing);
     
     QPen pen(Qt::black, 2, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin);
@@ -122,7 +146,7 @@ void TransitionItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *op
     
     painter->drawPath(m_path);
     
-    // Draw Arrow Head at the end of path (m_targetPoint)
+    // Draw Arrow Head at the end of path
     if (m_path.elementCount() < 2) return;
     
     // Get direction for arrow head
@@ -137,10 +161,10 @@ void TransitionItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *op
         QLineF tangent(pBefore, endPoint);
         angle = std::atan2(-tangent.dy(), tangent.dx());
     } else {
-        // Straight line
-        QLineF line(m_sourcePoint, m_targetPoint);
+        // Last segment of the line or route
+        QLineF line(m_points[m_points.size() - 2], m_points.last());
         angle = std::atan2(-line.dy(), line.dx());
-        endPoint = m_targetPoint;
+        endPoint = m_points.last();
     }
     
     QPointF arrowP1 = endPoint - QPointF(sin(angle + M_PI / 3) * 10,
@@ -153,25 +177,16 @@ void TransitionItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *op
     painter->drawPolygon(QPolygonF() << endPoint << arrowP1 << arrowP2);
     
     // Draw Label (Event)
-    if (m_transition && !m_transition->event().isEmpty()) {
-        QPointF mid = m_path.pointAtPercent(0.5);
+    if (m_transition && !m_labelRect.isNull()) {
+        // Same font and rect as calculatePath() measured
+        painter->setFont(labelFont());
         
         // Draw white background for text
-        painter->setPen(pen); // Restore pen
-        QFont font = painter->font();
-        font.setPointSize(9);
-        painter->setFont(font);
-        
-        QFontMetrics fm(font);
-        int textWidth = fm.horizontalAdvance(m_transition->event());
-        int textHeight = fm.height();
-        QRectF textRect(mid.x() - textWidth/2 - 4, mid.y() - textHeight/2 - 4, textWidth + 8, textHeight + 4);
-        
         painter->setPen(Qt::NoPen);
         painter->setBrush(QColor(255, 255, 255, 200)); // Semi-transparent white
-        painter->drawRoundedRect(textRect, 4, 4);
+        painter->drawRoundedRect(m_labelRect.adjusted(-4, -4, 4, 0), 4, 4);
         
         painter->setPen(Qt::black);
-        painter->drawText(mid.x() - textWidth/2, mid.y() + textHeight/2 - fm.descent(), m_transition->event());
+        painter->drawText(m_labelRect, Qt::AlignCenter, m_transition->event());
     }
 }
@@ -2,6 +2,7 @@
 #define TRANSITIONITEM_H
 
 #include <QGraphicsItem>
+#include <QVector>
 
 class Transition;
 class StateItem;
@@ -10,9 +11,10 @@ class StateItem;
  * @brief The TransitionItem class represents a visual connection/arrow on the
  * Graphics Scene.
  *
- * It connects two @ref StateItem objects. It calculates the optimal path (line
- * or curve) between the source and target items, taking into account their
- * shapes to ensure the arrow terminates exactly at the boundary.
+ * It connects two @ref StateItem objects. By default it draws a straight line
+ * (or, for self-transitions, a loop) that ends exactly at the states'
+ * borders; the editor replaces it with the route from its @ref EdgeRouter,
+ * which goes around the states in the way.
  *
  * @ingroup View
  */
@@ -34,17 +36,34 @@ public:
   ~TransitionItem();
 
   /**
-   * @brief Recalculates the endpoints and path of the arrow.
-   * Should be called when either connected StateItem moves.
+   * @brief Recalculates the endpoints and path of the arrow as a straight
+   * line (or loop) between the connected StateItems.
    */
   void updatePosition();
 
+  /**
+   * @brief Draws the arrow along a precomputed route.
+   * @param route Points from the source border to the target border; with
+   * fewer than two points the arrow falls back to updatePosition().
+   */
+  void setRoute(const QVector<QPointF> &route);
+
   /**
    * @brief Gets the underlying Transition model object.
    * @return Pointer to the Transition.
    */
   Transition *transition() const { return m_transition; }
 
+  /**
+   * @brief Gets the visual of the source state.
+   */
+  StateItem *sourceItem() const { return m_sourceItem; }
+
+  /**
+   * @brief Gets the visual of the target state.
+   */
+  StateItem *targetItem() const { return m_targetItem; }
+
   /**
    * @brief Returns the bounding rectangle for this connection.
    * Includes the arrow path and any decorations (arrowhead).
@@ -52,6 +71,12 @@ public:
    */
   QRectF boundingRect() const override;
 
+  /**
+   * @brief Returns the area that reacts to clicks: the path widened by a
+   * few pixels, not its whole bounding rectangle.
+   */
+  QPainterPath shape() const override;
+
   /**
    * @brief Paints the transition (line, arrowhead, text labels).
    * @param painter The painter to use.
@@ -66,22 +91,15 @@ private:
   StateItem *m_sourceItem;
   StateItem *m_targetItem;
   QPainterPath m_path;
-  QPointF m_sourcePoint;
-  QPointF m_targetPoint;
+  QVector<QPointF> m_points; ///< Polyline from source to target border
+  QRectF m_boundingRect;
+  QRectF m_labelRect; ///< Where the event label is drawn; null without one
 
   /**
-   * @brief Internal helper to calculate the QPainterPath.
+   * @brief Internal helper to calculate the QPainterPath and the bounding
+   * rectangle around it.
    */
   void calculatePath();
-
-  /**
-   * @brief Calculates the intersection point of a line with a rectangle.
-   * Used to make sure the arrow stops at the edge of the StateItem.
-   * @param line The center-to-center line.
-   * @param rect The bounding rect of the state item.
-   * @return The intersection point.
-   */
-  QPointF getIntersectionPoint(const QLineF &line, const QRectF &rect) const;
 };
 
 #endif // TRANSITIONITEM_H
@@ -6,6 +6,7 @@
 #include "commands/AddTransitionCommand.h"
 #include "commands/DeleteStateCommand.h"
 #include "commands/DeleteTransitionCommand.h"
+#include "commands/MoveStatesCommand.h"
 #include <QDebug>
 
 
@@ -84,6 +85,26 @@ void DiagramViewModel::deleteTransition(Transition *transition) {
   emit transitionRemoved(transition);
 }
 
+void DiagramViewModel::moveStates(const QList<State *> &states,
+                                  const QVector<QPointF> &positions) {
+  QVector<QPointF> from;
+  from.reserve(states.size());
+  for (State *state : states) {
+    from.append(state->position());
+  }
+  moveStates(states, from, positions);
+}
+
+void DiagramViewModel::moveStates(const QList<State *> &states,
+                                  const QVector<QPointF> &from,
+                                  const QVector<QPointF> &to) {
+  if (!m_fsm || states.isEmpty())
+    return;
+
+  // The first redo() only writes the positions that are not there yet
+  m_undoStack->push(new MoveStatesCommand(m_fsm, states, from, to));
+}
+
 // Undo/Redo
 void DiagramViewModel::undo() {
   qDebug() << "DiagramViewModel::undo() called - canUndo:"
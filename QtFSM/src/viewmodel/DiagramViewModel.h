@@ -1,8 +1,11 @@
 #ifndef DIAGRAMVIEWMODEL_H
 #define DIAGRAMVIEWMODEL_H
 
+#include <QList>
 #include <QObject>
+#include <QPointF>
 #include <QUndoStack>
+#include <QVector>
 
 class FSM;
 class State;
@@ -84,6 +87,25 @@ public:
    */
   void deleteTransition(Transition *transition);
 
+  /**
+   * @brief Moves states to new positions in a single undo step.
+   * Creates an undo-able command.
+   * @param states The states to move.
+   * @param positions The new positions, in the same order.
+   */
+  void moveStates(const QList<State *> &states,
+                  const QVector<QPointF> &positions);
+
+  /**
+   * @brief Records a move that has already been applied (a finished drag or
+   * background layout) as a single undo step.
+   * @param states The states that moved.
+   * @param from Their positions before the move.
+   * @param to Their positions after the move.
+   */
+  void moveStates(const QList<State *> &states, const QVector<QPointF> &from,
+                  const QVector<QPointF> &to);
+
   // Undo/Redo
   /**
    * @brief Undoes the last command.
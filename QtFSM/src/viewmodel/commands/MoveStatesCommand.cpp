@@ -0,0 +1,34 @@
+#include "MoveStatesCommand.h"
+#include "../../model/FSM.h"
+#include "../../model/State.h"
+
+MoveStatesCommand::MoveStatesCommand(FSM *fsm, const QList<State *> &states,
+                                     const QVector<QPointF> &from,
+                                     const QVector<QPointF> &to,
+                                     QUndoCommand *parent)
+    : QUndoCommand(parent), m_fsm(fsm), m_from(from), m_to(to) {
+  m_states.reserve(states.size());
+  for (State *state : states) {
+    m_states.append(state);
+  }
+  if (states.size() == 1 && states.first()) {
+    setText(QObject::tr("Move State '%1'").arg(states.first()->name()));
+  } else {
+    setText(QObject::tr("Move %1 States").arg(states.size()));
+  }
+}
+
+void MoveStatesCommand::undo() { m_fsm->moveStates(liveStates(), m_from); }
+
+void MoveStatesCommand::redo() { m_fsm->moveStates(liveStates(), m_to); }
+
+QList<State *> MoveStatesCommand::liveStates() const {
+  // Deleted states become null entries, which FSM::moveStates() skips; the
+  // list keeps its length so it stays aligned with the positions
+  QList<State *> states;
+  states.reserve(m_states.size());
+  for (const QPointer<State> &state : m_states) {
+    states.append(state.data());
+  }
+  return states;
+}
@@ -0,0 +1,57 @@
+#ifndef MOVESTATESCOMMAND_H
+#define MOVESTATESCOMMAND_H
+
+#include <QList>
+#include <QPointF>
+#include <QPointer>
+#include <QUndoCommand>
+#include <QVector>
+
+class FSM;
+class State;
+
+/**
+ * @brief The MoveStatesCommand class implements the Undo/Redo logic for
+ * moving any number of states in one step.
+ *
+ * Redo and undo each write all positions through FSM::moveStates(), so the
+ * view is updated once per step rather than once per state. Used for
+ * auto-layouts as well as for drags. States deleted since the move (e.g. by
+ * a code reparse) are skipped.
+ *
+ * @ingroup Commands
+ */
+class MoveStatesCommand : public QUndoCommand {
+public:
+  /**
+   * @brief Constructs a MoveStatesCommand.
+   * @param fsm The FSM model.
+   * @param states The states to move.
+   * @param from Their positions before the move, in the same order.
+   * @param to Their positions after the move, in the same order.
+   * @param parent The parent undo command (default: nullptr).
+   */
+  MoveStatesCommand(FSM *fsm, const QList<State *> &states,
+                    const QVector<QPointF> &from, const QVector<QPointF> &to,
+                    QUndoCommand *parent = nullptr);
+
+  /**
+   * @brief Moves the states back to their old positions.
+   */
+  void undo() override;
+
+  /**
+   * @brief Moves the states to their new positions.
+   */
+  void redo() override;
+
+private:
+  QList<State *> liveStates() const;
+
+  FSM *m_fsm;
+  QVector<QPointer<State>> m_states;
+  QVector<QPointF> m_from;
+  QVector<QPointF> m_to;
+};
+
+#endif // MOVESTATESCOMMAND_H
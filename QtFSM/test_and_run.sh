@@ -17,10 +17,18 @@ cmake .. -DCMAKE_BUILD_TYPE=Debug
 TESTS=(
     "test_stress"
     "test_user_code"
+    "test_codegen"
     "test_json"
+    "test_binary_roundtrip"
+    "test_async_save"
+    "test_edit_journal"
+    "test_layout"
     "test_lexer"
     "test_parser"
     "test_debug_parser"
+    "test_incremental_parser"
+    "test_directory_importer"
+    "fuzz_parser"
 )
 
 # Build and run each test
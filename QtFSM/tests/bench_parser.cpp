@@ -0,0 +1,129 @@
+// Throughput baseline for the Lexer and CppParser.
+//
+//   ./bench_parser [max-size-in-MB]
+//
+// Generates synthetic sources from 1 KB up to the given size (100 MB by
+// default) and reports MB/s and tokens/s for Lexer::tokenize, CppParser::parse
+// over the token vector, and the streaming Lexer + CppParser combination that
+// CodeParser uses. Small inputs are repeated until each measurement runs for
+// at least a quarter of a second.
+
+#include "../src/parsing/CppParser.h"
+#include "../src/parsing/Lexer.h"
+#include <QElapsedTimer>
+#include <QString>
+#include <QVector>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace FSMParser;
+
+namespace {
+
+// A mix of what real inputs contain: state classes the parser looks into,
+// helper classes and out-of-line functions it skips, comments and strings.
+QString generateSource(qsizetype targetSize) {
+  QString source;
+  source.reserve(targetSize + 2048);
+  source += "#include <string>\n\nclass MyFSMStateBase {\npublic:\n"
+            "    virtual ~MyFSMStateBase() = default;\n};\n";
+
+  for (int i = 0; source.size() < targetSize; ++i) {
+    source += QString(R"(
+/* State %1: waits for Go%1 and moves on */
+class S%1State : public MyFSMStateBase {
+public:
+    S%1State() { m_counter = %1; }
+    void enter() { log("entering S%1"); }
+    std::map<std::string, std::vector<int>> m_cache;
+    MyFSMStateBase* handle(MyFSMContext* context, const Event& event) override {
+        if (event.type == "Go%1") {
+            return new S%2State();
+        } else if (event.type == "Reset") {
+            return static_cast<MyFSMStateBase*>(new S0State());
+        }
+        return nullptr;
+    }
+};
+
+// Helper that is not part of the state machine
+class Helper%1 {
+    int compute(int v) { if (v > %1) { return v * 2; } return v; }
+    const char *name = "Helper { %1 }";
+};
+
+int freeFunction%1(int a, int b) {
+    return a + b + %1;
+}
+)")
+                  .arg(i)
+                  .arg(i + 1);
+  }
+  return source;
+}
+
+struct Result {
+  double seconds = 0;
+  qint64 tokens = 0;
+};
+
+// Runs @p body until at least MinSeconds have passed and averages per run
+template <typename Body> Result measure(Body body) {
+  constexpr double MinSeconds = 0.25;
+  Result total;
+  int runs = 0;
+  QElapsedTimer timer;
+  timer.start();
+  do {
+    total.tokens += body();
+    runs++;
+  } while (timer.nsecsElapsed() / 1e9 < MinSeconds);
+  total.seconds = timer.nsecsElapsed() / 1e9 / runs;
+  total.tokens /= runs;
+  return total;
+}
+
+void report(const char *stage, qsizetype bytes, const Result &result) {
+  std::printf("  %-22s %10.2f MB/s %12.2f Mtokens/s %10.3f ms\n", stage,
+              bytes / 1e6 / result.seconds, result.tokens / 1e6 / result.seconds,
+              result.seconds * 1e3);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const double maxMegabytes = argc > 1 ? std::atof(argv[1]) : 100.0;
+  if (maxMegabytes <= 0) {
+    std::fprintf(stderr, "usage: %s [max-size-in-MB]\n", argv[0]);
+    return 1;
+  }
+
+  for (qsizetype size = 1000; size <= qsizetype(maxMegabytes * 1e6);
+       size *= 10) {
+    const QString source = generateSource(size);
+    // Generated sources are ASCII, so characters and UTF-8 bytes agree
+    const qsizetype bytes = source.size();
+    std::printf("%lld bytes\n", static_cast<long long>(bytes));
+
+    QVector<Token> tokens;
+    report("tokenize", bytes, measure([&] {
+             Lexer lexer(source);
+             tokens = lexer.tokenize();
+             return qint64(tokens.size());
+           }));
+
+    report("parse (vector)", bytes, measure([&] {
+             CppParser parser(tokens);
+             parser.parse();
+             return qint64(tokens.size());
+           }));
+
+    report("lex + parse (stream)", bytes, measure([&] {
+             Lexer lexer(source);
+             CppParser parser(lexer);
+             parser.parse();
+             return qint64(parser.tokenStream().tokenCount());
+           }));
+  }
+  return 0;
+}
@@ -0,0 +1,234 @@
+// Fuzz target for the C++ import pipeline (Lexer, CppParser, ModelBuilder,
+// IncrementalParser).
+//
+// With -DQTFSM_LIBFUZZER=ON (clang) this is a plain libFuzzer target:
+//   ./fuzz_parser corpus_dir/
+// Otherwise the standalone driver below is linked in. It replays the files or
+// directories given on the command line, or, without arguments, runs a set of
+// pathological seeds plus deterministic random mutations of them and reports
+// the slowest input.
+
+#include "../src/model/FSM.h"
+#include "../src/parsing/CppParser.h"
+#include "../src/parsing/IncrementalParser.h"
+#include "../src/parsing/Lexer.h"
+#include "../src/parsing/ModelBuilder.h"
+#include <QString>
+#include <QVector>
+#include <cstddef>
+#include <cstdint>
+
+namespace {
+
+void runPipeline(const QString &code) {
+  using namespace FSMParser;
+
+  // Pre-tokenized parse plus model building
+  Lexer vectorLexer(code);
+  QVector<Token> tokens = vectorLexer.tokenize();
+  CppParser vectorParser(tokens);
+  QVector<ClassDecl *> classes = vectorParser.parse();
+  FSM fsm;
+  ModelBuilder builder(&fsm);
+  builder.build(classes);
+
+  // Streaming parse takes different paths through TokenStream and the Lexer
+  Lexer streamLexer(code);
+  CppParser streamParser(streamLexer);
+  streamParser.parse();
+
+  // A full parse followed by an edit that cuts the input in half
+  FSM live;
+  IncrementalParser incremental;
+  if (incremental.update(&live, code)) {
+    incremental.update(&live, code.left(code.size() / 2));
+  }
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  runPipeline(QString::fromUtf8(reinterpret_cast<const char *>(data),
+                                qsizetype(size)));
+  return 0;
+}
+
+#ifndef QTFSM_LIBFUZZER
+
+#include <QByteArray>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QList>
+#include <cstdio>
+#include <iterator>
+#include <random>
+
+namespace {
+
+QByteArray repeat(const QByteArray &text, int count) {
+  QByteArray result;
+  result.reserve(text.size() * count);
+  for (int i = 0; i < count; ++i) {
+    result += text;
+  }
+  return result;
+}
+
+// Inputs that have caused crashes or pathological slowdowns before
+QList<QByteArray> seeds() {
+  const QByteArray stateMachine = R"(
+class MyFSMStateBase {
+public:
+    virtual ~MyFSMStateBase() = default;
+    virtual MyFSMStateBase* handle(MyFSMContext* context, const Event& event) = 0;
+};
+
+class IdleState : public MyFSMStateBase {
+public:
+    IdleState() { m_count = 0; }
+    void enter() {}
+    std::map<std::string, std::vector<int>> m_cache;
+    MyFSMStateBase* handle(MyFSMContext* context, const Event& event) override {
+        if (event.type == "Start") {
+            return new RunningState();
+        } else if (event.type == "Stop") {
+            return static_cast<MyFSMStateBase*>(new IdleState());
+        }
+        return nullptr;
+    }
+};
+)";
+
+  QList<QByteArray> result;
+  result << stateMachine;
+  result << "class AState { /* never closed " + repeat("x ", 10000);
+  result << "class AState { const char *s = \"never closed " +
+                repeat("\\\"", 10000);
+  result << "class Helper " + repeat("{", 100000) + repeat("}", 100000);
+  result << "class Helper " + repeat("{", 100000);
+  result << repeat("}", 100000) + stateMachine;
+  result << "class DeepState : public State { void handle() {" +
+                repeat("if (event.type == \"E\") {", 100000) +
+                repeat("}", 100000) + "} };";
+  result << "class ChainState : public State { void handle() {" +
+                repeat("if (e == \"E\") { return new XState(); } else ", 50000) +
+                "{ } } };";
+  result << "class TState : public State { " + repeat("std::vector<", 50000) +
+                "int" + repeat(">", 50000) + " m; };";
+  result << "class CastState : public State { void handle() { return "
+            "static_cast<" +
+                repeat("(", 50000) + "new XState()" + repeat(")", 50000) +
+                "; } };";
+  result << "class EqState : public State { void handle() { if (a" +
+                repeat(" == a", 100000) + ") { return new XState(); } } };";
+  result << "class DotState : public State { void handle() { if (e" +
+                repeat(".m", 100000) + " == \"E\") { } } };";
+  result << repeat("class ", 20000);
+  result << repeat("a::", 50000) + "b";
+  result << repeat("// comment\n", 20000) + stateMachine;
+
+  QByteArray binary;
+  std::mt19937 rng(7);
+  for (int i = 0; i < 4096; ++i) {
+    binary += char(rng() & 0xff);
+  }
+  result << binary;
+  return result;
+}
+
+QByteArray mutate(const QByteArray &input, std::mt19937 &rng) {
+  static const char *const fragments[] = {
+      "{",     "}",      "(",     ")",        "/*",       "*/",
+      "//",    "\"",     "\\",    ";",        "<",        ">",
+      "::",    "class ", "if (",  "else ",    "return ",  "new XState()",
+      "State", "~",      "enum ", "public: ", "override", "\n"};
+  QByteArray data = input;
+  const int edits = 1 + int(rng() % 8);
+  for (int i = 0; i < edits; ++i) {
+    const int pos = data.isEmpty() ? 0 : int(rng() % (data.size() + 1));
+    switch (rng() % 4) {
+    case 0: // Insert a syntax fragment
+      data.insert(pos, fragments[rng() % std::size(fragments)]);
+      break;
+    case 1: // Delete a range
+      data.remove(pos, int(rng() % 64));
+      break;
+    case 2: // Duplicate a range
+      data.insert(pos, data.mid(pos, int(rng() % 256)));
+      break;
+    default: // Flip a byte
+      if (pos < data.size()) {
+        data[pos] = char(rng() & 0xff);
+      }
+      break;
+    }
+  }
+  return data;
+}
+
+struct Runner {
+  int inputs = 0;
+  qint64 slowestNs = 0;
+  QByteArray slowest;
+
+  void run(const QByteArray &data) {
+    QElapsedTimer timer;
+    timer.start();
+    LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t *>(data.constData()),
+                           size_t(data.size()));
+    const qint64 elapsed = timer.nsecsElapsed();
+    inputs++;
+    if (elapsed > slowestNs) {
+      slowestNs = elapsed;
+      slowest = data;
+    }
+  }
+};
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  Runner runner;
+
+  if (argc > 1) {
+    // Replay files, e.g. a crash reproducer or a libFuzzer corpus
+    for (int i = 1; i < argc; ++i) {
+      const QString path = QString::fromLocal8Bit(argv[i]);
+      QStringList files;
+      if (QFileInfo(path).isDir()) {
+        QDirIterator it(path, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+          files << it.next();
+        }
+      } else {
+        files << path;
+      }
+      for (const QString &file : files) {
+        QFile input(file);
+        if (!input.open(QIODevice::ReadOnly)) {
+          std::fprintf(stderr, "Cannot open %s\n", qPrintable(file));
+          return 1;
+        }
+        runner.run(input.readAll());
+      }
+    }
+  } else {
+    const QList<QByteArray> corpus = seeds();
+    for (const QByteArray &seed : corpus) {
+      runner.run(seed);
+    }
+    std::mt19937 rng(1);
+    for (int i = 0; i < 2000; ++i) {
+      runner.run(mutate(corpus[int(rng() % corpus.size())], rng));
+    }
+  }
+
+  std::printf("fuzz_parser: %d inputs, slowest %.1f ms (%lld bytes)\n",
+              runner.inputs, runner.slowestNs / 1e6,
+              static_cast<long long>(runner.slowest.size()));
+  return 0;
+}
+
+#endif // QTFSM_LIBFUZZER
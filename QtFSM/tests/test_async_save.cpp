@@ -0,0 +1,144 @@
+#include "../src/model/FSM.h"
+#include "../src/model/State.h"
+#include "../src/model/Transition.h"
+#include "../src/serialization/AsyncProjectSaver.h"
+#include "../src/serialization/Autosaver.h"
+#include "../src/serialization/BinarySerializer.h"
+#include "../src/serialization/FSMSnapshot.h"
+#include "../src/serialization/JSONSerializer.h"
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <gtest/gtest.h>
+
+
+class AsyncSaveTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_TRUE(dir.isValid());
+    fsm = new FSM();
+    fsm->setName("TestFSM");
+    s1 = new State("idle", "Idle", fsm);
+    s1->setInitial(true);
+    s1->addFunction("void reset()");
+    s2 = new State("busy", "Busy", fsm);
+    s2->setPosition(QPointF(150, 40));
+    fsm->addState(s1);
+    fsm->addState(s2);
+    Transition *t1 = new Transition("t1", s1, s2, fsm);
+    t1->setEvent("go");
+    fsm->addTransition(t1);
+  }
+
+  void TearDown() override { delete fsm; }
+
+  QTemporaryDir dir;
+  FSM *fsm;
+  State *s1;
+  State *s2;
+};
+
+// Edits after capture() do not reach the snapshot
+TEST_F(AsyncSaveTest, SnapshotIsIndependentOfLaterEdits) {
+  const FSMSnapshot snapshot = FSMSnapshot::capture(fsm);
+  s2->setName("Renamed");
+  s2->setPosition(QPointF(1, 1));
+
+  ASSERT_EQ(snapshot.states().size(), 2);
+  EXPECT_EQ(snapshot.states()[1].name, "Busy");
+  EXPECT_EQ(snapshot.states()[1].position, QPointF(150, 40));
+  ASSERT_EQ(snapshot.transitions().size(), 1);
+  EXPECT_EQ(snapshot.transitions()[0].source, 0);
+  EXPECT_EQ(snapshot.transitions()[0].target, 1);
+  EXPECT_NE(snapshot, FSMSnapshot::capture(fsm));
+
+  // Rebuilding gives back an FSM with the same contents
+  FSM *copy = snapshot.toFsm();
+  ASSERT_EQ(copy->states().size(), 2);
+  EXPECT_EQ(copy->states()[0]->customFunctions(), QStringList{"void reset()"});
+  EXPECT_EQ(FSMSnapshot::capture(copy), snapshot);
+  delete copy;
+}
+
+TEST_F(AsyncSaveTest, SavesInBackground) {
+  const QString jsonPath = dir.filePath("project.json");
+  const QString binaryPath = dir.filePath("project.fsmb");
+
+  AsyncProjectSaver saver;
+  QStringList savedFiles;
+  QObject::connect(&saver, &AsyncProjectSaver::saved,
+                   [&](const QString &path) { savedFiles.append(path); });
+
+  saver.save(fsm, jsonPath);
+  saver.save(fsm, binaryPath);
+  EXPECT_TRUE(saver.isSaving());
+
+  // The editor may change the model while the files are written
+  s2->setName("Changed");
+
+  saver.waitForFinished();
+  EXPECT_FALSE(saver.isSaving());
+  EXPECT_EQ(savedFiles, QStringList({jsonPath, binaryPath}));
+
+  JSONSerializer json;
+  FSM *fromJson = json.load(jsonPath);
+  ASSERT_NE(fromJson, nullptr) << json.lastError().toStdString();
+  ASSERT_EQ(fromJson->states().size(), 2);
+  EXPECT_EQ(fromJson->states()[1]->name(), "Busy");
+  EXPECT_EQ(fromJson->transitions().size(), 1);
+  delete fromJson;
+
+  BinarySerializer binary;
+  FSM *fromBinary = binary.load(binaryPath);
+  ASSERT_NE(fromBinary, nullptr) << binary.lastError().toStdString();
+  EXPECT_EQ(fromBinary->states()[1]->name(), "Busy");
+  delete fromBinary;
+}
+
+TEST_F(AsyncSaveTest, ReportsFailedSaves) {
+  AsyncProjectSaver saver;
+  QString failedPath;
+  QString error;
+  QObject::connect(&saver, &AsyncProjectSaver::saveFailed,
+                   [&](const QString &path, const QString &message) {
+                     failedPath = path;
+                     error = message;
+                   });
+
+  const QString path = dir.filePath("missing/project.json");
+  saver.save(fsm, path);
+  saver.waitForFinished();
+  EXPECT_EQ(failedPath, path);
+  EXPECT_FALSE(error.isEmpty());
+}
+
+TEST_F(AsyncSaveTest, AutosavesOnlyChanges) {
+  Autosaver autosaver(dir.path());
+  EXPECT_TRUE(autosaver.autosave(fsm));
+  autosaver.waitForFinished();
+  EXPECT_TRUE(QFile::exists(autosaver.recoveryFile()));
+
+  // Nothing changed, nothing written
+  EXPECT_FALSE(autosaver.autosave(fsm));
+  s1->setPosition(QPointF(5, 5));
+  EXPECT_TRUE(autosaver.autosave(fsm));
+  autosaver.waitForFinished();
+
+  BinarySerializer serializer;
+  FSM *recovered = serializer.load(autosaver.recoveryFile());
+  ASSERT_NE(recovered, nullptr);
+  EXPECT_EQ(recovered->states()[0]->position(), QPointF(5, 5));
+  delete recovered;
+
+  // The running instance's own file is not offered for recovery; a file
+  // without a live lock is
+  EXPECT_TRUE(autosaver.recoverableFiles().isEmpty());
+  const QString orphan = QDir(dir.path()).filePath("autosave-999999.fsmb");
+  ASSERT_TRUE(QFile::copy(autosaver.recoveryFile(), orphan));
+  EXPECT_EQ(autosaver.recoverableFiles(), QStringList{orphan});
+  Autosaver::removeRecoveryFile(orphan);
+  EXPECT_TRUE(autosaver.recoverableFiles().isEmpty());
+
+  autosaver.discard();
+  EXPECT_FALSE(QFile::exists(autosaver.recoveryFile()));
+}
@@ -0,0 +1,198 @@
+#include "../src/model/FSM.h"
+#include "../src/model/State.h"
+#include "../src/model/Transition.h"
+#include "../src/serialization/BinarySerializer.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryFile>
+#include <gtest/gtest.h>
+
+
+class BinaryRoundtripTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    fsm = new FSM();
+    fsm->setName("TestFSM");
+  }
+
+  void TearDown() override {
+    delete fsm;
+    for (const QString &file : files)
+      QFile::remove(file);
+  }
+
+  // Saves fsm to a new temporary file and returns its path
+  QString save() {
+    QTemporaryFile tempFile;
+    tempFile.setAutoRemove(false);
+    EXPECT_TRUE(tempFile.open());
+    QString filePath = tempFile.fileName();
+    tempFile.close();
+    files.append(filePath);
+
+    BinarySerializer serializer;
+    EXPECT_TRUE(serializer.save(fsm, filePath))
+        << serializer.lastError().toStdString();
+    return filePath;
+  }
+
+  FSM *fsm;
+  QStringList files;
+};
+
+// Test complete roundtrip of all model fields
+TEST_F(BinaryRoundtripTest, RoundtripAllFields) {
+  State *s1 = new State("start", "Start", fsm);
+  s1->setPosition(QPointF(10.5, -20.25));
+  s1->setInitial(true);
+  s1->setEntryAction("log('Enter Start');");
+  s1->setExitAction("log('Exit Start');");
+  s1->addFunction("void init()");
+  s1->addFunction("void reset()");
+  fsm->addState(s1);
+
+  State *s2 =
+      new State("process", QString::fromUtf8("Verarbeitung \xE2\x9C\x93"), fsm);
+  s2->setPosition(QPointF(100, 200));
+  s2->setFinal(true);
+  s2->addFunction("int compute(int x)");
+  fsm->addState(s2);
+
+  Transition *t1 = new Transition("t1", s1, s2, fsm);
+  t1->setEvent("start_event");
+  t1->setGuard("x > 0");
+  t1->setAction("doWork()");
+  fsm->addTransition(t1);
+
+  BinarySerializer serializer;
+  FSM *loadedFsm = serializer.load(save());
+  ASSERT_NE(loadedFsm, nullptr) << serializer.lastError().toStdString();
+
+  EXPECT_EQ(loadedFsm->name(), "TestFSM");
+  ASSERT_EQ(loadedFsm->states().size(), 2);
+  ASSERT_EQ(loadedFsm->transitions().size(), 1);
+
+  // States keep their order, so indices match
+  State *loadedS1 = loadedFsm->states()[0];
+  EXPECT_EQ(loadedS1->id(), "start");
+  EXPECT_EQ(loadedS1->name(), "Start");
+  EXPECT_EQ(loadedS1->position(), QPointF(10.5, -20.25));
+  EXPECT_TRUE(loadedS1->isInitial());
+  EXPECT_FALSE(loadedS1->isFinal());
+  EXPECT_EQ(loadedS1->entryAction(), "log('Enter Start');");
+  EXPECT_EQ(loadedS1->exitAction(), "log('Exit Start');");
+  ASSERT_EQ(loadedS1->customFunctions().size(), 2);
+  EXPECT_EQ(loadedS1->customFunctions()[0], "void init()");
+  EXPECT_EQ(loadedS1->customFunctions()[1], "void reset()");
+
+  State *loadedS2 = loadedFsm->states()[1];
+  EXPECT_EQ(loadedS2->name(), s2->name());
+  EXPECT_TRUE(loadedS2->isFinal());
+  EXPECT_FALSE(loadedS2->isInitial());
+  ASSERT_EQ(loadedS2->customFunctions().size(), 1);
+  EXPECT_EQ(loadedS2->customFunctions()[0], "int compute(int x)");
+
+  Transition *loadedT1 = loadedFsm->transitions()[0];
+  EXPECT_EQ(loadedT1->id(), "t1");
+  EXPECT_EQ(loadedT1->sourceState(), loadedS1);
+  EXPECT_EQ(loadedT1->targetState(), loadedS2);
+  EXPECT_EQ(loadedT1->event(), "start_event");
+  EXPECT_EQ(loadedT1->guard(), "x > 0");
+  EXPECT_EQ(loadedT1->action(), "doWork()");
+
+  delete loadedFsm;
+}
+
+// Large machines are read through the mapped view without building an FSM
+TEST_F(BinaryRoundtripTest, ViewsLargeMachineInPlace) {
+  const int stateCount = 1000;
+  const int transitionCount = 100000;
+  QList<State *> states;
+  for (int i = 0; i < stateCount; ++i) {
+    State *state =
+        new State(QString("s%1").arg(i), QString("S%1").arg(i), fsm);
+    state->setPosition(QPointF(i, -i));
+    states.append(state);
+  }
+  fsm->addStates(states);
+
+  QList<Transition *> transitions;
+  for (int i = 0; i < transitionCount; ++i) {
+    Transition *transition =
+        new Transition(QString("t%1").arg(i), states[i % stateCount],
+                       states[(i * 7 + 1) % stateCount], fsm);
+    transition->setEvent(QString("E%1").arg(i % 10));
+    transitions.append(transition);
+  }
+  fsm->addTransitions(transitions);
+
+  const QString path = save();
+
+  // Repeated events, empty guards and actions are stored once
+  const qint64 size = QFileInfo(path).size();
+  EXPECT_LT(size, qint64(transitionCount) * 64);
+
+  BinaryProjectView view;
+  ASSERT_TRUE(view.open(path)) << view.errorString().toStdString();
+  EXPECT_EQ(view.name(), u"TestFSM");
+  ASSERT_EQ(view.stateCount(), stateCount);
+  ASSERT_EQ(view.transitionCount(), transitionCount);
+  EXPECT_EQ(view.stateName(999), u"S999");
+  EXPECT_EQ(view.statePosition(999), QPointF(999, -999));
+  EXPECT_EQ(view.transitionId(12345), u"t12345");
+  EXPECT_EQ(view.transitionSource(12345), 12345 % stateCount);
+  EXPECT_EQ(view.transitionTarget(12345), (12345 * 7 + 1) % stateCount);
+  EXPECT_EQ(view.transitionEvent(12345), u"E5");
+  EXPECT_TRUE(view.transitionGuard(12345).isEmpty());
+
+  FSM *loadedFsm = BinarySerializer::load(view);
+  ASSERT_EQ(loadedFsm->states().size(), stateCount);
+  ASSERT_EQ(loadedFsm->transitions().size(), transitionCount);
+  EXPECT_EQ(loadedFsm->transitions()[12345]->targetState(),
+            loadedFsm->states()[(12345 * 7 + 1) % stateCount]);
+  delete loadedFsm;
+}
+
+TEST_F(BinaryRoundtripTest, RejectsCorruptFiles) {
+  State *s1 = new State("a", "A", fsm);
+  State *s2 = new State("b", "B", fsm);
+  fsm->addState(s1);
+  fsm->addState(s2);
+  fsm->addTransition(new Transition("t", s1, s2, fsm));
+
+  QFile file(save());
+  ASSERT_TRUE(file.open(QIODevice::ReadOnly));
+  const QByteArray image = file.readAll();
+  file.close();
+
+  BinaryProjectView view;
+  EXPECT_TRUE(view.openData(image));
+
+  // Wrong magic, truncated, unknown version
+  QByteArray bad = image;
+  bad[0] = 'X';
+  EXPECT_FALSE(view.openData(bad));
+  EXPECT_FALSE(view.openData(image.left(image.size() / 2)));
+  bad = image;
+  bad[4] = char(99);
+  EXPECT_FALSE(view.openData(bad));
+  EXPECT_FALSE(view.errorString().isEmpty());
+
+  // Transition target (third field of the record) naming a missing state.
+  // The transition section offset is stored at byte 64 of the header.
+  bad = image;
+  const int transitions =
+      int(qFromLittleEndian<quint64>(bad.constData() + 64));
+  qToLittleEndian<quint32>(5, bad.data() + transitions + 8);
+  EXPECT_FALSE(view.openData(bad));
+
+  // Every truncation is rejected without reading out of bounds
+  for (int size = 0; size < image.size(); ++size) {
+    BinaryProjectView truncated;
+    EXPECT_FALSE(truncated.openData(image.left(size))) << size;
+  }
+
+  BinarySerializer serializer;
+  EXPECT_EQ(serializer.load(file.fileName() + ".missing"), nullptr);
+  EXPECT_FALSE(serializer.lastError().isEmpty());
+}
@@ -0,0 +1,150 @@
+#include "../src/codegen/CodeGenerator.h"
+#include "../src/codegen/CodeSnapshot.h"
+#include "../src/model/FSM.h"
+#include "../src/model/State.h"
+#include "../src/model/Transition.h"
+#include <gtest/gtest.h>
+
+
+class CodegenTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    fsm = new FSM();
+    fsm->setName("Door");
+    closed = new State("closed", "Closed", fsm);
+    closed->setInitial(true);
+    closed->setEntryAction("lock();");
+    open = new State("open", "Open", fsm);
+    open->setExitAction("beep();");
+    fsm->addState(closed);
+    fsm->addState(open);
+    fsm->setInitialState(closed);
+
+    // The generator reads each state's own transitions
+    Transition *push = new Transition("push", closed, open, fsm);
+    push->setEvent("PUSH");
+    push->setGuard("unlocked");
+    push->setAction("swing();");
+    closed->addTransition(push);
+    fsm->addTransition(push);
+    Transition *pull = new Transition("pull", open, closed, fsm);
+    open->addTransition(pull);
+    fsm->addTransition(pull);
+  }
+
+  void TearDown() override { delete fsm; }
+
+  FSM *fsm;
+  State *closed;
+  State *open;
+};
+
+TEST_F(CodegenTest, GeneratesFromSnapshot) {
+  CodeGenerator generator;
+  const QString code = generator.generate(fsm);
+  EXPECT_TRUE(code.contains("class ClosedState : public DoorStateBase"));
+  EXPECT_TRUE(code.contains("if (event.type == \"PUSH\" && unlocked) {"));
+  EXPECT_TRUE(code.contains("            swing();\n"));
+  EXPECT_TRUE(code.contains("if (event.type == \"EVENT\") {"));
+  EXPECT_TRUE(code.contains("currentState = new ClosedState();"));
+
+  // The snapshot carries everything the generator reads
+  EXPECT_EQ(generator.generate(CodeSnapshot::capture(fsm)), code);
+}
+
+// Edits after capture() do not reach the snapshot
+TEST_F(CodegenTest, SnapshotIsIndependentOfLaterEdits) {
+  const CodeSnapshot snapshot = CodeSnapshot::capture(fsm);
+  closed->setName("Shut");
+  open->setEntryAction("light();");
+
+  ASSERT_EQ(snapshot.states().size(), 2);
+  EXPECT_EQ(snapshot.initialState(), 0);
+  EXPECT_EQ(snapshot.states()[1].transitions[0].targetName, "Closed");
+
+  CodeGenerator generator;
+  const QString code = generator.generate(snapshot);
+  EXPECT_TRUE(code.contains("class ClosedState"));
+  EXPECT_FALSE(code.contains("Shut"));
+  EXPECT_FALSE(code.contains("light();"));
+}
+
+TEST_F(CodegenTest, StopsWhenCanceled) {
+  CodeGenerator generator;
+  int checks = 0;
+  const QString code =
+      generator.generate(CodeSnapshot::capture(fsm), [&checks]() {
+        return ++checks > 1; // Cancel before the second state
+      });
+  EXPECT_TRUE(code.isEmpty());
+  EXPECT_EQ(checks, 2);
+}
+
+TEST_F(CodegenTest, RegeneratesOnlyEditedStates) {
+  CodeGenerator generator;
+  const QString first = generator.generate(fsm);
+  EXPECT_EQ(generator.regeneratedFragments(), 2);
+  EXPECT_EQ(generator.generate(fsm), first);
+  EXPECT_EQ(generator.regeneratedFragments(), 0);
+
+  open->setEntryAction("light();");
+  QString code = generator.generate(fsm);
+  EXPECT_EQ(generator.regeneratedFragments(), 1);
+  EXPECT_EQ(code, CodeGenerator().generate(fsm));
+  EXPECT_TRUE(code.contains("light();"));
+
+  // Renaming a state also dirties the states with transitions into it
+  closed->setName("Shut");
+  code = generator.generate(fsm);
+  EXPECT_EQ(generator.regeneratedFragments(), 2);
+  EXPECT_EQ(code, CodeGenerator().generate(fsm));
+  EXPECT_TRUE(code.contains("currentState = new ShutState();"));
+
+  // A different FSM name changes every fragment
+  fsm->setName("Gate");
+  code = generator.generate(fsm);
+  EXPECT_EQ(generator.regeneratedFragments(), 2);
+  EXPECT_EQ(code, CodeGenerator().generate(fsm));
+}
+
+// Parallel generation joins the state classes in the model's order
+TEST(CodegenParallelTest, MatchesSerialOutput) {
+  FSM fsm;
+  fsm.setName("Big");
+  const int count = 3000;
+  QList<State *> states;
+  for (int i = 0; i < count; ++i) {
+    State *state =
+        new State(QString("s%1").arg(i), QString("S%1").arg(i), &fsm);
+    state->setEntryAction(QString("enter(%1);").arg(i));
+    fsm.addState(state);
+    states.append(state);
+  }
+  fsm.setInitialState(states[0]);
+  for (int i = 0; i < count; ++i) {
+    for (int step : {1, 7}) {
+      Transition *t = new Transition(QString("t%1_%2").arg(i).arg(step),
+                                     states[i], states[(i + step) % count],
+                                     &fsm);
+      t->setEvent(QString("E%1").arg(step));
+      states[i]->addTransition(t);
+      fsm.addTransition(t);
+    }
+  }
+
+  CodeGenerator serial;
+  serial.setParallel(false);
+  CodeGenerator parallel;
+  const QString expected = serial.generate(&fsm);
+  EXPECT_EQ(parallel.generate(&fsm), expected);
+  EXPECT_EQ(parallel.regeneratedFragments(), count);
+
+  // Also when only some of the states come from the cache
+  for (int i = 0; i < count; i += 3) {
+    states[i]->setExitAction(QString("leave(%1);").arg(i));
+  }
+  const QString edited = parallel.generate(&fsm);
+  EXPECT_EQ(parallel.regeneratedFragments(), count / 3);
+  EXPECT_EQ(edited, serial.generate(&fsm));
+  EXPECT_NE(edited, expected);
+}
@@ -71,8 +71,6 @@ public:
       EXPECT_GT(cls->methods.size(), 0) << "State1State should have methods";
     }
   }
-
-  qDeleteAll(classes);
 }
 
 TEST(ParserDebugTest, VerifyFunctionParsing) {
@@ -135,6 +133,4 @@ TEST(ParserDebugTest, VerifyFunctionParsing) {
   ASSERT_EQ(funcs.size(), 1);
   // Reconstructed signature: "void customFunc(int x, float y)"
   EXPECT_EQ(funcs[0], "void customFunc(int x, float y)");
-
-  qDeleteAll(classes);
 }
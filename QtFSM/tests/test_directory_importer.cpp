@@ -0,0 +1,163 @@
+#include "../src/model/FSM.h"
+#include "../src/model/State.h"
+#include "../src/model/Transition.h"
+#include "../src/parsing/DirectoryImporter.h"
+#include "../src/parsing/Lexer.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSet>
+#include <QTemporaryDir>
+#include <atomic>
+#include <gtest/gtest.h>
+
+using namespace FSMParser;
+
+namespace {
+
+void writeFile(const QDir &dir, const QString &name, const QString &content) {
+  QDir().mkpath(QFileInfo(dir.filePath(name)).absolutePath());
+  QFile file(dir.filePath(name));
+  ASSERT_TRUE(file.open(QIODevice::WriteOnly | QIODevice::Text));
+  file.write(content.toUtf8());
+}
+
+QString stateClass(const QString &name, const QString &event,
+                   const QString &target) {
+  return QString(R"(
+class %1State : public MyFSMStateBase {
+public:
+    MyFSMStateBase* handle(MyFSMContext* context, const Event& event) override {
+        if (event.type == "%2") {
+            return new %3State();
+        }
+        return nullptr;
+    }
+};
+)")
+      .arg(name, event, target);
+}
+
+} // namespace
+
+TEST(DirectoryImporterTest, FindsTopLevelClassesThroughNamespaces) {
+  QString code = R"(
+#include <string>
+class Forward;
+namespace app { namespace detail {
+int helper() { return 1; }
+template <class T> class Box { T value; };
+} }
+class Plain { void f() { if (x) { y(); } } };
+extern "C" { class CApi {}; }
+)";
+  Lexer lexer(code);
+  QVector<Token> tokens = lexer.tokenize();
+
+  QVector<QPair<int, int>> ranges =
+      DirectoryImporter::topLevelClassRanges(tokens);
+
+  ASSERT_EQ(ranges.size(), 3);
+  QStringList names;
+  for (const auto &range : ranges) {
+    EXPECT_EQ(tokens[range.first].type, TokenType::Keyword_Class);
+    EXPECT_EQ(tokens[range.second - 1].type, TokenType::Semicolon);
+    names.append(tokens[range.first + 1].value.toString());
+  }
+  EXPECT_EQ(names, QStringList({"Box", "Plain", "CApi"}));
+}
+
+TEST(DirectoryImporterTest, SkipsTemplateParameters) {
+  QString code = R"(
+template <class T> void reset(T &value) { value = T(); }
+template <typename T, template <class> class C> class Holder { C<T> items; };
+class Plain {};
+)";
+  Lexer lexer(code);
+  QVector<Token> tokens = lexer.tokenize();
+
+  QVector<QPair<int, int>> ranges =
+      DirectoryImporter::topLevelClassRanges(tokens);
+
+  ASSERT_EQ(ranges.size(), 2);
+  EXPECT_EQ(tokens[ranges[0].first + 1].value, u"Holder");
+  EXPECT_EQ(tokens[ranges[1].first + 1].value, u"Plain");
+}
+
+TEST(DirectoryImporterTest, MergesStatesAcrossFiles) {
+  QTemporaryDir temp;
+  ASSERT_TRUE(temp.isValid());
+  QDir dir(temp.path());
+
+  writeFile(dir, "base.h", "class MyFSMStateBase {};\n");
+  writeFile(dir, "idle.h", stateClass("Idle", "Start", "Running"));
+  writeFile(dir, "states/running.hpp",
+            "namespace fsm {\n" + stateClass("Running", "Stop", "Idle") +
+                stateClass("Paused", "Resume", "Running") + "}\n");
+  writeFile(dir, "states/broken.h", "class BrokenState : public {\n};\n");
+  writeFile(dir, "notes.txt", stateClass("Ignored", "X", "Idle"));
+
+  DirectoryImporter importer;
+  FSM *fsm = importer.importDirectory(dir.path());
+  ASSERT_NE(fsm, nullptr) << importer.lastError().toStdString();
+
+  EXPECT_EQ(importer.fileCount(), 4);
+  ASSERT_EQ(importer.warnings().size(), 1) << "Broken class is skipped";
+  // Reported as file:line:col, like a compiler would
+  EXPECT_TRUE(QRegularExpression("broken\\.h:\\d+:\\d+: \\S")
+                  .match(importer.warnings().first())
+                  .hasMatch())
+      << importer.warnings().first().toStdString();
+
+  QSet<QString> states;
+  for (State *state : fsm->states()) {
+    states.insert(state->name());
+  }
+  EXPECT_EQ(states, QSet<QString>({"Idle", "Running", "Paused"}));
+
+  QSet<QString> transitions;
+  for (Transition *transition : fsm->transitions()) {
+    transitions.insert(transition->sourceState()->name() + "->" +
+                       transition->targetState()->name() + ":" +
+                       transition->event());
+  }
+  EXPECT_EQ(transitions,
+            QSet<QString>({"Idle->Running:Start", "Running->Idle:Stop",
+                           "Paused->Running:Resume"}));
+
+  // Files are processed in sorted order, so the model is deterministic
+  ASSERT_NE(fsm->initialState(), nullptr);
+  EXPECT_EQ(fsm->initialState()->name(), "Idle");
+
+  delete fsm;
+}
+
+TEST(DirectoryImporterTest, ReportsProgressAndCancels) {
+  QTemporaryDir temp;
+  ASSERT_TRUE(temp.isValid());
+  QDir dir(temp.path());
+  writeFile(dir, "idle.h", stateClass("Idle", "Start", "Running"));
+  writeFile(dir, "running.h", stateClass("Running", "Stop", "Idle"));
+
+  // Two files, then two classes
+  DirectoryImporter importer;
+  std::atomic<int> calls{0};
+  std::atomic<int> lastTotal{0};
+  FSM *fsm = importer.importDirectory(dir.path(), nullptr,
+                                      [&](int done, int total) {
+                                        ++calls;
+                                        EXPECT_LE(done, total);
+                                        lastTotal = total;
+                                        return true;
+                                      });
+  ASSERT_NE(fsm, nullptr) << importer.lastError().toStdString();
+  EXPECT_EQ(calls, 4);
+  EXPECT_EQ(lastTotal, 4);
+  delete fsm;
+
+  fsm = importer.importDirectory(dir.path(), nullptr,
+                                 [](int, int) { return false; });
+  EXPECT_EQ(fsm, nullptr);
+  EXPECT_EQ(importer.lastError(), "Import canceled");
+}
@@ -0,0 +1,191 @@
+#include "../src/model/FSM.h"
+#include "../src/model/State.h"
+#include "../src/model/Transition.h"
+#include "../src/serialization/EditJournal.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <algorithm>
+#include <gtest/gtest.h>
+
+
+// One line per state and transition, sorted, so FSMs can be compared
+// regardless of the order their objects were added in
+static QStringList describe(const FSM *fsm) {
+  QStringList lines{"name " + fsm->name()};
+  for (State *s : fsm->states()) {
+    lines.append(QString("state %1 %2 %3,%4 %5%6 [%7] [%8] [%9]")
+                     .arg(s->id(), s->name())
+                     .arg(s->position().x())
+                     .arg(s->position().y())
+                     .arg(int(s->isInitial()))
+                     .arg(int(s->isFinal()))
+                     .arg(s->entryAction(), s->exitAction(),
+                          s->customFunctions().join(';')));
+  }
+  for (Transition *t : fsm->transitions()) {
+    lines.append(QString("transition %1 %2->%3 %4 [%5] [%6]")
+                     .arg(t->id(), t->sourceState()->id(),
+                          t->targetState()->id(), t->event(), t->guard(),
+                          t->action()));
+  }
+  std::sort(lines.begin(), lines.end());
+  return lines;
+}
+
+class EditJournalTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_TRUE(dir.isValid());
+    path = dir.filePath("project.fsmj");
+    fsm = new FSM();
+    fsm->setName("Journaled");
+    for (int i = 0; i < 50; ++i) {
+      State *state =
+          new State(QString("s%1").arg(i), QString("S%1").arg(i), fsm);
+      state->setPosition(QPointF(i * 10, 0));
+      fsm->addState(state);
+    }
+    fsm->states()[0]->setInitial(true);
+    Transition *t = new Transition("t0", fsm->states()[0], fsm->states()[1],
+                                   fsm);
+    t->setEvent("go");
+    fsm->addTransition(t);
+  }
+
+  void TearDown() override { delete fsm; }
+
+  // Opens the project with a fresh journal, as a later session would
+  QStringList reopened() {
+    EditJournal journal;
+    FSM *loaded = journal.open(path);
+    EXPECT_NE(loaded, nullptr) << journal.lastError().toStdString();
+    if (!loaded)
+      return QStringList();
+    const QStringList result = describe(loaded);
+    journal.close();
+    delete loaded;
+    return result;
+  }
+
+  QTemporaryDir dir;
+  QString path;
+  FSM *fsm;
+};
+
+// Dragging a state writes one record, not the whole model
+TEST_F(EditJournalTest, SavesOnlyTheEdits) {
+  EditJournal journal;
+  ASSERT_TRUE(journal.create(fsm, path)) << journal.lastError().toStdString();
+  const qint64 emptyLog = journal.logSize();
+
+  State *dragged = fsm->states()[7];
+  for (int step = 0; step < 100; ++step) {
+    dragged->setPosition(QPointF(step, step * 2));
+  }
+  EXPECT_EQ(journal.pendingCount(), 1);
+  ASSERT_TRUE(journal.flush());
+  EXPECT_EQ(journal.pendingCount(), 0);
+  EXPECT_LT(journal.logSize() - emptyLog, 200);
+
+  EXPECT_EQ(reopened(), describe(fsm));
+}
+
+TEST_F(EditJournalTest, ReplaysStructuralEdits) {
+  EditJournal journal;
+  ASSERT_TRUE(journal.create(fsm, path));
+
+  // Add, remove, rename and re-id, split over two saves
+  State *added = new State("extra", "Extra", fsm);
+  added->addFunction("void onEnter()");
+  fsm->addState(added);
+  Transition *t = new Transition("t1", fsm->states()[2], added, fsm);
+  t->setGuard("ready");
+  fsm->addTransition(t);
+  fsm->removeState(fsm->states()[3]);
+  fsm->setName("Renamed");
+  ASSERT_TRUE(journal.flush());
+
+  fsm->states()[2]->setId("renamed_s2");
+  fsm->removeTransition(fsm->transitionById("t0"));
+  added->setExitAction("cleanup();");
+  ASSERT_TRUE(journal.flush());
+
+  EXPECT_EQ(reopened(), describe(fsm));
+}
+
+// A record cut short by a crash is dropped; earlier saves survive
+TEST_F(EditJournalTest, DropsTornRecords) {
+  {
+    EditJournal journal;
+    ASSERT_TRUE(journal.create(fsm, path));
+    fsm->states()[5]->setName("Saved");
+    ASSERT_TRUE(journal.flush());
+  }
+  const QStringList saved = describe(fsm);
+
+  QFile log(path + ".log");
+  ASSERT_TRUE(log.open(QIODevice::Append));
+  log.write(QByteArray("\x40\x00\x00\x00\x12\x34partial", 14));
+  log.close();
+  const qint64 tornSize = QFileInfo(log).size();
+
+  EXPECT_EQ(reopened(), saved);
+  EXPECT_LT(QFileInfo(log).size(), tornSize);
+}
+
+TEST_F(EditJournalTest, CompactsInBackground) {
+  EditJournal journal;
+  ASSERT_TRUE(journal.create(fsm, path));
+  for (int round = 0; round < 20; ++round) {
+    for (State *state : fsm->states()) {
+      state->setEntryAction(QString("log(%1);").arg(round));
+    }
+    ASSERT_TRUE(journal.flush());
+  }
+  const qint64 before = journal.logSize();
+
+  journal.compact();
+  // Edits made while the image is written stay in the log
+  fsm->states()[0]->setName("DuringCompaction");
+  ASSERT_TRUE(journal.flush());
+  journal.waitForCompaction();
+
+  EXPECT_LT(journal.logSize(), before);
+  EXPECT_EQ(reopened(), describe(fsm));
+}
+
+// Crash after the new base image was written but before the log was cut
+TEST_F(EditJournalTest, SurvivesInterruptedCompaction) {
+  EditJournal journal;
+  ASSERT_TRUE(journal.create(fsm, path));
+  fsm->states()[1]->setPosition(QPointF(-5, -5));
+  ASSERT_TRUE(journal.flush());
+
+  QFile log(path + ".log");
+  ASSERT_TRUE(log.open(QIODevice::ReadOnly));
+  const QByteArray oldLog = log.readAll();
+  log.close();
+
+  journal.compact();
+  journal.waitForCompaction();
+  journal.close();
+
+  ASSERT_TRUE(log.open(QIODevice::WriteOnly | QIODevice::Truncate));
+  log.write(oldLog);
+  log.close();
+
+  EXPECT_EQ(reopened(), describe(fsm));
+}
+
+TEST_F(EditJournalTest, RejectsOtherFiles) {
+  QFile file(path);
+  ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+  file.write("{\"name\": \"json\"}");
+  file.close();
+
+  EditJournal journal;
+  EXPECT_EQ(journal.open(path), nullptr);
+  EXPECT_FALSE(journal.lastError().isEmpty());
+  EXPECT_FALSE(journal.flush());
+}
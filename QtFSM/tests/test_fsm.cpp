@@ -28,6 +28,9 @@ TEST(FSMTest, RemoveStateCleanupTransitions) {
   fsm.addTransition(trans1);
   fsm.addTransition(trans2);
   fsm.addTransition(trans3);
+  state1->addTransition(trans1);
+  state2->addTransition(trans2);
+  state3->addTransition(trans3);
 
   // Verify initial state
   ASSERT_EQ(fsm.states().size(), 3);
@@ -51,6 +54,9 @@ TEST(FSMTest, RemoveStateCleanupTransitions) {
       << "Transition from deleted state should be removed";
   EXPECT_FALSE(fsm.transitions().contains(trans2))
       << "Transition to deleted state should be removed";
+  EXPECT_FALSE(state1->transitions().contains(trans1))
+      << "Remaining source states must not keep removed transitions";
+  EXPECT_TRUE(state3->transitions().contains(trans3));
 }
 
 // Test removing initial state
@@ -0,0 +1,212 @@
+#include "../src/model/FSM.h"
+#include "../src/model/State.h"
+#include "../src/model/Transition.h"
+#include "../src/parsing/CodeParser.h"
+#include "../src/parsing/IncrementalParser.h"
+#include "../src/viewmodel/DiagramViewModel.h"
+#include <QCoreApplication>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <gtest/gtest.h>
+
+namespace {
+
+QString stateClass(int index, int count, const QString &event = "Next") {
+  return QString(R"(
+class S%1State : public MyFSMStateBase {
+public:
+    MyFSMStateBase* handle(MyFSMContext* context, const Event& event) override {
+        if (event.type == "%3%1") {
+            return new S%2State();
+        }
+        return nullptr;
+    }
+    void enter() override {}
+    std::string getName() const override { return "S%1"; }
+};
+)")
+      .arg(index)
+      .arg((index + 1) % count)
+      .arg(event);
+}
+
+QString machine(int count) {
+  QString code = "#include <string>\n\nclass MyFSMStateBase {};\n";
+  for (int i = 0; i < count; ++i) {
+    code += stateClass(i, count);
+  }
+  return code;
+}
+
+// Order-independent description of the model, for comparing with a full parse
+QSet<QString> describe(FSM *fsm) {
+  QSet<QString> result;
+  for (State *state : fsm->states()) {
+    result.insert("state " + state->name() + " entry=" + state->entryAction() +
+                  " functions=" + state->customFunctions().join(','));
+  }
+  for (Transition *transition : fsm->transitions()) {
+    result.insert("transition " + transition->sourceState()->name() + " -> " +
+                  transition->targetState()->name() + " on " +
+                  transition->event());
+  }
+  return result;
+}
+
+QSet<QString> describeFullParse(const QString &code) {
+  CodeParser parser;
+  FSM *fsm = parser.parse(code);
+  EXPECT_NE(fsm, nullptr) << parser.lastError().toStdString();
+  QSet<QString> result = fsm ? describe(fsm) : QSet<QString>();
+  delete fsm;
+  return result;
+}
+
+} // namespace
+
+TEST(IncrementalParserTest, FirstUpdateMatchesFullParse) {
+  QString code = machine(10);
+  FSM fsm;
+  IncrementalParser parser;
+
+  ASSERT_TRUE(parser.update(&fsm, code)) << parser.lastError().toStdString();
+  EXPECT_EQ(fsm.states().size(), 10);
+  EXPECT_EQ(parser.addedStates().size(), 10);
+  EXPECT_EQ(parser.reparsedClassCount(), 10);
+  EXPECT_EQ(describe(&fsm), describeFullParse(code));
+  ASSERT_NE(fsm.initialState(), nullptr);
+  EXPECT_EQ(fsm.initialState()->name(), "S0");
+}
+
+TEST(IncrementalParserTest, EditReparsesOnlyTouchedClass) {
+  QString code = machine(50);
+  FSM fsm;
+  IncrementalParser parser;
+  ASSERT_TRUE(parser.update(&fsm, code));
+
+  State *untouched = fsm.stateById("S3");
+  ASSERT_NE(untouched, nullptr);
+  untouched->setPosition(QPointF(123, 456));
+
+  // Rename the event of one class in the middle of the file
+  QString edited = code;
+  edited.replace(stateClass(25, 50), stateClass(25, 50, "Renamed"));
+  ASSERT_NE(edited, code);
+
+  ASSERT_TRUE(parser.update(&fsm, edited)) << parser.lastError().toStdString();
+  EXPECT_EQ(parser.reparsedClassCount(), 1);
+  EXPECT_TRUE(parser.addedStates().isEmpty());
+  EXPECT_EQ(fsm.stateById("S3"), untouched);
+  EXPECT_EQ(untouched->position(), QPointF(123, 456));
+  EXPECT_EQ(describe(&fsm), describeFullParse(edited));
+}
+
+TEST(IncrementalParserTest, AddedAndRemovedClassesAreApplied) {
+  QString code = machine(5);
+  FSM fsm;
+  IncrementalParser parser;
+  ASSERT_TRUE(parser.update(&fsm, code));
+
+  // Drop S2 (S1 still targets it, so it must stay as a referenced state) and
+  // append a brand-new class
+  QString edited = code;
+  edited.remove(stateClass(2, 5));
+  edited += R"(
+class ExtraState : public MyFSMStateBase {
+public:
+    MyFSMStateBase* handle(MyFSMContext* context, const Event& event) override {
+        if (event.type == "Back") {
+            return new S0State();
+        }
+        return nullptr;
+    }
+};
+)";
+
+  ASSERT_TRUE(parser.update(&fsm, edited)) << parser.lastError().toStdString();
+  ASSERT_EQ(parser.addedStates().size(), 1);
+  EXPECT_EQ(parser.addedStates().first()->name(), "Extra");
+  EXPECT_NE(fsm.stateById("S2"), nullptr);
+  EXPECT_EQ(describe(&fsm), describeFullParse(edited));
+
+  // Removing the reference as well removes the state
+  edited.replace("return new S2State();", "return nullptr;");
+  ASSERT_TRUE(parser.update(&fsm, edited)) << parser.lastError().toStdString();
+  EXPECT_EQ(fsm.stateById("S2"), nullptr);
+  EXPECT_EQ(describe(&fsm), describeFullParse(edited));
+}
+
+// A move recorded before a reparse removed one of the moved states can still
+// be undone and redone; the deleted state is skipped
+TEST(IncrementalParserTest, UndoSkipsStatesRemovedByUpdate) {
+  int argc = 0;
+  QCoreApplication app(argc, nullptr);
+  QString code = machine(3);
+  FSM fsm;
+  IncrementalParser parser;
+  ASSERT_TRUE(parser.update(&fsm, code));
+  DiagramViewModel viewModel;
+  viewModel.setFSM(&fsm);
+
+  State *s0 = fsm.stateById("S0");
+  State *s1 = fsm.stateById("S1");
+  ASSERT_NE(s0, nullptr);
+  ASSERT_NE(s1, nullptr);
+  const QPointF start = s0->position();
+  viewModel.moveStates({s0, s1}, {QPointF(100, 50), QPointF(200, 50)});
+
+  // Drop S1 and the only reference to it
+  QString edited = code;
+  edited.remove(stateClass(1, 3));
+  edited.replace("return new S1State();", "return nullptr;");
+  ASSERT_TRUE(parser.update(&fsm, edited)) << parser.lastError().toStdString();
+  EXPECT_EQ(parser.removedStateCount(), 1);
+  QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+  ASSERT_EQ(fsm.stateById("S1"), nullptr);
+
+  ASSERT_TRUE(viewModel.canUndo());
+  viewModel.undo();
+  EXPECT_EQ(s0->position(), start);
+  viewModel.redo();
+  EXPECT_EQ(s0->position(), QPointF(100, 50));
+}
+
+// An unfinished function body between classes swallows the rest of the file
+// in a full parse; the incremental result has to agree
+TEST(IncrementalParserTest, UnclosedBraceMatchesFullParse) {
+  QString code = machine(4);
+  FSM fsm;
+  IncrementalParser parser;
+  ASSERT_TRUE(parser.update(&fsm, code));
+
+  QString edited = code;
+  const int split = int(edited.indexOf(stateClass(2, 4)));
+  ASSERT_GT(split, 0);
+  edited.insert(split, "\nvoid helper() {\n    int unused = 0;\n");
+  ASSERT_TRUE(parser.update(&fsm, edited)) << parser.lastError().toStdString();
+  EXPECT_EQ(describe(&fsm), describeFullParse(edited));
+  EXPECT_EQ(fsm.stateById("S3"), nullptr);
+
+  // Closing the body brings the later classes back
+  edited = QString(code).insert(split, "\nvoid helper() {}\n");
+  ASSERT_TRUE(parser.update(&fsm, edited)) << parser.lastError().toStdString();
+  EXPECT_EQ(describe(&fsm), describeFullParse(edited));
+  EXPECT_NE(fsm.stateById("S3"), nullptr);
+}
+
+TEST(IncrementalParserTest, ParseErrorLeavesModelUntouched) {
+  QString code = machine(3);
+  FSM fsm;
+  IncrementalParser parser;
+  ASSERT_TRUE(parser.update(&fsm, code));
+  QSet<QString> before = describe(&fsm);
+
+  QString broken = code;
+  broken.replace("class S1State : public MyFSMStateBase {",
+                 "class S1State : public {");
+
+  EXPECT_FALSE(parser.update(&fsm, broken));
+  EXPECT_FALSE(parser.lastError().isEmpty());
+  EXPECT_EQ(describe(&fsm), before);
+}
@@ -2,6 +2,7 @@
 #include "../src/model/State.h"
 #include "../src/model/Transition.h"
 #include "../src/serialization/JSONSerializer.h"
+#include <QBuffer>
 #include <QFile>
 #include <QTemporaryFile>
 #include <gtest/gtest.h>
@@ -102,3 +103,80 @@ TEST_F(JSONRoundtripTest, RoundtripAllFields) {
 
   delete loadedFsm;
 }
+
+// Strings that need escaping survive a roundtrip through a device
+TEST_F(JSONRoundtripTest, RoundtripEscapesThroughDevice) {
+  const QString name = QString::fromUtf8("Quote \" back\\slash\ttab\n"
+                                         "\x01 \xC3\xA9 \xF0\x9F\x98\x80");
+  State *s1 = new State("a", name, fsm);
+  s1->setPosition(QPointF(0.1, -1e-7));
+  fsm->addState(s1);
+
+  QBuffer buffer;
+  ASSERT_TRUE(buffer.open(QIODevice::ReadWrite));
+  JSONSerializer serializer;
+  ASSERT_TRUE(serializer.save(fsm, &buffer));
+
+  buffer.seek(0);
+  FSM *loadedFsm = serializer.load(&buffer);
+  ASSERT_NE(loadedFsm, nullptr) << serializer.lastError().toStdString();
+  ASSERT_EQ(loadedFsm->states().size(), 1);
+  EXPECT_EQ(loadedFsm->states()[0]->name(), name);
+  EXPECT_EQ(loadedFsm->states()[0]->position(), QPointF(0.1, -1e-7));
+  delete loadedFsm;
+}
+
+// Files written before states had IDs, with transitions listed first and
+// keys the loader does not know
+TEST_F(JSONRoundtripTest, LoadsLegacyNameReferences) {
+  QByteArray json = R"json({
+    "transitions": [
+      {"source": "Idle", "target": "Busy", "event": "go", "color": [1, {}]}
+    ],
+    "layout": {"zoom": 2, "grid": [true, null]},
+    "states": [
+      {"name": "Idle", "isInitial": true, "positionX": 5},
+      {"name": "Busy", "customFunctions": ["void run()"]}
+    ],
+    "name": "Legacy"
+  })json";
+  QBuffer buffer(&json);
+  ASSERT_TRUE(buffer.open(QIODevice::ReadOnly));
+
+  JSONSerializer serializer;
+  FSM *loadedFsm = serializer.load(&buffer);
+  ASSERT_NE(loadedFsm, nullptr) << serializer.lastError().toStdString();
+  EXPECT_EQ(loadedFsm->name(), "Legacy");
+  ASSERT_EQ(loadedFsm->states().size(), 2);
+  EXPECT_EQ(loadedFsm->states()[0]->id(), "Idle");
+  EXPECT_TRUE(loadedFsm->states()[0]->isInitial());
+  EXPECT_EQ(loadedFsm->states()[0]->position().x(), 5);
+  EXPECT_EQ(loadedFsm->states()[1]->customFunctions(),
+            QStringList{"void run()"});
+
+  ASSERT_EQ(loadedFsm->transitions().size(), 1);
+  Transition *transition = loadedFsm->transitions()[0];
+  EXPECT_FALSE(transition->id().isEmpty());
+  EXPECT_EQ(transition->sourceState(), loadedFsm->states()[0]);
+  EXPECT_EQ(transition->targetState(), loadedFsm->states()[1]);
+  EXPECT_EQ(transition->event(), "go");
+  delete loadedFsm;
+}
+
+TEST_F(JSONRoundtripTest, RejectsMalformedDocuments) {
+  const QList<QByteArray> documents = {
+      "",
+      "[]",
+      R"({"states": [{"name": "A"})",
+      R"({"states": [{"name": "A",}]})",
+      R"({"name": "unterminated})",
+      R"({"name": "A"} trailing)",
+  };
+  for (QByteArray json : documents) {
+    QBuffer buffer(&json);
+    ASSERT_TRUE(buffer.open(QIODevice::ReadOnly));
+    JSONSerializer serializer;
+    EXPECT_EQ(serializer.load(&buffer), nullptr) << json.toStdString();
+    EXPECT_FALSE(serializer.lastError().isEmpty()) << json.toStdString();
+  }
+}
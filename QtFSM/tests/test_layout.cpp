@@ -0,0 +1,354 @@
+#include "../src/layout/EdgeRouter.h"
+#include "../src/layout/ForceDirectedLayout.h"
+#include "../src/layout/LayeredLayout.h"
+#include "../src/layout/LayoutGraph.h"
+#include "../src/model/FSM.h"
+#include "../src/model/State.h"
+#include "../src/model/Transition.h"
+#include "../src/viewmodel/DiagramViewModel.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QLineF>
+#include <QMap>
+#include <QRandomGenerator>
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <limits>
+
+
+static qreal distance(const QPointF &a, const QPointF &b) {
+  return QLineF(a, b).length();
+}
+
+// Builds an FSM whose states all sit at the origin, as a naive import might
+static FSM *stackedChain(int count) {
+  FSM *fsm = new FSM();
+  for (int i = 0; i < count; ++i) {
+    fsm->addState(new State(QString("s%1").arg(i), QString("S%1").arg(i), fsm));
+  }
+  for (int i = 1; i < count; ++i) {
+    fsm->addTransition(new Transition(QString("t%1").arg(i),
+                                      fsm->states()[i - 1], fsm->states()[i],
+                                      fsm));
+  }
+  return fsm;
+}
+
+TEST(LayoutTest, CapturesPositionsAndEndpoints) {
+  FSM *fsm = stackedChain(3);
+  fsm->states()[2]->setPosition(QPointF(10, 20));
+
+  QList<State *> states;
+  const LayoutGraph graph = LayoutGraph::capture(fsm, &states);
+  EXPECT_EQ(states, fsm->states());
+  ASSERT_EQ(graph.positions.size(), 3);
+  EXPECT_EQ(graph.positions[2], QPointF(10, 20));
+  ASSERT_EQ(graph.edges.size(), 2);
+  EXPECT_EQ(graph.edges[1], qMakePair(1, 2));
+  delete fsm;
+}
+
+TEST(LayoutTest, SeparatesOverlappingStates) {
+  FSM *fsm = stackedChain(200);
+  const QVector<QPointF> positions =
+      ForceDirectedLayout::run(LayoutGraph::capture(fsm),
+                               ForceDirectedLayout::Options());
+
+  qreal closest = std::numeric_limits<qreal>::max();
+  for (int i = 0; i < positions.size(); ++i) {
+    for (int j = i + 1; j < positions.size(); ++j) {
+      closest = qMin(closest, distance(positions[i], positions[j]));
+    }
+  }
+  // States are 120 x 80; none may overlap
+  EXPECT_GT(closest, 150);
+  delete fsm;
+}
+
+// Connected states end up together, unconnected groups apart
+TEST(LayoutTest, KeepsConnectedStatesTogether) {
+  LayoutGraph graph;
+  for (int i = 0; i < 20; ++i) {
+    graph.positions.append(QPointF((i * 37) % 100, (i * 61) % 100));
+  }
+  for (int group = 0; group < 2; ++group) {
+    for (int i = 0; i < 10; ++i) {
+      for (int j = i + 1; j < 10; ++j) {
+        graph.edges.append(qMakePair(group * 10 + i, group * 10 + j));
+      }
+    }
+  }
+
+  const QVector<QPointF> positions =
+      ForceDirectedLayout::run(graph, ForceDirectedLayout::Options());
+  qreal within = 0, between = 0;
+  for (int i = 0; i < 20; ++i) {
+    for (int j = i + 1; j < 20; ++j) {
+      (i / 10 == j / 10 ? within : between) +=
+          distance(positions[i], positions[j]);
+    }
+  }
+  // 90 pairs inside the groups, 100 across
+  EXPECT_LT(within / 90, between / 100 / 2);
+}
+
+TEST(LayoutTest, LaysOutInBackground) {
+  FSM *fsm = stackedChain(50);
+  ForceDirectedLayout layout;
+  bool finished = false;
+  QObject::connect(&layout, &ForceDirectedLayout::finished,
+                   [&]() { finished = true; });
+
+  layout.start(fsm);
+  EXPECT_TRUE(layout.isRunning());
+  layout.waitForFinished();
+  EXPECT_FALSE(layout.isRunning());
+  EXPECT_TRUE(finished);
+  EXPECT_GT(distance(fsm->states()[0]->position(),
+                     fsm->states()[1]->position()),
+            50);
+
+  // A cancelled run leaves the states alone and does not report completion
+  const QPointF before = fsm->states()[0]->position();
+  finished = false;
+  layout.start(fsm);
+  layout.cancel();
+  EXPECT_FALSE(finished);
+  EXPECT_EQ(fsm->states()[0]->position(), before);
+  delete fsm;
+}
+
+static QVector<QPointF> positionsOf(const FSM *fsm) {
+  QVector<QPointF> positions;
+  for (const State *state : fsm->states()) {
+    positions.append(state->position());
+  }
+  return positions;
+}
+
+// Cancelling part-way puts the states back, so undo still restores the
+// layout from before the last completed run
+TEST(LayoutTest, CancelRestoresStartPositions) {
+  int argc = 0;
+  QCoreApplication app(argc, nullptr);
+  FSM *fsm = stackedChain(2000);
+  DiagramViewModel viewModel;
+  viewModel.setFSM(fsm);
+  ForceDirectedLayout layout;
+  // Recorded the way MainWindow does it
+  QObject::connect(&layout, &ForceDirectedLayout::finished,
+                   [&](const QList<State *> &states,
+                       const QVector<QPointF> &from) {
+                     QVector<QPointF> to;
+                     for (State *state : states) {
+                       to.append(state->position());
+                     }
+                     viewModel.moveStates(states, from, to);
+                   });
+
+  ForceDirectedLayout::Options options;
+  options.iterations = 10;
+  layout.setOptions(options);
+  layout.start(fsm);
+  layout.waitForFinished();
+  const QVector<QPointF> laidOut = positionsOf(fsm);
+  ASSERT_EQ(viewModel.undoStack()->count(), 1);
+
+  // Long enough to still be running once the first steps have been applied
+  options.iterations = 100000;
+  layout.setOptions(options);
+  layout.start(fsm);
+  QElapsedTimer timer;
+  timer.start();
+  while (positionsOf(fsm) == laidOut && timer.elapsed() < 10000) {
+    QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+  }
+  ASSERT_NE(positionsOf(fsm), laidOut);
+  ASSERT_TRUE(layout.isRunning());
+
+  layout.cancel();
+  EXPECT_EQ(positionsOf(fsm), laidOut);
+  EXPECT_EQ(viewModel.undoStack()->count(), 1);
+
+  viewModel.undo();
+  EXPECT_EQ(positionsOf(fsm), QVector<QPointF>(2000, QPointF()));
+  delete fsm;
+}
+
+// Every state sits below its predecessor, even with a loop back to the start
+TEST(LayoutTest, LayersFlowDownFromTheRoot) {
+  LayoutGraph graph;
+  graph.positions.fill(QPointF(), 5);
+  for (int i = 1; i < 5; ++i) {
+    graph.edges.append(qMakePair(i - 1, i));
+  }
+  graph.edges.append(qMakePair(4, 0)); // back to the start
+  graph.edges.append(qMakePair(2, 2)); // self-loop
+
+  const QVector<QPointF> positions =
+      LayeredLayout::run(graph, 0, LayeredLayout::Options());
+  ASSERT_EQ(positions.size(), 5);
+  EXPECT_EQ(positions[0].y(), 0);
+  for (int i = 1; i < 5; ++i) {
+    EXPECT_GT(positions[i].y(), positions[i - 1].y());
+  }
+}
+
+TEST(LayoutTest, SpreadsStatesWithinALayer) {
+  // 0 -> {1, 2} -> 3
+  LayoutGraph graph;
+  graph.positions.fill(QPointF(), 4);
+  graph.edges = {qMakePair(0, 1), qMakePair(0, 2), qMakePair(1, 3),
+                 qMakePair(2, 3)};
+
+  const LayeredLayout::Options options;
+  const QVector<QPointF> positions = LayeredLayout::run(graph, 0, options);
+  EXPECT_EQ(positions[1].y(), positions[2].y());
+  EXPECT_GE(qAbs(positions[1].x() - positions[2].x()), options.stateSpacing);
+  EXPECT_GT(positions[3].y(), positions[1].y());
+}
+
+TEST(LayoutTest, LaysOutLargeGraphsInLayers) {
+  LayoutGraph graph;
+  const int count = 5000;
+  graph.positions.fill(QPointF(), count);
+  QRandomGenerator random(7);
+  for (int i = 1; i < count; ++i) {
+    graph.edges.append(qMakePair(random.bounded(i), i));
+    graph.edges.append(qMakePair(i, random.bounded(count)));
+  }
+
+  const LayeredLayout::Options options;
+  const QVector<QPointF> positions = LayeredLayout::run(graph, 0, options);
+  ASSERT_EQ(positions.size(), count);
+
+  // No two states of a layer closer than the minimum spacing
+  QMap<qreal, QVector<qreal>> layers;
+  for (const QPointF &p : positions) {
+    layers[p.y()].append(p.x());
+  }
+  EXPECT_GT(layers.size(), 1);
+  for (QVector<qreal> &xs : layers) {
+    std::sort(xs.begin(), xs.end());
+    for (int i = 1; i < xs.size(); ++i) {
+      EXPECT_GE(xs[i] - xs[i - 1], options.stateSpacing - 1e-6);
+    }
+  }
+}
+
+// A layout moves all states with one notification instead of one per state
+TEST(LayoutTest, MovesStatesInOneBatch) {
+  FSM *fsm = stackedChain(10);
+  int batches = 0;
+  int movedCount = 0;
+  int positionSignals = 0;
+  QObject::connect(fsm, &FSM::statesMoved,
+                   [&](const QList<State *> &moved) {
+                     ++batches;
+                     movedCount = moved.size();
+                   });
+  for (State *state : fsm->states()) {
+    QObject::connect(state, &State::positionChanged,
+                     [&]() { ++positionSignals; });
+  }
+
+  QVector<QPointF> positions;
+  for (int i = 0; i < 10; ++i) {
+    // The first state stays where it is
+    positions.append(QPointF(0, i * 100));
+  }
+  fsm->moveStates(fsm->states(), positions);
+
+  EXPECT_EQ(batches, 1);
+  EXPECT_EQ(movedCount, 9);
+  EXPECT_EQ(positionSignals, 0);
+  EXPECT_EQ(fsm->states()[9]->position(), QPointF(0, 900));
+  delete fsm;
+}
+
+static QRectF stateRect(qreal x, qreal y) { return QRectF(x - 60, y - 40, 120, 80); }
+
+// True if the route enters the rectangle's interior
+static bool enters(const QVector<QPointF> &route, const QRectF &rect) {
+  for (int i = 1; i < route.size(); ++i) {
+    for (int step = 0; step <= 100; ++step) {
+      const QPointF p = route[i - 1] + (route[i] - route[i - 1]) * step / 100.0;
+      if (p.x() > rect.left() && p.x() < rect.right() && p.y() > rect.top() &&
+          p.y() < rect.bottom())
+        return true;
+    }
+  }
+  return false;
+}
+
+TEST(EdgeRouterTest, RoutesAroundStatesInTheWay) {
+  FSM *fsm = stackedChain(3);
+  State *a = fsm->states()[0];
+  State *b = fsm->states()[1];
+  State *blocker = fsm->states()[2];
+  Transition *t = new Transition("direct", a, b, fsm);
+
+  EdgeRouter router;
+  router.setStateRect(a, stateRect(0, 0));
+  router.setStateRect(b, stateRect(400, 0));
+  router.addEdge(t);
+
+  // Nothing in the way: a straight line from border to border
+  EXPECT_EQ(router.route(t),
+            QVector<QPointF>({QPointF(60, 0), QPointF(340, 0)}));
+
+  // A state dropped onto the line invalidates it
+  EXPECT_EQ(router.setStateRect(blocker, stateRect(200, 0)),
+            QList<Transition *>{t});
+  const QVector<QPointF> route = router.route(t);
+  ASSERT_GT(route.size(), 2);
+  EXPECT_FALSE(enters(route, stateRect(200, 0)));
+  EXPECT_TRUE(stateRect(0, 0).contains(route.first()));
+  EXPECT_TRUE(stateRect(400, 0).contains(route.last()));
+  for (int i = 1; i < route.size() - 1; ++i) {
+    // Orthogonal between the borders
+    EXPECT_TRUE(route[i].x() == route[i - 1].x() ||
+                route[i].y() == route[i - 1].y());
+  }
+
+  // Moving it away again straightens the route
+  EXPECT_EQ(router.setStateRect(blocker, stateRect(200, 1000)),
+            QList<Transition *>{t});
+  EXPECT_EQ(router.route(t).size(), 2);
+  delete fsm;
+}
+
+TEST(EdgeRouterTest, ReroutesOnlyAffectedTransitions) {
+  FSM *fsm = stackedChain(20);
+  EdgeRouter router;
+  for (int i = 0; i < 20; ++i) {
+    router.setStateRect(fsm->states()[i],
+                        stateRect((i % 5) * 300, (i / 5) * 300));
+  }
+  for (Transition *t : fsm->transitions()) {
+    router.addEdge(t);
+    router.route(t);
+  }
+  const int computed = router.computedRoutes();
+
+  // Memoized until something changes
+  for (Transition *t : fsm->transitions()) {
+    router.route(t);
+  }
+  EXPECT_EQ(router.computedRoutes(), computed);
+
+  // Moving s7 within its free space affects s6->s7 and s7->s8 only
+  State *moved = fsm->states()[7];
+  QList<Transition *> stale =
+      router.setStateRect(moved, stateRect(2 * 300 + 20, 300 + 20));
+  std::sort(stale.begin(), stale.end());
+  QList<Transition *> expected{fsm->transitions()[6], fsm->transitions()[7]};
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(stale, expected);
+  for (Transition *t : fsm->transitions()) {
+    EXPECT_EQ(router.hasRoute(t), !expected.contains(t));
+  }
+
+  EXPECT_EQ(router.statesIn(QRectF(500, 250, 200, 100)), QList<State *>{moved});
+  delete fsm;
+}
@@ -1,5 +1,7 @@
 #include "../src/parsing/Lexer.h"
+#include <QByteArray>
 #include <QString>
+#include <QStringList>
 #include <gtest/gtest.h>
 
 using namespace FSMParser;
@@ -43,13 +45,13 @@ public:
   for (const Token &token : tokens) {
     if (token.type == TokenType::EndOfFile)
       break;
-    if (token.value == "class")
+    if (token.value == u"class")
       hasClass = true;
-    if (token.value == "public")
+    if (token.value == u"public")
       hasPublic = true;
-    if (token.value == "if")
+    if (token.value == u"if")
       hasIf = true;
-    if (token.value == "return")
+    if (token.value == u"return")
       hasReturn = true;
   }
 
@@ -58,3 +60,133 @@ public:
   EXPECT_TRUE(hasIf) << "Should tokenize 'if' keyword";
   EXPECT_TRUE(hasReturn) << "Should tokenize 'return' keyword";
 }
+
+TEST(LexerTest, TokensViewIntoSourceAndResolveKeywords) {
+  QString source = "class Foo final : public static_cast_like { override };";
+  Lexer lexer(source);
+  QVector<Token> tokens = lexer.tokenize();
+
+  ASSERT_GE(tokens.size(), 10);
+
+  // Lexemes are views into the source buffer, not copies
+  EXPECT_EQ(tokens[1].value.data(), source.constData() + 6);
+  EXPECT_EQ(tokens[1].value.toString(), "Foo");
+
+  EXPECT_EQ(tokens[0].type, TokenType::Keyword_Class);
+  EXPECT_EQ(tokens[1].type, TokenType::Identifier);
+  EXPECT_EQ(tokens[2].type, TokenType::Keyword_Final);
+  EXPECT_EQ(tokens[3].type, TokenType::Colon);
+  EXPECT_EQ(tokens[4].type, TokenType::Keyword_Public);
+  // Prefix of a keyword must stay an identifier
+  EXPECT_EQ(tokens[5].type, TokenType::Identifier);
+  EXPECT_EQ(tokens[5].value.toString(), "static_cast_like");
+  EXPECT_EQ(tokens[7].type, TokenType::Keyword_Override);
+  EXPECT_EQ(tokens[7].value.toString(), "override");
+}
+
+TEST(LexerTest, SkipsCommentsAndResolvesLocationsLazily) {
+  // Runs of whitespace and comments longer than one SIMD block, plus a string
+  // literal with escapes that straddles a block boundary
+  QString source = "/* block comment spanning\n several lines ** / still */\n"
+                   "                                        \t\t  \r\n"
+                   "// line comment with \"quotes\" and * stars\n"
+                   "class A { return \"esc \\\" quote and \\\\ slash\"; }\n"
+                   "   /* trailing */ X";
+  Lexer lexer(source);
+  QVector<Token> tokens = lexer.tokenize();
+
+  ASSERT_GE(tokens.size(), 8);
+  EXPECT_EQ(tokens[0].type, TokenType::Keyword_Class);
+  EXPECT_EQ(tokens[1].value.toString(), "A");
+  EXPECT_EQ(tokens[3].type, TokenType::Keyword_Return);
+  EXPECT_EQ(tokens[4].type, TokenType::StringLiteral);
+  EXPECT_EQ(tokens[4].value.toString(),
+            "\"esc \\\" quote and \\\\ slash\"");
+  EXPECT_EQ(tokens[5].type, TokenType::Semicolon);
+  EXPECT_EQ(tokens[7].value.toString(), "X");
+
+  // Line numbers are only computed when asked for
+  SourceLocation classLoc = lexer.location(tokens[0].offset);
+  EXPECT_EQ(classLoc.line, 5);
+  EXPECT_EQ(classLoc.column, 1);
+  SourceLocation xLoc = lexer.location(tokens[7].offset);
+  EXPECT_EQ(xLoc.line, 6);
+  EXPECT_EQ(xLoc.column, 19);
+}
+
+TEST(LexerTest, LexesUtf8LikeUtf16) {
+  // Non-ASCII identifiers and strings, every operator, comments with braces
+  const QByteArray utf8 =
+      "class Zust\xC3\xA4ndeState : public Base { /* { */\n"
+      "  void f() { if (e.type == \"Gr\xC3\xBC\xC3\x9F {\\\"\") { return new X(); } }\n"
+      "  // }\n"
+      "  int n = 42; a->b; c::d <= >= != ! ~ - + & * , . ; @\n"
+      "};\n";
+  const QString utf16 = QString::fromUtf8(utf8);
+
+  Lexer wide(utf16);
+  QVector<Token> expected = wide.tokenize();
+  Lexer narrow = Lexer::fromUtf8(utf8);
+  QVector<Token> actual = narrow.tokenize();
+
+  ASSERT_EQ(actual.size(), expected.size());
+  for (int i = 0; i < actual.size(); ++i) {
+    EXPECT_EQ(actual[i].type, expected[i].type) << "token " << i;
+    EXPECT_EQ(actual[i].value, expected[i].value) << "token " << i;
+    EXPECT_EQ(actual[i].match, expected[i].match) << "token " << i;
+  }
+  EXPECT_EQ(actual[1].value.toString(),
+            QString::fromUtf8("Zust\xC3\xA4ndeState"));
+
+  // Offsets count bytes: the two-byte "ä" shifts everything after it
+  EXPECT_EQ(actual[2].offset, expected[2].offset + 1);
+  SourceLocation loc = narrow.location(actual[2].offset);
+  EXPECT_EQ(loc.line, 1);
+  EXPECT_EQ(loc.column, 22);
+
+  // Skipping a block honours the same comment and string rules
+  Lexer skipping = Lexer::fromUtf8(utf8);
+  while (skipping.nextToken().type != TokenType::LeftBrace) {
+  }
+  skipping.skipBalanced(1);
+  Token close = skipping.nextToken();
+  EXPECT_EQ(close.type, TokenType::RightBrace);
+  EXPECT_EQ(close.offset, utf8.lastIndexOf('}'));
+}
+
+TEST(LexerTest, ClassifiesNonAsciiLikeUtf16) {
+  // No-break space, curly quotes and an ellipsis are not identifier
+  // characters; letters (also outside the BMP) and digits after the first
+  // character are
+  const QByteArray utf8 = "Stop\xC2\xA0State \xE2\x80\x9Cx\xE2\x80\x9D "
+                          "caf\xC3\xA9_\xD9\xA3 \xD9\xA3n 7\xD9\xA3 "
+                          "\xF0\x9D\x91\xA5y a\xE2\x80\xA6"
+                          "b";
+  const QString utf16 = QString::fromUtf8(utf8);
+
+  Lexer wide(utf16);
+  QVector<Token> expected = wide.tokenize();
+  Lexer narrow = Lexer::fromUtf8(utf8);
+  QVector<Token> actual = narrow.tokenize();
+
+  ASSERT_EQ(actual.size(), expected.size());
+  for (int i = 0; i < actual.size(); ++i) {
+    EXPECT_EQ(actual[i].type, expected[i].type) << "token " << i;
+    EXPECT_EQ(actual[i].value, expected[i].value) << "token " << i;
+  }
+
+  QStringList identifiers;
+  int unknown = 0;
+  for (const Token &token : actual) {
+    if (token.type == TokenType::Identifier)
+      identifiers.append(token.value.toString());
+    else if (token.type == TokenType::Unknown)
+      ++unknown;
+  }
+  EXPECT_EQ(identifiers,
+            QStringList({"Stop", "State", "x",
+                         QString::fromUtf8("caf\xC3\xA9_\xD9\xA3"), "n",
+                         QString::fromUtf8("\xF0\x9D\x91\xA5y"), "a", "b"}));
+  // U+00A0, the quotes, the leading and trailing U+0663, the ellipsis
+  EXPECT_EQ(unknown, 6);
+}
@@ -1,11 +1,13 @@
 #include "../src/model/FSM.h"
 #include "../src/model/State.h"
 #include "../src/model/Transition.h"
+#include "../src/parsing/ASTArena.h"
 #include "../src/parsing/CodeParser.h"
 #include "../src/parsing/CppParser.h"
 #include "../src/parsing/Lexer.h"
 #include <QSet>
 #include <QString>
+#include <QTemporaryFile>
 #include <QVector>
 #include <gtest/gtest.h>
 
@@ -195,22 +197,22 @@ TEST(LexerTest, TokenizesDoubleColonOperator) {
   ASSERT_GE(tokens.size(), 9);
 
   EXPECT_EQ(tokens[0].type, TokenType::Identifier);
-  EXPECT_EQ(tokens[0].value, "std");
+  EXPECT_EQ(tokens[0].value.toString(), "std");
 
   EXPECT_EQ(tokens[1].type, TokenType::DoubleColon);
-  EXPECT_EQ(tokens[1].value, "::");
+  EXPECT_EQ(tokens[1].value.toString(), "::");
 
   EXPECT_EQ(tokens[2].type, TokenType::Identifier);
-  EXPECT_EQ(tokens[2].value, "string");
+  EXPECT_EQ(tokens[2].value.toString(), "string");
 
   EXPECT_EQ(tokens[3].type, TokenType::Identifier);
-  EXPECT_EQ(tokens[3].value, "ABC");
+  EXPECT_EQ(tokens[3].value.toString(), "ABC");
 
   EXPECT_EQ(tokens[4].type, TokenType::DoubleColon);
-  EXPECT_EQ(tokens[4].value, "::");
+  EXPECT_EQ(tokens[4].value.toString(), "::");
 
   EXPECT_EQ(tokens[5].type, TokenType::Identifier);
-  EXPECT_EQ(tokens[5].value, "func");
+  EXPECT_EQ(tokens[5].value.toString(), "func");
 }
 
 // Test for Qualified Function Names (ABC::func_name)
@@ -257,10 +259,251 @@ void MyNamespace::processEvent(const Event& e) {
   // The class should have methods
   EXPECT_GE(classes[0]->methods.size(), 1) << "Should have at least 1 method";
 
-  // Clean up
-  qDeleteAll(classes);
 }
 
+TEST(CppParserTest, StreamingParseMatchesTokenVector) {
+  using namespace FSMParser;
+
+  // Enough classes and member variables that the stream has to wrap its
+  // ring buffer and rewind after member-variable lookahead several times.
+  QString testCode;
+  for (int i = 0; i < 20; ++i) {
+    testCode += QString(R"(
+class S%1State : public MyFSMStateBase {
+public:
+    std::map<std::string, std::vector<int>>* m_cache%1;
+    MyFSMStateBase* handle(MyFSMContext* context, const Event& event) override {
+        if (event.type == "Go%1") {
+            return new S%2State();
+        }
+        return nullptr;
+    }
+    std::string getName() const override { return "S%1"; }
+};
+)")
+                    .arg(i)
+                    .arg((i + 1) % 20);
+  }
+
+  Lexer vectorLexer(testCode);
+  CppParser vectorParser(vectorLexer.tokenize());
+  QVector<ClassDecl *> expected = vectorParser.parse();
+
+  Lexer streamLexer(testCode);
+  CppParser streamParser(streamLexer);
+  QVector<ClassDecl *> actual = streamParser.parse();
+
+  EXPECT_FALSE(streamParser.hasError()) << streamParser.errorMessage().toStdString();
+  ASSERT_EQ(actual.size(), 20);
+  ASSERT_EQ(actual.size(), expected.size());
+  for (int i = 0; i < actual.size(); ++i) {
+    EXPECT_EQ(actual[i]->name, expected[i]->name);
+    EXPECT_EQ(actual[i]->baseClass, expected[i]->baseClass);
+    ASSERT_EQ(actual[i]->methods.size(), expected[i]->methods.size());
+    for (int m = 0; m < actual[i]->methods.size(); ++m) {
+      EXPECT_EQ(actual[i]->methods[m]->name, expected[i]->methods[m]->name);
+    }
+  }
+}
+
+TEST(CodeParserTest, RecordsPipelineStats) {
+  QString testCode;
+  for (int i = 0; i < 50; ++i) {
+    testCode += QString(R"(
+class S%1State : public MyFSMStateBase {
+public:
+    MyFSMStateBase* handle(MyFSMContext* context, const Event& event) override {
+        if (event.type == "Go") {
+            return new S%2State();
+        }
+        return nullptr;
+    }
+};
+)")
+                    .arg(i)
+                    .arg((i + 1) % 50);
+  }
+
+  CodeParser parser;
+  FSM *fsm = parser.parse(testCode);
+  ASSERT_NE(fsm, nullptr);
+
+  const ParseStats &stats = parser.stats();
+  EXPECT_GT(stats.tokens, 50 * 30);
+  EXPECT_GT(stats.astNodes, 50);
+  EXPECT_GT(stats.astBytes, 0);
+  EXPECT_EQ(stats.states, 50);
+  EXPECT_EQ(stats.transitions, 50);
+  EXPECT_GT(stats.nanoseconds[ParseStats::Lexing], 0);
+  EXPECT_GE(stats.nanoseconds[ParseStats::Parsing], 0);
+  EXPECT_GT(stats.nanoseconds[ParseStats::ModelBuilding], 0);
+  EXPECT_EQ(stats.nanoseconds[ParseStats::SceneRebuild], 0);
+  EXPECT_GE(stats.allocations[ParseStats::Lexing], 1);
+  EXPECT_GE(stats.allocations[ParseStats::Parsing], 1);
+  EXPECT_EQ(stats.allocations[ParseStats::ModelBuilding], 100);
+  EXPECT_TRUE(stats.report().contains("model building"));
+
+  delete fsm;
+
+  // Stats belong to the last call only
+  EXPECT_EQ(parser.parse(QString()), nullptr);
+  EXPECT_EQ(parser.stats().tokens, 0);
+}
+
+TEST(CodeParserTest, ParsesMappedUtf8File) {
+  const QByteArray code = "\xEF\xBB\xBF" // Byte order mark
+                          "// Zust\xC3\xA4nde: Idle -> Running\n"
+                          R"(
+class IdleState : public MyFSMStateBase {
+public:
+    MyFSMStateBase* handle(MyFSMContext* context, const Event& event) override {
+        if (event.type == "Start") {
+            return new RunningState();
+        }
+        return nullptr;
+    }
+};
+
+class RunningState : public MyFSMStateBase {
+public:
+    MyFSMStateBase* handle(MyFSMContext* context, const Event& event) override {
+        if (event.type == "Stop") {
+            return new IdleState();
+        }
+        return nullptr;
+    }
+};
+)";
+
+  QTemporaryFile file;
+  ASSERT_TRUE(file.open());
+  file.write(code);
+  file.flush();
+
+  CodeParser parser;
+  FSM *fsm = parser.parseFile(file.fileName());
+  ASSERT_NE(fsm, nullptr) << parser.lastError().toStdString();
+
+  // Same result as parsing the decoded text
+  FSM *expected = parser.parse(QString::fromUtf8(code.mid(3)));
+  ASSERT_NE(expected, nullptr);
+  EXPECT_EQ(fsm->states().size(), 2);
+  EXPECT_EQ(fsm->states().size(), expected->states().size());
+  EXPECT_EQ(fsm->transitions().size(), expected->transitions().size());
+  for (int i = 0; i < fsm->states().size(); ++i) {
+    EXPECT_EQ(fsm->states()[i]->name(), expected->states()[i]->name());
+  }
+  EXPECT_TRUE(fsm->states().first()->isInitial());
+
+  delete expected;
+  delete fsm;
+
+  EXPECT_EQ(parser.parseFile(file.fileName() + ".missing"), nullptr);
+  EXPECT_FALSE(parser.lastError().isEmpty());
+}
+
+TEST(CppParserTest, RejectsPathologicalNestingWithoutRecursing) {
+  using namespace FSMParser;
+
+  QString testCode = "class DeepState : public State { void handle() {";
+  for (int i = 0; i < 5000; ++i)
+    testCode += "if (event.type == \"E\") {";
+  for (int i = 0; i < 5000; ++i)
+    testCode += "}";
+  testCode += "} };";
+
+  Lexer lexer(testCode);
+  CppParser parser(lexer);
+  parser.parse();
+  EXPECT_TRUE(parser.hasError());
+  EXPECT_TRUE(parser.errorMessage().contains("nested too deeply"))
+      << parser.errorMessage().toStdString();
+}
+
+TEST(CppParserTest, SkipsIrrelevantBlocksByBraceIndex) {
+  using namespace FSMParser;
+
+  QString testCode = R"(
+class Helper {
+    void f() { if (x) { y(); } }
+    const char *s = "}}} class FakeState {";
+    // } stray brace in a comment
+    /* { another */
+};
+
+int compute(int v) {
+    class LocalState : public State { };
+    return v > 0 ? "{" : 0;
+}
+
+class RealState : public MyFSMStateBase {
+public:
+    MyFSMStateBase* handle(MyFSMContext* context, const Event& event) override {
+        if (event.type == "Go") {
+            return new RealState();
+        }
+        return nullptr;
+    }
+};
+)";
+
+  // tokenize() pairs braces in the same pass
+  Lexer indexLexer(testCode);
+  QVector<Token> tokens = indexLexer.tokenize();
+  for (int i = 0; i < tokens.size(); ++i) {
+    if (tokens[i].type == TokenType::LeftBrace) {
+      ASSERT_GT(tokens[i].match, 0);
+      EXPECT_EQ(tokens[i + tokens[i].match].type, TokenType::RightBrace);
+      EXPECT_EQ(tokens[i + tokens[i].match].match, -tokens[i].match);
+    }
+  }
+
+  CppParser vectorParser(tokens);
+  QVector<ClassDecl *> fromVector = vectorParser.parse();
+
+  Lexer streamLexer(testCode);
+  CppParser streamParser(streamLexer);
+  QVector<ClassDecl *> fromStream = streamParser.parse();
+
+  for (const QVector<ClassDecl *> &classes : {fromVector, fromStream}) {
+    ASSERT_EQ(classes.size(), 1);
+    EXPECT_EQ(classes[0]->name, "RealState");
+    ASSERT_EQ(classes[0]->methods.size(), 1);
+    EXPECT_EQ(classes[0]->methods[0]->name, "handle");
+  }
+  EXPECT_FALSE(streamParser.hasError()) << streamParser.errorMessage().toStdString();
+}
+
+namespace {
+struct CountedNode {
+  static int alive;
+  QString payload;
+  explicit CountedNode(const QString &p) : payload(p) { ++alive; }
+  ~CountedNode() { --alive; }
+};
+int CountedNode::alive = 0;
+} // namespace
+
+TEST(ASTArenaTest, ReleasesAllNodesAtOnce) {
+  FSMParser::ASTArena arena;
+
+  // Enough nodes to span several blocks
+  QVector<CountedNode *> nodes;
+  for (int i = 0; i < 5000; ++i) {
+    nodes.append(arena.create<CountedNode>(QString::number(i)));
+  }
+
+  EXPECT_EQ(CountedNode::alive, 5000);
+  EXPECT_GT(arena.blockCount(), 1);
+  EXPECT_EQ(nodes[4321]->payload, "4321");
+  EXPECT_EQ(reinterpret_cast<quintptr>(nodes[10]) % alignof(CountedNode), 0u);
+
+  arena.release();
+  EXPECT_EQ(CountedNode::alive, 0);
+  EXPECT_EQ(arena.blockCount(), 0);
+  EXPECT_EQ(arena.bytesUsed(), 0u);
+}
+
 TEST(CodeParserTest, ParsesSpecialKeywordCases) {
   QString testCode = R"(
 class MyFSMStateBase {
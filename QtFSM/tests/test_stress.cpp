@@ -1,4 +1,5 @@
 #include "../src/model/FSM.h"
+#include "../src/model/Transition.h"
 #include "../src/parsing/CodeParser.h"
 #include <QString>
 #include <gtest/gtest.h>
@@ -146,3 +147,41 @@ TEST(FSMParserStressTest, HandlesComplexCode) {
 
   delete fsm;
 }
+
+TEST(FSMParserStressTest, DeduplicatesManyTransitionsPerState) {
+  // One state with hundreds of events, each handled twice
+  QString code = R"(
+class HubState : public MyFSMStateBase {
+public:
+    MyFSMStateBase* handle(MyFSMContext* context, const Event& event) override {
+)";
+  for (int pass = 0; pass < 2; ++pass) {
+    for (int i = 0; i < 400; ++i) {
+      code += QString(R"(
+        if (event.type == "E%1") {
+            return new Leaf%2State();
+        })")
+                  .arg(i)
+                  .arg(i % 10);
+    }
+  }
+  code += R"(
+        return nullptr;
+    }
+};
+)";
+
+  CodeParser parser;
+  FSM *fsm = parser.parse(code);
+  ASSERT_NE(fsm, nullptr);
+
+  State *hub = fsm->stateById("Hub");
+  ASSERT_NE(hub, nullptr);
+  EXPECT_EQ(hub->transitions().size(), 400);
+  EXPECT_EQ(fsm->transitions().size(), 400);
+  EXPECT_EQ(fsm->states().size(), 11);
+  EXPECT_EQ(fsm->transitions().first()->event(), "E0");
+  EXPECT_EQ(fsm->transitions().last()->event(), "E399");
+
+  delete fsm;
+}